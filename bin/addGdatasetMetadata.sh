@@ -16,24 +16,6 @@ if [ ! -f "$INPUT_FILE" ]; then
     exit 1
 fi
 
-# Initialize a counter for processing documents
-COUNT=0
-
-# Read the input file line by line, using tab ('\t') as a delimiter
-# The first line (header) is skipped
-while IFS=$'\t' read -r filename title year authors; do
-    COUNT=$((COUNT + 1))
-
-    # Print document metadata being processed
-    echo "------------------------"
-    echo "Filename: $filename"
-    echo "Title: $title"
-    echo "Year: $year"
-    echo "Authors: $authors"
-
-    # Call the dclient program with extracted metadata
-    ./dclient -a "$title" "$authors" $year "$filename"
-
-done < <(tail -n +2 "$INPUT_FILE")
-
-echo -e "\nAdded metadata for $COUNT files."
\ No newline at end of file
+# Send the whole catalog in a single bulk request (the header line is skipped by dclient).
+# Rows that cannot be added are reported on stderr with their line number.
+./dclient -b "$INPUT_FILE"
@@ -0,0 +1,37 @@
+#ifndef CLIENT_CONN_H
+#define CLIENT_CONN_H
+
+#include "Document_Struct.h" // Para Request, Response, Document
+
+// --- Ligação do Cliente ao Servidor ---
+// Envia pedidos e recebe as respostas pelo transporte em que o servidor está a escutar:
+// - TRANSPORT_FIFO: o pedido segue pelo SERVER_PIPE e a resposta pelo FIFO deste cliente
+//   (CLIENT_PIPE_FORMAT), que o servidor abre pelo nome.
+// - TRANSPORT_UNIX: uma ligação bidirecional ao socket SERVER_SOCKET (SOCK_SEQPACKET), onde
+//   cada pedido e cada trama da resposta é uma mensagem.
+// Com TRANSPORT_AUTO, o transporte é escolhido no primeiro pedido: o socket, se o servidor
+// aceitar a ligação, senão os FIFOs.
+//
+// Uma ligação persistente (sessão) mantém os descritores abertos entre pedidos; as outras
+// abrem e fecham tudo em cada pedido. O lote de BULK_ADD, MULTI_QUERY, MULTI_COUNT,
+// MULTI_SEARCH e SEARCH_QUERY segue depois do pedido: pelo FIFO de lote com TRANSPORT_FIFO,
+// e pela própria ligação, em mensagens, com TRANSPORT_UNIX.
+
+/**
+ * @brief Estado da ligação de um cliente ao servidor.
+ */
+typedef struct {
+    int requested_transport;    // Transporte pedido (TRANSPORT_AUTO, TRANSPORT_FIFO ou TRANSPORT_UNIX).
+    int transport;              // Transporte em uso (TRANSPORT_AUTO antes do primeiro pedido).
+    int persistent;             // 1 em sessão: os descritores ficam abertos entre pedidos.
+    int session_open;           // 1 depois do primeiro pedido de uma sessão FIFO (SESSION_BEGIN já enviado).
+    int server_fd;              // FIFO do servidor aberto para escrita, ou o socket ligado (-1 se fechado).
+    int reply_fd;               // FIFO deste cliente aberto para leitura (-1 se fechado; não usado com socket).
+    char client_pipe[128];      // Nome do FIFO deste cliente (vazio enquanto não existir).
+} ClientConn;
+
+void client_conn_init(ClientConn* conn, int transport, int persistent);
+int client_conn_request(ClientConn* conn, Request* req, const void* batch, Response* resp);
+void client_conn_close(ClientConn* conn);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CLIENT_TABLE_H
+#define CLIENT_TABLE_H
+
+#include <stddef.h>     // Para size_t
+
+// --- Tabela de Clientes ---
+// Descritores pelos quais o servidor responde aos clientes, com a resposta que cada um ainda
+// tem por escrever. Pertence ao ciclo de eventos da thread principal (ver dserver.c): só essa
+// thread abre, escreve e fecha estes descritores, todos em modo não bloqueante, por isso a
+// tabela não tem mutex.
+//
+// Três tipos de cliente:
+// - CLIENT_FIFO_ONCE: um pedido sem sessão; o FIFO do cliente é aberto para esta resposta e
+//   fechado quando ela acaba de ser escrita.
+// - CLIENT_FIFO_SESSION: um cliente em sessão (dclient -i); o FIFO fica aberto entre pedidos,
+//   até um END_SESSION ou até o cliente fechar o seu lado.
+// - CLIENT_SOCKET: uma ligação ao SERVER_SOCKET (dserver -t unix), aberta até o cliente a fechar.
+//
+// Os clientes são procurados pelo PID (o que vem no pedido) numa tabela de dispersão; um PID
+// com várias entradas (ex: uma ligação antiga ainda por fechar) devolve a mais recente.
+// Uma resposta que deixa de avançar até ao seu prazo (o cliente não a lê) leva ao fecho do
+// cliente: nunca atrasa as respostas aos outros. Cada trama escrita renova o prazo, por isso
+// uma resposta grande a um cliente que a vai lendo nunca expira.
+//
+// As entradas retiradas só são libertadas em `client_table_reap`, para que um evento do
+// epoll já recebido para essa entrada não use memória libertada (fica com fd == -1).
+
+#define CLIENT_FIFO_ONCE 0
+#define CLIENT_FIFO_SESSION 1
+#define CLIENT_SOCKET 2
+
+/**
+ * @brief Descritor de resposta de um cliente e a resposta por escrever.
+ */
+typedef struct ClientSession {
+    int client_pid;             // PID do cliente (nome do seu FIFO, ou o processo ligado ao socket).
+    int fd;                     // FIFO do cliente aberto para escrita, ou o socket (-1 depois de retirado).
+    int kind;                   // CLIENT_FIFO_ONCE, CLIENT_FIFO_SESSION ou CLIENT_SOCKET.
+    int index;                  // Posição em `sessions` (para retirar em O(1)).
+    char* out;                  // Tramas por escrever (NULL se não há resposta pendente).
+    size_t out_len;             // Bytes em `out`.
+    size_t out_pos;             // Bytes de `out` já escritos (sempre no início de uma trama).
+    long long deadline_ms;      // Prazo para a próxima trama de `out` (relógio CLOCK_MONOTONIC, em ms).
+    int epoll_events;           // Eventos pedidos ao epoll para fd (gerido pelo ciclo de eventos).
+    int busy;                   // 1 enquanto tem um pedido à espera de resposta (ligação ao socket).
+    struct ClientSession* next_by_pid; // Cadeia da tabela de dispersão, ou da lista de retirados.
+} ClientSession;
+
+/**
+ * @brief Conjunto dos clientes com descritor aberto.
+ */
+typedef struct {
+    ClientSession** sessions;   // Todas as entradas (ordem arbitrária).
+    int count;                  // Número de entradas.
+    int capacity;               // Espaço alocado em `sessions`.
+    ClientSession** buckets;    // Tabela de dispersão PID -> entradas (a mais recente primeiro).
+    int num_buckets;            // Potência de 2.
+    int pending;                // Entradas com uma resposta por escrever.
+    ClientSession* retired;     // Entradas retiradas, a libertar em `client_table_reap`.
+} ClientTable;
+
+int client_table_init(ClientTable* table);
+void client_table_destroy(ClientTable* table);
+int client_pipe_open(int client_pid);
+ClientSession* client_table_add(ClientTable* table, int client_pid, int fd, int kind);
+ClientSession* client_table_find(const ClientTable* table, int client_pid);
+void client_table_remove(ClientTable* table, ClientSession* session);
+void client_table_reap(ClientTable* table);
+int client_session_queue(ClientTable* table, ClientSession* session, char* frames, size_t len, long long deadline_ms);
+int client_session_flush(ClientTable* table, ClientSession* session, long long deadline_ms);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef DOC_CACHE_H
+#define DOC_CACHE_H
+
+#include "Document_Struct.h" // Para Document
+
+// --- Cache de Metadados com Política de Substituição ---
+// Guarda até `capacity` documentos em memória. Todas as operações são O(1): as entradas são
+// ligadas por índices, sem deslocar nada a cada remoção. As entradas vivem numa arena de blocos
+// de CACHE_BLOCK_ENTRIES, alocados à medida que a cache enche: a memória acompanha o número de
+// documentos em cache (e não a capacidade pedida), e uma entrada nunca muda de endereço.
+// A tabela de documentos (Doc_Table.h) aponta para o `doc` da entrada; quando um documento
+// sai da cache, o chamador recebe o seu ID para limpar essa posição.
+//
+// Políticas (escolhidas no arranque do servidor, opção -p):
+// - LRU: lista duplamente ligada por ordem de uso; sai o documento usado há mais tempo.
+// - CLOCK: aproximação do LRU com um bit de referência por entrada; o ponteiro do relógio
+//   percorre as entradas, dá uma segunda oportunidade às referenciadas e retira a primeira
+//   que não o foi. Um acerto só liga um bit (não mexe em listas).
+//
+// Estatísticas: `hits` é contado por `doc_cache_touch`, `evictions` por `doc_cache_insert`;
+// `misses` é contado pelo chamador (só ele sabe quando uma consulta falhou).
+
+#define CACHE_POLICY_LRU 0
+#define CACHE_POLICY_CLOCK 1
+#define CACHE_BLOCK_ENTRIES 1024 // Entradas por bloco da arena (~0,5 MiB).
+
+/**
+ * @brief Entrada da cache.
+ */
+typedef struct {
+    Document doc;       // O documento (primeiro campo: um Document* da cache é também um CacheEntry*).
+    int in_use;         // 1 se a entrada guarda um documento.
+    int prev;           // LRU: entrada usada mais recentemente (-1 se for a cabeça).
+    int next;           // LRU: entrada usada menos recentemente (-1 se for a cauda); livre: próxima livre.
+    int referenced;     // CLOCK: bit de referência.
+    int index;          // Índice da entrada (posição na arena).
+} CacheEntry;
+
+/**
+ * @brief Cache de documentos.
+ */
+typedef struct {
+    CacheEntry** blocks; // Blocos da arena; a entrada i está em blocks[i / CACHE_BLOCK_ENTRIES].
+    int num_blocks;      // Blocos alocados.
+    int num_entries;     // Entradas já usadas alguma vez (0 .. num_entries-1); as seguintes ainda não existem.
+    int capacity;        // Número máximo de documentos.
+    int num_docs;        // Número de entradas em uso.
+    int policy;          // CACHE_POLICY_LRU ou CACHE_POLICY_CLOCK.
+    int lru_head;        // LRU: entrada usada mais recentemente (-1 se vazia).
+    int lru_tail;        // LRU: entrada usada há mais tempo (-1 se vazia).
+    int free_head;       // Primeira entrada livre (-1 se a cache estiver cheia).
+    int clock_hand;      // CLOCK: próxima entrada a examinar.
+    unsigned long hits;      // Consultas respondidas pela cache.
+    unsigned long misses;    // Consultas que tiveram de ler o disco.
+    unsigned long evictions; // Documentos retirados para dar lugar a outros.
+} DocCache;
+
+int doc_cache_init(DocCache* cache, int capacity, int policy);
+void doc_cache_free(DocCache* cache);
+Document* doc_cache_insert(DocCache* cache, const Document* doc, int* evicted_id);
+void doc_cache_touch(DocCache* cache, Document* doc);
+void doc_cache_remove(DocCache* cache, Document* doc);
+int doc_cache_parse_policy(const char* name);
+const char* doc_cache_policy_name(int policy);
+
+#endif
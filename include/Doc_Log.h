@@ -0,0 +1,74 @@
+#ifndef DOC_LOG_H
+#define DOC_LOG_H
+
+#include <stdint.h>     // Para uint32_t, int32_t
+#include <pthread.h>    // Para pthread_mutex_t
+#include "Document_Struct.h" // Para Document
+
+// --- Registo (log) Append-Only das Alterações à Base de Dados ---
+// Em vez de reescrever "database.bin" a cada alteração, ADD_DOC e DELETE_DOC acrescentam um
+// registo de tamanho fixo a "database.log": UPSERT (documento completo) ou DELETE (lápide).
+// O estado persistido é a fotografia (snapshot) "database.bin" mais o log, reaplicado por
+// ordem no arranque. A compactação escreve uma nova fotografia com os documentos vivos e
+// esvazia o log (ver `compact_store` em dserver.c).
+//
+// Cada registo leva um número mágico e uma soma de verificação: um registo incompleto no fim
+// do ficheiro (ex: o processo terminou a meio de um write) é detetado e descartado.
+//
+// Durabilidade (group commit): cada registo é escrito com `pwrite` antes de a alteração ser
+// aplicada em memória, por isso sobrevive à terminação do processo. Para sobreviver a uma
+// falha do sistema é preciso `fdatasync`, que é agrupado: é feito quando há `sync_batch`
+// registos por sincronizar (1 = a cada registo, antes de responder ao cliente) e, além
+// disso, periodicamente por quem chama `doc_log_sync` (a thread de sincronização do servidor).
+
+#define LOG_FILE "database.log"         // Ficheiro do log (ao lado de database.bin).
+#define LOG_RECORD_MAGIC 0x474F4C44     // "DLOG" em little-endian.
+
+#define LOG_UPSERT 1    // O documento passa a ter este conteúdo (inserção).
+#define LOG_DELETE 2    // O documento com doc.id foi removido (lápide).
+
+/**
+ * @brief Registo do log, tal como é escrito no disco.
+ */
+typedef struct {
+    uint32_t magic;     // LOG_RECORD_MAGIC.
+    int32_t op;         // LOG_UPSERT ou LOG_DELETE.
+    int32_t next_id;    // Valor de next_id depois da operação (repõe o contador no arranque).
+    uint32_t checksum;  // Soma de verificação dos campos op, next_id e doc.
+    Document doc;       // Documento (UPSERT) ou apenas doc.id (DELETE).
+} LogRecord;
+
+/**
+ * @brief Log aberto para leitura e escrita.
+ */
+typedef struct {
+    int fd;             // Descritor de LOG_FILE, ou -1 se fechado.
+    off_t size;         // Tamanho válido do log (bytes); os registos são acrescentados aqui.
+    int num_records;    // Número de registos no log (desde a última compactação).
+    int sync_batch;     // fdatasync automático a cada sync_batch registos (0 = só com doc_log_sync).
+    unsigned long written; // Registos escritos desde a abertura (protegido por sync_mutex).
+    unsigned long synced;  // Quantos desses já passaram por um fdatasync concluído (idem).
+    pthread_mutex_t sync_mutex;
+    pthread_mutex_t flush_mutex; // Serializa os fdatasync de `doc_log_sync`.
+} DocLog;
+
+/**
+ * @brief Função chamada para cada registo válido durante `doc_log_replay`.
+ *
+ * @param op LOG_UPSERT ou LOG_DELETE.
+ * @param doc O documento do registo.
+ * @param doc_offset Offset, no log, do campo `doc` do registo (para leituras com `pread`).
+ * @param next_id Valor de next_id gravado no registo.
+ * @param ctx Ponteiro passado a `doc_log_replay`.
+ */
+typedef void (*DocLogReplayFn)(int op, const Document* doc, off_t doc_offset, int next_id, void* ctx);
+
+int doc_log_open(DocLog* log, const char* path, int sync_batch);
+void doc_log_close(DocLog* log);
+int doc_log_replay(DocLog* log, DocLogReplayFn fn, void* ctx);
+off_t doc_log_append(DocLog* log, int op, const Document* doc, int next_id);
+int doc_log_append_batch(DocLog* log, const Document* docs, int n, int next_id, off_t* doc_offsets);
+int doc_log_reset(DocLog* log);
+int doc_log_sync(DocLog* log);
+
+#endif
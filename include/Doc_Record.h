@@ -0,0 +1,82 @@
+#ifndef DOC_RECORD_H
+#define DOC_RECORD_H
+
+#include <stdint.h>     // Para uint8_t, uint32_t, int32_t, int64_t
+#include "Document_Struct.h" // Para Document
+
+// --- Formato Compacto da Fotografia "database.bin" (versão 3) ---
+// A versão 1 (sem cabeçalho) guardava next_id, o número de documentos e cada Document tal
+// como está em memória (473 bytes, quase todos de enchimento). A versão 3 guarda:
+//
+//   DbHeader | registo | registo | ... | dicionário de autores | índices de metadados
+//
+// Cada registo tem tamanho variável (tipicamente dezenas de bytes):
+//   u16 tamanho total do registo | u8 flags | varint id | ano | str título | varint autor | str caminho
+// - str: u8 com o número de bytes, seguido dos bytes (sem '\0'); os campos do Document
+//   cabem todos (até 200 bytes).
+// - ano: varint com o valor, se o texto for um número decimal canónico (ex: "1865"), com a
+//   flag DOC_RECORD_YEAR_NUMERIC; senão, str (o texto tal como foi dado).
+// - autor: posição no dicionário de autores, guardado uma vez no fim do ficheiro (cada nome
+//   distinto aparece uma só vez, ex: "Unknown"). É lido para memória no arranque.
+// - varint: inteiro sem sinal em grupos de 7 bits (LEB128).
+//
+// A tabela de documentos guarda o offset de cada registo, por isso uma leitura do disco
+// continua a ser um único `pread` (de até DOC_RECORD_MAX bytes). O log ("database.log")
+// mantém registos de tamanho fixo: é esvaziado em cada compactação.
+//
+// Os índices de metadados (autor, ano e título; formato em Meta_Index.h) são gravados no fim
+// e lidos no arranque, para não terem de ser reconstruídos a partir de todos os registos.
+// `meta_offset` 0 indica que não foram gravados.
+//
+// Migração: um "database.bin" sem o número mágico é da versão 1; é lido como antes e
+// reescrito na versão atual logo no arranque (ver `migrate_store` em dserver.c). A versão 2
+// é igual à 3, sem `meta_offset` no cabeçalho (32 bytes) e sem índices de metadados: é lida
+// tal como está (os índices são construídos no arranque) e reescrita na próxima compactação.
+
+#define DB_MAGIC 0x32424444         // "DDB2" em little-endian.
+#define DB_VERSION 3                // Versão atual do formato.
+#define DB_VERSION_COMPACT_V2 2     // Formato compacto sem índices de metadados.
+#define DB_HEADER_V2_SIZE 32        // Tamanho do cabeçalho da versão 2 (DbHeader sem meta_offset).
+#define DB_VERSION_LEGACY 1         // Formato antigo (sem cabeçalho, Document de tamanho fixo).
+#define DOC_RECORD_MAX 512          // Tamanho máximo de um registo (bytes).
+#define DOC_RECORD_YEAR_NUMERIC 1   // Flag: o ano está guardado como número.
+
+/**
+ * @brief Cabeçalho da fotografia, no início do ficheiro.
+ */
+typedef struct {
+    uint32_t magic;             // DB_MAGIC.
+    uint32_t version;           // DB_VERSION.
+    int32_t next_id;            // Próximo ID a atribuir.
+    int32_t count;              // Número de registos.
+    int64_t dict_offset;        // Offset do dicionário de autores (a seguir ao último registo).
+    uint32_t dict_count;        // Número de nomes no dicionário.
+    uint32_t reserved;          // 0 (alinhamento; para versões futuras).
+    int64_t meta_offset;        // Offset dos índices de metadados (a seguir ao dicionário), ou 0.
+} DbHeader;
+
+/**
+ * @brief Dicionário de autores: cada nome distinto uma vez, num único bloco de memória.
+ */
+typedef struct {
+    char* heap;                 // Nomes seguidos, cada um terminado em '\0'.
+    size_t heap_len;
+    size_t heap_capacity;
+    uint32_t* offsets;          // Posição de cada nome em heap.
+    uint32_t count;
+    uint32_t capacity;
+    int32_t* slots;             // Tabela de dispersão nome -> posição (-1: livre); só para `author_dict_intern`.
+    uint32_t num_slots;         // Potência de 2, ou 0 se ainda não foi criada.
+} AuthorDict;
+
+void author_dict_init(AuthorDict* dict);
+void author_dict_free(AuthorDict* dict);
+int64_t author_dict_intern(AuthorDict* dict, const char* name, size_t len);
+const char* author_dict_get(const AuthorDict* dict, uint32_t index);
+int author_dict_write(const AuthorDict* dict, int fd);
+int author_dict_read(AuthorDict* dict, int fd, off_t offset, uint32_t count);
+
+int doc_record_encode(const Document* doc, uint32_t author_index, unsigned char* buf);
+int doc_record_decode(const unsigned char* buf, size_t len, const AuthorDict* dict, Document* out);
+
+#endif
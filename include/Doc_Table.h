@@ -0,0 +1,38 @@
+#ifndef DOC_TABLE_H
+#define DOC_TABLE_H
+
+#include "Document_Struct.h" // Para Document
+
+// --- Tabela de Documentos Indexada por ID ---
+// Os IDs são atribuídos de forma crescente a partir de `next_id`, por isso um array denso
+// indexado diretamente pelo ID dá acesso O(1) sem precisar de hashing.
+// Cada posição indica onde o documento está: na cache (ponteiro) e/ou no disco (offset na
+// fotografia "database.bin" ou no log "database.log"), o que transforma uma leitura do disco
+// num único `pread`. O caminho do ficheiro de cada documento fica também em memória, para que
+// as pesquisas (que só precisam dele) não leiam um registo do disco por documento.
+
+/**
+ * @brief Localização de um documento.
+ */
+typedef struct {
+    Document* cached;   // Documento na cache, ou NULL se não estiver em memória.
+    off_t disk_offset;  // Offset do documento no disco, ou -1 se o documento não existir.
+    int in_log;         // 1 se disk_offset se refere a "database.log", 0 se a "database.bin".
+    char* path;         // Caminho do ficheiro do documento (cópia), ou NULL se não existe ou faltou memória.
+} DocSlot;
+
+/**
+ * @brief Array de DocSlot indexado pelo ID do documento; cresce conforme necessário.
+ */
+typedef struct {
+    DocSlot* slots;     // slots[id] descreve o documento com esse ID.
+    int capacity;       // Número de posições alocadas (IDs válidos: 0 .. capacity-1).
+} DocTable;
+
+int doc_table_init(DocTable* table, int initial_capacity);
+void doc_table_free(DocTable* table);
+DocSlot* doc_table_slot(DocTable* table, int id);
+DocSlot* doc_table_slot_create(DocTable* table, int id);
+void doc_table_set_path(DocSlot* slot, const char* path);
+
+#endif
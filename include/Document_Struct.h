@@ -24,8 +24,7 @@
 #define MAX_YEAR_SIZE 5         // Tamanho máximo para o ano de publicação (4 caracteres + terminador nulo '\0').
 #define MAX_PATH_SIZE 64        // Tamanho máximo para o caminho relativo do ficheiro do documento (bytes).
 #define MAX_KEYWORD_SIZE 64     // Tamanho máximo para uma palavra-chave de pesquisa (bytes).
-#define MAX_DOCS 1500           // Número máximo de documentos que podem ser geridos (na cache e/ou no disco).
-#define MAX_RESULT_IDS 1500     // Número máximo de IDs de documentos retornados numa operação de pesquisa.
+#define MAX_QUERY_SIZE 1024     // Tamanho máximo do texto de uma consulta SEARCH_QUERY (bytes, com o '\0').
 #define MAX_ARGS_TOTAL_SIZE 512 // Tamanho total máximo combinado dos argumentos para a operação de adicionar documento (-a).
 
 // --- Códigos de Operação Cliente-Servidor ---
@@ -38,6 +37,37 @@
 #define COUNT_LINES 4   // Operação para contar o número de linhas num documento que contêm uma palavra-chave.
 #define SEARCH_DOCS 5   // Operação para procurar todos os documentos que contêm uma palavra-chave.
 #define SHUTDOWN 6      // Operação para instruir o servidor a encerrar (com persistência dos dados).
+#define END_SESSION 7   // Operação para terminar a sessão do cliente (o servidor fecha o FIFO dele; sem resposta).
+#define BULK_ADD 8      // Operação para adicionar um lote de documentos (enviados depois do pedido, ver BATCH_PIPE_FORMAT).
+#define STATS 9         // Operação para obter as métricas do servidor (ver ServerStats).
+#define MULTI_QUERY 10  // QUERY_DOC de um lote de IDs (enviados depois do pedido), numa só resposta.
+#define MULTI_COUNT 11  // COUNT_LINES de um lote de pares (ID, palavra-chave) (ver CountItem), numa só resposta.
+#define MULTI_SEARCH 12 // Contagens de várias palavras-chave (enviadas depois do pedido) em todos os documentos, numa só passagem.
+#define SEARCH_QUERY 13 // SEARCH_DOCS com uma consulta booleana/de frase (texto enviado depois do pedido; ver Search_Query.h).
+#define RANKED_SEARCH 14 // SEARCH_DOCS com os `top_k` documentos mais relevantes (BM25; ver Ranking.h).
+#define META_SEARCH 15  // Documentos por autor, intervalo de anos ou título (índices de metadados; ver Meta_Index.h).
+
+#define NUM_OPERATIONS 16 // Códigos de operação possíveis (0 a META_SEARCH), para tabelas indexadas pela operação.
+#define MULTI_MAX_ITEMS (1 << 20) // Número máximo de elementos de um lote MULTI_QUERY/MULTI_COUNT.
+#define BULK_MAX_DOCS (1 << 20)   // Número máximo de documentos de um BULK_ADD.
+#define MULTI_SEARCH_MAX_KEYWORDS 256 // Número máximo de palavras-chave de um MULTI_SEARCH.
+
+// --- Campos de META_SEARCH ---
+// Usados no campo `meta_field` da estrutura `Request`.
+
+#define META_AUTHOR 0       // Documentos de um autor (`doc.authors`, um só autor).
+#define META_YEAR 1         // Documentos com o ano entre `year_from` e `year_to` (inclusive).
+#define META_TITLE 2        // Documentos cujo título contém `doc.title`.
+#define META_TITLE_PREFIX 3 // Documentos cujo título começa por `doc.title`.
+
+// --- Modos de Sessão ---
+// Usados no campo `session` da estrutura `Request`. Em sessão, o cliente mantém o FIFO do
+// servidor e o seu FIFO de resposta abertos entre pedidos, e o servidor mantém aberto o
+// descritor de escrita para o FIFO do cliente (ver Client_Table.h).
+
+#define SESSION_NONE 0      // Pedido isolado: o servidor abre e fecha o FIFO do cliente.
+#define SESSION_BEGIN 1     // Primeiro pedido de uma sessão: o servidor abre e guarda o FIFO do cliente.
+#define SESSION_ACTIVE 2    // Pedido seguinte de uma sessão: o servidor reutiliza o FIFO já aberto.
 
 /**
  * @brief Estrutura para representar a metainformação de um documento.
@@ -66,18 +96,68 @@ typedef struct {
                                         // DELETE_DOC (para enviar o ID na `doc.id`),
                                         // COUNT_LINES (para enviar o ID na `doc.id`).
     char keyword[MAX_KEYWORD_SIZE];     // Palavra-chave para operações de pesquisa de conteúdo.
-                                        // Usada em COUNT_LINES e SEARCH_DOCS.
+                                        // Usada em COUNT_LINES, SEARCH_DOCS e RANKED_SEARCH.
     int client_pid;                     // PID (Process ID) do processo cliente.
                                         // Essencial para o servidor saber para qual pipe de cliente deve enviar a resposta.
-    int nr_processes;                   // Número de processos a serem usados na pesquisa concorrente (SEARCH_DOCS).
+    int nr_processes;                   // SEARCH_DOCS, MULTI_SEARCH, SEARCH_QUERY, RANKED_SEARCH: pesquisa paralela (no pool de threads do servidor) se > 1.
                                         // Se não especificado ou <= 1, a pesquisa é sequencial.
+    int session;                        // Modo de sessão (SESSION_NONE, SESSION_BEGIN ou SESSION_ACTIVE).
+    int batch_size;                     // Número de elementos do lote (BULK_ADD, MULTI_QUERY, MULTI_COUNT, MULTI_SEARCH)
+                                        // ou de bytes da consulta (SEARCH_QUERY, sem o '\0').
+    int top_k;                          // RANKED_SEARCH: número máximo de documentos devolvidos (> 0).
+    int meta_field;                     // META_SEARCH: campo pesquisado (META_AUTHOR, META_YEAR, ...).
+    int year_from;                      // META_SEARCH com META_YEAR: intervalo de anos [year_from, year_to].
+    int year_to;
+    int batch_fd;                       // Preenchido pelo servidor (o valor do cliente é ignorado): cópia da ligação
+                                        // de onde se lê o lote, com o socket, ou -1 (FIFO de lote).
 } Request;
 
 /**
- * @brief Estrutura para a mensagem de resposta enviada do servidor para o cliente.
+ * @brief Elemento de um lote MULTI_COUNT: contar as linhas do documento `id` com `keyword`.
+ */
+typedef struct {
+    int id;
+    char keyword[MAX_KEYWORD_SIZE];
+} CountItem;
+
+/**
+ * @brief Contagem e latências de uma operação (ver ServerStats).
  *
- * Contém o resultado da operação solicitada, incluindo um código de estado
- * e quaisquer dados relevantes (como metainformação de um documento ou IDs encontrados).
+ * As latências são as do servidor (desde que uma trabalhadora retira o pedido da fila até a
+ * resposta estar pronta), em microssegundos; os percentis são aproximados por excesso
+ * (histograma com erro relativo até 12,5%).
+ */
+typedef struct {
+    unsigned long count;                // Pedidos processados.
+    unsigned long errors;               // Pedidos com estado diferente de 0.
+    unsigned long p50_us;
+    unsigned long p95_us;
+    unsigned long p99_us;
+    unsigned long max_us;
+} OperationStats;
+
+/**
+ * @brief Métricas do servidor desde o arranque (resposta a STATS).
+ */
+typedef struct {
+    OperationStats ops[NUM_OPERATIONS]; // Indexado pelo código da operação (ADD_DOC, ...).
+    unsigned long cache_hits;           // Cache de documentos (QUERY_DOC, COUNT_LINES).
+    unsigned long cache_misses;
+    unsigned long cache_evictions;
+    unsigned long result_hits;          // Cache de resultados (SEARCH_DOCS e COUNT_LINES).
+    unsigned long result_misses;
+    unsigned long result_evictions;
+    unsigned long bytes_scanned;        // Bytes dos ficheiros pesquisados (COUNT_LINES, SEARCH_DOCS).
+    int queue_depth;                    // Pedidos à espera de uma trabalhadora (fila e backlog).
+    int num_documents;
+    int index_pending;                  // Documentos de BULK_ADD à espera da indexação em segundo plano.
+    long uptime_ms;
+} ServerStats;
+
+/**
+ * @brief Resultado de uma operação, tal como o servidor o produz e o cliente o reconstrói.
+ *
+ * Não é enviada tal como está: no pipe segue como uma ou mais tramas (ver ResponseHeader).
  */
 typedef struct {
     int status;                         // Código de estado da operação:
@@ -88,12 +168,70 @@ typedef struct {
                                         // Na resposta a ADD_DOC, `doc.id` contém o ID do novo documento.
     int count;                          // Resultado da contagem de linhas.
                                         // Preenchido na resposta a uma operação COUNT_LINES bem-sucedida.
-    int ids[MAX_RESULT_IDS];            // Array de IDs dos documentos encontrados numa pesquisa.
-                                        // Preenchido na resposta a uma operação SEARCH_DOCS.
-    int num_ids;                        // Número de IDs válidos presentes no array `ids`.
-                                        // Usado em conjunto com `ids` na resposta a SEARCH_DOCS.
+    int* ids;                           // IDs dos documentos encontrados numa pesquisa (SEARCH_DOCS), alocados
+                                        // com malloc (ou NULL); quem recebe a resposta liberta-os.
+    int num_ids;                        // Número de IDs em `ids` (sem limite).
+    Document* docs;                     // Documentos de um MULTI_QUERY, pela ordem dos IDs pedidos (id 0 se
+                                        // não existir), ou de um META_SEARCH, alocados com malloc (ou NULL);
+                                        // quem recebe liberta-os.
+    int num_docs;                       // Número de documentos em `docs`.
+    ServerStats stats;                  // Métricas (resposta a STATS).
 } Response;
 
+// --- Protocolo de Resposta (Tramas) ---
+// O servidor responde com uma sequência de tramas, cada uma escrita com um único `write`:
+// um ResponseHeader seguido de `payload_len` bytes. Uma trama nunca excede PIPE_BUF, por
+// isso cada escrita no FIFO do cliente é atómica e uma resposta pequena é uma só escrita.
+// - ADD_DOC: `value` é o ID atribuído; sem dados.
+// - QUERY_DOC: com sucesso, os dados são o Document.
+// - COUNT_LINES: `value` é o número de linhas; sem dados.
+// - SEARCH_DOCS: os IDs seguem em blocos de até SEARCH_IDS_PER_FRAME inteiros, um por trama;
+//   todas menos a última têm RESPONSE_MORE em `flags`. Não há limite para o número de IDs.
+// - DELETE_DOC, SHUTDOWN e erros: apenas o cabeçalho.
+// - BULK_ADD: como SEARCH_DOCS, uma lista de inteiros em blocos: o primeiro ID reservado, o
+//   número de documentos adicionados e, por cada documento rejeitado, o par (posição no lote,
+//   a contar de 1; código de erro). O documento na posição i recebe o ID primeiro + i - 1.
+//   `status` é -2 se o lote tiver mais de BULK_MAX_DOCS documentos ou os IDs se esgotarem.
+// - STATS: os dados são o ServerStats.
+// - MULTI_QUERY: os Document seguem em blocos de até QUERY_DOCS_PER_FRAME, um por trama (como
+//   em SEARCH_DOCS, com RESPONSE_MORE), um por ID pedido e pela mesma ordem; um documento
+//   inexistente segue com id 0.
+// - MULTI_COUNT: como SEARCH_DOCS, uma lista de inteiros em blocos: a contagem de cada par, pela
+//   ordem do lote (-1 se o documento não existir ou não puder ser lido).
+// - MULTI_SEARCH: como SEARCH_DOCS, uma lista de inteiros em blocos: para cada palavra-chave,
+//   pela ordem do lote, o número n de documentos que a contêm seguido de n pares (ID, número de
+//   linhas), por ordem de ID.
+// - SEARCH_QUERY: como SEARCH_DOCS (IDs por ordem crescente); `status` é -2 se a consulta for
+//   inválida.
+// - RANKED_SEARCH: como SEARCH_DOCS, uma lista de inteiros em blocos: até `top_k` pares (ID,
+//   pontuação em milésimas), do documento mais relevante para o menos; `status` é -2 se
+//   `top_k` <= 0.
+// - META_SEARCH: como MULTI_QUERY, os Document encontrados em blocos: por ordem de ID (META_AUTHOR,
+//   META_TITLE, META_TITLE_PREFIX) ou de ano e ID (META_YEAR); `status` é -2 se o campo for
+//   desconhecido, o texto estiver vazio ou `year_from` > `year_to`.
+// - Pedidos com lote: `status` é -6 se o lote chegou incompleto (os elementos em falta seguem
+//   como inexistentes, ou sem documentos; SEARCH_QUERY segue sem resultados).
+// - END_SESSION: nenhuma resposta.
+
+#define RESPONSE_MAX_FRAME PIPE_BUF     // Tamanho máximo de uma trama (cabeçalho + dados), em bytes.
+#define RESPONSE_MORE 1                 // Flag: seguem-se mais tramas da mesma resposta.
+
+/**
+ * @brief Cabeçalho de cada trama de resposta.
+ */
+typedef struct {
+    int operation;                      // Operação do pedido a que a trama responde.
+    int status;                         // Código de estado (como em Response).
+    int value;                          // ID atribuído (ADD_DOC), contagem (COUNT_LINES) ou número de IDs
+                                        // (SEARCH_DOCS, BULK_ADD, MULTI_COUNT, MULTI_SEARCH, SEARCH_QUERY,
+                                        // RANKED_SEARCH) ou de documentos (MULTI_QUERY, META_SEARCH) na trama.
+    int flags;                          // RESPONSE_MORE se a resposta continua na trama seguinte.
+    int payload_len;                    // Número de bytes de dados que se seguem ao cabeçalho.
+} ResponseHeader;
+
+#define SEARCH_IDS_PER_FRAME ((int)((RESPONSE_MAX_FRAME - sizeof(ResponseHeader)) / sizeof(int)))
+#define QUERY_DOCS_PER_FRAME ((int)((RESPONSE_MAX_FRAME - sizeof(ResponseHeader)) / sizeof(Document)))
+
 // --- Nomes dos Pipes Nomeados (FIFOs) para Comunicação ---
 // Pipes nomeados (FIFOs) são o mecanismo de comunicação entre processos (IPC)
 // escolhido para este sistema. Permitem que o cliente e o servidor, que são
@@ -116,9 +254,46 @@ typedef struct {
  * O nome deste FIFO é geralmente construído usando o PID (Process ID) do cliente
  * para garantir a sua unicidade. O servidor usa este nome (construído com o
  * `client_pid` recebido no `Request`) para abrir o pipe do cliente específico
- * em modo de escrita e enviar a estrutura `Response`.
+ * em modo de escrita e enviar as tramas da resposta.
  * Exemplo: /tmp/client_pipe_so_12345 (onde 12345 é o PID do cliente).
  */
 #define CLIENT_PIPE_FORMAT "/tmp/client_pipe_so_%d"
 
+/**
+ * @brief Formato para os nomes dos FIFOs de lote (BULK_ADD, MULTI_QUERY, MULTI_COUNT, MULTI_SEARCH, SEARCH_QUERY).
+ *
+ * O cliente cria este FIFO antes de enviar o pedido e escreve nele os `batch_size` elementos
+ * do lote: estruturas `Document`, sem ID (BULK_ADD), IDs `int` (MULTI_QUERY), estruturas
+ * `CountItem` (MULTI_COUNT), palavras-chave `char[MAX_KEYWORD_SIZE]` (MULTI_SEARCH) ou os bytes
+ * do texto da consulta (SEARCH_QUERY); o servidor lê-os pela ordem em que chegam.
+ * Um FIFO por cliente evita que o lote se misture com os pedidos dos outros clientes no
+ * SERVER_PIPE (só as escritas até PIPE_BUF são atómicas). Só é usado com TRANSPORT_FIFO.
+ */
+#define BATCH_PIPE_FORMAT "/tmp/client_batch_so_%d"
+
+/**
+ * @brief Tamanho máximo de cada mensagem do lote com o socket (TRANSPORT_UNIX).
+ *
+ * Com o socket, o lote segue pela própria ligação, logo depois do pedido: os mesmos bytes que
+ * iriam para o FIFO de lote, cortados em mensagens de até BATCH_MESSAGE_SIZE bytes (um corte
+ * pode cair a meio de um elemento). A última mensagem acaba no fim do lote, para que o pedido
+ * seguinte chegue sempre numa mensagem própria.
+ */
+#define BATCH_MESSAGE_SIZE 65536
+
+/**
+ * @brief Caminho do socket Unix do servidor (transporte alternativo aos FIFOs).
+ *
+ * Com `dserver -t unix`, o servidor escuta neste socket (SOCK_SEQPACKET) em vez de no
+ * SERVER_PIPE. Cada cliente tem a sua ligação: envia cada `Request` como uma mensagem e
+ * recebe cada trama da resposta como uma mensagem, pela mesma ligação, sem FIFO próprio. O lote
+ * de um pedido segue também por ela (ver BATCH_MESSAGE_SIZE).
+ */
+#define SERVER_SOCKET "/tmp/server_socket_so"
+
+// Transportes entre cliente e servidor.
+#define TRANSPORT_AUTO 0    // Cliente: o socket, se o servidor estiver a escutar nele; senão os FIFOs.
+#define TRANSPORT_FIFO 1    // SERVER_PIPE e um FIFO de resposta por cliente.
+#define TRANSPORT_UNIX 2    // Uma ligação por cliente ao SERVER_SOCKET.
+
 #endif
\ No newline at end of file
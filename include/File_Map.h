@@ -0,0 +1,78 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stddef.h>     // Para size_t
+#include <pthread.h>    // Para pthread_mutex_t
+#include <sys/types.h>  // Para dev_t, ino_t
+#include <time.h>       // Para struct timespec
+
+// --- Cache de Mapeamentos (mmap) dos Ficheiros dos Documentos ---
+// COUNT_LINES e SEARCH_DOCS leem os ficheiros dos documentos. Em vez de os copiar com `read`
+// para um buffer, o ficheiro é mapeado com `mmap` e pesquisado no próprio page cache.
+// Os mapeamentos ficam abertos entre pedidos (até `capacity` ficheiros e `max_bytes` bytes
+// mapeados; sai o usado há mais tempo), para que os documentos pesquisados com frequência
+// não tenham de ser mapeados de novo.
+//
+// Atualidade: cada utilização faz um `stat` ao ficheiro; se o dispositivo, o inode, o tamanho
+// ou a data de modificação mudaram, o mapeamento antigo é descartado e o ficheiro é mapeado
+// de novo. Um mapeamento em uso por outra thread só é desfeito quando ela o liberta.
+//
+// Ficheiros truncados durante uma pesquisa: aceder a uma página para lá do novo fim do
+// ficheiro gera SIGBUS. `file_map_scan` apanha esse sinal (apenas na thread que está a
+// pesquisar), descarta o mapeamento e devolve FILE_MAP_UNAVAILABLE, para o chamador
+// repetir a leitura com `read`.
+//
+// Processos criados com fork não devem usar a cache herdada (o mutex pode ter ficado
+// adquirido por uma thread que não existe no filho).
+
+#define FILE_MAP_DEFAULT_ENTRIES 128              // Número máximo de ficheiros mapeados.
+#define FILE_MAP_DEFAULT_BYTES (256L * 1024 * 1024) // Total máximo de bytes mapeados.
+#define FILE_MAP_UNAVAILABLE (-2)                 // O ficheiro não pôde ser pesquisado por mmap.
+
+/**
+ * @brief Ficheiro mapeado em memória.
+ */
+typedef struct {
+    char* path;             // Caminho usado como chave (cópia).
+    const char* data;       // Conteúdo mapeado (NULL se o ficheiro estiver vazio).
+    size_t size;            // Tamanho do ficheiro quando foi mapeado.
+    dev_t dev;              // Identificação do ficheiro mapeado (dispositivo e inode) ...
+    ino_t ino;
+    struct timespec mtime;  // ... e a sua data de modificação.
+    int refs;               // Pesquisas a decorrer sobre este mapeamento.
+    int detached;           // 1 se já saiu da cache (desfeito quando refs chegar a 0).
+    unsigned long last_use; // Instante lógico da última utilização (escolha de quem sai).
+} FileMapping;
+
+/**
+ * @brief Conjunto limitado de mapeamentos, partilhado pelas threads (protegido por `mutex`).
+ */
+typedef struct {
+    FileMapping** entries;  // Mapeamentos na cache.
+    int capacity;           // Número máximo de mapeamentos.
+    int count;              // Número de mapeamentos na cache.
+    size_t max_bytes;       // Total máximo de bytes mapeados.
+    size_t mapped_bytes;    // Bytes mapeados (inclui mapeamentos em uso que já saíram da cache).
+    unsigned long tick;     // Relógio lógico para last_use.
+    unsigned long hits;     // Utilizações de um mapeamento existente.
+    unsigned long misses;   // Ficheiros mapeados pela primeira vez.
+    unsigned long remaps;   // Mapeamentos descartados porque o ficheiro mudou.
+    pthread_mutex_t mutex;
+} FileMapCache;
+
+/**
+ * @brief Função que pesquisa o conteúdo mapeado de um ficheiro.
+ *
+ * @param data Conteúdo do ficheiro.
+ * @param size Tamanho em bytes.
+ * @param nul_terminated 1 se o byte data[size] existe e vale '\0' (fim de página parcial).
+ * @param ctx Ponteiro passado a `file_map_scan`.
+ * @return O resultado da pesquisa (devolvido por `file_map_scan`).
+ */
+typedef long (*FileMapScanFn)(const char* data, size_t size, int nul_terminated, void* ctx);
+
+int file_map_cache_init(FileMapCache* cache, int capacity, size_t max_bytes);
+void file_map_cache_destroy(FileMapCache* cache);
+long file_map_scan(FileMapCache* cache, const char* path, FileMapScanFn fn, void* ctx);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef INVERTED_INDEX_H
+#define INVERTED_INDEX_H
+
+#include <stdint.h>     // Para int64_t, uint32_t
+#include <stddef.h>     // Para size_t
+#include "Document_Struct.h" // Para MAX_KEYWORD_SIZE
+
+// --- Índice Invertido (termo -> IDs de documentos) ---
+// Permite responder a SEARCH_DOCS sem reler o conteúdo de todos os documentos.
+//
+// Tokenização: um termo é uma sequência maximal de bytes "de palavra", isto é,
+// [A-Za-z0-9_] ou bytes >= 0x80 (para não partir caracteres UTF-8). O índice distingue
+// maiúsculas de minúsculas, tal como o grep.
+//
+// Semântica preservada: a pesquisa do grep é por substring, por isso "whale" também encontra
+// "whales". Se a palavra-chave for composta apenas por bytes de palavra, qualquer ocorrência
+// está contida num único termo; basta então unir as listas de todos os termos do vocabulário
+// que contêm a palavra-chave como substring (o vocabulário é muito menor do que o corpus).
+//
+// Os termos que contêm a palavra-chave não são procurados percorrendo o vocabulário: cada
+// trigrama (3 bytes seguidos) de um termo tem a lista dos números dos termos onde aparece, e
+// basta confirmar com memmem os termos da lista mais curta entre os trigramas da palavra-chave.
+// Só palavras-chave com menos de 3 bytes percorrem o vocabulário todo. A tabela só existe no
+// índice onde se pesquisa (`index_enable_term_grams`).
+//
+// Atualidade: as listas refletem o conteúdo de cada ficheiro no momento em que foi indexado.
+// Quem pesquisa confirma com `index_document_is_current` (um `stat`) que o ficheiro de cada
+// candidato (documento das listas) não mudou desde então e, se mudou, lê o ficheiro em vez de
+// confiar nas listas desse documento. Os restantes documentos indexados (`index_has_document`)
+// são dados como não contendo a palavra-chave sem `stat`: o custo de uma pesquisa cresce com
+// os candidatos e não com a coleção. Um ficheiro alterado fora do servidor que passe a conter
+// a palavra-chave só é encontrado depois de reindexado (no próximo arranque).
+//
+// Recurso (fallback): palavras-chave vazias, com espaços, pontuação ou metacaracteres de
+// expressões regulares (ex: "New York", "whale.", "Th.*ng") não podem ser respondidas pelo
+// índice; `index_can_answer` devolve 0 e o servidor percorre os ficheiros como antes. Para
+// as literais (ex: "New York"), `index_search_words` ainda dá os candidatos: os documentos com
+// todas as suas palavras.
+//
+// Ordenação (RANKED_SEARCH): cada lista guarda também a frequência do termo em cada documento
+// e cada documento o seu comprimento em termos, que dão as estatísticas do BM25 (Ranking.h)
+// sem reler os ficheiros.
+
+#define INDEX_FILE "index.bin"  // Ficheiro de persistência do índice (ao lado de database.bin).
+#define INDEX_MAGIC 0x58444949  // "IIDX" em little-endian.
+#define INDEX_VERSION 2        // 2: frequências e comprimentos dos documentos.
+
+/**
+ * @brief Lista de documentos (ordenada por ID) onde um termo ocorre.
+ */
+typedef struct {
+    char* term;         // Termo (terminado em '\0'); NULL se a posição da tabela estiver livre.
+    int term_len;       // Comprimento do termo em bytes.
+    int* doc_ids;       // IDs dos documentos, por ordem crescente e sem repetições.
+    int* tfs;           // Ocorrências do termo em cada documento (paralelo a doc_ids).
+    int num_docs;       // Número de IDs válidos em doc_ids.
+    int capacity;       // Capacidade alocada de doc_ids.
+    int term_id;        // Número do termo (ordem de inserção; ver InvertedIndex.terms).
+} Posting;
+
+/**
+ * @brief Termos que contêm um trigrama (ver `index_term_frequencies`).
+ */
+typedef struct {
+    uint32_t gram;      // Os 3 bytes do trigrama; 0 se a posição da tabela estiver livre.
+    int* term_ids;      // Números dos termos que o contêm, por ordem crescente e sem repetições.
+    int num_terms;      // Número de termos em term_ids.
+    int capacity;       // Capacidade alocada de term_ids.
+} GramList;
+
+/**
+ * @brief Documento indexado e estado do ficheiro no momento da indexação.
+ *
+ * Permite detetar, no arranque, ficheiros alterados desde a última indexação. A lista de termos
+ * permite remover o documento só das listas onde aparece.
+ */
+typedef struct {
+    int id;             // ID do documento.
+    int64_t mtime;      // Data de modificação do ficheiro (segundos).
+    int64_t size;       // Tamanho do ficheiro (bytes).
+    int64_t length;     // Número de termos (ocorrências) do documento.
+    unsigned char* term_ids; // Números dos termos distintos, por ordem crescente, em diferenças varint.
+    int term_ids_size;  // Bytes em term_ids.
+    int num_terms;      // Número de termos distintos do documento.
+} IndexedDoc;
+
+/**
+ * @brief Índice invertido em memória: tabela de hash (endereçamento aberto) de termos.
+ */
+typedef struct {
+    Posting* table;         // Tabela de termos (sondagem linear).
+    int capacity;           // Número de posições da tabela (potência de 2).
+    int num_terms;          // Número de posições ocupadas.
+    char** terms;           // Termos por número (Posting.term_id); um termo nunca sai da tabela.
+    int terms_capacity;     // Capacidade alocada de terms.
+    GramList* grams;        // Tabela de trigramas dos termos (sondagem linear).
+    int grams_capacity;     // Número de posições da tabela de trigramas (potência de 2).
+    int num_grams;          // Número de posições ocupadas.
+    IndexedDoc* docs;       // Documentos indexados, por ordem crescente de ID.
+    int num_docs;           // Número de documentos indexados.
+    int docs_capacity;      // Capacidade alocada de docs.
+    int64_t total_length;   // Soma dos comprimentos dos documentos indexados.
+    int max_doc_id;         // Maior ID alguma vez indexado (dimensiona a união de resultados).
+    int modified;           // Flag: houve alterações desde a última gravação.
+} InvertedIndex;
+
+int index_init(InvertedIndex* idx);
+void index_free(InvertedIndex* idx);
+int index_enable_term_grams(InvertedIndex* idx);
+int index_add_file(InvertedIndex* idx, int doc_id, const char* full_path);
+void index_remove_document(InvertedIndex* idx, int doc_id);
+int index_merge(InvertedIndex* dst, const InvertedIndex* src, int id_offset);
+int index_document_is_current(const InvertedIndex* idx, int doc_id, const char* full_path);
+int index_has_document(const InvertedIndex* idx, int doc_id);
+void index_retain_documents(InvertedIndex* idx, const int* live_ids, int num_live);
+int index_can_answer(const char* keyword);
+int index_search(const InvertedIndex* idx, const char* keyword, int* result_ids, int max_results);
+int index_term_frequencies(const InvertedIndex* idx, const char* keyword, int* result_ids, int* result_tfs,
+                           int max_results);
+int64_t index_document_length(const InvertedIndex* idx, int doc_id);
+int index_file_term_frequencies(const char* full_path, const char* const* words, int num_words, long* tfs,
+                                int64_t* length);
+int index_text_words(const char* text, char (*words)[MAX_KEYWORD_SIZE], int max_words);
+int index_search_words(const InvertedIndex* idx, const char* text, int* result_ids, int max_results);
+int index_save(const InvertedIndex* idx, const char* path);
+int index_load(InvertedIndex* idx, const char* path);
+
+#endif
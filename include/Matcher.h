@@ -0,0 +1,57 @@
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <stddef.h>     // Para size_t
+#include <regex.h>      // Para regex_t, regcomp, regexec (padrões com metacaracteres BRE)
+
+// --- Matcher de Palavras-Chave em Processo ---
+// Substitui o pipeline `grep keyword ficheiro | wc -l` (dois forks, dois pipes e dois exec
+// por documento) por uma pesquisa feita dentro do próprio servidor.
+//
+// Semântica: igual à do `grep` sem opções, isto é, a palavra-chave é uma expressão regular
+// básica (BRE) e o resultado é o número de linhas que contêm pelo menos uma ocorrência.
+// - Palavras-chave sem metacaracteres BRE (\ . [ * ^ $) são tratadas como texto literal e
+//   procuradas sobre blocos do ficheiro (caminho rápido) por um de três núcleos equivalentes:
+//   `memmem` (escalar), SSE2 ou AVX2. Os vetoriais comparam 16/32 posições de uma vez com o
+//   primeiro e o último byte da palavra-chave e só confirmam os candidatos com `memcmp`;
+//   depois de uma ocorrência saltam para a linha seguinte com a máscara de '\n' do próprio
+//   bloco. `matcher_init` escolhe o melhor núcleo suportado pelo processador (CPUID).
+// - As restantes são compiladas uma vez com `regcomp` e avaliadas com `regexec` sobre blocos
+//   do ficheiro. São interpretadas no locale do processo (LC_CTYPE), tal como no grep: quem usa
+//   o Matcher deve chamar `setlocale(LC_ALL, "")` no arranque, senão '.' e as listas passam a
+//   corresponder a bytes (locale "C") em vez de caracteres multibyte.
+//   O ganho vem de evitar os forks; para expressões complexas o motor de regex da libc pode
+//   ser mais lento do que o do grep num ficheiro grande (ver `make bench`).
+// - Palavras-chave com '\n' (que o grep interpreta como vários padrões) ou que não compilam
+//   não são suportadas: `matcher_init` devolve -1 e o chamador deve recorrer a
+//   `matcher_count_lines_exec`, que mantém o comportamento original.
+
+#define MATCHER_READ_CHUNK (64 * 1024) // Tamanho do bloco de leitura do ficheiro (bytes).
+
+// Núcleos de pesquisa literal (campo `kernel` do Matcher).
+#define MATCHER_KERNEL_SCALAR 0 // memmem + memchr.
+#define MATCHER_KERNEL_SSE2 1   // 16 posições por iteração (x86-64).
+#define MATCHER_KERNEL_AVX2 2   // 32 posições por iteração (x86-64 com AVX2).
+
+/**
+ * @brief Palavra-chave pré-processada, pronta a ser usada em várias pesquisas.
+ */
+typedef struct {
+    const char* keyword;    // Palavra-chave original (não copiada; deve viver tanto quanto o Matcher).
+    size_t keyword_len;     // Comprimento da palavra-chave em bytes.
+    int is_literal;         // 1 se a palavra-chave não tem metacaracteres (caminho literal).
+    int kernel;             // Núcleo da pesquisa literal (MATCHER_KERNEL_*); pode ser alterado depois de matcher_init.
+    regex_t regex;          // Expressão compilada (apenas se is_literal == 0).
+} Matcher;
+
+int matcher_init(Matcher* m, const char* keyword);
+void matcher_destroy(Matcher* m);
+long matcher_count_lines_buffer(const Matcher* m, const char* buf, size_t len, int stop_at_first);
+long matcher_count_lines_fd(const Matcher* m, int fd, int stop_at_first);
+long matcher_count_lines_file(const Matcher* m, const char* path, int stop_at_first);
+long matcher_count_lines_exec(const char* path, const char* keyword);
+int matcher_best_kernel(void);
+int matcher_kernel_supported(int kernel);
+const char* matcher_kernel_name(int kernel);
+
+#endif
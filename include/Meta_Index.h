@@ -0,0 +1,94 @@
+#ifndef META_INDEX_H
+#define META_INDEX_H
+
+#include <stdint.h>     // Para int32_t
+#include <sys/types.h>  // Para off_t
+#include "Document_Struct.h" // Para Document
+
+// --- Índices Secundários de Metadados (META_SEARCH) ---
+// Os documentos só podem ser consultados pelo ID; estes índices respondem, sem percorrer
+// todos os documentos, a "documentos de um autor", "documentos de um intervalo de anos" e
+// "documentos cujo título contém / começa por um texto".
+//
+// Normalização: autores, títulos e textos pesquisados passam a minúsculas (ASCII), os espaços
+// em branco seguidos ficam um só espaço e os das pontas desaparecem. "Mark  TWAIN " e
+// "mark twain" são o mesmo autor.
+//
+// - Autor: tabela de dispersão (endereçamento aberto) autor normalizado -> IDs ordenados. O
+//   campo `authors` pode ter vários autores separados por ';' (ex: "Charles Dickens;Wilkie
+//   Collins"): o documento fica na lista de cada um. A pesquisa é por igualdade.
+// - Ano: array de pares (ano, ID) por ordem crescente; um intervalo são duas procuras binárias
+//   e os documentos seguem por ano (e ID). Anos que não são números (ex: "s/d") não entram.
+// - Título: tabela de dispersão trigrama -> IDs ordenados, sobre o título normalizado com uma
+//   marca de início (META_TITLE_START) e uma de fim, por isso um título com um só carácter
+//   também tem um trigrama. Um texto com 3 ou mais bytes dá a interseção das listas dos seus
+//   trigramas (candidatos, a confirmar com `meta_title_matches`: os trigramas podem estar em
+//   posições diferentes); com 1 ou 2 bytes, a união das listas dos trigramas que o contêm
+//   (exata). "Começa por" é o mesmo que conter a marca de início seguida do texto.
+//
+// Os índices são atualizados em cada ADD/DELETE e gravados numa secção de "database.bin" a
+// seguir ao dicionário de autores (ver Doc_Record.h), reconstruída em cada compactação.
+// Formato da secção (inteiros em formato nativo):
+//   int32 n_autores,   n_autores x { u8 comprimento, bytes, int32 n, n x int32 id }
+//   int32 n_trigramas, n_trigramas x { 3 bytes, int32 n, n x int32 id }
+//   int32 n_anos,      n_anos x { int32 ano, int32 id }
+
+#define META_TITLE_START '\x02' // Marca de início do título (nos trigramas).
+#define META_TITLE_END '\x03'   // Marca de fim do título.
+
+/**
+ * @brief Chave de uma tabela de dispersão e a lista de documentos onde aparece.
+ */
+typedef struct {
+    char* key;          // Chave (terminada em '\0'); NULL se a posição estiver livre.
+    int* ids;           // IDs por ordem crescente, sem repetições.
+    int num_ids;
+    int capacity;
+} MetaPosting;
+
+/**
+ * @brief Tabela de dispersão chave -> IDs (sondagem linear).
+ */
+typedef struct {
+    MetaPosting* slots;
+    int capacity;       // Potência de 2.
+    int count;          // Posições ocupadas.
+} MetaTable;
+
+/**
+ * @brief Entrada do índice de anos.
+ */
+typedef struct {
+    int32_t year;
+    int32_t id;
+} YearEntry;
+
+/**
+ * @brief Os três índices de metadados.
+ */
+typedef struct {
+    MetaTable authors;  // Autor normalizado -> IDs.
+    MetaTable trigrams; // Trigrama do título normalizado -> IDs.
+    YearEntry* years;   // Por ordem crescente de (ano, ID).
+    int num_years;
+    int years_capacity;
+} MetaIndex;
+
+int meta_index_init(MetaIndex* mi);
+void meta_index_free(MetaIndex* mi);
+int meta_index_add(MetaIndex* mi, const Document* doc);
+void meta_index_remove(MetaIndex* mi, const Document* doc);
+
+size_t meta_normalize(const char* text, size_t max, char* out, size_t out_size);
+int meta_year_value(const char* year);
+int meta_author_matches(const char* authors, const char* author);
+int meta_title_matches(const char* title, const char* text, int prefix);
+
+int meta_index_by_author(const MetaIndex* mi, const char* author, int** ids);
+int meta_index_by_year(const MetaIndex* mi, int from, int to, int** ids);
+int meta_index_by_title(const MetaIndex* mi, const char* text, int prefix, int** ids, int* exact);
+
+int meta_index_write(const MetaIndex* mi, int fd);
+int meta_index_read(MetaIndex* mi, int fd, off_t offset);
+
+#endif
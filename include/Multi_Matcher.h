@@ -0,0 +1,89 @@
+#ifndef MULTI_MATCHER_H
+#define MULTI_MATCHER_H
+
+#include <stddef.h>     // Para size_t
+#include <stdint.h>     // Para int32_t
+#include "Matcher.h"    // Para Matcher (palavras-chave com metacaracteres)
+
+// --- Pesquisa de Várias Palavras-Chave numa Só Passagem ---
+// Um Matcher procura uma palavra-chave; com K palavras-chave o ficheiro seria percorrido K
+// vezes. O MultiMatcher conta, para cada palavra-chave, as linhas que a contêm (mesma
+// semântica que o Matcher e o `grep`), percorrendo o conteúdo uma única vez.
+//
+// - As palavras-chave literais (sem metacaracteres BRE, não vazias) formam um autómato de
+//   Aho-Corasick: um estado por prefixo, com as transições de falha já resolvidas numa tabela
+//   (DFA). Cada byte custa uma consulta à tabela, qualquer que seja K; uma ocorrência percorre
+//   os estados terminais ligados pelo sufixo (palavras-chave contidas noutras).
+//   A tabela usa classes de bytes: cada byte que aparece nas palavras-chave tem a sua coluna e
+//   todos os outros partilham a coluna 0 (que volta sempre à raiz), por isso tem
+//   (estados × classes) posições em vez de (estados × 256).
+//   Na raiz, salta-se sem consultar a tabela até uma posição onde os dois bytes seguintes
+//   sejam o início de alguma palavra-chave (mapa de bits de 8 KiB com todos os pares): ao
+//   contrário do autómato, cada teste não depende do anterior, e em texto corrido poucas
+//   posições passam o filtro. Com AVX2, um filtro ao estilo Teddy testa 32 posições de uma vez:
+//   as palavras-chave são repartidas por 8 grupos e, para cada nibble dos dois primeiros bytes,
+//   uma tabela de 16 entradas (`vpshufb`) diz que grupos o aceitam; só as posições aceites por
+//   algum grupo nos quatro nibbles passam ao mapa de pares.
+// - Cada palavra-chave conta uma vez por linha: guarda-se o início da última linha onde foi
+//   contada. O início da linha de uma ocorrência só é procurado (memrchr) quando há uma
+//   ocorrência, e cada byte é examinado no máximo uma vez.
+// - As restantes (expressões regulares, ou a palavra-chave vazia) têm o seu próprio Matcher e
+//   continuam a custar uma passagem cada.
+// - Com menos de MULTI_MATCHER_AUTOMATON_MIN_KEYWORDS literais distintas, também estas usam o
+//   seu Matcher: os kernels SIMD do Matcher (Matcher.h) percorrem vários GB/s, e até esse número
+//   de passagens sai mais barato do que uma passagem pelo autómato (medido com
+//   `bench_multi_matcher`).
+// - Palavras-chave que o Matcher não suporta (ver Matcher.h) ficam de fora: a contagem devolvida
+//   é -1 e o chamador deve recorrer a `matcher_count_lines_exec`.
+// - Palavras-chave repetidas são procuradas uma vez e recebem a mesma contagem.
+//
+// A tabela tem no máximo (soma dos comprimentos + 1) × 256 posições: o número de palavras-chave
+// de um MultiMatcher está limitado a MULTI_MATCHER_MAX_KEYWORDS (quem tem mais divide-as).
+
+#define MULTI_MATCHER_MAX_KEYWORDS 256 // Palavras-chave por MultiMatcher (tabela até ~16 MiB).
+#define MULTI_MATCHER_FILTER_MAX_KEYWORDS 8 // Acima disto o filtro dos pares deixa passar quase tudo.
+#define MULTI_MATCHER_LANES 4              // Troços percorridos em simultâneo (ver `count_literals`).
+#define MULTI_MATCHER_LANE_MIN_BYTES 4096  // Blocos mais pequenos são percorridos de uma vez.
+#define MULTI_MATCHER_AUTOMATON_MIN_KEYWORDS 16 // Abaixo disto as literais usam o seu Matcher (ver acima).
+
+#define MULTI_MATCHER_LITERAL 0     // Procurada pelo autómato.
+#define MULTI_MATCHER_SINGLE 1      // Procurada pelo seu Matcher (passagem própria).
+#define MULTI_MATCHER_UNSUPPORTED 2 // Não suportada em processo (contagem -1).
+#define MULTI_MATCHER_DUPLICATE 3   // Igual a uma anterior (ver `alias`).
+
+/**
+ * @brief Conjunto de palavras-chave pré-processado, pronto a ser usado em várias pesquisas.
+ *
+ * Só é lido durante as pesquisas: pode ser partilhado por várias threads.
+ */
+typedef struct {
+    int num_keywords;
+    const char* const* keywords; // Palavras-chave originais (não copiadas; devem viver tanto quanto o MultiMatcher).
+    unsigned char* kind;        // MULTI_MATCHER_* de cada palavra-chave.
+    int* alias;                 // Primeira palavra-chave igual (a própria, se não for repetida).
+    Matcher* matchers;          // Matcher de cada palavra-chave MULTI_MATCHER_SINGLE.
+    int num_literals;           // Palavras-chave distintas no autómato.
+    int num_single;             // Palavras-chave distintas com Matcher próprio.
+    int needs_nul;              // Alguma é uma expressão regular (ver `multi_matcher_needs_nul`).
+
+    // Autómato (apenas se num_literals > 0).
+    unsigned char byte_class[256]; // Coluna de cada byte na tabela (0: não aparece nas palavras-chave).
+    unsigned char pair_starts[8192]; // Bit (b0 << 8 | b1): alguma palavra-chave começa pelos bytes b0 b1.
+    unsigned char nibble_masks[4][16]; // Grupos (bits) que aceitam cada nibble baixo/alto de b0 e de b1.
+    int kernel;                 // MATCHER_KERNEL_AVX2 para filtrar os pares com AVX2; pode ser alterado depois de init.
+    int num_classes;            // Colunas da tabela (potência de 2, >= classes usadas).
+    int class_shift;            // log2(num_classes).
+    int num_states;
+    int32_t* next;              // Transições: next[(estado << class_shift) + classe] (ver `build_automaton`).
+    int32_t* output;            // Palavra-chave que termina no estado (-1: nenhuma).
+    int32_t* match_link;        // O próprio estado se tiver output, senão o primeiro sufixo com output (-1: nenhum).
+    int32_t* dict_link;         // Sufixo próprio seguinte com output (-1: nenhum).
+} MultiMatcher;
+
+int multi_matcher_init(MultiMatcher* mm, const char* const* keywords, int num_keywords);
+void multi_matcher_destroy(MultiMatcher* mm);
+int multi_matcher_needs_nul(const MultiMatcher* mm);
+int multi_matcher_count_lines_buffer(const MultiMatcher* mm, const char* buf, size_t len, int stop_at_first, long* counts);
+int multi_matcher_count_lines_fd(const MultiMatcher* mm, int fd, int stop_at_first, long* counts);
+
+#endif
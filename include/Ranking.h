@@ -0,0 +1,51 @@
+#ifndef RANKING_H
+#define RANKING_H
+
+#include <stdint.h>     // Para int64_t
+
+// --- Pesquisa Ordenada por Relevância (RANKED_SEARCH) ---
+// Os documentos que SEARCH_DOCS devolveria são pontuados com o BM25 e só os k melhores são
+// devolvidos, do mais para o menos relevante:
+//
+//   pontuação(d) = soma, por cada palavra w da palavra-chave, de
+//                  idf(w) × tf(w, d) × (k1 + 1) / (tf(w, d) + k1 × (1 - b + b × |d| / média(|d|)))
+//   idf(w)       = ln(1 + (N - df(w) + 0.5) / (df(w) + 0.5))
+//
+// com tf a frequência da palavra no documento, |d| o comprimento do documento, N o número de
+// documentos e df o número de documentos com a palavra. As estatísticas vêm do índice
+// invertido (Inverted_Index.h), que guarda as frequências e os comprimentos.
+//
+// Seleção dos k melhores: um monte mínimo (heap) com no máximo k documentos, cuja raiz é o
+// pior deles; cada documento pontuado só entra se for melhor do que a raiz. Custa
+// O(n log k) e O(k) de memória, sem ordenar nem guardar a lista completa dos resultados.
+
+#define BM25_K1 1.2     // Saturação da frequência.
+#define BM25_B 0.75     // Peso da normalização pelo comprimento.
+#define RANK_SCORE_SCALE 1000 // As pontuações seguem no protocolo como inteiros (milésimas).
+
+/**
+ * @brief Documento pontuado.
+ */
+typedef struct {
+    int id;
+    double score;
+} ScoredDoc;
+
+/**
+ * @brief Os k documentos com maior pontuação vistos até agora (monte mínimo).
+ */
+typedef struct {
+    ScoredDoc* docs;    // Monte: docs[0] é o pior dos guardados.
+    int count;          // Documentos guardados.
+    int k;              // Capacidade.
+} TopK;
+
+double bm25_idf(int64_t num_docs, int64_t doc_freq);
+double bm25_term_score(double idf, double tf, double doc_length, double avg_length);
+
+int top_k_init(TopK* top, int k);
+void top_k_push(TopK* top, int id, double score);
+int top_k_sort(TopK* top);
+void top_k_free(TopK* top);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef REPLY_QUEUE_H
+#define REPLY_QUEUE_H
+
+#include <pthread.h>    // Para pthread_mutex_t
+#include <stddef.h>     // Para size_t
+
+// --- Fila de Respostas Prontas ---
+// Liga as threads trabalhadoras ao ciclo de eventos da thread principal, no sentido inverso
+// da RequestQueue: cada trabalhadora, depois de processar um pedido, coloca aqui a resposta
+// já codificada em tramas e acorda o ciclo de eventos através de um eventfd (registado no
+// seu epoll). É o ciclo de eventos que a escreve ao cliente, sem bloquear; assim uma
+// trabalhadora nunca espera por um cliente.
+//
+// A fila não tem limite: tem no máximo uma resposta por pedido retirado da RequestQueue.
+
+/**
+ * @brief Resposta pronta a enviar a um cliente.
+ */
+typedef struct Reply {
+    int client_pid;             // Cliente a quem se destina.
+    int operation;              // Operação do pedido.
+    int session;                // Modo de sessão do pedido (SESSION_NONE, SESSION_BEGIN ou SESSION_ACTIVE).
+    char* frames;               // Tramas codificadas (malloc), ou NULL se faltou memória para as codificar.
+    size_t len;                 // Bytes em `frames`.
+    struct Reply* next;
+} Reply;
+
+/**
+ * @brief Lista de respostas protegida por mutex, com um eventfd para acordar o consumidor.
+ */
+typedef struct {
+    Reply* head;
+    Reply* tail;
+    int event_fd;               // Legível enquanto houver respostas por retirar.
+    pthread_mutex_t mutex;
+} ReplyQueue;
+
+int reply_queue_init(ReplyQueue* q);
+void reply_queue_destroy(ReplyQueue* q);
+void reply_queue_push(ReplyQueue* q, Reply* reply);
+Reply* reply_queue_take_all(ReplyQueue* q);
+
+#endif
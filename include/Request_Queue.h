@@ -0,0 +1,34 @@
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <pthread.h>    // Para pthread_mutex_t, pthread_cond_t
+#include "Document_Struct.h" // Para Request
+
+// --- Fila Limitada de Pedidos ---
+// Liga o ciclo de eventos da thread principal (que lê os pedidos) às threads trabalhadoras.
+// O ciclo de eventos só acrescenta pedidos quando há lugar, por isso nunca bloqueia aqui; com
+// a fila cheia, deixa de ler o SERVER_PIPE, aplicando contrapressão aos clientes.
+
+#define REQUEST_QUEUE_CAPACITY 128  // Número máximo de pedidos à espera de um trabalhador.
+
+/**
+ * @brief Fila circular de pedidos protegida por mutex e variáveis de condição.
+ */
+typedef struct {
+    Request items[REQUEST_QUEUE_CAPACITY]; // Buffer circular.
+    int head;                   // Posição do próximo pedido a retirar.
+    int count;                  // Número de pedidos na fila.
+    int closed;                 // 1 depois de request_queue_close: não aceita mais pedidos.
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;   // Sinalizada quando entra um pedido (ou a fila fecha).
+    pthread_cond_t not_full;    // Sinalizada quando sai um pedido.
+} RequestQueue;
+
+int request_queue_init(RequestQueue* q);
+void request_queue_destroy(RequestQueue* q);
+int request_queue_push(RequestQueue* q, const Request* req);
+int request_queue_pop(RequestQueue* q, Request* out);
+void request_queue_close(RequestQueue* q);
+int request_queue_depth(RequestQueue* q);
+
+#endif
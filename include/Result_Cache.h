@@ -0,0 +1,110 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>     // Para size_t
+#include <pthread.h>    // Para pthread_mutex_t
+#include <sys/types.h>  // Para dev_t, ino_t, off_t
+#include <sys/stat.h>   // Para struct stat
+#include <time.h>       // Para struct timespec
+
+// --- Cache de Resultados das Pesquisas ---
+// Guarda o resultado de SEARCH_DOCS (palavra-chave -> IDs dos documentos) e de COUNT_LINES
+// ((ID, palavra-chave) -> número de linhas), para que uma palavra-chave repetida não volte a
+// ler todos os ficheiros. A palavra-chave tem sempre a semântica do grep (ver Matcher.h), por
+// isso é a chave completa. Limitada a `max_bytes` (IDs e palavras-chave incluídos); quando
+// cheia, sai a entrada usada há mais tempo (LRU).
+//
+// Invalidação exata:
+// - ADD_DOC: nenhuma. Os IDs são atribuídos por ordem crescente e cada pesquisa guarda o maior
+//   ID que cobriu (`max_id`); numa pesquisa seguinte só são lidos os documentos com ID
+//   superior, e o resultado é acrescentado à entrada.
+// - BULK_ADD: os IDs do lote são reservados de uma vez, mas cada bloco só fica visível quando é
+//   aplicado; entretanto, outro ADD_DOC ou lote pode tornar visível um ID superior. Um bloco
+//   aplicado nessas condições chama `result_cache_add_documents`: as pesquisas com `max_id` a
+//   partir do primeiro ID do bloco saem (não o leram) e a geração avança.
+// - DELETE_DOC: o ID sai das listas de todas as pesquisas e as contagens do documento saem.
+// - Ficheiro alterado: a cache guarda a identificação de cada ficheiro (dispositivo, inode,
+//   tamanho, data de modificação) vista na última utilização. Quem usa uma entrada faz `stat`
+//   aos ficheiros de que ela depende e chama `result_cache_check_file`: se um mudou, saem as
+//   contagens desse documento e todas as pesquisas (qualquer uma pode deixar de estar certa).
+//   Numa pesquisa, dependem do ficheiro os documentos encontrados e todos os que foram lidos,
+//   mesmo sem correspondência; só os que o índice invertido dá como não contendo a
+//   palavra-chave ficam de fora, tal como fora da cache.
+//
+// Geração: cada invalidação incrementa `generation`. Um resultado calculado sem o mutex só é
+// guardado se a geração não mudou desde que o cálculo começou; assim, uma remoção ou alteração
+// que aconteça durante uma pesquisa longa nunca deixa na cache um resultado antigo.
+//
+// Com `max_bytes` a 0 a cache está desligada: as procuras falham sempre e nada é guardado.
+
+#define RESULT_CACHE_DEFAULT_BYTES (16L * 1024 * 1024) // Limite por defeito (opção -R do servidor).
+
+#define RESULT_ENTRY_SEARCH 0   // Resultado de SEARCH_DOCS.
+#define RESULT_ENTRY_COUNT 1    // Resultado de COUNT_LINES.
+
+/**
+ * @brief Resultado guardado (uma pesquisa ou uma contagem).
+ */
+typedef struct ResultEntry {
+    int kind;                   // RESULT_ENTRY_SEARCH ou RESULT_ENTRY_COUNT.
+    char* keyword;              // Palavra-chave (cópia).
+    int doc_id;                 // Documento contado (RESULT_ENTRY_COUNT).
+    long count;                 // Número de linhas (RESULT_ENTRY_COUNT).
+    int* ids;                   // IDs encontrados, por ordem crescente (RESULT_ENTRY_SEARCH).
+    int num_ids;
+    int max_id;                 // Maior ID de documento coberto pela pesquisa.
+    size_t bytes;               // Memória contada para o limite.
+    unsigned hash;
+    struct ResultEntry* next_in_bucket;
+    struct ResultEntry* lru_prev; // Mais recente.
+    struct ResultEntry* lru_next; // Mais antiga.
+} ResultEntry;
+
+/**
+ * @brief Identificação de um ficheiro vista na última utilização.
+ */
+typedef struct {
+    int known;                  // 0 se o documento ainda não foi visto.
+    int missing;                // 1 se o ficheiro não existia.
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+} ResultFileSig;
+
+/**
+ * @brief Cache partilhada pelas threads (protegida por `mutex`).
+ */
+typedef struct {
+    ResultEntry** buckets;      // Tabela de dispersão (potência de 2).
+    int num_buckets;
+    int count;                  // Número de entradas.
+    ResultEntry* lru_head;      // Usada há menos tempo.
+    ResultEntry* lru_tail;      // Usada há mais tempo (a próxima a sair).
+    size_t bytes;               // Memória ocupada pelas entradas.
+    size_t max_bytes;           // Limite (0: cache desligada).
+    ResultFileSig* files;       // Identificação do ficheiro de cada documento, por ID.
+    int files_capacity;
+    unsigned long generation;   // Incrementada em cada invalidação.
+    unsigned long search_hits;  // Pesquisas respondidas pela cache (total ou parcialmente).
+    unsigned long search_misses;
+    unsigned long search_partial; // Acertos que ainda leram documentos novos.
+    unsigned long count_hits;
+    unsigned long count_misses;
+    unsigned long invalidations; // Entradas retiradas por DELETE_DOC, BULK_ADD ou ficheiro alterado.
+    unsigned long evictions;    // Entradas retiradas por falta de espaço.
+    pthread_mutex_t mutex;
+} ResultCache;
+
+int result_cache_init(ResultCache* cache, size_t max_bytes);
+void result_cache_destroy(ResultCache* cache);
+unsigned long result_cache_generation(ResultCache* cache);
+int result_cache_check_file(ResultCache* cache, int doc_id, const struct stat* st);
+int result_cache_get_search(ResultCache* cache, const char* keyword, int current_max_id, int** ids, int* num_ids, int* max_id);
+void result_cache_put_search(ResultCache* cache, const char* keyword, const int* ids, int num_ids, int max_id, unsigned long generation);
+int result_cache_get_count(ResultCache* cache, int doc_id, const char* keyword, long* count);
+void result_cache_put_count(ResultCache* cache, int doc_id, const char* keyword, long count, unsigned long generation);
+void result_cache_add_documents(ResultCache* cache, int first_id);
+void result_cache_remove_document(ResultCache* cache, int doc_id);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SEARCH_POOL_H
+#define SEARCH_POOL_H
+
+#include <pthread.h>    // Para pthread_t, pthread_mutex_t, pthread_cond_t
+
+// --- Pool de Threads da Pesquisa Paralela ---
+// Threads criadas uma vez no arranque do servidor e reutilizadas por todas as pesquisas
+// paralelas (SEARCH_DOCS com nr_processos > 1), em vez de processos filho criados em cada
+// pedido. Os resultados ficam em memória (um byte por documento): não há ficheiros temporários.
+//
+// Escalonamento por tamanho: os itens de uma pesquisa (documentos) são ordenados do maior para
+// o menor ficheiro e distribuídos em rodízio pelas filas (deques) das threads, por isso cada
+// thread começa pelo maior ficheiro que lhe calhou. Uma thread sem trabalho rouba do fim da
+// fila de outra (os mais pequenos): um ficheiro enorme ocupa uma thread enquanto as outras
+// repartem o resto, em vez de atrasar todo um bloco fixo de documentos.
+//
+// Várias pesquisas (de trabalhadoras diferentes) podem correr ao mesmo tempo no mesmo pool;
+// os seus itens partilham as filas.
+
+#define SEARCH_POOL_MAX_THREADS 64  // Limite de segurança para o número de threads.
+
+/**
+ * @brief Função que processa um item de uma pesquisa.
+ *
+ * @param item Posição do item (0 a num_items - 1).
+ * @param ctx Ponteiro passado a `search_pool_run`.
+ * @return 1 se o item corresponde (ex: o documento contém a palavra-chave), 0 caso contrário.
+ */
+typedef int (*SearchPoolFn)(int item, void* ctx);
+
+struct SearchJob;
+
+/**
+ * @brief Item à espera de uma thread: uma posição de uma pesquisa.
+ */
+typedef struct {
+    struct SearchJob* job;
+    int index;
+} SearchPoolItem;
+
+/**
+ * @brief Fila (deque) de uma thread: a dona retira do início, as outras roubam do fim.
+ */
+typedef struct {
+    SearchPoolItem* items;      // Buffer circular.
+    int head;                   // Posição do primeiro item.
+    int count;                  // Número de itens.
+    int capacity;               // Espaço alocado (cresce conforme necessário).
+    pthread_mutex_t mutex;
+} SearchDeque;
+
+/**
+ * @brief Conjunto de threads com uma fila cada.
+ */
+typedef struct {
+    SearchDeque* deques;        // Uma fila por thread.
+    pthread_t* threads;
+    int num_threads;            // 0 se o pool não foi criado (pesquisa sempre sequencial).
+    int next_deque;             // Primeira fila da próxima pesquisa (espalha pesquisas simultâneas).
+    int queued;                 // Itens nas filas (pode ficar negativo por instantes; ver search_pool.c).
+    int stop;                   // 1 depois de search_pool_destroy: as threads terminam.
+    long steals;                // Itens roubados por uma thread de outra (estatística).
+    pthread_mutex_t mutex;      // Protege queued (esperas), stop e next_deque.
+    pthread_cond_t work;        // Sinalizada quando entram itens (ou o pool termina).
+} SearchPool;
+
+int search_pool_init(SearchPool* pool, int num_threads);
+void search_pool_destroy(SearchPool* pool);
+int search_pool_run(SearchPool* pool, int num_items, const long* weights, SearchPoolFn fn, void* ctx, unsigned char* matched);
+int search_pool_default_threads(void);
+
+#endif
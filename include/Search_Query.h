@@ -0,0 +1,74 @@
+#ifndef SEARCH_QUERY_H
+#define SEARCH_QUERY_H
+
+#include <stddef.h>     // Para size_t
+#include "Document_Struct.h" // Para MAX_KEYWORD_SIZE
+
+// --- Consultas Booleanas e de Frase (SEARCH_QUERY) ---
+// Gramática (os operadores são palavras em maiúsculas; "and", "or" e "not" são termos):
+//
+//   consulta := ou
+//   ou       := e ( "OR" e )*
+//   e        := nao ( ["AND"] nao )*         (termos seguidos: AND implícito)
+//   nao      := "NOT" nao | primario
+//   primario := "(" ou ")" | "\"frase com espaços\"" | palavra
+//
+// Cada termo (palavra ou frase) é uma palavra-chave com a semântica de SEARCH_DOCS: o
+// documento corresponde se alguma linha a contém (`grep`). Uma frase é apenas um termo que
+// pode ter espaços, parênteses ou operadores. Ex: whale AND ship NOT captain,
+// "Moby Dick" OR (Alice NOT Rabbit).
+//
+// A consulta é avaliada de duas formas, conforme o que se sabe de cada termo:
+// - Sobre listas de IDs ordenadas (`search_query_eval_lists`): AND é uma interseção com
+//   procura galopante (custo proporcional à lista mais curta), OR uma união por fusão e
+//   NOT a diferença para o universo (ou, em "a AND NOT b", a diferença a \ b).
+// - Por documento (`search_query_matches`), a partir de uma flag por termo, depois de uma só
+//   passagem pelo ficheiro para todos os termos (ver Multi_Matcher.h).
+
+#define QUERY_MAX_TERMS 64      // Termos distintos numa consulta.
+#define QUERY_MAX_NODES 256     // Nós da árvore (termos e operadores).
+
+// Tipos de nó.
+#define QUERY_TERM 0
+#define QUERY_AND 1
+#define QUERY_OR 2
+#define QUERY_NOT 3
+
+/**
+ * @brief Nó da árvore de uma consulta.
+ */
+typedef struct {
+    int type;                   // QUERY_TERM, QUERY_AND, QUERY_OR ou QUERY_NOT.
+    int left, right;            // Filhos (AND/OR: ambos; NOT: left).
+    int term;                   // QUERY_TERM: posição do termo em `terms`.
+} QueryNode;
+
+/**
+ * @brief Consulta já analisada.
+ */
+typedef struct {
+    QueryNode nodes[QUERY_MAX_NODES];
+    int num_nodes;
+    int root;
+    char terms[QUERY_MAX_TERMS][MAX_KEYWORD_SIZE]; // Termos distintos, pela ordem em que aparecem.
+    int num_terms;
+} SearchQuery;
+
+/**
+ * @brief Lista de IDs por ordem crescente, sem repetições (alocada com malloc).
+ */
+typedef struct {
+    int* ids;
+    int count;
+} IdList;
+
+int search_query_parse(const char* text, SearchQuery* query, char* error, size_t error_size);
+int search_query_matches(const SearchQuery* query, const unsigned char* term_found);
+int search_query_eval_lists(const SearchQuery* query, const IdList* terms, const int* exact, const IdList* universe,
+                            IdList* result, int* result_exact);
+
+int id_list_intersect(const IdList* a, const IdList* b, IdList* out);
+int id_list_union(const IdList* a, const IdList* b, IdList* out);
+int id_list_difference(const IdList* a, const IdList* b, IdList* out);
+
+#endif
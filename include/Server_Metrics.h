@@ -0,0 +1,45 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include "Document_Struct.h" // Para NUM_OPERATIONS, ServerStats
+
+// --- Métricas do Servidor ---
+// Contadores sempre ativos por trás da operação STATS: pedidos, erros e histograma de latências
+// por operação, e bytes dos ficheiros pesquisados. Cada thread escreve na sua própria parte
+// (shard), escolhida na primeira utilização, com somas atómicas relaxadas (sem locks e sem
+// partilhar linhas de cache entre threads); STATS soma todas as partes no momento da leitura.
+//
+// Histograma: valores em microssegundos, 8 posições exatas (0 a 7) e depois 8 subdivisões
+// por cada potência de 2, o que dá um erro relativo máximo de 12,5% em qualquer percentil.
+
+#define METRICS_SUB_BUCKETS 8
+#define METRICS_BUCKETS (METRICS_SUB_BUCKETS * 39) // Até 2^41 µs (~25 dias); acima conta no último.
+
+/**
+ * @brief Contadores de uma thread (alinhados para não partilharem linhas de cache).
+ */
+typedef struct {
+    unsigned long errors[NUM_OPERATIONS];
+    unsigned long max_us[NUM_OPERATIONS];
+    unsigned long latency[NUM_OPERATIONS][METRICS_BUCKETS];
+    unsigned long bytes_scanned;
+} __attribute__((aligned(64))) MetricsShard;
+
+/**
+ * @brief Métricas de todas as threads.
+ */
+typedef struct {
+    MetricsShard* shards;
+    int num_shards;             // A última é partilhada pelas threads que já não têm uma só para si.
+    int next_shard;             // Próxima parte livre (atribuída atomicamente).
+    long long start_us;         // Arranque (relógio monotónico), para o tempo de funcionamento.
+} ServerMetrics;
+
+int server_metrics_init(ServerMetrics* m, int num_shards);
+void server_metrics_destroy(ServerMetrics* m);
+long long server_metrics_now_us(void);
+void server_metrics_record(ServerMetrics* m, int operation, int status, long long latency_us);
+void server_metrics_add_bytes(ServerMetrics* m, long bytes);
+void server_metrics_snapshot(ServerMetrics* m, ServerStats* out);
+
+#endif
@@ -0,0 +1,270 @@
+#include "Document_Struct.h"
+#include "Client_Conn.h"
+#include "Doc_Log.h"        // Para LOG_FILE
+#include "Inverted_Index.h" // Para INDEX_FILE
+#include <dirent.h>         // Para opendir, readdir (ficheiros do corpus)
+
+// Benchmark de BULK_ADD (carregar um catálogo inteiro num só pedido).
+// Lança um dserver numa pasta temporária e adiciona `documentos` linhas (por defeito 100000, a
+// escala de um catálogo grande) num único BULK_ADD, cada uma com um dos ficheiros do corpus,
+// por ordem. Por defeito o corpus são SYNTH_FILES ficheiros sintéticos de SYNTH_KIB KiB, criados
+// na pasta temporária: o índice de 100000 cópias dos livros de documentos/ ocuparia vários GiB.
+// Com `pasta_corpus`, usa os ficheiros dessa pasta.
+// Reporta:
+//  - o tempo do BULK_ADD (objetivo: BULK_TARGET_MS, "segundos, não minutos");
+//  - o tempo até a indexação em segundo plano acabar (STATS.index_pending a 0) e a latência de
+//    QUERY_DOC enquanto isso (a indexação só bloqueia os pedidos enquanto junta cada bloco).
+//
+// Uso: ./bench_bulk_add dserver [documentos] [pasta_temporaria] [pasta_corpus]
+//      (por defeito: 100000 documentos, em /tmp, corpus sintético)
+
+#define BULK_TARGET_MS 5000     // Objetivo para o BULK_ADD de 100000 documentos.
+#define POLL_INTERVAL_US 20000  // Intervalo entre pedidos STATS enquanto a indexação decorre.
+#define MAX_CORPUS_FILES 1024
+#define SYNTH_FILES 1000        // Ficheiros do corpus sintético.
+#define SYNTH_KIB 4             // Tamanho de cada ficheiro sintético.
+#define SYNTH_VOCABULARY 5000   // Palavras distintas dos ficheiros sintéticos ("sw0" a "sw4999").
+#define SYNTH_SEED 12345        // Os ficheiros sintéticos são iguais em todas as execuções.
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Lança o servidor na pasta `work_dir`, com os documentos em `corpus_dir`, e espera que fique à escuta.
+ *
+ * @return O PID do servidor, ou -1 em caso de erro.
+ */
+static pid_t start_server(const char* server_path, const char* work_dir, const char* corpus_dir) {
+    unlink(SERVER_PIPE);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        if (chdir(work_dir) != 0) _exit(1);
+        execl(server_path, server_path, corpus_dir, "-t", "fifo", (char*)NULL);
+        perror("Erro ao executar o servidor");
+        _exit(1);
+    }
+    for (int i = 0; i < 500; i++) { // Até 5 s.
+        if (access(SERVER_PIPE, F_OK) == 0) return pid;
+        if (waitpid(pid, NULL, WNOHANG) == pid) return -1;
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+/**
+ * @brief Envia um pedido sem lote numa ligação própria.
+ *
+ * @return 0 em caso de sucesso (`resp` preenchida), -1 se não foi possível comunicar com o servidor.
+ */
+static int simple_request(int operation, int id, Response* resp) {
+    ClientConn conn;
+    Request req;
+    memset(&req, 0, sizeof(Request));
+    req.operation = operation;
+    req.doc.id = id;
+    client_conn_init(&conn, TRANSPORT_FIFO, 0);
+    if (client_conn_request(&conn, &req, NULL, resp) != 0) return -1;
+    free(resp->ids);
+    resp->ids = NULL;
+    return 0;
+}
+
+/**
+ * @brief Lê os nomes dos ficheiros regulares da pasta do corpus.
+ *
+ * @return O número de ficheiros (0 se a pasta não existir ou estiver vazia).
+ */
+static int list_corpus(const char* corpus_dir, char (*names)[MAX_PATH_SIZE], int max_names) {
+    DIR* dir = opendir(corpus_dir);
+    if (!dir) return 0;
+    int count = 0;
+    struct dirent* entry;
+    while (count < max_names && (entry = readdir(dir)) != NULL) {
+        char path[PATH_MAX];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", corpus_dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || strlen(entry->d_name) >= MAX_PATH_SIZE) continue;
+        strcpy(names[count++], entry->d_name);
+    }
+    closedir(dir);
+    return count;
+}
+
+/**
+ * @brief Cria o corpus sintético em `dir` (palavras "swN", as de número baixo mais frequentes).
+ *
+ * @return O número de ficheiros criados, ou 0 em caso de erro.
+ */
+static int create_synthetic_corpus(const char* dir, char (*names)[MAX_PATH_SIZE]) {
+    unsigned seed = SYNTH_SEED;
+    char line[256];
+    for (int i = 0; i < SYNTH_FILES; i++) {
+        char path[PATH_MAX + MAX_PATH_SIZE];
+        snprintf(names[i], MAX_PATH_SIZE, "synth_%d.txt", i);
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return 0;
+        long written = 0;
+        while (written < SYNTH_KIB * 1024L) {
+            int len = 0;
+            for (int w = 0; w < 12; w++) {
+                double r = (double)rand_r(&seed) / RAND_MAX;
+                len += snprintf(line + len, sizeof(line) - len, "sw%d ", (int)(r * r * r * (SYNTH_VOCABULARY - 1)));
+            }
+            line[len++] = '\n';
+            if (write(fd, line, len) != len) {
+                close(fd);
+                return 0;
+            }
+            written += len;
+        }
+        close(fd);
+    }
+    return SYNTH_FILES;
+}
+
+/**
+ * @brief Mede o BULK_ADD e a indexação em segundo plano que se segue.
+ *
+ * @return 0 em caso de sucesso, -1 se algum pedido falhou.
+ */
+static int bench_bulk_add(const Document* docs, int num_docs) {
+    ClientConn conn;
+    Request req;
+    Response resp;
+    memset(&req, 0, sizeof(Request));
+    req.operation = BULK_ADD;
+    req.batch_size = num_docs;
+    client_conn_init(&conn, TRANSPORT_FIFO, 0);
+
+    double start = now_ns();
+    if (client_conn_request(&conn, &req, docs, &resp) != 0) return -1;
+    double bulk_ms = (now_ns() - start) / 1e6;
+    int added = (resp.num_ids >= 2) ? resp.ids[1] : 0;
+    int status = resp.status;
+    free(resp.ids);
+    if (status != 0 || added != num_docs) {
+        char msg[128];
+        int len = snprintf(msg, sizeof(msg), "Erro: BULK_ADD devolveu %d (%d de %d adicionados).\n", status, added, num_docs);
+        write(STDERR_FILENO, msg, len);
+        return -1;
+    }
+
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "BULK_ADD de %d documentos: %.0f ms (%.0f documentos/s) — objetivo %d ms: %s\n",
+                       num_docs, bulk_ms, num_docs / (bulk_ms / 1e3), BULK_TARGET_MS,
+                       bulk_ms <= BULK_TARGET_MS ? "cumprido" : "NÃO cumprido");
+    write(STDOUT_FILENO, msg, len);
+
+    // Espera pela indexação em segundo plano, medindo entretanto consultas a documentos do lote.
+    double query_max_ns = 0, query_total_ns = 0;
+    int queries = 0, pending = 0;
+    do {
+        double query_start = now_ns();
+        if (simple_request(QUERY_DOC, 1 + (queries * 7919) % num_docs, &resp) != 0 || resp.status != 0) return -1;
+        double query_ns = now_ns() - query_start;
+        query_total_ns += query_ns;
+        if (query_ns > query_max_ns) query_max_ns = query_ns;
+        queries++;
+
+        if (simple_request(STATS, 0, &resp) != 0) return -1;
+        pending = resp.stats.index_pending;
+        if (pending > 0) usleep(POLL_INTERVAL_US);
+    } while (pending > 0);
+    double index_ms = (now_ns() - start) / 1e6 - bulk_ms;
+
+    len = snprintf(msg, sizeof(msg),
+                   "Indexação em segundo plano: %.0f ms depois do BULK_ADD | QUERY_DOC durante a indexação: "
+                   "%d pedidos, média %.1f us, máx %.1f us\n",
+                   index_ms, queries, query_total_ns / queries / 1e3, query_max_ns / 1e3);
+    write(STDOUT_FILENO, msg, len);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        write(STDERR_FILENO, "Uso: ./bench_bulk_add dserver [documentos] [pasta_temporaria] [pasta_corpus]\n",
+              strlen("Uso: ./bench_bulk_add dserver [documentos] [pasta_temporaria] [pasta_corpus]\n"));
+        return 1;
+    }
+    char server_path[PATH_MAX];
+    if (!realpath(argv[1], server_path)) {
+        perror("Erro ao encontrar o servidor");
+        return 1;
+    }
+    int num_docs = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 100000;
+    const char* tmp_dir = (argc > 3) ? argv[3] : "/tmp";
+
+    // Pasta de trabalho do servidor (database.bin, log, índice e, por defeito, o corpus).
+    char work_dir[PATH_MAX], corpus_dir[PATH_MAX], resolved[PATH_MAX];
+    snprintf(work_dir, sizeof(work_dir), "%s/bench_bulk_add_%d", tmp_dir, getpid());
+    if (mkdir(work_dir, 0755) != 0 || !realpath(work_dir, resolved)) {
+        perror("Erro ao preparar a pasta temporária");
+        return 1;
+    }
+    strcpy(work_dir, resolved);
+    if (argc > 4 && !realpath(argv[4], corpus_dir)) {
+        perror("Erro ao encontrar a pasta do corpus");
+        rmdir(work_dir);
+        return 1;
+    }
+    int synthetic = (argc <= 4);
+    if (synthetic) strcpy(corpus_dir, work_dir);
+
+    static char names[MAX_CORPUS_FILES][MAX_PATH_SIZE];
+    int num_names = synthetic ? create_synthetic_corpus(corpus_dir, names) : list_corpus(corpus_dir, names, MAX_CORPUS_FILES);
+    Document* docs = calloc(num_docs, sizeof(Document));
+    int failed = 1;
+    if (num_names == 0 || !docs) {
+        write(STDERR_FILENO, "Erro: corpus vazio ou sem memória para o lote.\n",
+              strlen("Erro: corpus vazio ou sem memória para o lote.\n"));
+    } else {
+        for (int i = 0; i < num_docs; i++) {
+            snprintf(docs[i].title, MAX_TITLE_SIZE, "Documento %d", i + 1);
+            snprintf(docs[i].authors, MAX_AUTHORS_SIZE, "Autor %d", i % 1000);
+            snprintf(docs[i].year, MAX_YEAR_SIZE, "%d", 1900 + i % 125);
+            strcpy(docs[i].path, names[i % num_names]);
+        }
+
+        signal(SIGPIPE, SIG_IGN);
+        pid_t server = start_server(server_path, work_dir, corpus_dir);
+        if (server < 0) {
+            write(STDERR_FILENO, "Erro ao lançar o servidor.\n", strlen("Erro ao lançar o servidor.\n"));
+        } else {
+            failed = (bench_bulk_add(docs, num_docs) != 0);
+            Response resp;
+            simple_request(SHUTDOWN, 0, &resp);
+            waitpid(server, NULL, 0);
+        }
+    }
+
+    const char* files[] = { "database.bin", LOG_FILE, INDEX_FILE };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        char path[PATH_MAX + 32];
+        snprintf(path, sizeof(path), "%s/%s", work_dir, files[i]);
+        unlink(path);
+    }
+    for (int i = 0; synthetic && i < num_names; i++) {
+        char path[PATH_MAX + MAX_PATH_SIZE];
+        snprintf(path, sizeof(path), "%s/%s", work_dir, names[i]);
+        unlink(path);
+    }
+    rmdir(work_dir);
+    free(docs);
+    if (failed) {
+        write(STDERR_FILENO, "ERRO: o benchmark de BULK_ADD falhou.\n", strlen("ERRO: o benchmark de BULK_ADD falhou.\n"));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "Document_Struct.h"
+#include "Doc_Cache.h"
+#include <math.h>       // Para pow
+
+// Micro-benchmark das políticas da cache de metadados.
+// Gera um traço de consultas por ID com distribuição Zipf (poucos documentos muito
+// consultados, muitos raramente) e mede, para cada política, a taxa de acerto e o custo
+// por consulta. Uma falha coloca o documento na cache, retirando outro se estiver cheia.
+// A referência "FCFS" é a política antiga: retira o documento mais antigo e desloca o
+// array de ponteiros (O(N) por remoção), sem olhar para a frequência de acesso.
+//
+// Uso: ./bench_cache [num_documentos] [tamanho_cache] [consultas] [expoente_zipf]
+//      (por defeito: 10000 1000 2000000 0.9)
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Gera `len` IDs em [1, n] com distribuição Zipf de expoente `s` (IDs baralhados).
+ */
+static int* zipf_trace(int n, int len, double s) {
+    double* cdf = malloc(n * sizeof(double));
+    int* perm = malloc((n + 1) * sizeof(int));
+    int* trace = malloc(len * sizeof(int));
+    if (!cdf || !perm || !trace) {
+        perror("Erro de alocação");
+        exit(1);
+    }
+    double sum = 0;
+    for (int k = 0; k < n; k++) {
+        sum += 1.0 / pow(k + 1, s);
+        cdf[k] = sum;
+    }
+    for (int i = 1; i <= n; i++) perm[i] = i;
+    for (int i = n; i > 1; i--) { // Os documentos populares não são os de ID mais baixo.
+        int j = 1 + rand() % i;
+        int t = perm[i]; perm[i] = perm[j]; perm[j] = t;
+    }
+    for (int i = 0; i < len; i++) {
+        double u = (double)rand() / RAND_MAX * sum;
+        int lo = 0, hi = n - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cdf[mid] < u) lo = mid + 1; else hi = mid;
+        }
+        trace[i] = perm[lo + 1];
+    }
+    free(cdf);
+    free(perm);
+    return trace;
+}
+
+static void report(const char* policy, long hits, int lookups, double total_ns) {
+    char msg[160];
+    int len = snprintf(msg, sizeof(msg), "%-8s %10.2f%% acertos %12.1f ns/consulta\n",
+                       policy, 100.0 * hits / lookups, total_ns / lookups);
+    write(STDOUT_FILENO, msg, len);
+}
+
+/**
+ * @brief Política antiga: array de ponteiros, sai o primeiro e os restantes deslocam-se.
+ */
+static void bench_fcfs(int n, int capacity, const int* trace, int len) {
+    Document** docs = malloc(capacity * sizeof(Document*));
+    Document** by_id = calloc(n + 1, sizeof(Document*));
+    if (!docs || !by_id) {
+        perror("Erro de alocação");
+        exit(1);
+    }
+    int num_docs = 0;
+    long hits = 0;
+    Document d;
+    memset(&d, 0, sizeof(Document));
+
+    double start = now_ns();
+    for (int i = 0; i < len; i++) {
+        int id = trace[i];
+        if (by_id[id]) { hits++; continue; }
+        if (num_docs == capacity) {
+            by_id[docs[0]->id] = NULL;
+            free(docs[0]);
+            for (int j = 0; j < num_docs - 1; j++) docs[j] = docs[j + 1];
+            num_docs--;
+        }
+        d.id = id;
+        Document* copy = malloc(sizeof(Document));
+        memcpy(copy, &d, sizeof(Document));
+        docs[num_docs++] = copy;
+        by_id[id] = copy;
+    }
+    report("FCFS", hits, len, now_ns() - start);
+
+    for (int i = 0; i < num_docs; i++) free(docs[i]);
+    free(docs);
+    free(by_id);
+}
+
+static void bench_policy(int policy, int n, int capacity, const int* trace, int len) {
+    DocCache cache;
+    Document** by_id = calloc(n + 1, sizeof(Document*)); // Faz o papel da tabela de documentos.
+    if (!by_id || doc_cache_init(&cache, capacity, policy) != 0) {
+        perror("Erro de alocação");
+        exit(1);
+    }
+    Document d;
+    memset(&d, 0, sizeof(Document));
+
+    double start = now_ns();
+    for (int i = 0; i < len; i++) {
+        int id = trace[i];
+        if (by_id[id]) {
+            doc_cache_touch(&cache, by_id[id]);
+            continue;
+        }
+        cache.misses++;
+        int evicted_id;
+        d.id = id;
+        by_id[id] = doc_cache_insert(&cache, &d, &evicted_id);
+        if (evicted_id >= 0) by_id[evicted_id] = NULL;
+    }
+    report(doc_cache_policy_name(policy), cache.hits, len, now_ns() - start);
+
+    doc_cache_free(&cache);
+    free(by_id);
+}
+
+int main(int argc, char* argv[]) {
+    int n = (argc > 1) ? atoi(argv[1]) : 10000;
+    int capacity = (argc > 2) ? atoi(argv[2]) : 1000;
+    int len = (argc > 3) ? atoi(argv[3]) : 2000000;
+    double s = (argc > 4) ? atof(argv[4]) : 0.9;
+    if (n < 1 || capacity < 1 || len < 1) {
+        write(STDERR_FILENO, "Uso: ./bench_cache [num_documentos] [tamanho_cache] [consultas] [expoente_zipf]\n",
+            strlen("Uso: ./bench_cache [num_documentos] [tamanho_cache] [consultas] [expoente_zipf]\n"));
+        return 1;
+    }
+
+    srand(42);
+    int* trace = zipf_trace(n, len, s);
+    char header[160];
+    int hlen = snprintf(header, sizeof(header), "%d documentos, cache de %d, %d consultas Zipf(%.2f)\n",
+                        n, capacity, len, s);
+    write(STDOUT_FILENO, header, hlen);
+
+    bench_fcfs(n, capacity, trace, len);
+    bench_policy(CACHE_POLICY_LRU, n, capacity, trace, len);
+    bench_policy(CACHE_POLICY_CLOCK, n, capacity, trace, len);
+    free(trace);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "Document_Struct.h"
+#include "Doc_Table.h"
+
+// Micro-benchmark da latência de consulta por ID.
+// Para cada tamanho N, compara:
+//  - memória: DocTable (acesso direto por ID) vs. procura linear num array de ponteiros (cache antiga);
+//  - disco: `pread` no offset guardado na tabela vs. leitura sequencial de "database.bin" até ao ID.
+// O ficheiro de teste tem o formato antigo de "database.bin" (registos de tamanho fixo, ver Doc_Record.h)
+// e é criado (e removido) na pasta indicada.
+//
+// Uso: ./bench_doc_table [pasta_temporaria] [N ...]   (por defeito: /tmp 1000 100000 1000000)
+
+#define TABLE_LOOKUPS 1000000   // Consultas aleatórias por medição com a tabela.
+#define LINEAR_MEM_LOOKUPS 1000 // Consultas com procura linear em memória.
+#define LINEAR_DISK_LOOKUPS 5   // Consultas com leitura sequencial do ficheiro.
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Cria um ficheiro com o formato antigo de "database.bin" com N documentos (IDs 1..N).
+ */
+static int create_database(const char* path, int n) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+
+    int next_id = n + 1;
+    write(fd, &next_id, sizeof(int));
+    write(fd, &n, sizeof(int));
+
+    enum { BATCH = 1024 };
+    Document* batch = calloc(BATCH, sizeof(Document));
+    if (!batch) { close(fd); return -1; }
+    for (int i = 0; i < n; i += BATCH) {
+        int k = (n - i < BATCH) ? n - i : BATCH;
+        for (int j = 0; j < k; j++) {
+            batch[j].id = i + j + 1;
+            snprintf(batch[j].path, MAX_PATH_SIZE, "%d.txt", i + j + 1);
+        }
+        write(fd, batch, k * sizeof(Document));
+    }
+    free(batch);
+    return fd;
+}
+
+static void report(int n, const char* what, double total_ns, int lookups) {
+    char msg[160];
+    int len = snprintf(msg, sizeof(msg), "%9d  %-28s %14.1f ns/consulta\n", n, what, total_ns / lookups);
+    write(STDOUT_FILENO, msg, len);
+}
+
+static void bench_size(const char* tmp_dir, int n) {
+    // --- Memória ---
+    DocTable table;
+    Document** linear = malloc(n * sizeof(Document*));
+    Document* docs = calloc(n, sizeof(Document));
+    if (!linear || !docs || doc_table_init(&table, 16) != 0) {
+        perror("Erro de alocação");
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        docs[i].id = i + 1;
+        linear[i] = &docs[i];
+        doc_table_slot_create(&table, i + 1)->cached = &docs[i];
+    }
+
+    volatile long sink = 0;
+    srand(42);
+    double start = now_ns();
+    for (int i = 0; i < TABLE_LOOKUPS; i++) {
+        DocSlot* slot = doc_table_slot(&table, 1 + rand() % n);
+        sink += slot->cached->id;
+    }
+    report(n, "memoria: tabela por ID", now_ns() - start, TABLE_LOOKUPS);
+
+    start = now_ns();
+    for (int i = 0; i < LINEAR_MEM_LOOKUPS; i++) {
+        int id = 1 + rand() % n;
+        for (int j = 0; j < n; j++) {
+            if (linear[j]->id == id) { sink += j; break; }
+        }
+    }
+    report(n, "memoria: procura linear", now_ns() - start, LINEAR_MEM_LOOKUPS);
+
+    // --- Disco ---
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/bench_doc_table_%d.bin", tmp_dir, getpid());
+    int fd = create_database(path, n);
+    if (fd < 0) {
+        perror("Erro ao criar ficheiro de teste");
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        table.slots[i + 1].disk_offset = 2 * sizeof(int) + (off_t)i * sizeof(Document);
+    }
+
+    Document d;
+    start = now_ns();
+    for (int i = 0; i < TABLE_LOOKUPS; i++) {
+        DocSlot* slot = doc_table_slot(&table, 1 + rand() % n);
+        pread(fd, &d, sizeof(Document), slot->disk_offset);
+        sink += d.id;
+    }
+    report(n, "disco: pread no offset", now_ns() - start, TABLE_LOOKUPS);
+
+    start = now_ns();
+    for (int i = 0; i < LINEAR_DISK_LOOKUPS; i++) {
+        int id = 1 + rand() % n;
+        lseek(fd, 2 * sizeof(int), SEEK_SET);
+        while (read(fd, &d, sizeof(Document)) == sizeof(Document)) {
+            if (d.id == id) { sink += d.id; break; }
+        }
+    }
+    report(n, "disco: leitura sequencial", now_ns() - start, LINEAR_DISK_LOOKUPS);
+
+    close(fd);
+    unlink(path);
+    doc_table_free(&table);
+    free(linear);
+    free(docs);
+}
+
+int main(int argc, char* argv[]) {
+    const char* tmp_dir = (argc > 1) ? argv[1] : "/tmp";
+    int default_sizes[] = { 1000, 100000, 1000000 };
+
+    char header[128];
+    int len = snprintf(header, sizeof(header), "%9s  %-28s %14s\n", "N", "metodo", "latencia");
+    write(STDOUT_FILENO, header, len);
+
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) {
+            int n = atoi(argv[i]);
+            if (n > 0) bench_size(tmp_dir, n);
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) {
+            bench_size(tmp_dir, default_sizes[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "Document_Struct.h"
+#include "Matcher.h"
+#include <locale.h> // Para setlocale (mesmo locale que o grep usado como referência).
+
+// Benchmark de débito (GB/s) dos núcleos de pesquisa literal do Matcher.
+// Repete o ficheiro indicado até ter pelo menos `MiB` mebibytes em memória e conta as linhas
+// com cada palavra-chave usando cada núcleo (escalar, SSE2, AVX2, conforme o processador) e
+// o pipeline `grep | wc -l` sobre uma cópia em disco (já no page cache). Todas as contagens
+// têm de coincidir.
+//
+// Uso: ./bench_kernel ficheiro [MiB] [pasta_temporaria] [palavra-chave ...]
+//      (por defeito: 64 MiB em /tmp, palavras-chave de default_keywords)
+
+#define BENCH_REPS 5
+
+static const char* default_keywords[] = { "the", "Alice", "whale", "zzzzqqq", "e", "Project Gutenberg" };
+
+static double now_s() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Lê o ficheiro e repete o seu conteúdo até ter pelo menos min_bytes.
+ */
+static char* build_corpus(const char* path, size_t min_bytes, size_t* out_len) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) return NULL;
+    size_t file_len = st.st_size;
+    size_t copies = (min_bytes + file_len - 1) / file_len;
+    char* buf = malloc(copies * file_len);
+    if (!buf) { close(fd); return NULL; }
+    if (pread(fd, buf, file_len, 0) != (ssize_t)file_len) { free(buf); close(fd); return NULL; }
+    close(fd);
+    for (size_t c = 1; c < copies; c++) memcpy(buf + c * file_len, buf, file_len);
+    *out_len = copies * file_len;
+    return buf;
+}
+
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "");
+    if (argc < 2) {
+        write(STDERR_FILENO, "Uso: ./bench_kernel ficheiro [MiB] [pasta_temporaria] [palavra-chave ...]\n",
+              strlen("Uso: ./bench_kernel ficheiro [MiB] [pasta_temporaria] [palavra-chave ...]\n"));
+        return 1;
+    }
+    size_t mib = (argc > 2 && atoi(argv[2]) > 0) ? (size_t)atoi(argv[2]) : 64;
+    const char* tmp_dir = (argc > 3) ? argv[3] : "/tmp";
+    const char** keywords = default_keywords;
+    int num_keywords = sizeof(default_keywords) / sizeof(default_keywords[0]);
+    if (argc > 4) {
+        keywords = (const char**)&argv[4];
+        num_keywords = argc - 4;
+    }
+
+    size_t len;
+    char* corpus = build_corpus(argv[1], mib * 1024 * 1024, &len);
+    if (!corpus) {
+        perror("Erro ao ler o ficheiro");
+        return 1;
+    }
+
+    // Cópia em disco para o grep (a primeira execução traz o ficheiro para o page cache).
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/bench_kernel_%d.txt", tmp_dir, getpid());
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, corpus, len) != (ssize_t)len) {
+        perror("Erro ao escrever o ficheiro temporário");
+        free(corpus);
+        return 1;
+    }
+    close(fd);
+
+    char msg[256];
+    int n = snprintf(msg, sizeof(msg), "%.1f MiB (%s repetido), núcleo escolhido: %s\n%-18s %-8s %10s %10s\n",
+                     len / (1024.0 * 1024.0), argv[1], matcher_kernel_name(matcher_best_kernel()),
+                     "palavra", "metodo", "linhas", "GB/s");
+    write(STDOUT_FILENO, msg, n);
+
+    int mismatches = 0;
+    for (int k = 0; k < num_keywords; k++) {
+        Matcher m;
+        if (matcher_init(&m, keywords[k]) != 0 || !m.is_literal) {
+            n = snprintf(msg, sizeof(msg), "%-18s (não é uma palavra-chave literal)\n", keywords[k]);
+            write(STDOUT_FILENO, msg, n);
+            if (matcher_init(&m, keywords[k]) == 0) matcher_destroy(&m);
+            continue;
+        }
+
+        long reference = -1;
+        for (int kernel = MATCHER_KERNEL_SCALAR; kernel <= MATCHER_KERNEL_AVX2; kernel++) {
+            if (!matcher_kernel_supported(kernel)) continue;
+            m.kernel = kernel;
+            long count = 0;
+            double start = now_s();
+            for (int r = 0; r < BENCH_REPS; r++) {
+                count = matcher_count_lines_buffer(&m, corpus, len, 0);
+            }
+            double gbps = (double)len * BENCH_REPS / (now_s() - start) / 1e9;
+            if (reference < 0) reference = count;
+            n = snprintf(msg, sizeof(msg), "%-18s %-8s %10ld %10.2f%s\n", keywords[k], matcher_kernel_name(kernel),
+                         count, gbps, count == reference ? "" : "  <-- DIVERGE");
+            write(STDOUT_FILENO, msg, n);
+            if (count != reference) mismatches++;
+        }
+        matcher_destroy(&m);
+
+        matcher_count_lines_exec(tmp_path, keywords[k]); // Aquece o page cache.
+        double start = now_s();
+        long count = matcher_count_lines_exec(tmp_path, keywords[k]);
+        double gbps = (double)len / (now_s() - start) / 1e9;
+        n = snprintf(msg, sizeof(msg), "%-18s %-8s %10ld %10.2f%s\n", keywords[k], "grep|wc",
+                     count, gbps, count == reference ? "" : "  <-- DIVERGE");
+        write(STDOUT_FILENO, msg, n);
+        if (count != reference) mismatches++;
+    }
+
+    unlink(tmp_path);
+    free(corpus);
+    if (mismatches > 0) {
+        n = snprintf(msg, sizeof(msg), "ERRO: %d contagens divergem.\n", mismatches);
+        write(STDERR_FILENO, msg, n);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,573 @@
+#include "Document_Struct.h"
+#include "Client_Conn.h"
+#include "Doc_Log.h"        // Para LOG_FILE
+#include "Inverted_Index.h" // Para INDEX_FILE
+#include <dirent.h>         // Para opendir, readdir (ficheiros do corpus)
+#include <getopt.h>         // Para getopt
+#include <sys/mman.h>       // Para mmap (resultados partilhados com os processos clientes)
+
+// Gerador de carga para o dserver.
+// Lança um dserver numa pasta temporária com um corpus (os ficheiros de uma pasta, por defeito
+// documentos/, mais `-s` ficheiros sintéticos de `-k` KiB), adiciona todos os documentos e põe
+// `-c` processos clientes em simultâneo a fazer `-n` pedidos cada, sorteados segundo a mistura
+// `-m` de ADD_DOC, QUERY_DOC, COUNT_LINES, SEARCH_DOCS e DELETE_DOC. Cada cliente só remove
+// documentos que ele próprio adicionou (se não tiver nenhum, adiciona um), por isso o corpus
+// inicial está sempre disponível para as consultas.
+//
+// Reporta, por operação e no total, o débito (pedidos/s) e a latência vista pelo cliente
+// (p50, p95, p99, máximo), e o CPU (utilizador + sistema) e a memória (RSS atual e máximo) do
+// servidor durante a carga, lidos de /proc. Com `-o`, acrescenta os mesmos valores a um
+// ficheiro CSV (cabeçalho só se o ficheiro estiver vazio), com a etiqueta `-l` (ex: o commit),
+// para comparar execuções de versões diferentes.
+//
+// Uso: ./bench_load [-c clientes] [-n pedidos] [-m mistura] [-d pasta_corpus] [-s sinteticos]
+//                   [-k KiB] [-t fifo|unix] [-p processos_pesquisa] [-1] [-w pasta_temporaria]
+//                   [-o resultados.csv] [-l etiqueta] dserver
+//      (por defeito: 8 clientes, 500 pedidos cada, mistura
+//       add=5,query=40,count=20,search=30,delete=5, corpus documentos/, 0 sintéticos de 64 KiB,
+//       transporte fifo, pesquisa sequencial, uma sessão por cliente, pasta /tmp)
+//      -1: uma ligação nova por pedido (como cada execução do dclient) em vez de uma sessão.
+
+#define NUM_KINDS 5             // Tipos de pedido da mistura.
+#define SYNTH_VOCABULARY 5000   // Palavras distintas dos ficheiros sintéticos ("sw0" a "sw4999").
+#define SYNTH_SEED 12345        // Os ficheiros sintéticos são iguais em todas as execuções.
+
+static const char* kind_names[NUM_KINDS] = { "add", "query", "count", "search", "delete" };
+static const int kind_operations[NUM_KINDS] = { ADD_DOC, QUERY_DOC, COUNT_LINES, SEARCH_DOCS, DELETE_DOC };
+static const char* transport_names[] = { "auto", "fifo", "unix" };
+
+// Palavras-chave de COUNT_LINES e SEARCH_DOCS: frequentes, raras e ausentes, do corpus real
+// e do sintético (as palavras sintéticas de número baixo são as mais frequentes).
+static const char* keywords[] = { "the", "whale", "Lincoln", "Alice", "sw0 ", "sw42 ", "sw4321 ", "zzzzqqq" };
+#define NUM_KEYWORDS ((int)(sizeof(keywords) / sizeof(keywords[0])))
+
+/**
+ * @brief Resultado de um pedido (escrito pelo processo cliente na memória partilhada).
+ */
+typedef struct {
+    int kind;                   // Posição em kind_names.
+    int ok;                     // 1 se a resposta teve estado 0.
+    double latency_ns;
+} Sample;
+
+/**
+ * @brief Parâmetros da execução.
+ */
+typedef struct {
+    int clients;
+    int reqs;
+    int mix[NUM_KINDS];         // Peso de cada tipo de pedido.
+    int mix_total;
+    const char* corpus_dir;
+    int synthetic;
+    int synthetic_kib;
+    int transport;
+    int search_processes;
+    int persistent;
+    const char* tmp_dir;
+    const char* csv_path;
+    const char* label;
+} LoadConfig;
+
+/**
+ * @brief Documentos a adicionar (caminhos relativos à pasta do servidor).
+ */
+typedef struct {
+    char (*paths)[MAX_PATH_SIZE];
+    int count;
+} Corpus;
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Lê a mistura ("add=5,query=40,...").
+ *
+ * @return 0 em caso de sucesso, -1 se tiver um tipo desconhecido ou nenhum peso positivo.
+ */
+static int parse_mix(const char* text, LoadConfig* config) {
+    char copy[256];
+    strncpy(copy, text, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+    memset(config->mix, 0, sizeof(config->mix));
+    char* save = NULL;
+    for (char* item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(item, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        int k;
+        for (k = 0; k < NUM_KINDS && strcmp(item, kind_names[k]) != 0; k++) {
+        }
+        if (k == NUM_KINDS || atoi(eq + 1) < 0) return -1;
+        config->mix[k] = atoi(eq + 1);
+    }
+    config->mix_total = 0;
+    for (int k = 0; k < NUM_KINDS; k++) config->mix_total += config->mix[k];
+    return config->mix_total > 0 ? 0 : -1;
+}
+
+static int add_corpus_path(Corpus* corpus, const char* name) {
+    char (*grown)[MAX_PATH_SIZE] = realloc(corpus->paths, (corpus->count + 1) * sizeof(*corpus->paths));
+    if (!grown) return -1;
+    corpus->paths = grown;
+    snprintf(corpus->paths[corpus->count++], MAX_PATH_SIZE, "%s", name);
+    return 0;
+}
+
+/**
+ * @brief Prepara a pasta do servidor: ligações simbólicas para os ficheiros do corpus e os ficheiros sintéticos.
+ *
+ * Cada linha sintética tem 12 palavras "swN" com N enviesado para valores baixos (poucas
+ * palavras muito frequentes, muitas raras), como num texto real.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+static int prepare_corpus(const LoadConfig* config, const char* work_dir, Corpus* corpus) {
+    char path[PATH_MAX + MAX_PATH_SIZE];
+    DIR* dir = config->corpus_dir ? opendir(config->corpus_dir) : NULL;
+    if (config->corpus_dir && !dir) return -1;
+    struct dirent* entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        char source[PATH_MAX], real[PATH_MAX];
+        struct stat st;
+        snprintf(source, sizeof(source), "%s/%s", config->corpus_dir, entry->d_name);
+        if (stat(source, &st) != 0 || !S_ISREG(st.st_mode) || strlen(entry->d_name) >= MAX_PATH_SIZE) continue;
+        if (!realpath(source, real)) continue;
+        snprintf(path, sizeof(path), "%s/%s", work_dir, entry->d_name);
+        if (symlink(real, path) != 0 || add_corpus_path(corpus, entry->d_name) != 0) {
+            closedir(dir);
+            return -1;
+        }
+    }
+    if (dir) closedir(dir);
+
+    unsigned seed = SYNTH_SEED;
+    char line[256];
+    for (int i = 0; i < config->synthetic; i++) {
+        char name[MAX_PATH_SIZE];
+        snprintf(name, sizeof(name), "synth_%d.txt", i);
+        snprintf(path, sizeof(path), "%s/%s", work_dir, name);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return -1;
+        long written = 0;
+        while (written < (long)config->synthetic_kib * 1024) {
+            int len = 0;
+            for (int w = 0; w < 12; w++) {
+                double r = (double)rand_r(&seed) / RAND_MAX;
+                len += snprintf(line + len, sizeof(line) - len, "sw%d ", (int)(r * r * r * (SYNTH_VOCABULARY - 1)));
+            }
+            line[len++] = '\n';
+            if (write(fd, line, len) != len) {
+                close(fd);
+                return -1;
+            }
+            written += len;
+        }
+        close(fd);
+        if (add_corpus_path(corpus, name) != 0) return -1;
+    }
+    return corpus->count > 0 ? 0 : -1;
+}
+
+/**
+ * @brief Lança o servidor na pasta `work_dir` e espera que fique à escuta.
+ *
+ * @return O PID do servidor, ou -1 em caso de erro.
+ */
+static pid_t start_server(const char* server_path, const char* work_dir, int transport) {
+    const char* endpoint = (transport == TRANSPORT_UNIX) ? SERVER_SOCKET : SERVER_PIPE;
+    unlink(SERVER_PIPE);
+    unlink(SERVER_SOCKET);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        if (chdir(work_dir) != 0) _exit(1);
+        execl(server_path, server_path, ".", "-t", transport_names[transport], (char*)NULL);
+        perror("Erro ao executar o servidor");
+        _exit(1);
+    }
+    for (int i = 0; i < 500; i++) { // Até 5 s.
+        if (access(endpoint, F_OK) == 0) return pid;
+        if (waitpid(pid, NULL, WNOHANG) == pid) return -1;
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+/**
+ * @brief Tempo de CPU (utilizador + sistema) de um processo, em segundos (de /proc/PID/stat).
+ */
+static double process_cpu_seconds(pid_t pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    // Os campos seguem o nome do programa, entre parênteses: utime e stime são o 14.º e o 15.º.
+    char* p = strrchr(buf, ')');
+    unsigned long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return 0;
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/**
+ * @brief Lê um campo em KiB de /proc/PID/status (ex: "VmRSS:", "VmHWM:").
+ */
+static long process_status_kib(pid_t pid, const char* field) {
+    char path[64], buf[4096];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    char* p = strstr(buf, field);
+    return p ? atol(p + strlen(field)) : 0;
+}
+
+/**
+ * @brief Envia um pedido e devolve o estado da resposta (-100 se não foi possível comunicar).
+ */
+static int do_request(ClientConn* conn, Request* req, Response* resp) {
+    if (client_conn_request(conn, req, NULL, resp) != 0) return -100;
+    free(resp->ids);
+    resp->ids = NULL;
+    return resp->status;
+}
+
+/**
+ * @brief Preenche um pedido ADD_DOC para um ficheiro do corpus.
+ */
+static void fill_add(Request* req, const char* path) {
+    req->operation = ADD_DOC;
+    strcpy(req->doc.title, "bench_load");
+    strcpy(req->doc.authors, "bench_load");
+    strcpy(req->doc.year, "2000");
+    snprintf(req->doc.path, MAX_PATH_SIZE, "%s", path);
+}
+
+/**
+ * @brief Processo cliente: faz `config->reqs` pedidos sorteados e guarda o resultado de cada um.
+ */
+static void run_client(const LoadConfig* config, const Corpus* corpus, int client, Sample* samples) {
+    unsigned seed = SYNTH_SEED + 7919 * (client + 1);
+    int* own_ids = malloc(config->reqs * sizeof(int)); // Documentos adicionados por este cliente.
+    int num_own = 0;
+    if (!own_ids) _exit(1);
+    ClientConn conn;
+    client_conn_init(&conn, config->transport, config->persistent);
+
+    for (int i = 0; i < config->reqs; i++) {
+        int r = rand_r(&seed) % config->mix_total;
+        int kind = 0;
+        while (r >= config->mix[kind]) r -= config->mix[kind++];
+        if (kind_operations[kind] == DELETE_DOC && num_own == 0) kind = 0; // Nada a remover: adiciona.
+
+        Request req;
+        Response resp;
+        memset(&req, 0, sizeof(Request));
+        switch (kind_operations[kind]) {
+            case ADD_DOC:
+                fill_add(&req, corpus->paths[rand_r(&seed) % corpus->count]);
+                break;
+            case DELETE_DOC:
+                req.operation = DELETE_DOC;
+                req.doc.id = own_ids[--num_own];
+                break;
+            case QUERY_DOC:
+            case COUNT_LINES:
+                req.operation = kind_operations[kind];
+                req.doc.id = 1 + rand_r(&seed) % corpus->count; // Corpus inicial: IDs 1 a count.
+                strcpy(req.keyword, keywords[rand_r(&seed) % NUM_KEYWORDS]);
+                break;
+            default:
+                req.operation = SEARCH_DOCS;
+                req.nr_processes = config->search_processes;
+                strcpy(req.keyword, keywords[rand_r(&seed) % NUM_KEYWORDS]);
+        }
+
+        double start = now_ns();
+        int status = do_request(&conn, &req, &resp);
+        samples[i].latency_ns = now_ns() - start;
+        samples[i].kind = kind;
+        samples[i].ok = (status == 0);
+        if (status == -100) _exit(1);
+        if (req.operation == ADD_DOC && status == 0) own_ids[num_own++] = resp.doc.id;
+    }
+    client_conn_close(&conn);
+    _exit(0);
+}
+
+/**
+ * @brief Estatísticas de um tipo de pedido (ou do total).
+ */
+typedef struct {
+    const char* name;
+    long count;
+    long errors;
+    double throughput;
+    double p50_us, p95_us, p99_us, max_us;
+} KindReport;
+
+/**
+ * @brief Calcula as estatísticas das amostras de um tipo (kind < 0: todas).
+ */
+static void summarize(const Sample* samples, size_t total, int kind, double elapsed_s, double* scratch, KindReport* out) {
+    size_t n = 0;
+    out->errors = 0;
+    for (size_t i = 0; i < total; i++) {
+        if (kind >= 0 && samples[i].kind != kind) continue;
+        scratch[n++] = samples[i].latency_ns;
+        if (!samples[i].ok) out->errors++;
+    }
+    out->name = kind >= 0 ? kind_names[kind] : "total";
+    out->count = (long)n;
+    out->throughput = n / elapsed_s;
+    out->p50_us = out->p95_us = out->p99_us = out->max_us = 0;
+    if (n == 0) return;
+    qsort(scratch, n, sizeof(double), compare_doubles);
+    out->p50_us = scratch[(n - 1) * 50 / 100] / 1e3;
+    out->p95_us = scratch[(n - 1) * 95 / 100] / 1e3;
+    out->p99_us = scratch[(n - 1) * 99 / 100] / 1e3;
+    out->max_us = scratch[n - 1] / 1e3;
+}
+
+/**
+ * @brief Acrescenta as linhas de uma execução ao ficheiro CSV.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+static int append_csv(const LoadConfig* config, const char* mix_text, int num_docs, const KindReport* reports,
+                      int num_reports, double cpu_s, double elapsed_s, long rss_kib, long hwm_kib) {
+    int fd = open(config->csv_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return -1;
+    struct stat st;
+    char line[1024];
+    int len;
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        len = snprintf(line, sizeof(line),
+                       "timestamp,label,transport,clients,requests_per_client,session,mix,documents,"
+                       "operation,count,errors,throughput_rps,p50_us,p95_us,p99_us,max_us,"
+                       "elapsed_s,server_cpu_s,server_rss_kib,server_hwm_kib\n");
+        write(fd, line, len);
+    }
+    long timestamp = (long)time(NULL);
+    for (int i = 0; i < num_reports; i++) {
+        const KindReport* r = &reports[i];
+        len = snprintf(line, sizeof(line), "%ld,%s,%s,%d,%d,%d,\"%s\",%d,%s,%ld,%ld,%.1f,%.1f,%.1f,%.1f,%.1f,%.3f,%.3f,%ld,%ld\n",
+                       timestamp, config->label, transport_names[config->transport], config->clients, config->reqs,
+                       config->persistent, mix_text, num_docs, r->name, r->count, r->errors, r->throughput,
+                       r->p50_us, r->p95_us, r->p99_us, r->max_us, elapsed_s, cpu_s, rss_kib, hwm_kib);
+        write(fd, line, len);
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief Remove a pasta de trabalho (ligações, ficheiros sintéticos e ficheiros do servidor).
+ */
+static void remove_work_dir(const char* work_dir, const Corpus* corpus) {
+    char path[PATH_MAX + MAX_PATH_SIZE];
+    for (int i = 0; i < corpus->count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", work_dir, corpus->paths[i]);
+        unlink(path);
+    }
+    const char* files[] = { "database.bin", LOG_FILE, INDEX_FILE };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", work_dir, files[i]);
+        unlink(path);
+    }
+    rmdir(work_dir);
+}
+
+static void usage() {
+    const char* text = "Uso: ./bench_load [-c clientes] [-n pedidos] [-m add=5,query=40,count=20,search=30,delete=5] "
+                       "[-d pasta_corpus] [-s sinteticos] [-k KiB] [-t fifo|unix] [-p processos_pesquisa] [-1] "
+                       "[-w pasta_temporaria] [-o resultados.csv] [-l etiqueta] dserver\n";
+    write(STDERR_FILENO, text, strlen(text));
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config = { 8, 500, { 0 }, 0, "documentos", 0, 64, TRANSPORT_FIFO, 1, 1, "/tmp", NULL, "" };
+    const char* mix_text = "add=5,query=40,count=20,search=30,delete=5";
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:m:d:s:k:t:p:1w:o:l:")) != -1) {
+        switch (opt) {
+            case 'c': config.clients = atoi(optarg); break;
+            case 'n': config.reqs = atoi(optarg); break;
+            case 'm': mix_text = optarg; break;
+            case 'd': config.corpus_dir = (optarg[0] != '\0') ? optarg : NULL; break;
+            case 's': config.synthetic = atoi(optarg); break;
+            case 'k': config.synthetic_kib = atoi(optarg); break;
+            case 't':
+                if (strcmp(optarg, "fifo") == 0) config.transport = TRANSPORT_FIFO;
+                else if (strcmp(optarg, "unix") == 0) config.transport = TRANSPORT_UNIX;
+                else {
+                    usage();
+                    return 1;
+                }
+                break;
+            case 'p': config.search_processes = atoi(optarg); break;
+            case '1': config.persistent = 0; break;
+            case 'w': config.tmp_dir = optarg; break;
+            case 'o': config.csv_path = optarg; break;
+            case 'l': config.label = optarg; break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (optind >= argc || config.clients < 1 || config.reqs < 1 || config.synthetic < 0 ||
+        config.synthetic_kib < 1 || parse_mix(mix_text, &config) != 0) {
+        usage();
+        return 1;
+    }
+    char server_path[PATH_MAX];
+    if (!realpath(argv[optind], server_path)) {
+        perror("Erro ao encontrar o servidor");
+        return 1;
+    }
+
+    char work_dir[PATH_MAX];
+    snprintf(work_dir, sizeof(work_dir), "%s/bench_load_%d", config.tmp_dir, getpid());
+    Corpus corpus = { NULL, 0 };
+    if (mkdir(work_dir, 0755) != 0 || prepare_corpus(&config, work_dir, &corpus) != 0) {
+        perror("Erro ao preparar o corpus");
+        remove_work_dir(work_dir, &corpus);
+        return 1;
+    }
+
+    size_t total = (size_t)config.clients * config.reqs;
+    Sample* samples = mmap(NULL, total * sizeof(Sample), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    double* scratch = malloc(total * sizeof(double));
+    if (samples == MAP_FAILED || !scratch) {
+        perror("Erro de alocação");
+        remove_work_dir(work_dir, &corpus);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    pid_t server = start_server(server_path, work_dir, config.transport);
+    if (server < 0) {
+        write(STDERR_FILENO, "Erro ao lançar o servidor.\n", strlen("Erro ao lançar o servidor.\n"));
+        remove_work_dir(work_dir, &corpus);
+        return 1;
+    }
+
+    // Corpus inicial: IDs 1 a corpus.count, numa só sessão.
+    int failed = 0;
+    ClientConn conn;
+    client_conn_init(&conn, config.transport, 1);
+    for (int i = 0; i < corpus.count && !failed; i++) {
+        Request req;
+        Response resp;
+        memset(&req, 0, sizeof(Request));
+        fill_add(&req, corpus.paths[i]);
+        if (do_request(&conn, &req, &resp) != 0 || resp.doc.id != i + 1) failed = 1;
+    }
+    client_conn_close(&conn);
+
+    char msg[512];
+    int len;
+    double elapsed_s = 0, cpu_s = 0;
+    if (!failed) {
+        len = snprintf(msg, sizeof(msg), "%d documentos, %d clientes x %d pedidos (%s, %s), mistura %s\n",
+                       corpus.count, config.clients, config.reqs, transport_names[config.transport],
+                       config.persistent ? "sessão" : "ligação por pedido", mix_text);
+        write(STDOUT_FILENO, msg, len);
+
+        double cpu_start = process_cpu_seconds(server);
+        double start = now_ns();
+        int started = 0;
+        for (int c = 0; c < config.clients; c++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("Erro ao criar processo cliente");
+                failed = 1;
+                break;
+            }
+            if (pid == 0) run_client(&config, &corpus, c, samples + (size_t)c * config.reqs);
+            started++;
+        }
+        // O servidor também é filho deste processo: espera só pelos clientes.
+        for (int c = 0; c < started; c++) {
+            int status;
+            pid_t pid = wait(&status);
+            if (pid == server) {
+                failed = 1; // O servidor terminou durante a carga.
+                c--;
+                continue;
+            }
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+            if (pid < 0) break;
+        }
+        elapsed_s = (now_ns() - start) / 1e9;
+        cpu_s = process_cpu_seconds(server) - cpu_start;
+    }
+    long rss_kib = process_status_kib(server, "VmRSS:");
+    long hwm_kib = process_status_kib(server, "VmHWM:");
+
+    Request req;
+    Response resp;
+    memset(&req, 0, sizeof(Request));
+    req.operation = SHUTDOWN;
+    client_conn_init(&conn, config.transport, 0);
+    do_request(&conn, &req, &resp);
+    waitpid(server, NULL, 0);
+
+    if (!failed) {
+        KindReport reports[NUM_KINDS + 1];
+        int num_reports = 0;
+        len = snprintf(msg, sizeof(msg), "%-8s %8s %7s %11s %10s %10s %10s %10s\n",
+                       "pedido", "total", "erros", "pedidos/s", "p50 (us)", "p95 (us)", "p99 (us)", "max (us)");
+        write(STDOUT_FILENO, msg, len);
+        for (int k = -1; k < NUM_KINDS; k++) {
+            KindReport* r = &reports[num_reports];
+            summarize(samples, total, k, elapsed_s, scratch, r);
+            if (r->count == 0) continue;
+            num_reports++;
+            len = snprintf(msg, sizeof(msg), "%-8s %8ld %7ld %11.0f %10.1f %10.1f %10.1f %10.1f\n",
+                           r->name, r->count, r->errors, r->throughput, r->p50_us, r->p95_us, r->p99_us, r->max_us);
+            write(STDOUT_FILENO, msg, len);
+        }
+        len = snprintf(msg, sizeof(msg), "Servidor: %.2f s de CPU em %.2f s (%.0f%% de um processador), RSS %ld KiB (máximo %ld KiB)\n",
+                       cpu_s, elapsed_s, elapsed_s > 0 ? 100.0 * cpu_s / elapsed_s : 0.0, rss_kib, hwm_kib);
+        write(STDOUT_FILENO, msg, len);
+        if (config.csv_path &&
+            append_csv(&config, mix_text, corpus.count, reports, num_reports, cpu_s, elapsed_s, rss_kib, hwm_kib) != 0) {
+            perror("Erro ao escrever o ficheiro de resultados");
+            failed = 1;
+        }
+    }
+
+    remove_work_dir(work_dir, &corpus);
+    free(corpus.paths);
+    free(scratch);
+    munmap(samples, total * sizeof(Sample));
+    if (failed) {
+        write(STDERR_FILENO, "ERRO: a carga não terminou (cliente ou servidor falhou).\n",
+              strlen("ERRO: a carga não terminou (cliente ou servidor falhou).\n"));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "Document_Struct.h"
+#include "Matcher.h"
+#include "File_Map.h"
+#include <dirent.h> // Para opendir, readdir (listar os documentos da pasta).
+#include <locale.h> // Para setlocale (mesmo locale que o grep usado como referência).
+
+// Benchmark do Matcher em processo contra o pipeline original `grep | wc -l`.
+// Para cada ficheiro da pasta e cada palavra-chave, mede o tempo médio de uma contagem
+// com cada método e verifica que todos devolvem o mesmo número de linhas. O Matcher é
+// medido a ler o ficheiro com `read` e sobre o ficheiro mapeado (cache de mapeamentos do
+// servidor, já preenchida: é o caso de um documento pesquisado com frequência).
+//
+// Uso: ./bench_matcher pasta_documentos [repeticoes] [palavra-chave ...]
+
+#define BENCH_DEFAULT_REPS 20
+
+static FileMapCache file_maps;
+
+static const char* default_keywords[] = { "the", "Alice", "Lincoln", "whale", "zzzzqqq", "Th.*ng", "a.b", "^[A-Z]" };
+
+/**
+ * @brief Devolve o instante atual em microssegundos (relógio monotónico).
+ */
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Conta as linhas no conteúdo mapeado (como `scan_mapped_file` no servidor).
+ */
+static long scan_mapped(const char* data, size_t size, int nul_terminated, void* ctx) {
+    const Matcher* m = ctx;
+    if (!m->is_literal && !nul_terminated) return FILE_MAP_UNAVAILABLE;
+    return matcher_count_lines_buffer(m, data, size, 0);
+}
+
+/**
+ * @brief Mede um ficheiro com uma palavra-chave e escreve uma linha da tabela de resultados.
+ *
+ * @return 0 se as contagens coincidem, 1 caso contrário.
+ */
+static int bench_file(const char* path, const char* name, const char* keyword, int reps) {
+    Matcher m;
+    if (matcher_init(&m, keyword) != 0) {
+        char msg[256];
+        int len = snprintf(msg, sizeof(msg), "%-10s %-12s (palavra-chave não suportada em processo)\n", name, keyword);
+        write(STDOUT_FILENO, msg, len);
+        return 0;
+    }
+
+    long count_matcher = 0;
+    double start = now_us();
+    for (int r = 0; r < reps; r++) {
+        count_matcher = matcher_count_lines_file(&m, path, 0);
+    }
+    double matcher_us = (now_us() - start) / reps;
+
+    long count_mmap = file_map_scan(&file_maps, path, scan_mapped, &m); // Preenche a cache.
+    start = now_us();
+    for (int r = 0; r < reps; r++) {
+        count_mmap = file_map_scan(&file_maps, path, scan_mapped, &m);
+    }
+    double mmap_us = (now_us() - start) / reps;
+    if (count_mmap == FILE_MAP_UNAVAILABLE) { // Ex: regex num ficheiro com tamanho múltiplo da página.
+        count_mmap = count_matcher;
+        mmap_us = matcher_us;
+    }
+    matcher_destroy(&m);
+
+    long count_exec = 0;
+    start = now_us();
+    for (int r = 0; r < reps; r++) {
+        count_exec = matcher_count_lines_exec(path, keyword);
+    }
+    double exec_us = (now_us() - start) / reps;
+
+    int same = (count_matcher == count_exec && count_mmap == count_exec);
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "%-10s %-12s %8ld %8ld %12.1f %12.1f %12.1f %8.1fx%s\n",
+                       name, keyword, count_matcher, count_exec, matcher_us, mmap_us, exec_us,
+                       mmap_us > 0 ? exec_us / mmap_us : 0.0,
+                       same ? "" : "  <-- DIVERGE");
+    write(STDOUT_FILENO, msg, len);
+    return same ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "");
+    if (argc < 2) {
+        write(STDERR_FILENO, "Uso: ./bench_matcher pasta_documentos [repeticoes] [palavra-chave ...]\n",
+              strlen("Uso: ./bench_matcher pasta_documentos [repeticoes] [palavra-chave ...]\n"));
+        return 1;
+    }
+
+    int reps = (argc > 2) ? atoi(argv[2]) : BENCH_DEFAULT_REPS;
+    if (reps <= 0) reps = BENCH_DEFAULT_REPS;
+
+    const char** keywords = default_keywords;
+    int num_keywords = sizeof(default_keywords) / sizeof(default_keywords[0]);
+    if (argc > 3) {
+        keywords = (const char**)&argv[3];
+        num_keywords = argc - 3;
+    }
+
+    if (file_map_cache_init(&file_maps, FILE_MAP_DEFAULT_ENTRIES, FILE_MAP_DEFAULT_BYTES) != 0) {
+        perror("Erro ao inicializar a cache de mapeamentos");
+        return 1;
+    }
+
+    DIR* dir = opendir(argv[1]);
+    if (!dir) {
+        perror("Erro ao abrir a pasta de documentos");
+        return 1;
+    }
+
+    char header[256];
+    int len = snprintf(header, sizeof(header), "%-10s %-12s %8s %8s %12s %12s %12s %9s\n",
+                       "ficheiro", "palavra", "matcher", "grep|wc", "read(us)", "mmap(us)", "grep|wc(us)", "ganho");
+    write(STDOUT_FILENO, header, len);
+
+    int mismatches = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", argv[1], entry->d_name);
+        for (int k = 0; k < num_keywords; k++) {
+            mismatches += bench_file(path, entry->d_name, keywords[k], reps);
+        }
+    }
+    closedir(dir);
+    file_map_cache_destroy(&file_maps);
+
+    if (mismatches > 0) {
+        char msg[128];
+        len = snprintf(msg, sizeof(msg), "ERRO: %d contagens divergem do grep.\n", mismatches);
+        write(STDERR_FILENO, msg, len);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "Document_Struct.h"
+#include "Matcher.h"
+#include "Multi_Matcher.h"
+#include <dirent.h> // Para opendir, readdir (listar os documentos da pasta).
+#include <locale.h> // Para setlocale (mesmo locale que o servidor).
+
+// Benchmark do MultiMatcher (uma passagem para K palavras-chave) contra K Matchers (uma
+// passagem por palavra-chave). Os ficheiros da pasta são lidos para memória uma vez; para
+// cada K, as primeiras K palavras-chave da lista são contadas em todos os ficheiros pelos dois
+// métodos, que têm de dar as mesmas contagens. Com K Matchers o tempo cresce com K; com o
+// MultiMatcher deve ficar quase constante (cresce apenas com o número de ocorrências).
+// A última linha mistura literais e expressões regulares (estas custam uma passagem cada).
+//
+// Uso: ./bench_multi_matcher pasta_documentos [repeticoes]
+
+#define BENCH_DEFAULT_REPS 5
+
+static const char* bench_keywords[] = {
+    "the", "Alice", "Lincoln", "whale", "zzzzqqq", "and", "of", "people", "government", "sea",
+    "ship", "Queen", "Rabbit", "nation", "liberty", "war", "said", "little", "Ahab", "Congress",
+    "States", "President", "time", "great", "never", "thought", "head", "water", "shall", "law",
+    "power", "right", "men", "white", "old", "long", "down", "house", "King", "Hatter",
+    "Turtle", "harpoon", "captain", "Union", "freedom", "justice", "court", "vote", "election", "tax",
+    "he", "she", "they", "it", "was", "were", "is", "are", "had", "have",
+    "qqqzzz1", "qqqzzz2", "qqqzzz3", "qqqzzz4",
+};
+
+static const char* mixed_keywords[] = { "the", "Th.*ng", "Alice", "a.b", "^[A-Z]", "whale", "the" };
+
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Ficheiros da pasta, lidos para memória (cada um terminado em '\0').
+ */
+typedef struct {
+    char** data;
+    size_t* sizes;
+    int count;
+    size_t total;
+} BenchFiles;
+
+/**
+ * @brief Lê os ficheiros regulares da pasta.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+static int load_files(const char* folder, BenchFiles* files) {
+    DIR* dir = opendir(folder);
+    if (!dir) return -1;
+    memset(files, 0, sizeof(BenchFiles));
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[PATH_MAX];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", folder, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) continue;
+        char* data = malloc(st.st_size + 1);
+        files->data = realloc(files->data, (files->count + 1) * sizeof(char*));
+        files->sizes = realloc(files->sizes, (files->count + 1) * sizeof(size_t));
+        if (!data || !files->data || !files->sizes) {
+            close(fd);
+            closedir(dir);
+            return -1;
+        }
+        size_t done = 0;
+        ssize_t n;
+        while (done < (size_t)st.st_size && (n = read(fd, data + done, st.st_size - done)) > 0) done += n;
+        close(fd);
+        data[done] = '\0';
+        files->data[files->count] = data;
+        files->sizes[files->count++] = done;
+        files->total += done;
+    }
+    closedir(dir);
+    return 0;
+}
+
+/**
+ * @brief Mede K palavras-chave com os dois métodos e escreve uma linha da tabela.
+ *
+ * @return 0 se as contagens coincidem, 1 caso contrário.
+ */
+static int bench_keywords_set(const BenchFiles* files, const char* const* keywords, int k, const char* label, int reps) {
+    Matcher* matchers = malloc(k * sizeof(Matcher));
+    int* has_matcher = malloc(k * sizeof(int));
+    long* single = calloc((size_t)files->count * k, sizeof(long));
+    long* multi = calloc((size_t)files->count * k, sizeof(long));
+    MultiMatcher mm;
+    if (!matchers || !has_matcher || !single || !multi || multi_matcher_init(&mm, keywords, k) != 0) {
+        perror("Erro ao preparar o benchmark");
+        exit(EXIT_FAILURE);
+    }
+    for (int j = 0; j < k; j++) has_matcher[j] = (matcher_init(&matchers[j], keywords[j]) == 0);
+
+    double start = now_us();
+    for (int r = 0; r < reps; r++) {
+        for (int f = 0; f < files->count; f++) {
+            for (int j = 0; j < k; j++) {
+                single[(size_t)f * k + j] = has_matcher[j] ? matcher_count_lines_buffer(&matchers[j], files->data[f], files->sizes[f], 0) : -1;
+            }
+        }
+    }
+    double single_us = (now_us() - start) / reps;
+
+    start = now_us();
+    for (int r = 0; r < reps; r++) {
+        for (int f = 0; f < files->count; f++) {
+            multi_matcher_count_lines_buffer(&mm, files->data[f], files->sizes[f], 0, &multi[(size_t)f * k]);
+        }
+    }
+    double multi_us = (now_us() - start) / reps;
+
+    int same = (memcmp(single, multi, (size_t)files->count * k * sizeof(long)) == 0);
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "%-8s %4d %14.1f %14.1f %10.1f %8.1fx%s\n",
+                       label, k, single_us, multi_us, files->total / multi_us, multi_us > 0 ? single_us / multi_us : 0.0,
+                       same ? "" : "  <-- DIVERGE");
+    write(STDOUT_FILENO, msg, len);
+
+    for (int j = 0; j < k; j++) {
+        if (has_matcher[j]) matcher_destroy(&matchers[j]);
+    }
+    multi_matcher_destroy(&mm);
+    free(matchers);
+    free(has_matcher);
+    free(single);
+    free(multi);
+    return same ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "");
+    if (argc < 2) {
+        write(STDERR_FILENO, "Uso: ./bench_multi_matcher pasta_documentos [repeticoes]\n",
+              strlen("Uso: ./bench_multi_matcher pasta_documentos [repeticoes]\n"));
+        return 1;
+    }
+    int reps = (argc > 2) ? atoi(argv[2]) : BENCH_DEFAULT_REPS;
+    if (reps <= 0) reps = BENCH_DEFAULT_REPS;
+
+    BenchFiles files;
+    if (load_files(argv[1], &files) != 0 || files.count == 0) {
+        perror("Erro ao ler a pasta de documentos");
+        return 1;
+    }
+
+    char header[256];
+    int len = snprintf(header, sizeof(header), "%d ficheiros, %zu bytes\n%-8s %4s %14s %14s %10s %9s\n",
+                       files.count, files.total, "conjunto", "K", "K matchers(us)", "multi(us)", "MB/s", "ganho");
+    write(STDOUT_FILENO, header, len);
+
+    int mismatches = 0;
+    int num_keywords = sizeof(bench_keywords) / sizeof(bench_keywords[0]);
+    for (int k = 1; k < num_keywords * 2; k *= 2) { // 1, 2, 4, ... e todas.
+        int n = (k < num_keywords) ? k : num_keywords;
+        mismatches += bench_keywords_set(&files, bench_keywords, n, "literais", reps);
+    }
+    mismatches += bench_keywords_set(&files, mixed_keywords, sizeof(mixed_keywords) / sizeof(mixed_keywords[0]), "mistas", reps);
+
+    for (int f = 0; f < files.count; f++) free(files.data[f]);
+    free(files.data);
+    free(files.sizes);
+
+    if (mismatches > 0) {
+        char msg[128];
+        len = snprintf(msg, sizeof(msg), "ERRO: %d conjuntos com contagens diferentes.\n", mismatches);
+        write(STDERR_FILENO, msg, len);
+        return 1;
+    }
+    return 0;
+}
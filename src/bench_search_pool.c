@@ -0,0 +1,160 @@
+#include "Document_Struct.h"
+#include "Matcher.h"
+#include "Search_Pool.h"
+#include <dirent.h> // Para opendir, readdir (listar os documentos da pasta).
+#include <locale.h> // Para setlocale (mesmo locale que o servidor).
+
+// Benchmark da pesquisa paralela no pool de threads (ver Search_Pool.h).
+// Os ficheiros da pasta, repetidos `copias` vezes pela ordem em que foram listados (como
+// documentos com IDs seguidos), são pesquisados com uma palavra-chave que não ocorre (cada
+// ficheiro é lido até ao fim): em série, no pool escalonado pelo tamanho dos ficheiros e no
+// pool sem o tamanho (itens distribuídos pela ordem dos IDs). A diferença entre os dois
+// últimos mostra o efeito de um ficheiro muito maior do que os outros (ex: 14.txt).
+// Todos os métodos têm de encontrar os mesmos documentos.
+//
+// Uso: ./bench_search_pool pasta_documentos [copias] [threads_max] [palavra-chave]
+//      (por defeito: 20 cópias, até 4 threads, palavra-chave "zzzzqqq")
+
+#define BENCH_REPS 3
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Conjunto de ficheiros a pesquisar.
+ */
+typedef struct {
+    char (*paths)[PATH_MAX];
+    long* sizes;
+    long* no_sizes;
+    int count;
+    const Matcher* matcher;
+} BenchFiles;
+
+static int scan_file(int item, void* ctx) {
+    const BenchFiles* files = ctx;
+    return matcher_count_lines_file(files->matcher, files->paths[item], 1) > 0;
+}
+
+/**
+ * @brief Lista os ficheiros regulares da pasta e repete a lista `copies` vezes.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+static int load_files(const char* folder, int copies, BenchFiles* files) {
+    DIR* dir = opendir(folder);
+    if (!dir) return -1;
+    char (*names)[PATH_MAX] = NULL;
+    long* sizes = NULL;
+    int n = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[PATH_MAX];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", folder, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        names = realloc(names, (n + 1) * sizeof(*names));
+        sizes = realloc(sizes, (n + 1) * sizeof(long));
+        if (!names || !sizes) return -1;
+        strcpy(names[n], path);
+        sizes[n] = st.st_size;
+        n++;
+    }
+    closedir(dir);
+    if (n == 0) return -1;
+
+    files->count = n * copies;
+    files->paths = malloc(files->count * sizeof(*files->paths));
+    files->sizes = malloc(files->count * sizeof(long));
+    files->no_sizes = calloc(files->count, sizeof(long));
+    if (!files->paths || !files->sizes || !files->no_sizes) return -1;
+    for (int c = 0; c < copies; c++) {
+        for (int i = 0; i < n; i++) {
+            strcpy(files->paths[c * n + i], names[i]);
+            files->sizes[c * n + i] = sizes[i];
+        }
+    }
+    free(names);
+    free(sizes);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "");
+    if (argc < 2) {
+        write(STDERR_FILENO, "Uso: ./bench_search_pool pasta_documentos [copias] [threads_max] [palavra-chave]\n",
+              strlen("Uso: ./bench_search_pool pasta_documentos [copias] [threads_max] [palavra-chave]\n"));
+        return 1;
+    }
+    int copies = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 20;
+    int max_threads = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 4;
+    if (max_threads > SEARCH_POOL_MAX_THREADS) max_threads = SEARCH_POOL_MAX_THREADS;
+    const char* keyword = (argc > 4) ? argv[4] : "zzzzqqq";
+
+    BenchFiles files;
+    Matcher matcher;
+    if (load_files(argv[1], copies, &files) != 0 || matcher_init(&matcher, keyword) != 0) {
+        perror("Erro ao preparar os ficheiros");
+        return 1;
+    }
+    files.matcher = &matcher;
+    unsigned char* expected = malloc(files.count);
+    unsigned char* matched = malloc(files.count);
+    if (!expected || !matched) {
+        perror("Erro de alocação");
+        return 1;
+    }
+
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "%d ficheiros, palavra-chave '%s'\n%-22s %8s %12s %10s\n",
+                       files.count, keyword, "metodo", "threads", "tempo (ms)", "speedup");
+    write(STDOUT_FILENO, msg, len);
+
+    // Em série (e aquece o page cache).
+    for (int i = 0; i < files.count; i++) expected[i] = (unsigned char)scan_file(i, &files);
+    double start = now_ms();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int i = 0; i < files.count; i++) matched[i] = (unsigned char)scan_file(i, &files);
+    }
+    double serial_ms = (now_ms() - start) / BENCH_REPS;
+    len = snprintf(msg, sizeof(msg), "%-22s %8d %12.1f %10.2f\n", "serie", 1, serial_ms, 1.0);
+    write(STDOUT_FILENO, msg, len);
+
+    int mismatches = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        SearchPool pool;
+        if (search_pool_init(&pool, threads) != 0) {
+            perror("Erro ao criar o pool");
+            return 1;
+        }
+        for (int by_size = 1; by_size >= 0; by_size--) {
+            start = now_ms();
+            for (int r = 0; r < BENCH_REPS; r++) {
+                memset(matched, 0, files.count);
+                search_pool_run(&pool, files.count, by_size ? files.sizes : files.no_sizes, scan_file, &files, matched);
+            }
+            double ms = (now_ms() - start) / BENCH_REPS;
+            int same = (memcmp(matched, expected, files.count) == 0);
+            if (!same) mismatches++;
+            len = snprintf(msg, sizeof(msg), "%-22s %8d %12.1f %10.2f%s\n", by_size ? "pool (por tamanho)" : "pool (por ID)",
+                           threads, ms, serial_ms / ms, same ? "" : "  <-- DIVERGE");
+            write(STDOUT_FILENO, msg, len);
+        }
+        search_pool_destroy(&pool);
+    }
+
+    matcher_destroy(&matcher);
+    free(expected);
+    free(matched);
+    free(files.paths);
+    free(files.sizes);
+    free(files.no_sizes);
+    if (mismatches > 0) {
+        write(STDERR_FILENO, "ERRO: resultados divergem.\n", strlen("ERRO: resultados divergem.\n"));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "Document_Struct.h"
+#include "Client_Conn.h"
+#include "Doc_Log.h"        // Para LOG_FILE
+#include "Inverted_Index.h" // Para INDEX_FILE
+#include <sys/mman.h>       // Para mmap (latências partilhadas com os processos clientes)
+
+// Benchmark dos transportes cliente-servidor (FIFOs vs. socket Unix).
+// Para cada transporte, lança um dserver numa pasta temporária (`-t fifo` / `-t unix`),
+// adiciona um documento e mede pedidos QUERY_DOC feitos por `clientes` processos em
+// simultâneo, cada um com `pedidos` pedidos seguidos:
+//  - "por pedido": uma ligação nova por pedido (como cada execução do dclient);
+//  - "sessão": uma ligação aberta durante todos os pedidos (como dclient -i).
+// Reporta o débito (pedidos/s) e a latência de cada pedido (mediana, p99, máximo).
+// O documento está sempre na cache: o custo medido é o do transporte e da fila de pedidos.
+//
+// Uso: ./bench_transport dserver [clientes] [pedidos] [pasta_temporaria]
+//      (por defeito: 8 clientes, 2000 pedidos cada, em /tmp)
+
+static const char* transport_names[] = { "auto", "fifo", "unix" };
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Lança o servidor na pasta `work_dir` (que é também a pasta dos documentos) e espera que fique à escuta.
+ *
+ * @return O PID do servidor, ou -1 em caso de erro.
+ */
+static pid_t start_server(const char* server_path, const char* work_dir, int transport) {
+    const char* endpoint = (transport == TRANSPORT_UNIX) ? SERVER_SOCKET : SERVER_PIPE;
+    unlink(SERVER_PIPE);
+    unlink(SERVER_SOCKET);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        if (chdir(work_dir) != 0) _exit(1);
+        execl(server_path, server_path, ".", "-t", transport_names[transport], (char*)NULL);
+        perror("Erro ao executar o servidor");
+        _exit(1);
+    }
+    for (int i = 0; i < 500; i++) { // Até 5 s.
+        if (access(endpoint, F_OK) == 0) return pid;
+        if (waitpid(pid, NULL, WNOHANG) == pid) return -1;
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+/**
+ * @brief Envia um pedido com uma ligação própria.
+ *
+ * @return O estado da resposta, ou -1 se não foi possível comunicar com o servidor.
+ */
+static int one_request(int transport, int operation, const char* path) {
+    ClientConn conn;
+    Request req;
+    Response resp;
+    memset(&req, 0, sizeof(Request));
+    req.operation = operation;
+    if (path) {
+        strcpy(req.doc.title, "bench");
+        strcpy(req.doc.authors, "bench");
+        strcpy(req.doc.year, "2000");
+        strcpy(req.doc.path, path);
+    }
+    client_conn_init(&conn, transport, 0);
+    if (client_conn_request(&conn, &req, NULL, &resp) != 0) return -1;
+    free(resp.ids);
+    return resp.status;
+}
+
+/**
+ * @brief Processo cliente: faz `reqs` consultas ao documento 1 e guarda a latência de cada uma.
+ */
+static void run_client(int transport, int persistent, int reqs, double* latencies) {
+    ClientConn conn;
+    client_conn_init(&conn, transport, persistent);
+    for (int i = 0; i < reqs; i++) {
+        Request req;
+        Response resp;
+        memset(&req, 0, sizeof(Request));
+        req.operation = QUERY_DOC;
+        req.doc.id = 1;
+        double start = now_ns();
+        if (client_conn_request(&conn, &req, NULL, &resp) != 0 || resp.status != 0) _exit(1);
+        latencies[i] = now_ns() - start;
+        free(resp.ids);
+    }
+    client_conn_close(&conn);
+    _exit(0);
+}
+
+/**
+ * @brief Mede um transporte num modo (ligação por pedido ou sessão) e escreve uma linha do relatório.
+ *
+ * @return 0 em caso de sucesso, -1 se algum cliente falhou.
+ */
+static int bench_mode(int transport, int persistent, int clients, int reqs, double* latencies) {
+    double start = now_ns();
+    for (int c = 0; c < clients; c++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("Erro ao criar processo cliente");
+            return -1;
+        }
+        if (pid == 0) run_client(transport, persistent, reqs, latencies + (size_t)c * reqs);
+    }
+    int failed = 0;
+    for (int c = 0; c < clients; c++) {
+        int status;
+        if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+    double elapsed = now_ns() - start;
+    if (failed) return -1;
+
+    size_t total = (size_t)clients * reqs;
+    qsort(latencies, total, sizeof(double), compare_doubles);
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "%-6s %-11s %12.0f %12.1f %12.1f %12.1f\n",
+                       transport_names[transport], persistent ? "sessão" : "por pedido", total / (elapsed / 1e9),
+                       latencies[total / 2] / 1e3, latencies[total * 99 / 100] / 1e3, latencies[total - 1] / 1e3);
+    write(STDOUT_FILENO, msg, len);
+    return 0;
+}
+
+/**
+ * @brief Mede um transporte: lança o servidor, mede os dois modos e encerra-o.
+ */
+static int bench_transport(const char* server_path, const char* work_dir, int transport,
+                           int clients, int reqs, double* latencies) {
+    pid_t server = start_server(server_path, work_dir, transport);
+    if (server < 0) {
+        write(STDERR_FILENO, "Erro ao lançar o servidor.\n", strlen("Erro ao lançar o servidor.\n"));
+        return -1;
+    }
+    int result = -1;
+    if (one_request(transport, ADD_DOC, "bench.txt") >= 0) {
+        result = bench_mode(transport, 0, clients, reqs, latencies);
+        if (result == 0) result = bench_mode(transport, 1, clients, reqs, latencies);
+    }
+    one_request(transport, SHUTDOWN, NULL);
+    waitpid(server, NULL, 0);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        write(STDERR_FILENO, "Uso: ./bench_transport dserver [clientes] [pedidos] [pasta_temporaria]\n",
+              strlen("Uso: ./bench_transport dserver [clientes] [pedidos] [pasta_temporaria]\n"));
+        return 1;
+    }
+    char server_path[PATH_MAX];
+    if (!realpath(argv[1], server_path)) {
+        perror("Erro ao encontrar o servidor");
+        return 1;
+    }
+    int clients = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 8;
+    int reqs = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 2000;
+    const char* tmp_dir = (argc > 4) ? argv[4] : "/tmp";
+
+    // Pasta de trabalho do servidor (database.bin, log, índice) com o único documento.
+    char work_dir[PATH_MAX], doc_path[PATH_MAX + 16];
+    snprintf(work_dir, sizeof(work_dir), "%s/bench_transport_%d", tmp_dir, getpid());
+    snprintf(doc_path, sizeof(doc_path), "%s/bench.txt", work_dir);
+    int fd = (mkdir(work_dir, 0755) == 0) ? open(doc_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (fd < 0 || write(fd, "bench\n", 6) != 6) {
+        perror("Erro ao preparar a pasta temporária");
+        return 1;
+    }
+    close(fd);
+
+    size_t total = (size_t)clients * reqs;
+    double* latencies = mmap(NULL, total * sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (latencies == MAP_FAILED) {
+        perror("Erro de alocação");
+        return 1;
+    }
+
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "%d clientes x %d pedidos QUERY_DOC\n%-6s %-11s %12s %12s %12s %12s\n",
+                       clients, reqs, "transp", "ligação", "pedidos/s", "p50 (us)", "p99 (us)", "max (us)");
+    write(STDOUT_FILENO, msg, len);
+
+    signal(SIGPIPE, SIG_IGN);
+    int failed = 0;
+    if (bench_transport(server_path, work_dir, TRANSPORT_FIFO, clients, reqs, latencies) != 0) failed = 1;
+    if (bench_transport(server_path, work_dir, TRANSPORT_UNIX, clients, reqs, latencies) != 0) failed = 1;
+
+    const char* files[] = { "bench.txt", "database.bin", LOG_FILE, INDEX_FILE };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        char path[PATH_MAX + 32];
+        snprintf(path, sizeof(path), "%s/%s", work_dir, files[i]);
+        unlink(path);
+    }
+    rmdir(work_dir);
+    munmap(latencies, total * sizeof(double));
+    if (failed) {
+        write(STDERR_FILENO, "ERRO: um dos transportes falhou.\n", strlen("ERRO: um dos transportes falhou.\n"));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,477 @@
+#include "Document_Struct.h"
+#include "Client_Conn.h"
+#include <sys/socket.h> // Para socket, connect, send, recv
+#include <sys/un.h>     // Para struct sockaddr_un
+#include <poll.h>       // Para poll (espera pela resposta no FIFO do cliente)
+
+/**
+ * @brief Lê exatamente `len` bytes de um descritor (um pipe pode devolver menos por leitura).
+ *
+ * O FIFO do cliente está aberto sem bloquear: espera por dados com poll antes de cada leitura.
+ * Enquanto o servidor ainda não o abriu para escrita, o poll não indica nada (nem o fim).
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro ou fim do ficheiro antes de `len` bytes.
+ */
+static int read_fully(int fd, void* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) return -1;
+        ssize_t n = read(fd, (char*)buf + done, len - done);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) return -1;
+        done += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Verifica o cabeçalho de uma trama.
+ */
+static int valid_header(const ResponseHeader* header) {
+    if (header->payload_len < 0 ||
+        header->payload_len > (int)(RESPONSE_MAX_FRAME - sizeof(ResponseHeader))) return 0;
+    if ((header->operation == SEARCH_DOCS || header->operation == BULK_ADD || header->operation == MULTI_COUNT ||
+         header->operation == MULTI_SEARCH || header->operation == SEARCH_QUERY || header->operation == RANKED_SEARCH) &&
+        header->payload_len != header->value * (int)sizeof(int)) return 0;
+    if ((header->operation == MULTI_QUERY || header->operation == META_SEARCH) &&
+        header->payload_len != header->value * (int)sizeof(Document)) return 0;
+    return 1;
+}
+
+/**
+ * @brief Lê uma trama de resposta: o cabeçalho e os seus dados (até RESPONSE_MAX_FRAME bytes).
+ *
+ * Num FIFO a trama é lida como uma sequência de bytes; num socket SOCK_SEQPACKET é uma
+ * mensagem, lida de uma vez.
+ *
+ * @return 0 em caso de sucesso, -1 se a trama estiver incompleta ou for inválida.
+ */
+static int read_frame(int fd, int transport, ResponseHeader* header, char* payload) {
+    if (transport == TRANSPORT_UNIX) {
+        char frame[RESPONSE_MAX_FRAME];
+        ssize_t n;
+        do {
+            n = recv(fd, frame, sizeof(frame), 0);
+        } while (n < 0 && errno == EINTR);
+        if (n < (ssize_t)sizeof(ResponseHeader)) return -1;
+        memcpy(header, frame, sizeof(ResponseHeader));
+        if (!valid_header(header) || header->payload_len != n - (ssize_t)sizeof(ResponseHeader)) return -1;
+        memcpy(payload, frame + sizeof(ResponseHeader), header->payload_len);
+        return 0;
+    }
+    if (read_fully(fd, header, sizeof(ResponseHeader)) != 0) return -1;
+    if (!valid_header(header)) return -1;
+    return read_fully(fd, payload, header->payload_len);
+}
+
+/**
+ * @brief Liga-se ao socket do servidor.
+ *
+ * @return O descritor do socket ligado, ou -1 se o servidor não estiver a escutar no socket.
+ */
+static int connect_server_socket() {
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Prepara uma ligação (ainda sem descritores abertos).
+ *
+ * @param conn A ligação.
+ * @param transport TRANSPORT_AUTO, TRANSPORT_FIFO ou TRANSPORT_UNIX.
+ * @param persistent 1 para manter a ligação aberta entre pedidos (sessão).
+ */
+void client_conn_init(ClientConn* conn, int transport, int persistent) {
+    memset(conn, 0, sizeof(ClientConn));
+    conn->requested_transport = transport;
+    conn->transport = transport;
+    conn->persistent = persistent;
+    conn->server_fd = -1;
+    conn->reply_fd = -1;
+}
+
+/**
+ * @brief Fecha os descritores da ligação e remove o FIFO do cliente, sem avisar o servidor.
+ *
+ * A ligação pode voltar a ser usada (volta a escolher o transporte no próximo pedido).
+ */
+static void drop_conn(ClientConn* conn) {
+    if (conn->server_fd >= 0) close(conn->server_fd);
+    if (conn->reply_fd >= 0) close(conn->reply_fd);
+    if (conn->client_pipe[0] != '\0') unlink(conn->client_pipe);
+    conn->server_fd = conn->reply_fd = -1;
+    conn->session_open = 0;
+    conn->client_pipe[0] = '\0';
+    conn->transport = conn->requested_transport;
+}
+
+/**
+ * @brief Fecha a ligação.
+ *
+ * Numa sessão FIFO aberta, avisa primeiro o servidor (END_SESSION) para que feche o seu lado;
+ * com o socket, basta fechá-lo.
+ */
+void client_conn_close(ClientConn* conn) {
+    if (conn->transport == TRANSPORT_FIFO && conn->session_open && conn->server_fd >= 0) {
+        Request req;
+        memset(&req, 0, sizeof(Request));
+        req.operation = END_SESSION;
+        req.client_pid = getpid();
+        req.session = SESSION_ACTIVE;
+        write(conn->server_fd, &req, sizeof(Request));
+    }
+    drop_conn(conn);
+}
+
+/**
+ * @brief Tamanho em bytes do lote de um pedido (ver BATCH_PIPE_FORMAT).
+ */
+static size_t batch_bytes(const Request* req) {
+    size_t item_size = sizeof(Document); // BULK_ADD.
+    if (req->operation == MULTI_QUERY) item_size = sizeof(int);
+    else if (req->operation == MULTI_COUNT) item_size = sizeof(CountItem);
+    else if (req->operation == MULTI_SEARCH) item_size = MAX_KEYWORD_SIZE;
+    else if (req->operation == SEARCH_QUERY) item_size = 1;
+    return (size_t)req->batch_size * item_size;
+}
+
+/**
+ * @brief Cria o FIFO de lote, onde os elementos do lote são escritos depois de o pedido ser enviado.
+ */
+static int create_batch_pipe(char* batch_pipe, size_t size) {
+    snprintf(batch_pipe, size, BATCH_PIPE_FORMAT, getpid());
+    unlink(batch_pipe);
+    if (mkfifo(batch_pipe, 0666) < 0) {
+        perror("Erro ao criar pipe do lote (mkfifo)");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Escreve o lote no FIFO de lote (bloqueia até o servidor o abrir) e remove o FIFO.
+ *
+ * Se o servidor deixar de o ler, a escrita falha (com SIGPIPE ignorado) e a resposta indica
+ * os elementos que não chegaram.
+ */
+static void send_batch(const char* batch_pipe, const void* batch, size_t len) {
+    int batch_fd = open(batch_pipe, O_WRONLY);
+    if (batch_fd >= 0) {
+        size_t done = 0;
+        while (done < len) {
+            ssize_t n = write(batch_fd, (const char*)batch + done, len - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += n;
+        }
+        close(batch_fd);
+    } else {
+        perror("Erro ao abrir pipe do lote para escrita");
+    }
+    unlink(batch_pipe);
+}
+
+/**
+ * @brief Envia o lote pela ligação ao socket, em mensagens de até BATCH_MESSAGE_SIZE bytes.
+ *
+ * Se o servidor deixar de o ler (fecha o lado da leitura da ligação), o envio falha e a
+ * resposta indica os elementos que não chegaram.
+ */
+static void send_batch_socket(int fd, const void* batch, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        size_t size = (len - done < BATCH_MESSAGE_SIZE) ? len - done : BATCH_MESSAGE_SIZE;
+        ssize_t n = send(fd, (const char*)batch + done, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+}
+
+/**
+ * @brief Envia o pedido pela ligação ao socket (abrindo-a se necessário).
+ */
+static int send_request_socket(ClientConn* conn, const Request* req) {
+    if (conn->server_fd < 0) conn->server_fd = connect_server_socket();
+    if (conn->server_fd < 0) {
+        perror("Erro ao ligar ao socket do servidor");
+        write(STDERR_FILENO, "O servidor está em execução?\n", strlen("O servidor está em execução?\n"));
+        return -1;
+    }
+    if (send(conn->server_fd, req, sizeof(Request), MSG_NOSIGNAL) != sizeof(Request)) {
+        perror("Erro ao enviar o pedido pelo socket do servidor");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Envia o pedido pelos FIFOs (passos 1 a 5 descritos em `client_conn_request`).
+ */
+static int send_request_fifo(ClientConn* conn, Request* req, const void* batch, char* batch_pipe) {
+    // 1. Abrir o FIFO (pipe nomeado) do servidor para escrita.
+    //    O cliente escreve a sua requisição neste FIFO. Em sessão, fica aberto para os pedidos seguintes.
+    if (conn->server_fd < 0) conn->server_fd = open(SERVER_PIPE, O_WRONLY);
+    if (conn->server_fd < 0) {
+        // Se não conseguir abrir, assume que o servidor não está em execução ou há outro erro.
+        perror("Erro ao abrir pipe do servidor para escrita (send_request)");
+        write(STDERR_FILENO, "O servidor está em execução?\n", strlen("O servidor está em execução?\n"));
+        return -1;
+    }
+
+    // 2. Criar o FIFO (pipe nomeado) específico deste cliente para receber a resposta.
+    //    Em sessão, só é criado (e aberto) no primeiro pedido.
+    //    Gera o nome do FIFO usando o PID do cliente para garantir unicidade.
+    if (conn->client_pipe[0] == '\0') {
+        snprintf(conn->client_pipe, sizeof(conn->client_pipe), CLIENT_PIPE_FORMAT, getpid());
+        unlink(conn->client_pipe); // Remove o FIFO se já existir de uma execução anterior (precaução).
+
+        //    Cria o FIFO com permissões de leitura/escrita para o utilizador (e servidor).
+        if (mkfifo(conn->client_pipe, 0666) < 0) {
+            perror("Erro ao criar pipe do cliente (mkfifo)");
+            conn->client_pipe[0] = '\0';
+            return -1;
+        }
+    }
+
+    // 3. Abrir o FIFO do cliente para leitura, sem bloquear, antes de enviar o pedido.
+    //    O servidor abre-o para escrita também sem bloquear: só consegue se já houver um leitor.
+    if (conn->reply_fd < 0) conn->reply_fd = open(conn->client_pipe, O_RDONLY | O_NONBLOCK);
+    if (conn->reply_fd < 0) {
+        perror("Erro ao abrir pipe do cliente para leitura");
+        return -1;
+    }
+
+    //    Preencher o modo de sessão na requisição.
+    //    Em sessão, o servidor guarda o descritor aberto no primeiro pedido e reutiliza-o nos seguintes.
+    if (!conn->persistent) req->session = SESSION_NONE;
+    else req->session = conn->session_open ? SESSION_ACTIVE : SESSION_BEGIN;
+
+    //    O FIFO de lote tem de existir antes de o servidor receber o pedido.
+    if (batch && create_batch_pipe(batch_pipe, 128) != 0) return -1;
+
+    // 4. Enviar a requisição para o servidor através do FIFO do servidor.
+    ssize_t bytes_escritos = write(conn->server_fd, req, sizeof(Request));
+    if (bytes_escritos < 0) {
+        perror("Erro ao escrever no pipe do servidor");
+        return -1;
+    }
+    if (bytes_escritos != sizeof(Request)) {
+        fprintf(stderr, "Erro: Escrita incompleta para o pipe do servidor. Esperado: %zu, Escrito: %zd\n", sizeof(Request), bytes_escritos);
+        return -1;
+    }
+    // 5. Fechar o descritor do FIFO do servidor após a escrita (em sessão, mantém-no).
+    if (conn->persistent) conn->session_open = 1;
+    else {
+        close(conn->server_fd);
+        conn->server_fd = -1;
+    }
+
+    if (batch) send_batch(batch_pipe, batch, batch_bytes(req));
+    return 0;
+}
+
+/**
+ * @brief Envia um pedido (requisição) ao servidor e recebe a resposta correspondente.
+ *
+ * Esta função é o coração da comunicação do cliente com o servidor. Com o transporte
+ * TRANSPORT_FIFO, utiliza dois pipes nomeados (FIFOs) para realizar esta comunicação:
+ * 1. FIFO do Servidor (SERVER_PIPE): Usado pelo cliente para enviar o seu pedido ao servidor.
+ * É um canal conhecido por todos os clientes e pelo servidor.
+ * 2. FIFO do Cliente (client_pipe_XXX): Um FIFO único criado por este cliente, usado
+ * pelo servidor para enviar a resposta especificamente a este cliente. O nome
+ * inclui o PID (Process ID) do cliente para garantir a sua unicidade.
+ *
+ * ## Funcionamento Detalhado dos Pipes Nomeados (FIFOs) na Comunicação Cliente-Servidor:
+ *
+ * ### O que são Pipes Nomeados (FIFOs)?
+ * Pipes nomeados, ou FIFOs (First-In, First-Out), são ficheiros especiais no sistema
+ * de ficheiros que permitem a comunicação entre processos que não necessitam de
+ * ter uma relação de parentesco (como é o caso de pipes anónimos). Funcionam como
+ * um tubo: o que é escrito numa extremidade pode ser lido na outra, pela ordem de chegada.
+ * São persistentes no sistema de ficheiros (até serem explicitamente removidos),
+ * o que permite que processos independentes os encontrem e utilizem através do seu nome.
+ *
+ * ### Fluxo de Comunicação com FIFOs:
+ *
+ * 1.  **Abrir o FIFO do Servidor para Escrita (`SERVER_PIPE`):**
+ * -   **Porquê?** O cliente precisa de um canal para enviar o seu pedido ao servidor.
+ * O `SERVER_PIPE` é o "balcão de atendimento" do servidor, onde todos os clientes
+ * enviam os seus pedidos.
+ * -   **Onde e Como?** O cliente abre o `SERVER_PIPE` (que já deve ter sido criado
+ * pelo servidor) em modo de escrita (`O_WRONLY`).
+ * `int server_fd = open(SERVER_PIPE, O_WRONLY);`
+ * -   Se esta abertura falhar, geralmente significa que o servidor não está em execução
+ * ou que o FIFO não existe.
+ *
+ * 2.  **Criar o FIFO Específico do Cliente (`client_pipe_PID`):**
+ * -   **Porquê?** Após o servidor processar o pedido, ele precisa de enviar uma
+ * resposta de volta ao cliente que fez o pedido. Se o servidor escrevesse
+ * no `SERVER_PIPE`, todos os clientes poderiam tentar ler, gerando confusão.
+ * Assim, cada cliente cria o seu próprio FIFO de resposta, com um nome único
+ * (geralmente usando o seu PID - Process ID). O cliente informa o servidor
+ * sobre o nome deste FIFO (ou, como neste caso, o servidor constrói o nome
+ * do pipe do cliente usando o PID enviado no pedido).
+ * -   **Onde e Como?** O cliente gera um nome único para o seu FIFO (ex: `/tmp/client_pipe_1234`).
+ * `snprintf(client_pipe, sizeof(client_pipe), CLIENT_PIPE_FORMAT, getpid());`
+ * Antes de criar, remove qualquer FIFO com o mesmo nome que possa ter ficado
+ * de uma execução anterior (`unlink(client_pipe);`).
+ * Depois, cria o FIFO com `mkfifo(client_pipe, 0666);`. As permissões `0666`
+ * permitem leitura e escrita pelo proprietário, grupo e outros (o servidor
+ * precisará de permissão de escrita).
+ *
+ * 3.  **Abrir o FIFO do Cliente para Leitura (antes de enviar o pedido):**
+ * -   **Porquê?** O servidor escreve as respostas sem nunca bloquear (um cliente lento
+ * não pode atrasar os outros): abre o `client_pipe` para escrita com `O_NONBLOCK`, o que
+ * só tem sucesso se o FIFO já tiver um leitor. Por isso o cliente abre-o antes de o pedido
+ * partir, também com `O_NONBLOCK` (senão bloquearia à espera de um escritor).
+ * `int client_fd = open(client_pipe, O_RDONLY | O_NONBLOCK);`
+ *
+ * 4.  **Enviar o Pedido ao Servidor:**
+ * -   O cliente preenche a estrutura `Request` com os dados da operação e o seu PID.
+ * `req.client_pid = getpid();`
+ * -   O cliente escreve a estrutura `Request` no `server_fd` (o FIFO do servidor).
+ * `write(server_fd, &req, sizeof(Request));`
+ *
+ * 5.  **Fechar a Extremidade de Escrita do FIFO do Servidor:**
+ * -   **Porquê?** O cliente já enviou o seu pedido. Manter a extremidade de escrita
+ * aberta desnecessariamente pode ter implicações, especialmente se o servidor
+ * espera que todos os escritores fechem o pipe para detetar certas condições.
+ * É uma boa prática fechar descritores de ficheiro assim que não são mais necessários.
+ * -   **Onde e Como?** `close(server_fd);`
+ *
+ * 6.  **Ler a Resposta do Servidor:**
+ * -   **Espera:** O cliente espera com `poll` que haja dados no `client_pipe`. Enquanto o
+ * servidor não o abrir para escrita, o `poll` não indica nada: é um mecanismo de
+ * sincronização, o cliente espera que o servidor esteja pronto para enviar a resposta.
+ * -   A resposta chega em tramas (ver `ResponseHeader`): um cabeçalho seguido de `payload_len` bytes.
+ * O cliente lê tramas (`read_frame`) enquanto o cabeçalho tiver `RESPONSE_MORE`,
+ * acumulando os IDs de uma pesquisa num array que cresce conforme necessário.
+ * Se o servidor fechar o pipe a meio de uma resposta, o pedido falha.
+ *
+ * Numa ligação persistente (`dclient -i`), os passos 1, 2 e 3 só acontecem no primeiro pedido: os dois
+ * FIFOs ficam abertos e o servidor guarda o descritor de escrita do FIFO do cliente
+ * (campo `session` do pedido), poupando a criação, abertura e remoção de FIFOs por pedido.
+ *
+ * 7.  **Fechar e Remover o FIFO do Cliente:**
+ * -   **Porquê?** A comunicação terminou. O FIFO do cliente já cumpriu o seu propósito
+ * para este pedido/resposta específico.
+ * -   **Fechar a Extremidade de Leitura:** `close(client_fd);`
+ * -   **Remover o FIFO do Sistema de Ficheiros:** `unlink(client_pipe);`
+ * Se não for removido, o ficheiro FIFO permanecerá no sistema de ficheiros.
+ * É importante limpar estes FIFOs temporários.
+ *
+ * Esta sequência garante uma comunicação organizada e específica entre um cliente e o servidor.
+ *
+ * ### Fluxo de Comunicação com o Socket (TRANSPORT_UNIX):
+ * O cliente liga-se a SERVER_SOCKET (`connect`), envia o pedido como uma mensagem e lê as
+ * tramas da resposta da mesma ligação, uma mensagem por trama. Não há FIFOs a criar nem a
+ * remover, e a ligação é só deste cliente; numa ligação persistente fica aberta.
+ *
+ * Num pedido BULK_ADD, MULTI_QUERY, MULTI_COUNT, MULTI_SEARCH ou SEARCH_QUERY, os
+ * `req->batch_size` elementos de `batch` seguem depois do pedido: pelo FIFO de lote deste
+ * cliente (ver BATCH_PIPE_FORMAT) ou, com o socket, pela mesma ligação (ver BATCH_MESSAGE_SIZE).
+ *
+ * @param conn A ligação.
+ * @param req O pedido (o PID e o modo de sessão são preenchidos aqui).
+ * @param batch Os elementos do lote (Document, int, CountItem, char[MAX_KEYWORD_SIZE] ou os bytes
+ * da consulta, conforme a operação), ou NULL.
+ * @param resp Recebe a resposta do servidor (`ids` e `docs` alocados com malloc, ou NULL).
+ * @return 0 em caso de sucesso, -1 se não foi possível comunicar com o servidor (a mensagem
+ * de erro já foi escrita no stderr).
+ */
+int client_conn_request(ClientConn* conn, Request* req, const void* batch, Response* resp) {
+    memset(resp, 0, sizeof(Response)); // Inicializa a estrutura de resposta com zeros.
+
+    //    O servidor usará o PID para saber a que cliente (FIFO ou ligação) deve responder.
+    req->client_pid = getpid();
+    if (conn->transport == TRANSPORT_AUTO) {
+        conn->server_fd = connect_server_socket();
+        conn->transport = (conn->server_fd >= 0) ? TRANSPORT_UNIX : TRANSPORT_FIFO;
+    }
+
+    char batch_pipe[128] = "";
+    int sent;
+    if (conn->transport == TRANSPORT_UNIX) {
+        sent = send_request_socket(conn, req);
+        if (sent == 0 && batch) send_batch_socket(conn->server_fd, batch, batch_bytes(req));
+    } else {
+        sent = send_request_fifo(conn, req, batch, batch_pipe);
+        if (sent != 0 && batch) unlink(batch_pipe);
+    }
+    if (sent != 0) {
+        drop_conn(conn);
+        return -1;
+    }
+    int reply_fd = (conn->transport == TRANSPORT_UNIX) ? conn->server_fd : conn->reply_fd;
+
+    // 6. Ler a resposta do servidor, trama a trama.
+    //    A leitura é bloqueante, esperando que o servidor escreva cada trama.
+    char payload[RESPONSE_MAX_FRAME];
+    ResponseHeader header;
+    int capacity = 0;
+    do {
+        if (read_frame(reply_fd, conn->transport, &header, payload) != 0) {
+            fprintf(stderr, "Erro: Resposta do servidor incompleta ou inválida.\n");
+            fprintf(stderr, "Isto pode indicar que o servidor terminou inesperadamente.\n");
+            free(resp->ids);
+            free(resp->docs);
+            resp->ids = NULL;
+            resp->docs = NULL;
+            drop_conn(conn);
+            return -1;
+        }
+        resp->status = header.status;
+        if (header.operation == ADD_DOC) {
+            resp->doc.id = header.value;
+        } else if (header.operation == COUNT_LINES) {
+            resp->count = header.value;
+        } else if (header.operation == QUERY_DOC && header.payload_len == sizeof(Document)) {
+            memcpy(&resp->doc, payload, sizeof(Document));
+        } else if (header.operation == STATS && header.payload_len == sizeof(ServerStats)) {
+            memcpy(&resp->stats, payload, sizeof(ServerStats));
+        } else if ((header.operation == MULTI_QUERY || header.operation == META_SEARCH) && header.value > 0) {
+            if (resp->num_docs + header.value > capacity) {
+                capacity = (resp->num_docs + header.value) * 2;
+                Document* grown = realloc(resp->docs, capacity * sizeof(Document));
+                if (!grown) {
+                    perror("Erro ao alocar documentos da resposta");
+                    exit(EXIT_FAILURE);
+                }
+                resp->docs = grown;
+            }
+            memcpy(resp->docs + resp->num_docs, payload, header.value * sizeof(Document));
+            resp->num_docs += header.value;
+        } else if ((header.operation == SEARCH_DOCS || header.operation == BULK_ADD || header.operation == MULTI_COUNT ||
+                    header.operation == MULTI_SEARCH || header.operation == SEARCH_QUERY ||
+                    header.operation == RANKED_SEARCH) && header.value > 0) {
+            if (resp->num_ids + header.value > capacity) {
+                capacity = (resp->num_ids + header.value) * 2;
+                int* grown = realloc(resp->ids, capacity * sizeof(int));
+                if (!grown) {
+                    perror("Erro ao alocar IDs da resposta");
+                    exit(EXIT_FAILURE);
+                }
+                resp->ids = grown;
+            }
+            memcpy(resp->ids + resp->num_ids, payload, header.value * sizeof(int));
+            resp->num_ids += header.value;
+        }
+    } while (header.flags & RESPONSE_MORE);
+
+    // 7. Fechar a ligação e remover o FIFO do cliente.
+    //    Após receber a resposta, já não são necessários (em sessão, só quando a sessão
+    //    termina; depois de um SHUTDOWN o servidor já a fechou, e um pedido seguinte abre outra).
+    if (!conn->persistent || req->operation == SHUTDOWN) drop_conn(conn);
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "Document_Struct.h"
+#include "Client_Table.h"
+
+/**
+ * @brief Posição de um PID na tabela de dispersão.
+ */
+static int bucket_of(const ClientTable* table, int client_pid) {
+    return (int)(((unsigned)client_pid * 2654435761u) & (unsigned)(table->num_buckets - 1));
+}
+
+/**
+ * @brief Duplica a tabela de dispersão (quando há mais entradas do que posições).
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória (a tabela antiga continua válida).
+ */
+static int grow_buckets(ClientTable* table) {
+    int old_num = table->num_buckets;
+    ClientSession** old = table->buckets;
+    ClientSession** grown = calloc(old_num * 2, sizeof(ClientSession*));
+    if (!grown) return -1;
+    table->buckets = grown;
+    table->num_buckets = old_num * 2;
+    for (int b = 0; b < old_num; b++) {
+        ClientSession* s = old[b];
+        while (s) {
+            // Acrescenta no fim da nova cadeia: as entradas de um PID mantêm a ordem (a mais recente primeiro).
+            ClientSession* next = s->next_by_pid;
+            ClientSession** link = &grown[bucket_of(table, s->client_pid)];
+            while (*link) link = &(*link)->next_by_pid;
+            s->next_by_pid = NULL;
+            *link = s;
+            s = next;
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * @brief Inicializa uma tabela vazia.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int client_table_init(ClientTable* table) {
+    memset(table, 0, sizeof(ClientTable));
+    table->num_buckets = 64;
+    table->buckets = calloc(table->num_buckets, sizeof(ClientSession*));
+    return table->buckets ? 0 : -1;
+}
+
+/**
+ * @brief Fecha os descritores de todos os clientes e liberta a tabela (as respostas pendentes perdem-se).
+ */
+void client_table_destroy(ClientTable* table) {
+    while (table->count > 0) {
+        client_table_remove(table, table->sessions[table->count - 1]);
+    }
+    client_table_reap(table);
+    free(table->sessions);
+    free(table->buckets);
+    memset(table, 0, sizeof(ClientTable));
+}
+
+/**
+ * @brief Abre para escrita, sem bloquear, o FIFO de resposta de um cliente.
+ *
+ * O cliente abre o seu FIFO para leitura antes de enviar o pedido, por isso a abertura tem
+ * sucesso de imediato; se falhar com ENXIO, o cliente já não o tem aberto (terminou).
+ *
+ * @return O descritor (não bloqueante), ou -1 em caso de erro (errno indica a causa).
+ */
+int client_pipe_open(int client_pid) {
+    char client_pipe_name[128];
+    snprintf(client_pipe_name, sizeof(client_pipe_name), CLIENT_PIPE_FORMAT, client_pid);
+    return open(client_pipe_name, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+/**
+ * @brief Regista um descritor de resposta já aberto (e não bloqueante) para um cliente.
+ *
+ * Passa a ser a entrada devolvida por `client_table_find` para este PID.
+ *
+ * @return A entrada (o descritor passa a pertencer à tabela), ou NULL se faltar memória.
+ */
+ClientSession* client_table_add(ClientTable* table, int client_pid, int fd, int kind) {
+    if (table->count == table->capacity) {
+        int new_capacity = table->capacity ? table->capacity * 2 : 64;
+        ClientSession** grown = realloc(table->sessions, new_capacity * sizeof(ClientSession*));
+        if (!grown) return NULL;
+        table->sessions = grown;
+        table->capacity = new_capacity;
+    }
+    if (table->count >= table->num_buckets) grow_buckets(table); // Se falhar, as cadeias ficam mais longas.
+
+    ClientSession* session = calloc(1, sizeof(ClientSession));
+    if (!session) return NULL;
+    session->client_pid = client_pid;
+    session->fd = fd;
+    session->kind = kind;
+    session->index = table->count;
+    table->sessions[table->count++] = session;
+    int b = bucket_of(table, client_pid);
+    session->next_by_pid = table->buckets[b];
+    table->buckets[b] = session;
+    return session;
+}
+
+/**
+ * @brief Devolve a entrada mais recente de um cliente, ou NULL.
+ */
+ClientSession* client_table_find(const ClientTable* table, int client_pid) {
+    for (ClientSession* s = table->buckets[bucket_of(table, client_pid)]; s; s = s->next_by_pid) {
+        if (s->client_pid == client_pid) return s;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Retira um cliente: fecha o descritor e descarta a resposta por escrever.
+ *
+ * A memória da entrada só é libertada em `client_table_reap`.
+ */
+void client_table_remove(ClientTable* table, ClientSession* session) {
+    if (session->fd < 0) return; // Já retirada.
+    ClientSession** link = &table->buckets[bucket_of(table, session->client_pid)];
+    while (*link != session) link = &(*link)->next_by_pid;
+    *link = session->next_by_pid;
+
+    ClientSession* last = table->sessions[--table->count];
+    table->sessions[session->index] = last;
+    last->index = session->index;
+
+    if (session->out) table->pending--;
+    free(session->out);
+    session->out = NULL;
+    close(session->fd);
+    session->fd = -1;
+    session->next_by_pid = table->retired;
+    table->retired = session;
+}
+
+/**
+ * @brief Liberta as entradas retiradas (quando já não há eventos do epoll por tratar).
+ */
+void client_table_reap(ClientTable* table) {
+    while (table->retired) {
+        ClientSession* next = table->retired->next_by_pid;
+        free(table->retired);
+        table->retired = next;
+    }
+}
+
+/**
+ * @brief Acrescenta tramas à resposta por escrever de um cliente.
+ *
+ * @param frames Tramas (cabeçalho + dados, cada uma com até RESPONSE_MAX_FRAME bytes),
+ * alocadas com malloc; passam a pertencer à entrada.
+ * @param deadline_ms Prazo para as escrever, se o cliente ainda não tinha uma resposta pendente.
+ * @return 0 em caso de sucesso, -1 se faltar memória (as tramas são libertadas).
+ */
+int client_session_queue(ClientTable* table, ClientSession* session, char* frames, size_t len, long long deadline_ms) {
+    if (!session->out) {
+        session->out = frames;
+        session->out_len = len;
+        session->out_pos = 0;
+        session->deadline_ms = deadline_ms;
+        table->pending++;
+        return 0;
+    }
+    char* grown = realloc(session->out, session->out_len + len);
+    if (!grown) {
+        free(frames);
+        return -1;
+    }
+    memcpy(grown + session->out_len, frames, len);
+    session->out = grown;
+    session->out_len += len;
+    free(frames);
+    return 0;
+}
+
+/**
+ * @brief Escreve as tramas pendentes de um cliente até acabarem ou o descritor ficar cheio.
+ *
+ * Cada trama segue num único `write` (atómico num FIFO, por ter até PIPE_BUF bytes, e uma
+ * mensagem num socket SOCK_SEQPACKET): ou é escrita inteira, ou nada (EAGAIN). Enquanto o
+ * cliente for lendo, o prazo é renovado: só expira uma resposta que deixou de avançar.
+ *
+ * @param deadline_ms Novo prazo para o resto da resposta, se alguma trama for escrita.
+ * @return 1 se a resposta foi toda escrita, 0 se falta escrever (esperar por EPOLLOUT),
+ * -1 em caso de erro (o cliente fechou o seu lado).
+ */
+int client_session_flush(ClientTable* table, ClientSession* session, long long deadline_ms) {
+    size_t start_pos = session->out_pos;
+    while (session->out && session->out_pos < session->out_len) {
+        ResponseHeader header;
+        memcpy(&header, session->out + session->out_pos, sizeof(ResponseHeader));
+        size_t frame_len = sizeof(ResponseHeader) + header.payload_len;
+        ssize_t n = write(session->fd, session->out + session->out_pos, frame_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            if (session->out_pos > start_pos) session->deadline_ms = deadline_ms;
+            return 0;
+        }
+        if (n != (ssize_t)frame_len) return -1;
+        session->out_pos += frame_len;
+    }
+    if (session->out) {
+        free(session->out);
+        session->out = NULL;
+        table->pending--;
+    }
+    return 1;
+}
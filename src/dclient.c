@@ -1,216 +1,647 @@
 #include "Document_Struct.h" // Inclui as definições das estruturas e constantes partilhadas
+#include "Client_Conn.h"     // Ligação ao servidor (socket ou FIFOs)
+#include "Search_Query.h"    // Para verificar a sintaxe das consultas (-q)
+#include "Ranking.h"         // Para RANK_SCORE_SCALE (pontuações de -s -k)
+
+#define MAX_SESSION_ARGS 8      // Número máximo de palavras numa linha de comando em sessão.
+#define MAX_SESSION_LINE 1024   // Tamanho máximo de uma linha de comando em sessão (bytes).
+
+// Ligação ao servidor (persistente em sessão). O transporte (socket ou FIFOs) é escolhido
+// no primeiro pedido, conforme o servidor (ver Client_Conn.h).
+static ClientConn conn;
 
 /**
- * @brief Envia um pedido (requisição) ao servidor e recebe a resposta correspondente.
- *
- * Esta função é o coração da comunicação do cliente com o servidor. Utiliza dois
- * pipes nomeados (FIFOs) para realizar esta comunicação:
- * 1. FIFO do Servidor (SERVER_PIPE): Usado pelo cliente para enviar o seu pedido ao servidor.
- * É um canal conhecido por todos os clientes e pelo servidor.
- * 2. FIFO do Cliente (client_pipe_XXX): Um FIFO único criado por este cliente, usado
- * pelo servidor para enviar a resposta especificamente a este cliente. O nome
- * inclui o PID (Process ID) do cliente para garantir a sua unicidade.
- *
- * ## Funcionamento Detalhado dos Pipes Nomeados (FIFOs) na Comunicação Cliente-Servidor:
+ * @brief Envia um pedido ao servidor e recebe a resposta correspondente (ver `client_conn_request`).
  *
- * ### O que são Pipes Nomeados (FIFOs)?
- * Pipes nomeados, ou FIFOs (First-In, First-Out), são ficheiros especiais no sistema
- * de ficheiros que permitem a comunicação entre processos que não necessitam de
- * ter uma relação de parentesco (como é o caso de pipes anónimos). Funcionam como
- * um tubo: o que é escrito numa extremidade pode ser lido na outra, pela ordem de chegada.
- * São persistentes no sistema de ficheiros (até serem explicitamente removidos),
- * o que permite que processos independentes os encontrem e utilizem através do seu nome.
+ * Num pedido BULK_ADD, MULTI_QUERY, MULTI_COUNT, MULTI_SEARCH ou SEARCH_QUERY, os
+ * `req.batch_size` elementos de `batch` seguem depois do pedido. Se não for possível comunicar com o servidor,
+ * termina o cliente com erro.
  *
- * ### Fluxo de Comunicação em `send_request`:
- *
- * 1.  **Abrir o FIFO do Servidor para Escrita (`SERVER_PIPE`):**
- * -   **Porquê?** O cliente precisa de um canal para enviar o seu pedido ao servidor.
- * O `SERVER_PIPE` é o "balcão de atendimento" do servidor, onde todos os clientes
- * enviam os seus pedidos.
- * -   **Onde e Como?** O cliente abre o `SERVER_PIPE` (que já deve ter sido criado
- * pelo servidor) em modo de escrita (`O_WRONLY`).
- * `int server_fd = open(SERVER_PIPE, O_WRONLY);`
- * -   Se esta abertura falhar, geralmente significa que o servidor não está em execução
- * ou que o FIFO não existe.
+ * @param req A estrutura `Request` contendo os dados do pedido a ser enviado.
+ * @param batch Os elementos do lote (Document, int, CountItem, char[MAX_KEYWORD_SIZE] ou os bytes
+ * da consulta, conforme a operação), ou NULL.
+ * @return A estrutura `Response` recebida do servidor (`ids` e `docs` alocados com malloc, ou NULL).
+ */
+Response send_request_batch(Request req, const void* batch) {
+    Response resp;
+    if (client_conn_request(&conn, &req, batch, &resp) != 0) {
+        exit(EXIT_FAILURE); // Termina o cliente com erro.
+    }
+    return resp;
+}
+
+/**
+ * @brief Envia um pedido (sem lote) ao servidor e recebe a resposta (ver `send_request_batch`).
+ */
+Response send_request(Request req) {
+    return send_request_batch(req, NULL);
+}
+
+/**
+ * @brief Imprime uma mensagem de ajuda com as opções de uso do cliente para o STDERR.
  *
- * 2.  **Criar o FIFO Específico do Cliente (`client_pipe_PID`):**
- * -   **Porquê?** Após o servidor processar o pedido, ele precisa de enviar uma
- * resposta de volta ao cliente que fez o pedido. Se o servidor escrevesse
- * no `SERVER_PIPE`, todos os clientes poderiam tentar ler, gerando confusão.
- * Assim, cada cliente cria o seu próprio FIFO de resposta, com um nome único
- * (geralmente usando o seu PID - Process ID). O cliente informa o servidor
- * sobre o nome deste FIFO (ou, como neste caso, o servidor constrói o nome
- * do pipe do cliente usando o PID enviado no pedido).
- * -   **Onde e Como?** O cliente gera um nome único para o seu FIFO (ex: `/tmp/client_pipe_1234`).
- * `snprintf(client_pipe, sizeof(client_pipe), CLIENT_PIPE_FORMAT, getpid());`
- * Antes de criar, remove qualquer FIFO com o mesmo nome que possa ter ficado
- * de uma execução anterior (`unlink(client_pipe);`).
- * Depois, cria o FIFO com `mkfifo(client_pipe, 0666);`. As permissões `0666`
- * permitem leitura e escrita pelo proprietário, grupo e outros (o servidor
- * precisará de permissão de escrita).
+ * Esta função é chamada quando o cliente é invocado com argumentos inválidos
+ * ou sem argumentos suficientes.
+ */
+void print_usage() {
+    char buffer[4096]; // Buffer para construir a mensagem de ajuda.
+    int offset = 0;
+
+    // Construir a mensagem de ajuda completa no buffer.
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "Uso:\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -a \"título\" \"autores\" \"ano\" \"caminho\" # Adicionar documento\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -b catalogo.tsv # Adicionar todos os documentos de um catálogo (formato de Gcatalog.tsv)\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -c ID # Consultar documento por ID\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -C ID [ID ...] # Consultar vários documentos num só pedido\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -d ID # Eliminar documento por ID\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -l ID \"palavra-chave\" # Contar linhas com palavra-chave num documento\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -L pares.tsv # Contar linhas de vários pares (linhas \"ID<tab>palavra-chave\") num só pedido\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -s \"palavra-chave\" [nr_processos] [-k N] # Procurar documentos com palavra-chave (opcional: nº processos > 1 para pesquisa paralela; -k: só os N mais relevantes, com a pontuação BM25)\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -q \"consulta\" [nr_processos] # Procurar documentos com uma consulta (AND, OR, NOT, parênteses, frases entre aspas; ex: 'whale AND ship NOT captain')\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -A \"autor\" # Procurar documentos de um autor (sem distinguir maiúsculas; um dos autores separados por ';')\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -Y ano [ano_fim] # Procurar documentos de um ano ou de um intervalo de anos\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -T \"texto\" # Procurar documentos cujo título contém o texto (sem distinguir maiúsculas)\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -P \"prefixo\" # Procurar documentos cujo título começa pelo prefixo (sem distinguir maiúsculas)\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -S palavras.txt [nr_processos] # Contar linhas de várias palavras-chave (uma por linha) em todos os documentos, numa só passagem\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -e # Mostrar as métricas do servidor (pedidos, latências, caches, fila)\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -f # Forçar persistência e encerrar o servidor\n");
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -i # Sessão: lê comandos (ex: -c 1) do stdin, um por linha, com uma só ligação\n");
+
+    // Escrever a mensagem de ajuda de uma só vez para STDERR.
+    write(STDERR_FILENO, buffer, offset);
+}
+
+/**
+ * @brief Descreve um código de erro de ADD_DOC/BULK_ADD.
  *
- * 3.  **Enviar o Pedido ao Servidor:**
- * -   O cliente preenche a estrutura `Request` com os dados da operação e o seu PID.
- * `req.client_pid = getpid();`
- * -   O cliente escreve a estrutura `Request` no `server_fd` (o FIFO do servidor).
- * `write(server_fd, &req, sizeof(Request));`
+ * @return A descrição, ou NULL se o código for desconhecido.
+ */
+static const char* add_error_description(int status) {
+    switch (status) {
+        case -3: return "Ficheiro não encontrado ou inacessível";
+        case -4: return "Caminho do ficheiro demasiado longo";
+        case -5: return "Falha interna ao adicionar o documento";
+        case -6: return "Documento não recebido pelo servidor (lote incompleto)";
+        default: return NULL;
+    }
+}
+
+/**
+ * @brief Nome de uma operação na tabela de métricas.
+ */
+static const char* operation_name(int operation) {
+    switch (operation) {
+        case ADD_DOC: return "ADD_DOC";
+        case QUERY_DOC: return "QUERY_DOC";
+        case DELETE_DOC: return "DELETE_DOC";
+        case COUNT_LINES: return "COUNT_LINES";
+        case SEARCH_DOCS: return "SEARCH_DOCS";
+        case SHUTDOWN: return "SHUTDOWN";
+        case END_SESSION: return "END_SESSION";
+        case BULK_ADD: return "BULK_ADD";
+        case STATS: return "STATS";
+        case MULTI_QUERY: return "MULTI_QUERY";
+        case MULTI_COUNT: return "MULTI_COUNT";
+        case MULTI_SEARCH: return "MULTI_SEARCH";
+        case SEARCH_QUERY: return "SEARCH_QUERY";
+        case RANKED_SEARCH: return "RANKED_SEARCH";
+        case META_SEARCH: return "META_SEARCH";
+        default: return "inválida";
+    }
+}
+
+/**
+ * @brief Mostra as métricas do servidor (resposta a STATS).
+ */
+static void print_server_stats(const ServerStats* stats) {
+    char buffer[4096];
+    int offset = 0;
+    unsigned long lookups = stats->cache_hits + stats->cache_misses;
+    unsigned long result_lookups = stats->result_hits + stats->result_misses;
+
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
+                       "Tempo de funcionamento: %.1f s | Documentos: %d (%d por indexar) | Pedidos em espera: %d\n",
+                       stats->uptime_ms / 1000.0, stats->num_documents, stats->index_pending, stats->queue_depth);
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
+                       "Cache de documentos: %lu acertos, %lu falhas (taxa %.1f%%), %lu remoções\n",
+                       stats->cache_hits, stats->cache_misses, lookups ? 100.0 * stats->cache_hits / lookups : 0.0,
+                       stats->cache_evictions);
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
+                       "Cache de resultados: %lu acertos, %lu falhas (taxa %.1f%%), %lu remoções\n",
+                       stats->result_hits, stats->result_misses,
+                       result_lookups ? 100.0 * stats->result_hits / result_lookups : 0.0, stats->result_evictions);
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "Bytes pesquisados: %lu\n", stats->bytes_scanned);
+    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "%-14s %10s %8s %11s %11s %11s %12s\n", // Larguras com os bytes de 'ç', 'ã', 'á' e 'µ'.
+                       "operação", "pedidos", "erros", "p50 (µs)", "p95 (µs)", "p99 (µs)", "máx (µs)");
+    for (int op = 0; op < NUM_OPERATIONS; op++) {
+        const OperationStats* o = &stats->ops[op];
+        if (o->count == 0) continue;
+        offset += snprintf(buffer + offset, sizeof(buffer) - offset, "%-12s %10lu %8lu %10lu %10lu %10lu %10lu\n",
+                           operation_name(op), o->count, o->errors, o->p50_us, o->p95_us, o->p99_us, o->max_us);
+    }
+    write(STDOUT_FILENO, buffer, offset);
+}
+
+/**
+ * @brief Adiciona de uma só vez os documentos de um catálogo TSV (operação BULK_ADD).
  *
- * 4.  **Fechar a Extremidade de Escrita do FIFO do Servidor:**
- * -   **Porquê?** O cliente já enviou o seu pedido. Manter a extremidade de escrita
- * aberta desnecessariamente pode ter implicações, especialmente se o servidor
- * espera que todos os escritores fechem o pipe para detetar certas condições.
- * É uma boa prática fechar descritores de ficheiro assim que não são mais necessários.
- * -   **Onde e Como?** `close(server_fd);`
+ * O catálogo tem o formato de Gcatalog.tsv: uma linha de cabeçalho e depois uma linha por
+ * documento com os campos caminho, título, ano e autores separados por tabulações. As
+ * linhas mal formadas são reportadas aqui e não são enviadas; as restantes seguem num só
+ * pedido, e os documentos rejeitados pelo servidor são reportados com o número da linha.
  *
- * 5.  **Abrir o FIFO do Cliente para Leitura:**
- * -   **Porquê?** O cliente agora precisa de esperar e receber a resposta do servidor.
- * Esta resposta virá através do FIFO que o próprio cliente criou.
- * -   **Onde e Como?** O cliente abre o seu `client_pipe` em modo de leitura (`O_RDONLY`).
- * `int client_fd = open(client_pipe, O_RDONLY);`
- * -   **Comportamento Bloqueante:** Esta chamada a `open` para leitura num FIFO é
- * tipicamente bloqueante. O cliente ficará aqui "parado" (bloqueado) até que
- * outro processo (neste caso, o servidor) abra a outra extremidade do mesmo
- * FIFO para escrita. Isto é um mecanismo de sincronização: o cliente espera
- * pacientemente que o servidor esteja pronto para enviar a resposta.
+ * @param path Caminho do catálogo.
+ * @return 0 se todas as linhas foram adicionadas, 1 caso contrário.
+ */
+static int bulk_add_catalog(const char* path) {
+    FILE* catalog = fopen(path, "r");
+    if (!catalog) {
+        perror("Erro ao abrir o catálogo");
+        return 1;
+    }
+
+    Document* docs = NULL;
+    int* line_numbers = NULL; // Linha do catálogo de cada documento do lote.
+    int num_docs = 0, capacity = 0, rejected = 0, line_number = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    char msg[256];
+    while (getline(&line, &line_size, catalog) >= 0) {
+        if (++line_number == 1) continue; // Cabeçalho.
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        char* fields[4];
+        int num_fields = 0;
+        char* rest = line;
+        while (num_fields < 4 && rest) {
+            fields[num_fields++] = rest;
+            rest = strchr(rest, '\t');
+            if (rest) *rest++ = '\0';
+        }
+        if (num_fields != 4 || rest ||
+            strlen(fields[0]) + strlen(fields[1]) + strlen(fields[2]) + strlen(fields[3]) >= MAX_ARGS_TOTAL_SIZE) {
+            int len = snprintf(msg, sizeof(msg), "Linha %d: formato inválido (esperados 4 campos separados por tabulações, até %d bytes).\n",
+                               line_number, MAX_ARGS_TOTAL_SIZE);
+            write(STDERR_FILENO, msg, len);
+            rejected++;
+            continue;
+        }
+
+        if (num_docs == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            Document* more_docs = realloc(docs, capacity * sizeof(Document));
+            int* more_lines = realloc(line_numbers, capacity * sizeof(int));
+            if (more_docs) docs = more_docs;
+            if (more_lines) line_numbers = more_lines;
+            if (!more_docs || !more_lines) {
+                perror("Erro ao alocar memória para o lote");
+                exit(EXIT_FAILURE);
+            }
+        }
+        Document* doc = &docs[num_docs];
+        memset(doc, 0, sizeof(Document));
+        strncpy(doc->path, fields[0], MAX_PATH_SIZE - 1);
+        strncpy(doc->title, fields[1], MAX_TITLE_SIZE - 1);
+        strncpy(doc->year, fields[2], MAX_YEAR_SIZE - 1);
+        strncpy(doc->authors, fields[3], MAX_AUTHORS_SIZE - 1);
+        line_numbers[num_docs++] = line_number;
+    }
+    free(line);
+    fclose(catalog);
+
+    int result = (rejected > 0);
+    if (num_docs > BULK_MAX_DOCS) {
+        int len = snprintf(msg, sizeof(msg), "Erro: o catálogo tem %d documentos (máximo %d por lote).\n", num_docs, BULK_MAX_DOCS);
+        write(STDERR_FILENO, msg, len);
+        free(docs);
+        free(line_numbers);
+        return 1;
+    }
+    if (num_docs > 0) {
+        Request req;
+        memset(&req, 0, sizeof(Request));
+        req.operation = BULK_ADD;
+        req.batch_size = num_docs;
+        Response resp = send_request_batch(req, docs);
+
+        if (resp.status != 0 && resp.num_ids < 2) {
+            int len = snprintf(msg, sizeof(msg), "Erro %d ao adicionar o lote (resposta do servidor).\n", resp.status);
+            write(STDERR_FILENO, msg, len);
+            result = 1;
+        } else {
+            // Relatório: primeiro ID, número de adicionados, pares (posição no lote, erro).
+            for (int i = 2; i + 1 < resp.num_ids; i += 2) {
+                int position = resp.ids[i];
+                const char* description = add_error_description(resp.ids[i + 1]);
+                int len = snprintf(msg, sizeof(msg), "Linha %d: %s.\n",
+                                   (position >= 1 && position <= num_docs) ? line_numbers[position - 1] : -1,
+                                   description ? description : "Erro desconhecido");
+                write(STDERR_FILENO, msg, len);
+            }
+            int len = snprintf(msg, sizeof(msg), "%d de %d documentos indexados (IDs %d a %d, pela ordem do catálogo)\n",
+                               resp.ids[1], num_docs + rejected, resp.ids[0], resp.ids[0] + num_docs - 1);
+            write(STDOUT_FILENO, msg, len);
+            if (resp.status != 0) {
+                write(STDERR_FILENO, "Aviso: o servidor não conseguiu sincronizar o lote com o disco.\n",
+                      strlen("Aviso: o servidor não conseguiu sincronizar o lote com o disco.\n"));
+            }
+            if (resp.status != 0 || resp.ids[1] != num_docs) result = 1;
+        }
+        free(resp.ids);
+    }
+    free(docs);
+    free(line_numbers);
+    return result;
+}
+
+/**
+ * @brief Consulta vários documentos num só pedido (operação MULTI_QUERY).
  *
- * 6.  **Ler a Resposta do Servidor:**
- * -   Uma vez que o servidor abriu o `client_pipe` para escrita e enviou a resposta,
- * o cliente pode lê-la. A chamada `read` também é bloqueante; ela espera até
- * que haja dados suficientes no pipe (o tamanho de `Response`) ou que a
- * extremidade de escrita do pipe seja fechada pelo servidor.
- * `read(client_fd, &resp, sizeof(Response));`
+ * Mostra cada documento encontrado como `-c`, pela ordem dos IDs; os que não existem são
+ * reportados no STDERR.
  *
- * 7.  **Fechar e Remover o FIFO do Cliente:**
- * -   **Porquê?** A comunicação terminou. O FIFO do cliente já cumpriu o seu propósito
- * para este pedido/resposta específico.
- * -   **Fechar a Extremidade de Leitura:** `close(client_fd);`
- * -   **Remover o FIFO do Sistema de Ficheiros:** `unlink(client_pipe);`
- * Se não for removido, o ficheiro FIFO permanecerá no sistema de ficheiros.
- * É importante limpar estes FIFOs temporários.
+ * @param ids Os IDs, como texto.
+ * @param num Número de IDs.
+ * @return 0 se todos os documentos existem, 1 caso contrário.
+ */
+static int multi_query(char* ids[], int num) {
+    int* batch = malloc(num * sizeof(int));
+    if (!batch) {
+        perror("Erro ao alocar memória para o lote");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num; i++) batch[i] = atoi(ids[i]);
+
+    Request req;
+    memset(&req, 0, sizeof(Request));
+    req.operation = MULTI_QUERY;
+    req.batch_size = num;
+    Response resp = send_request_batch(req, batch);
+
+    int result = 0;
+    if (resp.num_docs != num) {
+        char msg[128];
+        int len = snprintf(msg, sizeof(msg), "Erro %d ao consultar os documentos (resposta do servidor).\n", resp.status);
+        write(STDERR_FILENO, msg, len);
+        result = 1;
+    } else {
+        for (int i = 0; i < num; i++) {
+            const Document* doc = &resp.docs[i];
+            char msg[MAX_TITLE_SIZE + MAX_AUTHORS_SIZE + MAX_YEAR_SIZE + MAX_PATH_SIZE + 100];
+            if (doc->id == 0) {
+                int len = snprintf(msg, sizeof(msg), "Documento %d não encontrado.\n", batch[i]);
+                write(STDERR_FILENO, msg, len);
+                result = 1;
+                continue;
+            }
+            int len = snprintf(msg, sizeof(msg), "ID: %d\nTítulo: %s\nAutores: %s\nAno: %s\nCaminho: %s\n",
+                               doc->id, doc->title, doc->authors, doc->year, doc->path);
+            write(STDOUT_FILENO, msg, len);
+        }
+        if (resp.status != 0) result = 1;
+    }
+    free(resp.docs);
+    free(batch);
+    return result;
+}
+
+/**
+ * @brief Conta as linhas de vários pares (ID, palavra-chave) num só pedido (operação MULTI_COUNT).
  *
- * Esta sequência garante uma comunicação organizada e específica entre um cliente e o servidor.
+ * O ficheiro tem uma linha "ID<tab>palavra-chave" por par. Mostra uma linha
+ * "ID<tab>palavra-chave<tab>contagem" por par, pela ordem do ficheiro; os pares que não
+ * puderam ser contados são reportados no STDERR.
  *
- * @param req A estrutura `Request` contendo os dados do pedido a ser enviado.
- * @return A estrutura `Response` recebida do servidor.
+ * @param path Caminho do ficheiro de pares.
+ * @return 0 se todos os pares foram contados, 1 caso contrário.
  */
-Response send_request(Request req) {
-    Response resp; // Estrutura para armazenar a resposta do servidor.
-    memset(&resp, 0, sizeof(Response)); // Inicializa a estrutura de resposta com zeros.
-
-    // 1. Abrir o FIFO (pipe nomeado) do servidor para escrita.
-    //    O cliente escreve a sua requisição neste FIFO.
-    int server_fd = open(SERVER_PIPE, O_WRONLY);
-    if (server_fd < 0) {
-        // Se não conseguir abrir, assume que o servidor não está em execução ou há outro erro.
-        perror("Erro ao abrir pipe do servidor para escrita (send_request)");
-        write(STDERR_FILENO, "O servidor está em execução?\n", strlen("O servidor está em execução?\n"));
-        exit(EXIT_FAILURE); // Termina o cliente com erro.
+static int multi_count(const char* path) {
+    FILE* pairs = fopen(path, "r");
+    if (!pairs) {
+        perror("Erro ao abrir o ficheiro de pares");
+        return 1;
     }
 
-    // 2. Criar o FIFO (pipe nomeado) específico deste cliente para receber a resposta.
-    char client_pipe[128]; // Buffer para o nome do FIFO do cliente.
-    //    Gera o nome do FIFO usando o PID do cliente para garantir unicidade.
-    snprintf(client_pipe, sizeof(client_pipe), CLIENT_PIPE_FORMAT, getpid());
-    unlink(client_pipe); // Remove o FIFO se já existir de uma execução anterior (precaução).
+    CountItem* items = NULL;
+    int num_items = 0, capacity = 0, result = 0, line_number = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    char msg[MAX_KEYWORD_SIZE + 128];
+    while (getline(&line, &line_size, pairs) >= 0) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+        char* keyword = strchr(line, '\t');
+        if (!keyword || keyword[1] == '\0' || strlen(keyword + 1) >= MAX_KEYWORD_SIZE) {
+            int len = snprintf(msg, sizeof(msg), "Linha %d: formato inválido (esperado \"ID<tab>palavra-chave\").\n", line_number);
+            write(STDERR_FILENO, msg, len);
+            result = 1;
+            continue;
+        }
+        *keyword++ = '\0';
+
+        if (num_items == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            CountItem* grown = realloc(items, capacity * sizeof(CountItem));
+            if (!grown) {
+                perror("Erro ao alocar memória para o lote");
+                exit(EXIT_FAILURE);
+            }
+            items = grown;
+        }
+        CountItem* item = &items[num_items++];
+        memset(item, 0, sizeof(CountItem));
+        item->id = atoi(line);
+        strncpy(item->keyword, keyword, MAX_KEYWORD_SIZE - 1);
+    }
+    free(line);
+    fclose(pairs);
+
+    if (num_items > 0) {
+        Request req;
+        memset(&req, 0, sizeof(Request));
+        req.operation = MULTI_COUNT;
+        req.batch_size = num_items;
+        Response resp = send_request_batch(req, items);
+
+        if (resp.num_ids != num_items) {
+            int len = snprintf(msg, sizeof(msg), "Erro %d ao contar as linhas (resposta do servidor).\n", resp.status);
+            write(STDERR_FILENO, msg, len);
+            result = 1;
+        } else {
+            for (int i = 0; i < num_items; i++) {
+                int len;
+                if (resp.ids[i] < 0) {
+                    len = snprintf(msg, sizeof(msg), "%d\t%s: erro ao contar linhas.\n", items[i].id, items[i].keyword);
+                    write(STDERR_FILENO, msg, len);
+                    result = 1;
+                    continue;
+                }
+                len = snprintf(msg, sizeof(msg), "%d\t%s\t%d\n", items[i].id, items[i].keyword, resp.ids[i]);
+                write(STDOUT_FILENO, msg, len);
+            }
+            if (resp.status != 0) result = 1;
+        }
+        free(resp.ids);
+    }
+    free(items);
+    return result;
+}
 
-    //    Cria o FIFO com permissões de leitura/escrita para o utilizador (e servidor).
-    if (mkfifo(client_pipe, 0666) < 0) {
-        perror("Erro ao criar pipe do cliente (mkfifo)");
-        close(server_fd); // Fecha o FIFO do servidor antes de sair.
-        exit(EXIT_FAILURE); // Termina o cliente com erro.
+/**
+ * @brief Mostra uma lista de IDs no formato [id1, id2, ...], escrita por blocos (o número de
+ * IDs não tem limite).
+ */
+static void print_id_list(const int* ids, int num_ids) {
+    char msg[4096];
+    int pos = 0; // Posição atual no buffer msg.
+
+    pos += snprintf(msg + pos, sizeof(msg) - pos, "[");
+    for (int i = 0; i < num_ids; i++) {
+        if (pos > (int)sizeof(msg) - 16) { // Espaço para ", " + um ID + "]\n".
+            write(STDOUT_FILENO, msg, pos);
+            pos = 0;
+        }
+        if (i > 0) {
+            pos += snprintf(msg + pos, sizeof(msg) - pos, ", ");
+        }
+        pos += snprintf(msg + pos, sizeof(msg) - pos, "%d", ids[i]);
     }
+    pos += snprintf(msg + pos, sizeof(msg) - pos, "]\n");
 
-    // 3. Preencher o PID do cliente na requisição.
-    //    O servidor usará este PID para saber em que FIFO de cliente deve escrever a resposta.
-    req.client_pid = getpid();
+    write(STDOUT_FILENO, msg, pos);
+}
 
-    // 4. Enviar a requisição para o servidor através do FIFO do servidor.
-    ssize_t bytes_escritos = write(server_fd, &req, sizeof(Request));
-    if (bytes_escritos < 0) {
-        perror("Erro ao escrever no pipe do servidor");
-        close(server_fd);
-        unlink(client_pipe);
-        exit(EXIT_FAILURE);
+/**
+ * @brief Procura os documentos mais relevantes para uma palavra-chave (operação RANKED_SEARCH).
+ *
+ * Mostra uma linha "ID<tab>pontuação" por documento, do mais relevante para o menos.
+ *
+ * @param keyword A palavra-chave.
+ * @param nr_processes Pesquisa paralela no servidor se > 1 (como em -s).
+ * @param top_k Número máximo de documentos.
+ * @return 0 em caso de sucesso, 1 caso contrário.
+ */
+static int ranked_search(const char* keyword, int nr_processes, int top_k) {
+    Request req;
+    memset(&req, 0, sizeof(Request));
+    req.operation = RANKED_SEARCH;
+    strncpy(req.keyword, keyword, MAX_KEYWORD_SIZE - 1);
+    req.keyword[MAX_KEYWORD_SIZE - 1] = '\0';
+    req.nr_processes = nr_processes;
+    req.top_k = top_k;
+
+    Response resp = send_request(req);
+    if (resp.status != 0) {
+        write(STDERR_FILENO, "Erro ao procurar documentos.\n", strlen("Erro ao procurar documentos.\n"));
+        free(resp.ids);
+        return 1;
     }
-    if (bytes_escritos != sizeof(Request)) {
-        fprintf(stderr, "Erro: Escrita incompleta para o pipe do servidor. Esperado: %zu, Escrito: %zd\n", sizeof(Request), bytes_escritos);
-        close(server_fd);
-        unlink(client_pipe);
-        exit(EXIT_FAILURE);
+    char msg[4096];
+    int pos = 0;
+    for (int i = 0; i + 1 < resp.num_ids; i += 2) { // Pares (ID, pontuação em milésimas).
+        if (pos > (int)sizeof(msg) - 64) {
+            write(STDOUT_FILENO, msg, pos);
+            pos = 0;
+        }
+        pos += snprintf(msg + pos, sizeof(msg) - pos, "%d\t%.3f\n", resp.ids[i], (double)resp.ids[i + 1] / RANK_SCORE_SCALE);
     }
-    //    Fecha o descritor do FIFO do servidor após a escrita.
-    close(server_fd);
+    write(STDOUT_FILENO, msg, pos);
+    free(resp.ids);
+    return 0;
+}
 
-    // 5. Abrir o FIFO do cliente para leitura.
-    //    O cliente agora espera pela resposta do servidor neste FIFO.
-    //    A abertura é bloqueante por defeito, esperando que o servidor abra para escrita.
-    int client_fd = open(client_pipe, O_RDONLY);
-    if (client_fd < 0) {
-        perror("Erro ao abrir pipe do cliente para leitura");
-        unlink(client_pipe); // Remove o FIFO do cliente antes de sair.
-        exit(EXIT_FAILURE); // Termina o cliente com erro.
+/**
+ * @brief Procura documentos pelos metadados: autor, intervalo de anos ou título (operação META_SEARCH).
+ *
+ * Mostra uma linha "ID<tab>ano<tab>autores<tab>título" por documento, por ordem de ID (ou de
+ * ano, com META_YEAR).
+ *
+ * @param field O campo (META_AUTHOR, META_YEAR, META_TITLE ou META_TITLE_PREFIX).
+ * @param text O autor ou o texto do título (ignorado com META_YEAR).
+ * @param year_from Primeiro ano do intervalo (META_YEAR).
+ * @param year_to Último ano do intervalo (META_YEAR).
+ * @return 0 em caso de sucesso, 1 caso contrário.
+ */
+static int meta_search(int field, const char* text, int year_from, int year_to) {
+    Request req;
+    memset(&req, 0, sizeof(Request));
+    req.operation = META_SEARCH;
+    req.meta_field = field;
+    req.year_from = year_from;
+    req.year_to = year_to;
+    if (field == META_AUTHOR) {
+        strncpy(req.doc.authors, text, MAX_AUTHORS_SIZE - 1);
+    } else if (field != META_YEAR) {
+        strncpy(req.doc.title, text, MAX_TITLE_SIZE - 1);
     }
 
-    // 6. Ler a resposta do servidor a partir do FIFO do cliente.
-    //    A leitura é bloqueante, esperando que o servidor escreva a resposta completa.
-    ssize_t bytes_lidos = read(client_fd, &resp, sizeof(Response));
-    if (bytes_lidos < 0) {
-        perror("Erro ao ler a resposta do servidor (read)");
-        close(client_fd);
-        unlink(client_pipe);
-        exit(EXIT_FAILURE);
-    } else if (bytes_lidos != sizeof(Response)) {
-        fprintf(stderr, "Erro: Leitura incompleta da resposta do servidor. Esperado: %zu, Lido: %zd\n", sizeof(Response), bytes_lidos);
-        fprintf(stderr, "Isto pode indicar que o servidor terminou inesperadamente ou que MAX_RESULT_IDS diverge entre cliente e servidor.\n");
-        close(client_fd);
-        unlink(client_pipe);
-        exit(EXIT_FAILURE);
+    Response resp = send_request(req);
+    if (resp.status != 0) {
+        char msg[128];
+        int len = snprintf(msg, sizeof(msg), "Erro %d ao procurar documentos%s.\n", resp.status,
+                           resp.status == -2 ? " (texto vazio ou intervalo inválido)" : "");
+        write(STDERR_FILENO, msg, len);
+        free(resp.docs);
+        return 1;
+    }
+    char msg[4096];
+    int pos = 0;
+    for (int i = 0; i < resp.num_docs; i++) {
+        const Document* doc = &resp.docs[i];
+        if (pos > (int)sizeof(msg) - (MAX_TITLE_SIZE + MAX_AUTHORS_SIZE + MAX_YEAR_SIZE + 32)) {
+            write(STDOUT_FILENO, msg, pos);
+            pos = 0;
+        }
+        pos += snprintf(msg + pos, sizeof(msg) - pos, "%d\t%.*s\t%.*s\t%.*s\n", doc->id,
+                        MAX_YEAR_SIZE, doc->year, MAX_AUTHORS_SIZE, doc->authors, MAX_TITLE_SIZE, doc->title);
     }
+    if (pos > 0) write(STDOUT_FILENO, msg, pos);
+    free(resp.docs);
+    return 0;
+}
 
-    // 7. Fechar e remover o FIFO do cliente.
-    //    Após receber a resposta, o FIFO já não é necessário.
-    close(client_fd);
-    unlink(client_pipe);
+/**
+ * @brief Procura os documentos que correspondem a uma consulta booleana/de frase (operação SEARCH_QUERY).
+ *
+ * A consulta é verificada aqui (ver Search_Query.h), para mostrar o erro de sintaxe, e segue
+ * como texto pelo FIFO de lote. Mostra os IDs como em -s.
+ *
+ * @param text A consulta.
+ * @param nr_processes Pesquisa paralela no servidor se > 1 (como em -s).
+ * @return 0 em caso de sucesso, 1 caso contrário.
+ */
+static int search_query(const char* text, int nr_processes) {
+    char msg[256];
+    size_t len = strlen(text);
+    SearchQuery* query = malloc(sizeof(SearchQuery));
+    if (!query) {
+        perror("Erro ao alocar memória para a consulta");
+        exit(EXIT_FAILURE);
+    }
+    char error[128];
+    int valid = (len < MAX_QUERY_SIZE && search_query_parse(text, query, error, sizeof(error)) == 0);
+    free(query);
+    if (!valid) {
+        int n = snprintf(msg, sizeof(msg), "Consulta inválida: %s.\n", len < MAX_QUERY_SIZE ? error : "demasiado longa");
+        write(STDERR_FILENO, msg, n);
+        return 1;
+    }
 
-    // 8. Retornar a resposta recebida do servidor.
-    return resp;
+    Request req;
+    memset(&req, 0, sizeof(Request));
+    req.operation = SEARCH_QUERY;
+    req.batch_size = (int)len;
+    req.nr_processes = nr_processes;
+    Response resp = send_request_batch(req, text);
+    if (resp.status != 0) {
+        int n = snprintf(msg, sizeof(msg), "Erro %d ao procurar documentos.\n", resp.status);
+        write(STDERR_FILENO, msg, n);
+        free(resp.ids);
+        return 1;
+    }
+    print_id_list(resp.ids, resp.num_ids);
+    free(resp.ids);
+    return 0;
 }
 
 /**
- * @brief Imprime uma mensagem de ajuda com as opções de uso do cliente para o STDERR.
+ * @brief Conta as linhas de várias palavras-chave em todos os documentos (operação MULTI_SEARCH).
  *
- * Esta função é chamada quando o cliente é invocado com argumentos inválidos
- * ou sem argumentos suficientes.
+ * O ficheiro tem uma palavra-chave por linha (linhas vazias são ignoradas). Mostra uma linha
+ * "palavra-chave<tab>ID<tab>linhas" por documento que contém cada palavra-chave, pela ordem do
+ * ficheiro e, para cada palavra-chave, por ordem de ID.
+ *
+ * @param path Caminho do ficheiro de palavras-chave.
+ * @param nr_processes Pesquisa paralela no servidor se > 1 (como em -s).
+ * @return 0 em caso de sucesso, 1 caso contrário.
  */
-void print_usage() {
-    char buffer[1024]; // Buffer para construir a mensagem de ajuda.
-    int offset = 0;
-
-    // Construir a mensagem de ajuda completa no buffer.
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "Uso:\n");
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -a \"título\" \"autores\" \"ano\" \"caminho\" # Adicionar documento\n");
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -c ID # Consultar documento por ID\n");
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -d ID # Eliminar documento por ID\n");
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -l ID \"palavra-chave\" # Contar linhas com palavra-chave num documento\n");
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -s \"palavra-chave\" [nr_processos] # Procurar documentos com palavra-chave (opcional: nº processos)\n");
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "./dclient -f # Forçar persistência e encerrar o servidor\n");
+static int multi_search(const char* path, int nr_processes) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror("Erro ao abrir o ficheiro de palavras-chave");
+        return 1;
+    }
 
-    // Escrever a mensagem de ajuda de uma só vez para STDERR.
-    write(STDERR_FILENO, buffer, offset);
+    char (*keywords)[MAX_KEYWORD_SIZE] = calloc(MULTI_SEARCH_MAX_KEYWORDS, MAX_KEYWORD_SIZE);
+    if (!keywords) {
+        perror("Erro ao alocar memória para o lote");
+        exit(EXIT_FAILURE);
+    }
+    int num_keywords = 0, result = 0, line_number = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    char msg[MAX_KEYWORD_SIZE + 128];
+    while (getline(&line, &line_size, file) >= 0) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+        if (strlen(line) >= MAX_KEYWORD_SIZE || num_keywords == MULTI_SEARCH_MAX_KEYWORDS) {
+            int len = snprintf(msg, sizeof(msg), "Linha %d: palavra-chave demasiado longa ou além do limite de %d.\n",
+                               line_number, MULTI_SEARCH_MAX_KEYWORDS);
+            write(STDERR_FILENO, msg, len);
+            result = 1;
+            continue;
+        }
+        strcpy(keywords[num_keywords++], line);
+    }
+    free(line);
+    fclose(file);
+
+    if (num_keywords > 0) {
+        Request req;
+        memset(&req, 0, sizeof(Request));
+        req.operation = MULTI_SEARCH;
+        req.batch_size = num_keywords;
+        req.nr_processes = nr_processes;
+        Response resp = send_request_batch(req, keywords);
+
+        // Para cada palavra-chave: n e n pares (ID, linhas); confirma que a lista está completa.
+        int pos = 0, k = 0;
+        while (k < num_keywords && pos < resp.num_ids && resp.ids[pos] >= 0 && resp.ids[pos] <= (resp.num_ids - pos - 1) / 2) {
+            pos += 1 + 2 * resp.ids[pos];
+            k++;
+        }
+        if ((resp.status != 0 && resp.status != -6) || k != num_keywords || pos != resp.num_ids) {
+            int len = snprintf(msg, sizeof(msg), "Erro %d ao pesquisar as palavras-chave (resposta do servidor).\n", resp.status);
+            write(STDERR_FILENO, msg, len);
+            result = 1;
+        } else {
+            char out[4096];
+            int used = 0;
+            pos = 0;
+            for (k = 0; k < num_keywords; k++) {
+                int n = resp.ids[pos++];
+                for (int j = 0; j < n; j++, pos += 2) {
+                    if (used > (int)sizeof(out) - (int)sizeof(msg)) {
+                        write(STDOUT_FILENO, out, used);
+                        used = 0;
+                    }
+                    used += snprintf(out + used, sizeof(out) - used, "%s\t%d\t%d\n", keywords[k], resp.ids[pos], resp.ids[pos + 1]);
+                }
+            }
+            if (used > 0) write(STDOUT_FILENO, out, used);
+            if (resp.status != 0) result = 1;
+        }
+        free(resp.ids);
+    }
+    free(keywords);
+    return result;
 }
 
 /**
- * @brief Função principal do cliente.
+ * @brief Executa um comando do cliente.
  *
- * Responsável por processar os argumentos da linha de comandos, construir a
+ * Responsável por processar os argumentos de um comando, construir a
  * estrutura de pedido (`Request`), chamar `send_request` para comunicar com o
  * servidor, e apresentar a resposta (`Response`) ao utilizador.
  *
- * @param argc Número de argumentos da linha de comandos.
- * @param argv Array de strings contendo os argumentos da linha de comandos.
+ * @param argc Número de argumentos (incluindo o nome do programa).
+ * @param argv Array de strings contendo os argumentos (da linha de comandos ou de uma linha da sessão).
  * @return 0 em caso de sucesso, 1 em caso de erro ou uso incorreto.
  */
-int main(int argc, char* argv[]) {
+static int run_command(int argc, char* argv[]) {
     // Verifica se foi fornecido pelo menos um argumento (a opção de operação).
     if (argc < 2) {
         print_usage(); // Mostra a ajuda se não houver argumentos suficientes.
@@ -267,24 +698,23 @@ int main(int argc, char* argv[]) {
             write(STDOUT_FILENO, msg, len);
         } else { // Erro (vindo do servidor).
             char error_msg[128];
-            switch (resp.status) {
-                case -3:
-                    snprintf(error_msg, sizeof(error_msg), "Erro do servidor: Ficheiro não encontrado ou inacessível.\n");
-                    break;
-                case -4:
-                    snprintf(error_msg, sizeof(error_msg), "Erro do servidor: Caminho do ficheiro demasiado longo.\n");
-                    break;
-                case -5:
-                    snprintf(error_msg, sizeof(error_msg), "Erro do servidor: Falha interna ao adicionar o documento.\n");
-                    break;
-                default:
-                    snprintf(error_msg, sizeof(error_msg), "Erro %d ao adicionar documento (resposta do servidor).\n", resp.status);
-                    break;
+            const char* description = add_error_description(resp.status);
+            if (description) {
+                snprintf(error_msg, sizeof(error_msg), "Erro do servidor: %s.\n", description);
+            } else {
+                snprintf(error_msg, sizeof(error_msg), "Erro %d ao adicionar documento (resposta do servidor).\n", resp.status);
             }
             write(STDERR_FILENO, error_msg, strlen(error_msg));
             return 1;
         }
     }
+    else if (strcmp(argv[1], "-b") == 0) { // Operação: Adicionar Lote de Documentos.
+        if (argc != 3) { // programa + opção + ficheiro.
+            print_usage();
+            return 1;
+        }
+        return bulk_add_catalog(argv[2]);
+    }
     else if (strcmp(argv[1], "-c") == 0) { // Operação: Consultar Documento.
         if (argc != 3) { // programa + opção + ID.
             print_usage();
@@ -307,6 +737,28 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    else if (strcmp(argv[1], "-C") == 0) { // Operação: Consultar Vários Documentos.
+        if (argc < 3 || argc - 2 > MULTI_MAX_ITEMS) { // programa + opção + pelo menos um ID.
+            print_usage();
+            return 1;
+        }
+        return multi_query(argv + 2, argc - 2);
+    }
+    else if (strcmp(argv[1], "-L") == 0) { // Operação: Contar Linhas de Vários Pares.
+        if (argc != 3) { // programa + opção + ficheiro.
+            print_usage();
+            return 1;
+        }
+        return multi_count(argv[2]);
+    }
+    else if (strcmp(argv[1], "-S") == 0) { // Operação: Contar Linhas de Várias Palavras-Chave.
+        if (argc < 3 || argc > 4) { // programa + opção + ficheiro [+ nr_processos].
+            print_usage();
+            return 1;
+        }
+        int nr_processes = (argc == 4) ? atoi(argv[3]) : 1;
+        return multi_search(argv[2], nr_processes > 0 ? nr_processes : 1);
+    }
     else if (strcmp(argv[1], "-d") == 0) { // Operação: Eliminar Documento.
         if (argc != 3) { // programa + opção + ID.
             print_usage();
@@ -350,10 +802,23 @@ int main(int argc, char* argv[]) {
         }
     }
     else if (strcmp(argv[1], "-s") == 0) { // Operação: Procurar Documentos.
+        int top_k = 0;
+        if (argc >= 5 && strcmp(argv[argc - 2], "-k") == 0) { // Pesquisa ordenada: -k N no fim.
+            top_k = atoi(argv[argc - 1]);
+            argc -= 2;
+            if (top_k <= 0) {
+                print_usage();
+                return 1;
+            }
+        }
         if (argc < 3 || argc > 4) { // Mínimo: prog + opção + keyword. Máximo: prog + opção + keyword + nr_procs.
             print_usage();
             return 1;
         }
+        if (top_k > 0) {
+            int nr_processes = (argc == 4) ? atoi(argv[3]) : 1;
+            return ranked_search(argv[2], nr_processes > 0 ? nr_processes : 1, top_k);
+        }
 
         req.operation = SEARCH_DOCS;
         strncpy(req.keyword, argv[2], MAX_KEYWORD_SIZE - 1);
@@ -368,26 +833,58 @@ int main(int argc, char* argv[]) {
         Response resp = send_request(req);
 
         if (resp.status == 0) { // Sucesso.
-            // Formata a saída como uma lista de IDs [id1, id2, ...].
-            // (MAX_RESULT_IDS * (10 digitos + 2 para ", ")) + 3 para "[]\n" + margem.
-            char msg[MAX_RESULT_IDS * 12 + 10];
-            int pos = 0; // Posição atual no buffer msg.
-
-            pos += snprintf(msg + pos, sizeof(msg) - pos, "[");
-            for (int i = 0; i < resp.num_ids; i++) {
-                if (i > 0) {
-                    pos += snprintf(msg + pos, sizeof(msg) - pos, ", ");
-                }
-                pos += snprintf(msg + pos, sizeof(msg) - pos, "%d", resp.ids[i]);
-            }
-            pos += snprintf(msg + pos, sizeof(msg) - pos, "]\n");
-
-            write(STDOUT_FILENO, msg, pos);
+            print_id_list(resp.ids, resp.num_ids);
+            free(resp.ids);
         } else { // Erro.
             write(STDERR_FILENO, "Erro ao procurar documentos.\n", strlen("Erro ao procurar documentos.\n"));
             return 1;
         }
     }
+    else if (strcmp(argv[1], "-q") == 0) { // Operação: Procurar Documentos com uma Consulta.
+        if (argc < 3 || argc > 4) { // prog + opção + consulta [+ nr_processos].
+            print_usage();
+            return 1;
+        }
+        int nr_processes = (argc == 4) ? atoi(argv[3]) : 1;
+        return search_query(argv[2], nr_processes > 0 ? nr_processes : 1);
+    }
+    else if (strcmp(argv[1], "-A") == 0 || strcmp(argv[1], "-T") == 0 || strcmp(argv[1], "-P") == 0) { // Operação: Procurar por Autor ou Título.
+        if (argc != 3) { // programa + opção + texto.
+            print_usage();
+            return 1;
+        }
+        int field = (argv[1][1] == 'A') ? META_AUTHOR : (argv[1][1] == 'T') ? META_TITLE : META_TITLE_PREFIX;
+        return meta_search(field, argv[2], 0, 0);
+    }
+    else if (strcmp(argv[1], "-Y") == 0) { // Operação: Procurar por Ano.
+        if (argc < 3 || argc > 4) { // programa + opção + ano [+ ano_fim].
+            print_usage();
+            return 1;
+        }
+        int year_from = atoi(argv[2]);
+        int year_to = (argc == 4) ? atoi(argv[3]) : year_from;
+        if (year_from > year_to) {
+            print_usage();
+            return 1;
+        }
+        return meta_search(META_YEAR, NULL, year_from, year_to);
+    }
+    else if (strcmp(argv[1], "-e") == 0) { // Operação: Métricas do Servidor.
+        if (argc != 2) {
+            print_usage();
+            return 1;
+        }
+        req.operation = STATS;
+
+        Response resp = send_request(req);
+
+        if (resp.status == 0) {
+            print_server_stats(&resp.stats);
+        } else {
+            write(STDERR_FILENO, "Erro ao obter as métricas do servidor.\n", strlen("Erro ao obter as métricas do servidor.\n"));
+            return 1;
+        }
+    }
     else if (strcmp(argv[1], "-f") == 0) { // Operação: Encerrar Servidor (com persistência).
          if (argc != 2) { // Apenas programa + opção -f.
             print_usage();
@@ -410,4 +907,82 @@ int main(int argc, char* argv[]) {
     }
 
     return 0; // Retorna 0 indicando sucesso na execução do cliente.
+}
+
+/**
+ * @brief Divide uma linha de comando em palavras (separadas por espaços; "entre aspas" forma uma só).
+ *
+ * Altera a linha (termina cada palavra com '\0').
+ *
+ * @return O número de palavras guardadas em argv, ou -1 se houver demasiadas ou aspas por fechar.
+ */
+static int split_command_line(char* line, char* argv[], int max_args) {
+    int argc = 0;
+    char* p = line;
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+        if (*p == '\0') return argc;
+        if (argc == max_args) return -1;
+        if (*p == '"') {
+            argv[argc++] = ++p;
+            while (*p != '\0' && *p != '"') p++;
+            if (*p != '"') return -1;
+        } else {
+            argv[argc++] = p;
+            while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') p++;
+        }
+        if (*p != '\0') *p++ = '\0';
+    }
+}
+
+/**
+ * @brief Modo sessão: executa os comandos lidos do stdin (um por linha) com uma só ligação.
+ *
+ * Cada linha tem a mesma forma que os argumentos do cliente (ex: `-a "título" "autor" 2000 1.txt`);
+ * linhas vazias ou começadas por '#' são ignoradas. No fim, fecha a ligação (com FIFOs, avisa
+ * o servidor com END_SESSION e remove o FIFO do cliente).
+ *
+ * @return 0 se todos os comandos tiverem sucesso, 1 caso contrário.
+ */
+static int run_session() {
+    client_conn_init(&conn, TRANSPORT_AUTO, 1);
+
+    char line[MAX_SESSION_LINE];
+    char* args[MAX_SESSION_ARGS + 1];
+    int result = 0;
+    args[0] = "dclient";
+    while (fgets(line, sizeof(line), stdin)) {
+        int n = split_command_line(line, args + 1, MAX_SESSION_ARGS);
+        if (n == 0 || args[1][0] == '#') continue;
+        if (n < 0 || strcmp(args[1], "-i") == 0) {
+            print_usage();
+            result = 1;
+            continue;
+        }
+        args[n + 1] = NULL;
+        if (run_command(n + 1, args) != 0) result = 1;
+    }
+
+    client_conn_close(&conn);
+    return result;
+}
+
+/**
+ * @brief Função principal do cliente.
+ *
+ * Executa o comando dado na linha de comandos, ou, com -i, uma sessão com os comandos do stdin.
+ *
+ * @param argc Número de argumentos da linha de comandos.
+ * @param argv Array de strings contendo os argumentos da linha de comandos.
+ * @return 0 em caso de sucesso, 1 em caso de erro ou uso incorreto.
+ */
+int main(int argc, char* argv[]) {
+    // Um servidor que termina, ou deixa de ler um lote (ver client_conn_request), gera erros
+    // de escrita, não um sinal.
+    signal(SIGPIPE, SIG_IGN);
+    if (argc == 2 && strcmp(argv[1], "-i") == 0) {
+        return run_session();
+    }
+    client_conn_init(&conn, TRANSPORT_AUTO, 0);
+    return run_command(argc, argv);
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "Document_Struct.h"
+#include "Doc_Cache.h"
+
+/**
+ * @brief Devolve a entrada com um dado índice.
+ */
+static inline CacheEntry* entry_at(const DocCache* cache, int i) {
+    return &cache->blocks[i / CACHE_BLOCK_ENTRIES][i % CACHE_BLOCK_ENTRIES];
+}
+
+/**
+ * @brief Devolve o índice da entrada que guarda um documento da cache.
+ */
+static int entry_index(const Document* doc) {
+    return ((const CacheEntry*)doc)->index;
+}
+
+/**
+ * @brief Liga uma entrada à cabeça da lista LRU (usada mais recentemente).
+ */
+static void lru_push_front(DocCache* cache, int i) {
+    entry_at(cache, i)->prev = -1;
+    entry_at(cache, i)->next = cache->lru_head;
+    if (cache->lru_head >= 0) entry_at(cache, cache->lru_head)->prev = i;
+    cache->lru_head = i;
+    if (cache->lru_tail < 0) cache->lru_tail = i;
+}
+
+/**
+ * @brief Desliga uma entrada da lista LRU.
+ */
+static void lru_unlink(DocCache* cache, int i) {
+    CacheEntry* e = entry_at(cache, i);
+    if (e->prev >= 0) entry_at(cache, e->prev)->next = e->next;
+    else cache->lru_head = e->next;
+    if (e->next >= 0) entry_at(cache, e->next)->prev = e->prev;
+    else cache->lru_tail = e->prev;
+    e->prev = e->next = -1;
+}
+
+/**
+ * @brief Escolhe a entrada a libertar numa cache cheia, segundo a política.
+ */
+static int choose_victim(DocCache* cache) {
+    if (cache->policy == CACHE_POLICY_LRU) return cache->lru_tail;
+
+    // CLOCK: limpa os bits de referência até encontrar uma entrada não referenciada
+    // (no máximo uma volta completa, já que cada passagem limpa o bit).
+    for (;;) {
+        CacheEntry* e = entry_at(cache, cache->clock_hand);
+        int i = cache->clock_hand;
+        cache->clock_hand = (cache->clock_hand + 1) % cache->num_entries;
+        if (!e->in_use) continue;
+        if (!e->referenced) return i;
+        e->referenced = 0;
+    }
+}
+
+/**
+ * @brief Liberta uma entrada (desliga-a da política e devolve-a à lista de livres).
+ */
+static void release_entry(DocCache* cache, int i) {
+    if (cache->policy == CACHE_POLICY_LRU) lru_unlink(cache, i);
+    CacheEntry* e = entry_at(cache, i);
+    e->in_use = 0;
+    e->referenced = 0;
+    e->next = cache->free_head;
+    cache->free_head = i;
+    cache->num_docs--;
+}
+
+/**
+ * @brief Devolve uma entrada livre: da lista de livres ou, se estiver vazia, uma nova da arena.
+ *
+ * Só deve ser chamada com a cache abaixo da capacidade.
+ *
+ * @return O índice da entrada, ou -1 se faltar memória para um novo bloco.
+ */
+static int take_free_entry(DocCache* cache) {
+    if (cache->free_head >= 0) {
+        int i = cache->free_head;
+        cache->free_head = entry_at(cache, i)->next;
+        return i;
+    }
+    int i = cache->num_entries;
+    if (i / CACHE_BLOCK_ENTRIES == cache->num_blocks) {
+        CacheEntry* block = malloc(CACHE_BLOCK_ENTRIES * sizeof(CacheEntry));
+        if (!block) return -1;
+        cache->blocks[cache->num_blocks++] = block;
+    }
+    entry_at(cache, i)->index = i;
+    cache->num_entries++;
+    return i;
+}
+
+/**
+ * @brief Inicializa uma cache vazia (as entradas são alocadas à medida que a cache enche).
+ *
+ * @param cache A cache.
+ * @param capacity Número máximo de documentos (>= 1).
+ * @param policy CACHE_POLICY_LRU ou CACHE_POLICY_CLOCK.
+ * @return 0 em caso de sucesso, -1 se os parâmetros forem inválidos ou faltar memória.
+ */
+int doc_cache_init(DocCache* cache, int capacity, int policy) {
+    memset(cache, 0, sizeof(DocCache));
+    cache->lru_head = cache->lru_tail = cache->free_head = -1;
+    if (capacity < 1 || (policy != CACHE_POLICY_LRU && policy != CACHE_POLICY_CLOCK)) return -1;
+
+    // Só a tabela de blocos é alocada já (8 bytes por CACHE_BLOCK_ENTRIES documentos).
+    int max_blocks = (int)(((long)capacity + CACHE_BLOCK_ENTRIES - 1) / CACHE_BLOCK_ENTRIES);
+    cache->blocks = calloc(max_blocks, sizeof(CacheEntry*));
+    if (!cache->blocks) return -1;
+    cache->capacity = capacity;
+    cache->policy = policy;
+    return 0;
+}
+
+/**
+ * @brief Liberta a memória da cache (os ponteiros devolvidos deixam de ser válidos).
+ */
+void doc_cache_free(DocCache* cache) {
+    for (int b = 0; b < cache->num_blocks; b++) free(cache->blocks[b]);
+    free(cache->blocks);
+    cache->blocks = NULL;
+    cache->num_blocks = 0;
+    cache->num_entries = 0;
+    cache->capacity = 0;
+    cache->num_docs = 0;
+}
+
+/**
+ * @brief Coloca uma cópia de um documento na cache, retirando outro se estiver cheia.
+ *
+ * @param cache A cache.
+ * @param doc O documento a copiar.
+ * @param evicted_id Recebe o ID do documento retirado para dar lugar a este, ou -1 se nenhum saiu.
+ * @return Ponteiro para a cópia em cache (válido até o documento sair da cache), ou NULL se
+ * faltar memória para a arena (o documento fica apenas no disco).
+ */
+Document* doc_cache_insert(DocCache* cache, const Document* doc, int* evicted_id) {
+    *evicted_id = -1;
+    if (cache->num_docs == cache->capacity) {
+        int victim = choose_victim(cache);
+        *evicted_id = entry_at(cache, victim)->doc.id;
+        release_entry(cache, victim);
+        cache->evictions++;
+    }
+
+    int i = take_free_entry(cache);
+    if (i < 0) return NULL;
+    CacheEntry* e = entry_at(cache, i);
+    memcpy(&e->doc, doc, sizeof(Document));
+    e->in_use = 1;
+    e->referenced = 1;
+    if (cache->policy == CACHE_POLICY_LRU) lru_push_front(cache, i);
+    cache->num_docs++;
+    return &e->doc;
+}
+
+/**
+ * @brief Regista um acerto: o documento passa a ser o usado mais recentemente.
+ *
+ * @param cache A cache.
+ * @param doc Ponteiro devolvido por `doc_cache_insert`.
+ */
+void doc_cache_touch(DocCache* cache, Document* doc) {
+    int i = entry_index(doc);
+    cache->hits++;
+    if (cache->policy == CACHE_POLICY_LRU) {
+        if (cache->lru_head != i) {
+            lru_unlink(cache, i);
+            lru_push_front(cache, i);
+        }
+    } else {
+        entry_at(cache, i)->referenced = 1;
+    }
+}
+
+/**
+ * @brief Retira um documento da cache (ex: foi removido da base de dados).
+ *
+ * @param cache A cache.
+ * @param doc Ponteiro devolvido por `doc_cache_insert`.
+ */
+void doc_cache_remove(DocCache* cache, Document* doc) {
+    release_entry(cache, entry_index(doc));
+}
+
+/**
+ * @brief Converte o nome de uma política ("lru" ou "clock") na constante correspondente.
+ *
+ * @return CACHE_POLICY_LRU, CACHE_POLICY_CLOCK, ou -1 se o nome for desconhecido.
+ */
+int doc_cache_parse_policy(const char* name) {
+    if (strcmp(name, "lru") == 0) return CACHE_POLICY_LRU;
+    if (strcmp(name, "clock") == 0) return CACHE_POLICY_CLOCK;
+    return -1;
+}
+
+/**
+ * @brief Devolve o nome de uma política, para mensagens.
+ */
+const char* doc_cache_policy_name(int policy) {
+    return policy == CACHE_POLICY_CLOCK ? "CLOCK" : "LRU";
+}
@@ -0,0 +1,230 @@
+#include "Document_Struct.h"
+#include "Doc_Log.h"
+#include <stddef.h>     // Para offsetof
+
+/**
+ * @brief Soma de verificação FNV-1a (32 bits) dos campos de um registo (exceto magic e checksum).
+ */
+static uint32_t record_checksum(const LogRecord* rec) {
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)&rec->op;
+    size_t len = sizeof(rec->op) + sizeof(rec->next_id);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    bytes = (const unsigned char*)&rec->doc;
+    for (size_t i = 0; i < sizeof(Document); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Abre (ou cria) o log. Os registos só são lidos por `doc_log_replay`.
+ *
+ * @param log O log a inicializar.
+ * @param path Caminho do ficheiro (normalmente LOG_FILE).
+ * @param sync_batch Número de registos por fdatasync automático (1 = cada registo; 0 = nunca).
+ * @return 0 em caso de sucesso, -1 em caso de erro (errno indica a causa).
+ */
+int doc_log_open(DocLog* log, const char* path, int sync_batch) {
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    log->size = 0;
+    log->num_records = 0;
+    log->sync_batch = sync_batch;
+    log->written = 0;
+    log->synced = 0;
+    pthread_mutex_init(&log->sync_mutex, NULL);
+    pthread_mutex_init(&log->flush_mutex, NULL);
+    return log->fd < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Fecha o log.
+ */
+void doc_log_close(DocLog* log) {
+    if (log->fd >= 0) {
+        doc_log_sync(log);
+        close(log->fd);
+        log->fd = -1;
+        pthread_mutex_destroy(&log->sync_mutex);
+        pthread_mutex_destroy(&log->flush_mutex);
+    }
+}
+
+/**
+ * @brief Sincroniza com o disco (fdatasync) os registos escritos desde a última sincronização.
+ *
+ * Pode ser chamada por outra thread enquanto se acrescentam registos: os que forem escritos
+ * durante o fdatasync ficam para a sincronização seguinte. Os registos só contam como
+ * sincronizados depois de o fdatasync terminar com sucesso; uma chamada concorrente espera
+ * por ele (flush_mutex) em vez de devolver 0 antes de os seus registos estarem no disco.
+ *
+ * @return 0 em caso de sucesso (ou se não havia nada a sincronizar), -1 em caso de erro.
+ */
+int doc_log_sync(DocLog* log) {
+    pthread_mutex_lock(&log->flush_mutex);
+    pthread_mutex_lock(&log->sync_mutex);
+    unsigned long target = log->written;
+    int pending = (target != log->synced);
+    pthread_mutex_unlock(&log->sync_mutex);
+
+    int result = 0;
+    if (pending && log->fd >= 0) {
+        if (fdatasync(log->fd) == 0) {
+            pthread_mutex_lock(&log->sync_mutex);
+            if (target > log->synced) log->synced = target; // Um reset entretanto pode já ter avançado.
+            pthread_mutex_unlock(&log->sync_mutex);
+        } else {
+            result = -1; // Continuam por sincronizar.
+        }
+    }
+    pthread_mutex_unlock(&log->flush_mutex);
+    return result;
+}
+
+/**
+ * @brief Lê todos os registos do log, por ordem, e chama `fn` para cada um.
+ *
+ * A leitura pára no primeiro registo incompleto ou inválido; o log é truncado nesse ponto
+ * para que os registos seguintes sejam escritos logo a seguir ao último registo válido.
+ *
+ * @param log O log aberto.
+ * @param fn Função chamada para cada registo válido.
+ * @param ctx Ponteiro passado a `fn`.
+ * @return O número de registos válidos, ou -1 em caso de erro de leitura.
+ */
+int doc_log_replay(DocLog* log, DocLogReplayFn fn, void* ctx) {
+    LogRecord rec;
+    off_t offset = 0;
+    int count = 0;
+
+    for (;;) {
+        ssize_t n = pread(log->fd, &rec, sizeof(LogRecord), offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n != sizeof(LogRecord)) break; // Fim do log (ou registo incompleto).
+        if (rec.magic != LOG_RECORD_MAGIC || rec.checksum != record_checksum(&rec) ||
+            (rec.op != LOG_UPSERT && rec.op != LOG_DELETE)) {
+            break; // Registo corrompido: tudo o que se segue é descartado.
+        }
+        fn(rec.op, &rec.doc, offset + offsetof(LogRecord, doc), rec.next_id, ctx);
+        offset += sizeof(LogRecord);
+        count++;
+    }
+
+    struct stat st;
+    if (fstat(log->fd, &st) == 0 && st.st_size > offset) {
+        char msg[160];
+        int len = snprintf(msg, sizeof(msg), "Aviso: %lld bytes inválidos no fim de '%s' descartados.\n",
+                           (long long)(st.st_size - offset), LOG_FILE);
+        write(STDERR_FILENO, msg, len);
+        if (ftruncate(log->fd, offset) != 0) return -1;
+    }
+    log->size = offset;
+    log->num_records = count;
+    return count;
+}
+
+/**
+ * @brief Acrescenta um registo ao fim do log.
+ *
+ * @param log O log aberto.
+ * @param op LOG_UPSERT ou LOG_DELETE.
+ * @param doc O documento (para LOG_DELETE basta doc->id).
+ * @param next_id Valor atual de next_id.
+ * @return O offset, no log, do campo `doc` do registo escrito, ou -1 em caso de erro.
+ */
+off_t doc_log_append(DocLog* log, int op, const Document* doc, int next_id) {
+    LogRecord rec;
+    memset(&rec, 0, sizeof(LogRecord)); // Bytes de preenchimento determinísticos (entram na soma).
+    rec.magic = LOG_RECORD_MAGIC;
+    rec.op = op;
+    rec.next_id = next_id;
+    if (op == LOG_DELETE) {
+        rec.doc.id = doc->id;
+    } else {
+        memcpy(&rec.doc, doc, sizeof(Document));
+    }
+    rec.checksum = record_checksum(&rec);
+
+    ssize_t written = pwrite(log->fd, &rec, sizeof(LogRecord), log->size);
+    if (written != sizeof(LogRecord)) {
+        // Escrita parcial: o registo fica incompleto e será sobrescrito pelo próximo.
+        return -1;
+    }
+    off_t doc_offset = log->size + offsetof(LogRecord, doc);
+    log->size += sizeof(LogRecord);
+    log->num_records++;
+
+    pthread_mutex_lock(&log->sync_mutex);
+    log->written++;
+    int due = (log->sync_batch > 0 && log->written - log->synced >= (unsigned long)log->sync_batch);
+    pthread_mutex_unlock(&log->sync_mutex);
+    if (due && doc_log_sync(log) != 0) {
+        // O registo pode não sobreviver a uma falha: é retirado e a operação não é confirmada.
+        log->size -= sizeof(LogRecord);
+        log->num_records--;
+        ftruncate(log->fd, log->size);
+        return -1;
+    }
+    return doc_offset;
+}
+
+/**
+ * @brief Acrescenta ao fim do log um registo UPSERT por documento, com uma só escrita.
+ *
+ * Ao contrário de `doc_log_append`, não sincroniza: os registos contam como por sincronizar
+ * e o chamador faz um único `doc_log_sync` no fim do lote (ou deixa-o à thread periódica).
+ *
+ * @param log O log aberto.
+ * @param docs Os documentos (já com o ID atribuído).
+ * @param n Número de documentos.
+ * @param next_id Valor atual de next_id (igual em todos os registos).
+ * @param doc_offsets Recebe, para cada documento, o offset do campo `doc` do seu registo.
+ * @return 0 em caso de sucesso, -1 em caso de erro (nenhum registo do lote fica no log).
+ */
+int doc_log_append_batch(DocLog* log, const Document* docs, int n, int next_id, off_t* doc_offsets) {
+    LogRecord* recs = calloc(n, sizeof(LogRecord)); // Bytes de preenchimento a zero (entram na soma).
+    if (!recs) return -1;
+    for (int i = 0; i < n; i++) {
+        recs[i].magic = LOG_RECORD_MAGIC;
+        recs[i].op = LOG_UPSERT;
+        recs[i].next_id = next_id;
+        memcpy(&recs[i].doc, &docs[i], sizeof(Document));
+        recs[i].checksum = record_checksum(&recs[i]);
+        doc_offsets[i] = log->size + (off_t)i * sizeof(LogRecord) + offsetof(LogRecord, doc);
+    }
+
+    size_t len = (size_t)n * sizeof(LogRecord);
+    ssize_t written = pwrite(log->fd, recs, len, log->size);
+    free(recs);
+    if (written != (ssize_t)len) {
+        ftruncate(log->fd, log->size); // Descarta a parte escrita do lote.
+        return -1;
+    }
+    log->size += len;
+    log->num_records += n;
+
+    pthread_mutex_lock(&log->sync_mutex);
+    log->written += n;
+    pthread_mutex_unlock(&log->sync_mutex);
+    return 0;
+}
+
+/**
+ * @brief Esvazia o log (depois de o seu conteúdo ter sido incorporado numa nova fotografia).
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int doc_log_reset(DocLog* log) {
+    if (ftruncate(log->fd, 0) != 0) return -1;
+    log->size = 0;
+    log->num_records = 0;
+    pthread_mutex_lock(&log->sync_mutex);
+    log->synced = log->written; // O conteúdo já está na fotografia, sincronizada antes do reset.
+    pthread_mutex_unlock(&log->sync_mutex);
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include "Doc_Record.h"
+
+/**
+ * @brief Escreve um inteiro sem sinal em varint (LEB128).
+ *
+ * @return O número de bytes escritos (1 a 5).
+ */
+static int put_varint(unsigned char* p, uint32_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        p[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (unsigned char)value;
+    return n;
+}
+
+/**
+ * @brief Lê um varint de [*p, end).
+ *
+ * @return 0 em caso de sucesso (avança *p), -1 se estiver truncado ou for demasiado longo.
+ */
+static int get_varint(const unsigned char** p, const unsigned char* end, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        unsigned char byte = *(*p)++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Escreve um campo de texto (até `max` bytes ou ao primeiro '\0') como str.
+ */
+static int put_str(unsigned char* p, const char* field, size_t max) {
+    size_t len = strnlen(field, max);
+    p[0] = (unsigned char)len;
+    memcpy(p + 1, field, len);
+    return 1 + (int)len;
+}
+
+/**
+ * @brief Lê uma str para um campo de `max` bytes (preenchido com '\0' a seguir ao texto).
+ *
+ * @return 0 em caso de sucesso (avança *p), -1 se estiver truncada ou não couber.
+ */
+static int get_str(const unsigned char** p, const unsigned char* end, char* field, size_t max) {
+    if (*p >= end) return -1;
+    size_t len = *(*p)++;
+    if (len > max || (size_t)(end - *p) < len) return -1;
+    memset(field, 0, max);
+    memcpy(field, *p, len);
+    *p += len;
+    return 0;
+}
+
+/**
+ * @brief Indica se o ano é um número decimal canónico (guardado como número sem perder nada).
+ */
+static int year_is_numeric(const char* year, uint32_t* value) {
+    size_t len = strnlen(year, MAX_YEAR_SIZE);
+    if (len == 0 || len >= MAX_YEAR_SIZE || (year[0] == '0' && len > 1)) return 0;
+    uint32_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (year[i] < '0' || year[i] > '9') return 0;
+        v = v * 10 + (uint32_t)(year[i] - '0');
+    }
+    *value = v;
+    return 1;
+}
+
+/**
+ * @brief Codifica um documento num registo (ver Doc_Record.h).
+ *
+ * @param author_index Posição do autor no dicionário (ver `author_dict_intern`).
+ * @param buf Espaço para DOC_RECORD_MAX bytes.
+ * @return O tamanho do registo, em bytes.
+ */
+int doc_record_encode(const Document* doc, uint32_t author_index, unsigned char* buf) {
+    int len = 2; // O tamanho é escrito no fim.
+    uint32_t year;
+    int numeric = year_is_numeric(doc->year, &year);
+    buf[len++] = numeric ? DOC_RECORD_YEAR_NUMERIC : 0;
+    len += put_varint(buf + len, (uint32_t)doc->id);
+    if (numeric) {
+        len += put_varint(buf + len, year);
+    } else {
+        len += put_str(buf + len, doc->year, MAX_YEAR_SIZE);
+    }
+    len += put_str(buf + len, doc->title, MAX_TITLE_SIZE);
+    len += put_varint(buf + len, author_index);
+    len += put_str(buf + len, doc->path, MAX_PATH_SIZE);
+    buf[0] = (unsigned char)(len & 0xFF);
+    buf[1] = (unsigned char)(len >> 8);
+    return len;
+}
+
+/**
+ * @brief Descodifica o registo no início de `buf`.
+ *
+ * @param len Bytes disponíveis em buf (pode haver mais do que um registo).
+ * @param dict Dicionário de autores da fotografia.
+ * @param out Documento reconstruído (campos de texto completados com '\0').
+ * @return O tamanho do registo, ou -1 se estiver truncado ou for inválido.
+ */
+int doc_record_decode(const unsigned char* buf, size_t len, const AuthorDict* dict, Document* out) {
+    if (len < 3) return -1;
+    size_t record_len = buf[0] | ((size_t)buf[1] << 8);
+    if (record_len < 3 || record_len > len || record_len > DOC_RECORD_MAX) return -1;
+    const unsigned char* p = buf + 3;
+    const unsigned char* end = buf + record_len;
+    int flags = buf[2];
+
+    uint32_t id, year, author;
+    memset(out, 0, sizeof(Document));
+    if (get_varint(&p, end, &id) != 0) return -1;
+    out->id = (int)id;
+    if (flags & DOC_RECORD_YEAR_NUMERIC) {
+        if (get_varint(&p, end, &year) != 0) return -1;
+        snprintf(out->year, MAX_YEAR_SIZE, "%u", year);
+    } else if (get_str(&p, end, out->year, MAX_YEAR_SIZE) != 0) {
+        return -1;
+    }
+    if (get_str(&p, end, out->title, MAX_TITLE_SIZE) != 0) return -1;
+    if (get_varint(&p, end, &author) != 0) return -1;
+    const char* name = author_dict_get(dict, author);
+    if (!name) return -1;
+    strncpy(out->authors, name, MAX_AUTHORS_SIZE); // O nome tem no máximo MAX_AUTHORS_SIZE bytes.
+    if (get_str(&p, end, out->path, MAX_PATH_SIZE) != 0) return -1;
+    return p == end ? (int)record_len : -1;
+}
+
+/**
+ * @brief Inicializa um dicionário vazio.
+ */
+void author_dict_init(AuthorDict* dict) {
+    memset(dict, 0, sizeof(AuthorDict));
+}
+
+/**
+ * @brief Liberta a memória do dicionário.
+ */
+void author_dict_free(AuthorDict* dict) {
+    free(dict->heap);
+    free(dict->offsets);
+    free(dict->slots);
+    author_dict_init(dict);
+}
+
+/**
+ * @brief Dispersão (FNV-1a) de um nome.
+ */
+static uint32_t hash_name(const char* name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+/**
+ * @brief Acrescenta um nome ao fim do dicionário (sem procurar repetidos).
+ *
+ * @return A posição do nome, ou -1 se faltar memória.
+ */
+static int64_t append_name(AuthorDict* dict, const char* name, size_t len) {
+    if (dict->count == dict->capacity) {
+        uint32_t new_capacity = dict->capacity ? dict->capacity * 2 : 256;
+        uint32_t* grown = realloc(dict->offsets, new_capacity * sizeof(uint32_t));
+        if (!grown) return -1;
+        dict->offsets = grown;
+        dict->capacity = new_capacity;
+    }
+    if (dict->heap_len + len + 1 > dict->heap_capacity) {
+        size_t new_capacity = dict->heap_capacity ? dict->heap_capacity * 2 : 4096;
+        while (new_capacity < dict->heap_len + len + 1) new_capacity *= 2;
+        char* grown = realloc(dict->heap, new_capacity);
+        if (!grown) return -1;
+        dict->heap = grown;
+        dict->heap_capacity = new_capacity;
+    }
+    memcpy(dict->heap + dict->heap_len, name, len);
+    dict->heap[dict->heap_len + len] = '\0';
+    dict->offsets[dict->count] = (uint32_t)dict->heap_len;
+    dict->heap_len += len + 1;
+    return dict->count++;
+}
+
+/**
+ * @brief Reconstrói a tabela de dispersão com o dobro das posições (ou a cria).
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int grow_slots(AuthorDict* dict) {
+    uint32_t num_slots = dict->num_slots ? dict->num_slots * 2 : 1024;
+    int32_t* slots = malloc(num_slots * sizeof(int32_t));
+    if (!slots) return -1;
+    memset(slots, 0xFF, num_slots * sizeof(int32_t)); // -1 em todas.
+    for (uint32_t i = 0; i < dict->count; i++) {
+        const char* name = dict->heap + dict->offsets[i];
+        uint32_t s = hash_name(name, strlen(name)) & (num_slots - 1);
+        while (slots[s] >= 0) s = (s + 1) & (num_slots - 1);
+        slots[s] = (int32_t)i;
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    dict->num_slots = num_slots;
+    return 0;
+}
+
+/**
+ * @brief Devolve a posição de um nome no dicionário, acrescentando-o se ainda lá não estiver.
+ *
+ * @param name O nome (não precisa de terminar em '\0').
+ * @param len Número de bytes do nome.
+ * @return A posição, ou -1 se faltar memória.
+ */
+int64_t author_dict_intern(AuthorDict* dict, const char* name, size_t len) {
+    if ((dict->count + 1) * 2 > dict->num_slots && grow_slots(dict) != 0) return -1;
+    uint32_t s = hash_name(name, len) & (dict->num_slots - 1);
+    while (dict->slots[s] >= 0) {
+        const char* existing = dict->heap + dict->offsets[dict->slots[s]];
+        if (strncmp(existing, name, len) == 0 && existing[len] == '\0') return dict->slots[s];
+        s = (s + 1) & (dict->num_slots - 1);
+    }
+    int64_t index = append_name(dict, name, len);
+    if (index >= 0) dict->slots[s] = (int32_t)index;
+    return index;
+}
+
+/**
+ * @brief Nome numa posição do dicionário, ou NULL se a posição não existir.
+ */
+const char* author_dict_get(const AuthorDict* dict, uint32_t index) {
+    return index < dict->count ? dict->heap + dict->offsets[index] : NULL;
+}
+
+/**
+ * @brief Escreve o dicionário (cada nome como str, pela ordem das posições) na posição atual de fd.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro de escrita.
+ */
+int author_dict_write(const AuthorDict* dict, int fd) {
+    unsigned char buf[64 * 1024];
+    size_t used = 0;
+    for (uint32_t i = 0; i < dict->count; i++) {
+        if (used + 1 + MAX_AUTHORS_SIZE > sizeof(buf)) {
+            if (write(fd, buf, used) != (ssize_t)used) return -1;
+            used = 0;
+        }
+        used += put_str(buf + used, dict->heap + dict->offsets[i], MAX_AUTHORS_SIZE);
+    }
+    if (used > 0 && write(fd, buf, used) != (ssize_t)used) return -1;
+    return 0;
+}
+
+/**
+ * @brief Lê um dicionário escrito por `author_dict_write` (substitui o conteúdo de dict).
+ *
+ * @param offset Offset do dicionário no ficheiro.
+ * @param count Número de nomes.
+ * @return 0 em caso de sucesso, -1 se estiver truncado ou faltar memória.
+ */
+int author_dict_read(AuthorDict* dict, int fd, off_t offset, uint32_t count) {
+    author_dict_free(dict);
+    unsigned char buf[64 * 1024];
+    size_t have = 0, pos = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (have - pos < 1 + MAX_AUTHORS_SIZE) { // Garante um nome inteiro no buffer (se existir).
+            memmove(buf, buf + pos, have - pos);
+            have -= pos;
+            pos = 0;
+            ssize_t n = pread(fd, buf + have, sizeof(buf) - have, offset);
+            if (n < 0) return -1;
+            have += n;
+            offset += n;
+        }
+        if (pos >= have) return -1;
+        size_t len = buf[pos];
+        if (len > MAX_AUTHORS_SIZE || have - pos - 1 < len) return -1;
+        if (append_name(dict, (const char*)buf + pos + 1, len) < 0) return -1;
+        pos += 1 + len;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "Document_Struct.h"
+#include "Doc_Table.h"
+
+/**
+ * @brief Marca as posições [from, to) como vazias (fora da cache e fora do disco).
+ */
+static void clear_slots(DocSlot* slots, int from, int to) {
+    for (int i = from; i < to; i++) {
+        slots[i].cached = NULL;
+        slots[i].disk_offset = -1;
+        slots[i].in_log = 0;
+        slots[i].path = NULL;
+    }
+}
+
+/**
+ * @brief Inicializa uma tabela vazia.
+ *
+ * @param table A tabela.
+ * @param initial_capacity Número inicial de posições (ex: next_id previsto).
+ * @return 0 em caso de sucesso, -1 em caso de falha de alocação.
+ */
+int doc_table_init(DocTable* table, int initial_capacity) {
+    if (initial_capacity < 16) initial_capacity = 16;
+    table->slots = malloc(initial_capacity * sizeof(DocSlot));
+    if (!table->slots) {
+        table->capacity = 0;
+        return -1;
+    }
+    table->capacity = initial_capacity;
+    clear_slots(table->slots, 0, initial_capacity);
+    return 0;
+}
+
+/**
+ * @brief Liberta a tabela e os caminhos (os documentos apontados pertencem à cache e não são libertados).
+ */
+void doc_table_free(DocTable* table) {
+    for (int i = 0; i < table->capacity; i++) free(table->slots[i].path);
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+}
+
+/**
+ * @brief Devolve a posição de um ID, sem fazer crescer a tabela.
+ *
+ * @return A posição, ou NULL se o ID estiver fora da tabela (documento inexistente).
+ */
+DocSlot* doc_table_slot(DocTable* table, int id) {
+    if (id < 0 || id >= table->capacity) return NULL;
+    return &table->slots[id];
+}
+
+/**
+ * @brief Devolve a posição de um ID, fazendo crescer a tabela (para o dobro) se necessário.
+ *
+ * @return A posição, ou NULL se o ID for inválido ou faltar memória.
+ */
+DocSlot* doc_table_slot_create(DocTable* table, int id) {
+    if (id < 0) return NULL;
+    if (id >= table->capacity) {
+        int new_capacity = table->capacity ? table->capacity : 16;
+        while (new_capacity <= id) new_capacity *= 2;
+
+        DocSlot* bigger = realloc(table->slots, new_capacity * sizeof(DocSlot));
+        if (!bigger) return NULL;
+        clear_slots(bigger, table->capacity, new_capacity);
+        table->slots = bigger;
+        table->capacity = new_capacity;
+    }
+    return &table->slots[id];
+}
+
+/**
+ * @brief Guarda (ou, com NULL, apaga) o caminho do documento de uma posição.
+ *
+ * Se faltar memória, a posição fica sem caminho: quem precisa dele lê o documento.
+ */
+void doc_table_set_path(DocSlot* slot, const char* path) {
+    free(slot->path);
+    slot->path = path ? strdup(path) : NULL;
+}
@@ -1,999 +1,4154 @@
+#define _GNU_SOURCE // Para struct ucred (SO_PEERCRED) e accept4.
 #include "Document_Struct.h"
+#include "Matcher.h"
+#include "Multi_Matcher.h"
+#include "Search_Query.h"
+#include "Ranking.h"
+#include "Inverted_Index.h"
+#include "Doc_Table.h"
+#include "Request_Queue.h"
+#include "Doc_Log.h"
+#include "Doc_Cache.h"
+#include "File_Map.h"
+#include "Client_Table.h"
+#include "Reply_Queue.h"
+#include "Search_Pool.h"
+#include "Result_Cache.h"
+#include "Server_Metrics.h"
+#include "Doc_Record.h"
+#include "Meta_Index.h"
+#include <locale.h> // Para setlocale (expressões regulares avaliadas no locale do utilizador, como no grep).
+#include <sys/socket.h> // Para socket, bind, listen, accept4, getsockopt, shutdown
+#include <sys/un.h>     // Para struct sockaddr_un
+#include <sys/epoll.h>  // Para epoll_create1, epoll_ctl, epoll_wait
+#include <sys/resource.h> // Para getrlimit, setrlimit (RLIMIT_NOFILE)
+#include <poll.h>       // Para poll (leitura do lote com prazo)
 
-// Estrutura para armazenar os documentos em memória (cache).
-typedef struct {
-    Document* docs[MAX_DOCS]; // Array de ponteiros para documentos armazenados na cache.
-    int num_docs;             // Contador de documentos atualmente na cache.
-    int max_size;             // Tamanho máximo da cache (número máximo de documentos permitidos).
-    int modified;             // Flag para indicar se houve modificações desde a última gravação em disco.
-} Cache;
+// Como uma tarefa de pesquisa é resolvida (ver `resolve_search_tasks_with_index`).
+#define SEARCH_TASK_SCAN 0        // Ler o ficheiro do documento.
+#define SEARCH_TASK_INDEX_HIT 1   // O índice (atualizado) indica que o documento contém a palavra-chave.
+#define SEARCH_TASK_INDEX_MISS 2  // O índice (atualizado) indica que o documento não a contém.
 
 // Estrutura para representar uma tarefa de pesquisa.
 typedef struct {
     int id;                   // ID do documento a pesquisar.
     char path[MAX_PATH_SIZE]; // Caminho para o ficheiro do documento.
+    int index_state;          // SEARCH_TASK_SCAN, SEARCH_TASK_INDEX_HIT ou SEARCH_TASK_INDEX_MISS.
+    double score;             // Pontuação BM25 calculada pelo índice (RANKED_SEARCH, SEARCH_TASK_INDEX_HIT).
 } SearchTask;
 
 // Variáveis globais.
-Cache cache;                // Instância da cache que mantém os documentos em memória.
+DocCache cache;             // Cache dos documentos em memória (política LRU ou CLOCK, ver Doc_Cache.h).
+int store_modified = 0;     // 1 se houve alterações desde a última compactação (ver compact_store).
 char base_folder[256];      // Pasta base onde os ficheiros de documentos estão armazenados.
 int next_id = 1;            // Contador global para atribuição de IDs únicos aos documentos.
+DocTable doc_table;         // Tabela ID -> localização do documento (cache e/ou disco).
+int db_fd = -1;             // Descritor de "database.bin" mantido aberto (ver database_fd()).
+int db_version = 0;         // Formato de "database.bin": 0 se não existe, DB_VERSION_LEGACY, DB_VERSION_COMPACT_V2 ou DB_VERSION (ver Doc_Record.h).
+AuthorDict db_authors;      // Dicionário de autores de "database.bin" (formatos compactos).
+DocLog doc_log = { -1, 0, 0 }; // Log das alterações desde a última compactação (ver Doc_Log.h).
+int num_documents = 0;      // Número de documentos existentes (na fotografia ou no log).
+InvertedIndex search_index; // Índice invertido termo -> IDs, usado por SEARCH_DOCS.
+FileMapCache file_maps;     // Ficheiros dos documentos mapeados em memória (ver File_Map.h).
+int file_maps_enabled = 0;  // 1 se COUNT_LINES/SEARCH_DOCS pesquisam os ficheiros por mmap.
+int index_enabled = 0;      // 1 se o índice está completo e pode responder a pesquisas.
+MetaIndex meta_index;       // Índices de metadados (autor, ano, título), usados por META_SEARCH.
+int meta_enabled = 0;       // 1 se os índices de metadados estão completos (senão META_SEARCH percorre os documentos).
+
+// Sincronização entre as threads trabalhadoras.
+// - store_lock: protege a cache, a tabela de documentos, o índice, "database.bin", o log e next_id.
+//   QUERY_DOC, COUNT_LINES e SEARCH_DOCS só leem e correm em paralelo (modo leitura);
+//   ADD_DOC e DELETE_DOC alteram o estado e correm sozinhos (modo escrita).
+// - cache_mutex: em modo leitura, find_document altera a cache (ordem de uso da política,
+//   estatísticas, inserção de um documento lido do disco); este mutex serializa essas
+//   alterações entre leitores.
+pthread_rwlock_t store_lock;
+pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+RequestQueue request_queue; // Pedidos lidos do SERVER_PIPE à espera de um trabalhador.
+ClientTable clients;        // Descritores de resposta dos clientes (só usada pelo ciclo de eventos).
+ReplyQueue reply_queue;     // Respostas das trabalhadoras à espera de serem escritas pelo ciclo de eventos.
+SearchPool search_pool;     // Threads da pesquisa paralela (opção -P), partilhadas por todas as trabalhadoras.
+ResultCache result_cache;   // Resultados de SEARCH_DOCS e COUNT_LINES por palavra-chave (opção -R).
+ServerMetrics metrics;      // Contadores e latências por operação (operação STATS).
+int backlog_depth = 0;      // Pedidos no backlog do ciclo de eventos (escrito só por ele; lido por STATS).
+int transport = TRANSPORT_FIFO; // Transporte em que o servidor recebe os pedidos (opção -t).
+int reply_timeout_ms;       // Prazo para um cliente ler a sua resposta (opção -T).
+
+#define BULK_CHUNK_DOCS 4096   // Documentos de um lote (BULK_ADD) lidos e aplicados de cada vez.
+#define INDEX_BATCH_DOCS 64    // Documentos indexados em segundo plano de cada vez (um lock em escrita por bloco).
+#define DEFAULT_CACHE_SIZE 100 // Tamanho da cache por defeito (segundo argumento posicional).
+#define DEFAULT_WORKERS 4   // Número de threads trabalhadoras por defeito (opção -w).
+#define MAX_WORKERS 64      // Limite de segurança para o número de trabalhadoras.
+#define SEARCH_SERIAL_THRESHOLD_TASKS 10 // Com menos documentos, a pesquisa paralela é feita em série.
+#define RANK_MAX_WORDS (MAX_KEYWORD_SIZE / 2) // Palavras de uma palavra-chave de RANKED_SEARCH (separadas por um byte).
+#define SOCKET_BACKLOG 128  // Ligações ao SERVER_SOCKET à espera de serem aceites.
+#define EPOLL_MAX_EVENTS 64 // Eventos tratados por cada epoll_pwait.
+#define SERVER_BACKLOG_LIMIT 4096  // Pedidos lidos à espera de lugar na fila antes de parar de ler o SERVER_PIPE.
+#define DEFAULT_REPLY_TIMEOUT_MS 5000 // Prazo por defeito para um cliente ler a resposta (opção -T).
+#define TIMEOUT_CHECK_MS 100        // Intervalo entre verificações dos prazos das respostas.
+
+// O log é incorporado numa nova fotografia quando tem pelo menos LOG_COMPACT_MIN_RECORDS
+// registos e mais registos do que documentos vivos: cada compactação (O(N)) é paga por
+// pelo menos N alterações, e cada ADD/DELETE custa O(1) amortizado.
+#define LOG_COMPACT_MIN_RECORDS 1024
+#define COMPACT_BUFFER_SIZE (64 * 1024) // Bytes de registos escritos de cada vez na nova fotografia.
+
+#define DEFAULT_FILE_MAP_MB (FILE_MAP_DEFAULT_BYTES / (1024 * 1024)) // Limite dos mapeamentos (opção -m).
+
+// Durabilidade do log (ver Doc_Log.h): fdatasync a cada DEFAULT_SYNC_BATCH registos (opção -B)
+// e, no máximo, DEFAULT_SYNC_INTERVAL_MS depois de uma alteração (opção -S). Com -B 1 cada
+// alteração é sincronizada antes da resposta; valores maiores trocam durabilidade (alterações
+// confirmadas que uma falha do sistema pode perder) por latência.
+#define DEFAULT_SYNC_BATCH 32
+#define DEFAULT_SYNC_INTERVAL_MS 100
+
+int sync_batch = DEFAULT_SYNC_BATCH;
+int sync_interval_ms = DEFAULT_SYNC_INTERVAL_MS;
+pthread_mutex_t sync_thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t sync_thread_cond = PTHREAD_COND_INITIALIZER;
+int sync_thread_stop = 0;   // Protegido por sync_thread_mutex.
+
+// Indexação em segundo plano dos documentos de BULK_ADD (ver index_main). Os campos seguintes
+// são protegidos por index_queue_mutex.
+pthread_mutex_t index_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t index_queue_cond = PTHREAD_COND_INITIALIZER;
+int* index_queue = NULL;    // IDs por indexar, por ordem de chegada.
+int index_queue_head = 0;   // Posição do próximo ID a indexar.
+int index_queue_count = 0;  // IDs em index_queue (incluindo os anteriores a index_queue_head).
+int index_queue_capacity = 0;
+int index_queue_busy = 0;   // IDs retirados pela thread e ainda não juntos ao índice.
+int index_thread_stop = 0;
+
+volatile sig_atomic_t stop_requested = 0; // Posto a 1 por SIGINT/SIGTERM (ver handle_signals).
 
 // Protótipos das funções.
-int add_document(Document* doc);
-Document* find_document(int id);
+int add_document(Document* doc, const InvertedIndex* doc_terms);
+void bulk_add_documents(const Request* req, Response* resp);
+void multi_query_documents(const Request* req, Response* resp);
+void multi_count_lines(const Request* req, Response* resp);
+void count_lines_multi(const char* doc_path, const char* const* keywords, int num, long* counts);
+int count_lines_with_multi_matcher(const char* doc_path, const MultiMatcher* mm, int stop_at_first, long* counts);
+void multi_search_documents(const Request* req, Response* resp);
+void search_query_documents(const Request* req, Response* resp);
+void ranked_search_documents(const Request* req, Response* resp);
+void meta_search_documents(const Request* req, Response* resp);
+int find_document(int id, Document* out);
 int remove_document(int id);
+int database_fd();
+void close_database_fd();
+int read_slot_document(const DocSlot* slot, Document* out);
+void cache_remove(DocSlot* slot);
+int cache_insert(DocSlot* slot, const Document* doc);
+int compact_store();
+void maybe_compact_store();
+long count_lines_with_matcher(const char* doc_path, const Matcher* matcher, const char* keyword, int stop_at_first);
 int count_lines_with_keyword(Document* doc, const char* keyword);
-int search_documents_with_keyword_parallel(char* keyword, int* result_ids, int nr_processes);
-int search_documents_with_keyword_serial(char* keyword, int* result_ids);
+int search_documents(const char* keyword, int** result_ids, int nr_processes);
+int search_documents_parallel(const SearchTask* tasks, int num_tasks, const char* keyword, int* result_ids, int nr_processes);
+int search_documents_serial(const SearchTask* tasks, int num_tasks, const char* keyword, int* result_ids);
+int resolve_search_tasks_with_index(const char* keyword, SearchTask* tasks, int num_tasks);
 void save_documents();
-void load_documents();
+void persist_state();
+void report_cache_stats();
+void collect_server_stats(ServerStats* stats);
+void* sync_main(void* arg);
+void* index_main(void* arg);
+void replay_log();
+int load_documents();
+void migrate_store();
+void load_search_index();
 void handle_signals(int sig);
-void process_search_tasks_child(const SearchTask* tasks_chunk, int num_tasks_in_chunk, const char* keyword, const char* temp_file_path);
+int collect_search_tasks(SearchTask* tasks, int max_tasks);
+int search_task_matches(const SearchTask* task, const Matcher* matcher, const char* keyword);
+int search_tasks_serial(const SearchTask* tasks, int num_tasks, const Matcher* matcher, const char* keyword, int* result_ids);
 Response process_request(Request req);
+void* worker_main(void* arg);
 
 /**
- * @brief Adiciona um documento à cache e, se a cache estiver cheia, remove o mais antigo (FCFS).
+ * @brief Devolve um descritor (aberto uma única vez) para a fotografia "database.bin".
  *
- * Aloca memória para o novo documento, copia os dados, atribui um ID único
- * e atualiza o estado da cache.
+ * Evita abrir e fechar o ficheiro em cada leitura: uma consulta ao disco passa a ser um
+ * único `pread` no offset guardado na tabela de documentos.
  *
- * @param doc Ponteiro para a estrutura Document com os dados do documento a adicionar.
- * @return O ID atribuído ao documento adicionado, ou -1 em caso de erro de alocação.
+ * @return O descritor aberto em leitura, ou -1 se o ficheiro não existir.
  */
-int add_document(Document* doc) {
-    // Verifica se a cache está cheia.
-    if (cache.num_docs >= cache.max_size) {
-        // Política FCFS: remove o documento mais antigo (índice 0).
-        char msg[256];
-        int len = snprintf(msg, sizeof(msg),
-                        "Cache cheia: a aplicar política FCFS para remover documento ID: %d, Título: '%s' para incluir novo documento Título: '%s'\n",
-                        cache.docs[0]->id,
-                        cache.docs[0]->title,
-                        doc->title);
-        write(STDOUT_FILENO, msg, len);
+int database_fd() {
+    if (db_fd < 0) {
+        db_fd = open("database.bin", O_RDONLY);
+    }
+    return db_fd;
+}
+
+/**
+ * @brief Lê do disco (fotografia ou log) o documento no offset indicado.
+ *
+ * @param offset Offset do documento.
+ * @param in_log 1 se o offset se refere ao log, 0 se à fotografia.
+ * @param id ID esperado (validação do registo lido).
+ * @param out Estrutura onde o documento é copiado.
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int read_disk_document(off_t offset, int in_log, int id, Document* out) {
+    if (offset < 0) return -1; // Documento removido (não abre a fotografia).
+    int fd = in_log ? doc_log.fd : database_fd();
+    if (fd < 0) return -1;
+    if (in_log || db_version == DB_VERSION_LEGACY) { // Registos de tamanho fixo.
+        return (pread(fd, out, sizeof(Document), offset) == sizeof(Document) && out->id == id) ? 0 : -1;
+    }
+    unsigned char record[DOC_RECORD_MAX];
+    ssize_t n = pread(fd, record, sizeof(record), offset);
+    if (n <= 0 || doc_record_decode(record, n, &db_authors, out) < 0 || out->id != id) {
+        return -1;
+    }
+    return 0;
+}
 
-        free(cache.docs[0]); // Liberta a memória do documento removido.
+/**
+ * @brief Copia o documento de uma posição da tabela, da cache ou do disco (sem o pôr em cache).
+ *
+ * @param slot Posição do documento (deve existir: na cache ou no disco).
+ * @param out Estrutura onde o documento é copiado.
+ * @return 0 em caso de sucesso, -1 se o documento não existir ou não puder ser lido.
+ */
+int read_slot_document(const DocSlot* slot, Document* out) {
+    if (slot->cached) {
+        memcpy(out, slot->cached, sizeof(Document));
+        return 0;
+    }
+    return read_disk_document(slot->disk_offset, slot->in_log, (int)(slot - doc_table.slots), out);
+}
 
-        // Desloca os restantes documentos para a esquerda.
-        for (int i = 0; i < cache.num_docs - 1; i++) {
-            cache.docs[i] = cache.docs[i + 1];
-        }
-        cache.num_docs--;
+/**
+ * @brief Retira da cache (e liberta) o documento de uma posição da tabela, se lá estiver.
+ */
+void cache_remove(DocSlot* slot) {
+    if (!slot->cached) return;
+    doc_cache_remove(&cache, slot->cached);
+    slot->cached = NULL;
+}
+
+/**
+ * @brief Coloca na cache o documento de uma posição da tabela (que ainda não esteja em cache).
+ *
+ * Se a cache estiver cheia, a política escolhe o documento a retirar (que continua no disco).
+ *
+ * @param slot Posição do documento.
+ * @param doc O documento.
+ * @return O ID do documento retirado da cache, ou -1 se nenhum saiu.
+ */
+int cache_insert(DocSlot* slot, const Document* doc) {
+    int evicted_id;
+    slot->cached = doc_cache_insert(&cache, doc, &evicted_id);
+    if (evicted_id >= 0) {
+        doc_table_slot(&doc_table, evicted_id)->cached = NULL; // Continua no disco.
     }
+    return evicted_id;
+}
 
-    // Aloca memória para o novo documento.
-    Document* new_doc = malloc(sizeof(Document));
-    if (!new_doc) {
-        perror("Erro ao alocar memória para novo documento");
-        return -1; // Falha na alocação.
+/**
+ * @brief Fecha o descritor de "database.bin" (ex: antes de o ficheiro ser reescrito).
+ */
+void close_database_fd() {
+    if (db_fd >= 0) {
+        close(db_fd);
+        db_fd = -1;
     }
+}
 
-    memcpy(new_doc, doc, sizeof(Document)); // Copia os dados do documento.
-    new_doc->id = next_id++; // Atribui um ID único e incrementa o contador global.
-    cache.docs[cache.num_docs++] = new_doc; // Adiciona o novo documento à cache.
-    cache.modified = 1; // Marca a cache como modificada.
+/**
+ * @brief Desativa os índices de metadados (incompletos) até à próxima compactação, que os reconstrói.
+ */
+static void disable_meta_index() {
+    write(STDERR_FILENO, "Aviso: falha ao atualizar os índices de metadados. Desativados até à próxima compactação.\n",
+        strlen("Aviso: falha ao atualizar os índices de metadados. Desativados até à próxima compactação.\n"));
+    meta_enabled = 0;
+}
 
-    return new_doc->id; // Retorna o ID do documento adicionado.
+/**
+ * @brief Desativa o índice invertido (incompleto): as pesquisas passam a ler os ficheiros até ao
+ * próximo arranque, que reconcilia o índice com a base de dados.
+ */
+static void disable_search_index() {
+    write(STDERR_FILENO, "Aviso: falha ao indexar documento. Índice desativado até ao próximo arranque.\n",
+        strlen("Aviso: falha ao indexar documento. Índice desativado até ao próximo arranque.\n"));
+    index_enabled = 0;
 }
 
 /**
- * @brief Procura um documento pelo seu ID, primeiro na cache e depois no ficheiro de persistência.
+ * @brief Adiciona um documento: regista-o no log e coloca-o na cache (a política escolhe quem sai se estiver cheia).
  *
- * Se encontrado no disco e não na cache (e houver espaço), adiciona-o à cache.
+ * O registo UPSERT é escrito no log antes de qualquer alteração em memória, por isso um
+ * documento adicionado nunca se perde por sair da cache. Atribui um ID único e atualiza a
+ * cache, a tabela de documentos e os índices.
  *
- * @param id O ID do documento a procurar.
- * @return Ponteiro para o Documento encontrado (na cache ou uma cópia temporária do disco),
- * ou NULL se não for encontrado.
+ * @param doc Ponteiro para a estrutura Document com os dados do documento a adicionar.
+ * @param doc_terms Índice privado só com o conteúdo do documento, sob o ID 0 (construído antes,
+ * sem o lock), ou NULL se não foi possível lê-lo.
+ * @return O ID atribuído ao documento adicionado, ou -1 em caso de erro (alocação ou escrita no log).
  */
-Document* find_document(int id) {
-    // Procura na cache.
-    for (int i = 0; i < cache.num_docs; i++) {
-        if (cache.docs[i]->id == id) {
-            return cache.docs[i]; // Encontrado na cache.
-        }
+int add_document(Document* doc, const InvertedIndex* doc_terms) {
+    // Reserva a posição do novo ID na tabela antes de alterar a cache.
+    DocSlot* slot = doc_table_slot_create(&doc_table, next_id);
+    if (!slot) {
+        perror("Erro ao alocar memória para a tabela de documentos");
+        return -1;
     }
 
-    // Procura no ficheiro de persistência "database.bin".
-    int fd = open("database.bin", O_RDONLY);
-    if (fd < 0) {
-        return NULL; // Ficheiro não existe ou erro ao abrir.
+    // Regista a inserção no log (O(1): um único registo acrescentado ao fim do ficheiro).
+    Document new_entry;
+    memcpy(&new_entry, doc, sizeof(Document));
+    new_entry.id = next_id;
+    off_t log_offset = doc_log_append(&doc_log, LOG_UPSERT, &new_entry, next_id + 1);
+    if (log_offset < 0) {
+        perror("Erro ao escrever no log da base de dados");
+        return -1;
     }
+    next_id++; // O ID fica atribuído a partir do momento em que está no log.
+    slot->disk_offset = log_offset;
+    slot->in_log = 1;
+    doc_table_set_path(slot, new_entry.path);
+    num_documents++;
+    store_modified = 1;
 
-    // Salta o cabeçalho do ficheiro (next_id e num_docs).
-    lseek(fd, 2 * sizeof(int), SEEK_SET);
+    // Coloca o novo documento na cache (O(1), mesmo com a cache cheia).
+    int evicted_id = cache_insert(slot, &new_entry);
+    if (evicted_id >= 0) {
+        char msg[320];
+        int len = snprintf(msg, sizeof(msg),
+                        "Cache cheia: a política %s retirou o documento ID: %d para incluir novo documento Título: '%.200s'\n",
+                        doc_cache_policy_name(cache.policy), evicted_id, doc->title);
+        write(STDOUT_FILENO, msg, len);
+    }
 
-    Document disk_doc;
-    // Lê documentos do ficheiro.
-    while (read(fd, &disk_doc, sizeof(Document)) == sizeof(Document)) {
-        if (disk_doc.id == id) {
-            close(fd);
-            // Documento encontrado no disco.
-            if (cache.num_docs < cache.max_size) {
-                // Adiciona à cache se houver espaço.
-                Document* doc_to_cache = malloc(sizeof(Document));
-                if (!doc_to_cache) { // Verifica falha na alocação
-                    perror("Erro ao alocar memória para colocar documento do disco na cache");
-                    // Retorna uma cópia temporária se a alocação para cache falhar, para não perder o documento encontrado
-                    // O chamador DEVE libertar esta memória.
-                    Document* temp_doc = malloc(sizeof(Document));
-                    if(!temp_doc) return NULL; // Não conseguiu alocar nem para a cópia temporária
-                    memcpy(temp_doc, &disk_doc, sizeof(Document));
-                    return temp_doc;
-                }
-                memcpy(doc_to_cache, &disk_doc, sizeof(Document));
-                cache.docs[cache.num_docs++] = doc_to_cache;
-                return doc_to_cache; // Retorna o documento agora na cache.
-            } else {
-                // Cache cheia, retorna uma cópia temporária.
-                // O chamador DEVE libertar esta memória.
-                Document* temp_doc = malloc(sizeof(Document));
-                if (!temp_doc) {
-                    perror("Erro ao alocar memória para cópia temporária do documento do disco");
-                    return NULL;
-                }
-                memcpy(temp_doc, &disk_doc, sizeof(Document));
-                return temp_doc;
-            }
-        }
+    // Junta ao índice os termos do novo documento para que as pesquisas o encontrem sem ler o
+    // ficheiro (um índice incompleto daria resultados errados).
+    if (index_enabled && (!doc_terms || index_merge(&search_index, doc_terms, new_entry.id) != 0)) {
+        disable_search_index();
     }
+    if (meta_enabled && meta_index_add(&meta_index, &new_entry) != 0) disable_meta_index();
 
-    close(fd);
-    return NULL; // Documento não encontrado.
+    return new_entry.id; // Retorna o ID do documento adicionado.
 }
 
 /**
- * @brief Remove um documento da cache e do ficheiro de persistência "database.bin".
- *
- * Após a remoção do ficheiro, a cache é limpa e recarregada para manter a consistência.
+ * @brief Trata um pedido ADD_DOC.
  *
- * @param id O ID do documento a remover.
- * @return 0 em caso de sucesso, -1 se o documento não for encontrado ou ocorrer um erro.
+ * Verifica e indexa o ficheiro sem o store_lock, num índice privado, e só adquire o lock em
+ * escrita para atribuir o ID e juntar esse índice ao do servidor: um ficheiro grande não faz
+ * esperar os pedidos que chegam entretanto.
  */
-int remove_document(int id) {
-    int document_found_in_cache = 0;
-
-    // Remove da cache.
-    for (int i = 0; i < cache.num_docs; i++) {
-        if (cache.docs[i]->id == id) {
-            free(cache.docs[i]);
-            for (int j = i; j < cache.num_docs - 1; j++) {
-                cache.docs[j] = cache.docs[j + 1];
-            }
-            cache.num_docs--;
-            cache.modified = 1;
-            document_found_in_cache = 1;
-            break;
-        }
+static void add_document_request(Request* req, Response* resp) {
+    char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, req->doc.path) >= (int)sizeof(full_path)) {
+        write(STDERR_FILENO, "Erro: Caminho completo do ficheiro excede o buffer.\n", strlen("Erro: Caminho completo do ficheiro excede o buffer.\n"));
+        resp->status = -4; // Caminho muito longo.
+        return;
     }
-
-    // Remove do ficheiro "database.bin".
-    int fd = open("database.bin", O_RDWR);
-    if (fd < 0) {
-        // Se removeu da cache mas não conseguiu abrir o disco, consideramos sucesso parcial.
-        // A persistência tentará corrigir isto mais tarde ou na próxima carga.
-        return document_found_in_cache ? 0 : -1;
+    if (access(full_path, R_OK) != 0) { // Verifica se o ficheiro existe e é legível.
+        char log_msg[512];
+        snprintf(log_msg, sizeof(log_msg), "Erro ADD_DOC: Ficheiro '%s' não encontrado ou sem permissão (errno: %d %s).\n", full_path, errno, strerror(errno));
+        write(STDERR_FILENO, log_msg, strlen(log_msg));
+        resp->status = -3; // Ficheiro inválido/inacessível.
+        return;
     }
 
-    int next_id_disk, num_docs_disk;
-    if (read(fd, &next_id_disk, sizeof(int)) != sizeof(int) ||
-        read(fd, &num_docs_disk, sizeof(int)) != sizeof(int)) {
-        close(fd);
-        return document_found_in_cache ? 0 : -1; // Erro ao ler cabeçalho.
+    // O ID só é atribuído sob o lock: o documento é indexado sob o ID 0 e add_document desloca-o.
+    InvertedIndex doc_terms;
+    int indexed = index_init(&doc_terms) == 0 && index_add_file(&doc_terms, 0, full_path) == 0;
+
+    pthread_rwlock_wrlock(&store_lock);
+    int added_id = add_document(&req->doc, indexed ? &doc_terms : NULL);
+    if (added_id >= 0) {
+        resp->doc.id = added_id;
+        resp->status = 0; // Sucesso.
+        maybe_compact_store();
+    } else {
+        resp->status = -5; // Falha interna ao adicionar (ex: malloc).
     }
+    pthread_rwlock_unlock(&store_lock);
+    index_free(&doc_terms);
+}
 
-    Document docs_on_disk[MAX_DOCS]; // Buffer para documentos válidos.
-    int valid_docs_count = 0;
-    int found_on_disk = 0;
+/**
+ * @brief Origem do lote de um pedido: o FIFO de lote do cliente ou a sua ligação ao socket.
+ *
+ * Com o socket, o lote chega em mensagens de até BATCH_MESSAGE_SIZE bytes que podem cortar um
+ * elemento a meio: o que sobra de uma mensagem fica em `msg` para a leitura seguinte.
+ */
+typedef struct {
+    int fd;                     // FIFO de lote, ou a cópia da ligação do pedido (fechada por worker_main).
+    int from_socket;            // 1 se o lote vem pela ligação ao socket.
+    int failed;                 // Socket: mensagem inválida recebida (a ligação deixa de estar sincronizada).
+    size_t left;                // Socket: bytes do lote ainda por receber.
+    size_t pos;                 // Socket: bytes de `msg` já entregues.
+    size_t len;                 // Socket: bytes em `msg`.
+    char msg[BATCH_MESSAGE_SIZE];
+} BatchInput;
 
-    // Lê todos os documentos do disco.
-    for (int i = 0; i < num_docs_disk; i++) {
-        Document d;
-        if (read(fd, &d, sizeof(Document)) != sizeof(Document)) break; // Erro ou fim de ficheiro.
-        if (d.id != id) {
-            if (valid_docs_count < MAX_DOCS) { // Previne overflow do buffer
-                docs_on_disk[valid_docs_count++] = d;
-            }
-        } else {
-            found_on_disk = 1;
-        }
+/**
+ * @brief Prepara a leitura do lote de um pedido de elementos de `item_size` bytes.
+ *
+ * Com FIFOs, abre (para leitura, sem bloquear) o FIFO de lote do cliente (ver BATCH_PIPE_FORMAT):
+ * se o cliente já terminou, a leitura esgota o prazo em vez de esperar para sempre. Com o socket,
+ * usa a ligação de onde veio o pedido (`req->batch_fd`).
+ *
+ * @return 0 em caso de sucesso, ou -1 em caso de erro (já reportado).
+ */
+static int open_batch_input(const Request* req, size_t item_size, BatchInput* in) {
+    in->failed = 0;
+    in->pos = 0;
+    in->len = 0;
+    if (req->batch_fd >= 0) {
+        in->fd = req->batch_fd;
+        in->from_socket = 1;
+        in->left = (req->batch_size > 0) ? (size_t)req->batch_size * item_size : 0;
+        return 0;
     }
+    char batch_pipe[128];
+    snprintf(batch_pipe, sizeof(batch_pipe), BATCH_PIPE_FORMAT, req->client_pid);
+    in->fd = open(batch_pipe, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    in->from_socket = 0;
+    in->left = 0;
+    if (in->fd < 0) perror("Erro ao abrir o lote do cliente");
+    return (in->fd < 0) ? -1 : 0;
+}
 
-    // Se o documento foi encontrado no disco, reescreve o ficheiro.
-    if (found_on_disk) {
-        lseek(fd, 0, SEEK_SET); // Volta ao início do ficheiro.
-        write(fd, &next_id_disk, sizeof(int));
-        write(fd, &valid_docs_count, sizeof(int)); // Novo número de documentos.
-        for (int i = 0; i < valid_docs_count; i++) {
-            write(fd, &docs_on_disk[i], sizeof(Document));
-        }
-        // Trunca o ficheiro para o novo tamanho.
-        ftruncate(fd, 2 * sizeof(int) + valid_docs_count * sizeof(Document));
-        cache.modified = 1; // Marca como modificado pois o disco mudou.
+/**
+ * @brief Termina a leitura do lote.
+ *
+ * Fecha o FIFO de lote. Com o socket, se o lote não foi lido até ao fim, o resto seria lido
+ * como pedidos: fecha o lado da leitura da ligação, que termina depois da resposta (e um
+ * cliente ainda a enviar o lote recebe EPIPE em vez de ficar bloqueado).
+ */
+static void close_batch_input(BatchInput* in) {
+    if (!in->from_socket) {
+        close(in->fd);
+        return;
     }
-    close(fd);
+    if (in->left > 0 || in->pos < in->len || in->failed) shutdown(in->fd, SHUT_RD);
+}
 
-    if (document_found_in_cache || found_on_disk) {
-        // Recarrega a cache para consistência se algo foi alterado.
-        // Primeiro, limpa a cache atual.
-        for (int i = 0; i < cache.num_docs; i++) {
-            free(cache.docs[i]);
-            cache.docs[i] = NULL;
+/**
+ * @brief Lê até `size` bytes do lote, esperando no máximo reply_timeout_ms por dados.
+ *
+ * @return O número de bytes lidos, ou 0 no fim do lote (o cliente fechou o FIFO, deixou de
+ * enviar ou enviou uma mensagem inválida).
+ */
+static size_t read_batch_bytes(BatchInput* in, char* buf, size_t size) {
+    while (!in->from_socket || in->pos == in->len) {
+        if (in->from_socket && (in->left == 0 || in->failed)) return 0;
+        struct pollfd pfd = { .fd = in->fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, reply_timeout_ms);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return 0; // Prazo esgotado (ou erro).
+        if (!in->from_socket) {
+            ssize_t n = read(in->fd, buf, size);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+            return (n > 0) ? (size_t)n : 0;
+        }
+        // MSG_TRUNC: devolve o tamanho real da mensagem, para detetar uma maior do que `msg`.
+        ssize_t n = recv(in->fd, in->msg, sizeof(in->msg), MSG_TRUNC);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0 || (size_t)n > sizeof(in->msg) || (size_t)n > in->left) {
+            in->failed = 1;
+            return 0;
         }
-        cache.num_docs = 0;
-        // A flag 'modified' será tratada pela load_documents ou pela próxima save.
-        load_documents(); // Recarrega do disco.
-        return 0; // Sucesso.
+        in->pos = 0;
+        in->len = n;
+        in->left -= n;
     }
-
-    return -1; // Documento não encontrado em lado nenhum.
+    size_t n = (in->len - in->pos < size) ? in->len - in->pos : size;
+    memcpy(buf, in->msg + in->pos, n);
+    in->pos += n;
+    return n;
 }
 
 /**
- * @brief Conta o número de linhas num ficheiro de documento que contêm uma determinada palavra-chave.
+ * @brief Lê até `max_items` elementos de `item_size` bytes do lote (pode receber menos numa leitura).
  *
- * Utiliza os comandos 'grep' e 'wc -l' através de pipes e processos filho.
+ * Cada leitura espera no máximo reply_timeout_ms por dados, para que um cliente que deixa de
+ * enviar o lote não prenda a trabalhadora.
  *
- * @param doc Ponteiro para o Documento cujo ficheiro será analisado.
- * @param keyword A palavra-chave a procurar.
- * @return O número de linhas encontradas, ou -1 em caso de erro.
+ * @return O número de elementos completos lidos (menos do que `max_items` se o cliente fechou
+ * o FIFO antes do fim ou deixou de enviar).
  */
-int count_lines_with_keyword(Document* doc, const char* keyword) {
-    if (!doc || !keyword) return -1;
-
-    char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2]; // +2 para '/' e '\0'.
-    snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, doc->path);
-
-    int pipe_grep_wc[2];
-    int pipe_wc_parent[2];
-    pid_t pid_grep, pid_wc;
-    int line_count = -1;
-
-    if (pipe(pipe_grep_wc) < 0 || pipe(pipe_wc_parent) < 0) {
-        perror("Erro ao criar pipes para contagem de linhas");
-        if (pipe_grep_wc[0] >= 0) { close(pipe_grep_wc[0]); close(pipe_grep_wc[1]); }
-        if (pipe_wc_parent[0] >= 0) { close(pipe_wc_parent[0]); close(pipe_wc_parent[1]); }
-        return -1;
+static int read_batch_items(BatchInput* in, void* items, size_t item_size, int max_items) {
+    size_t want = (size_t)max_items * item_size;
+    size_t done = 0;
+    while (done < want) {
+        size_t n = read_batch_bytes(in, (char*)items + done, want - done);
+        if (n == 0) break;
+        done += n;
     }
+    return (int)(done / item_size);
+}
 
-    // Fork para 'grep'.
-    pid_grep = fork();
-    if (pid_grep == 0) { // Processo filho (grep).
-        close(pipe_grep_wc[0]); // Fecha leitura do pipe grep->wc.
-        dup2(pipe_grep_wc[1], STDOUT_FILENO); // Redireciona stdout para escrita no pipe grep->wc.
-        close(pipe_grep_wc[1]); // Fecha escrita do pipe grep->wc.
+/**
+ * @brief Verifica um documento de um lote: o ficheiro tem de existir e ser legível.
+ *
+ * @return 0 se o documento pode ser adicionado, ou o código de erro de ADD_DOC (-3 ou -4).
+ */
+static int validate_batch_document(Document* doc) {
+    // Os dados vêm de outro processo: garante que as strings terminam.
+    doc->title[MAX_TITLE_SIZE - 1] = '\0';
+    doc->authors[MAX_AUTHORS_SIZE - 1] = '\0';
+    doc->year[MAX_YEAR_SIZE - 1] = '\0';
+    doc->path[MAX_PATH_SIZE - 1] = '\0';
 
-        close(pipe_wc_parent[0]); // Fecha extremidades não usadas do pipe wc->parent.
-        close(pipe_wc_parent[1]);
+    char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, doc->path) >= (int)sizeof(full_path)) return -4;
+    if (access(full_path, R_OK) != 0) return -3;
+    return 0;
+}
 
-        execlp("grep", "grep", keyword, full_path, (char*)NULL);
-        perror("Erro ao executar grep");
-        _exit(1); // Termina com erro se execlp falhar.
-    } else if (pid_grep < 0) {
-        perror("Erro no fork para grep");
-        close(pipe_grep_wc[0]); close(pipe_grep_wc[1]);
-        close(pipe_wc_parent[0]); close(pipe_wc_parent[1]);
-        return -1;
+/**
+ * @brief Acrescenta documentos à fila da indexação em segundo plano (ver index_main).
+ *
+ * Se faltar memória, os documentos ficam fora do índice até ao próximo arranque (as pesquisas
+ * leem os seus ficheiros).
+ */
+static void enqueue_for_indexing(const Document* docs, int n) {
+    pthread_mutex_lock(&index_queue_mutex);
+    if (index_queue_head > 0) { // Descarta os IDs já retirados.
+        memmove(index_queue, index_queue + index_queue_head, (index_queue_count - index_queue_head) * sizeof(int));
+        index_queue_count -= index_queue_head;
+        index_queue_head = 0;
     }
-
-    // Fork para 'wc'.
-    pid_wc = fork();
-    if (pid_wc == 0) { // Processo filho (wc).
-        close(pipe_grep_wc[1]); // Fecha escrita do pipe grep->wc.
-        dup2(pipe_grep_wc[0], STDIN_FILENO); // Redireciona stdin para leitura do pipe grep->wc.
-        close(pipe_grep_wc[0]); // Fecha leitura do pipe grep->wc.
-
-        close(pipe_wc_parent[0]); // Fecha leitura do pipe wc->parent.
-        dup2(pipe_wc_parent[1], STDOUT_FILENO); // Redireciona stdout para escrita no pipe wc->parent.
-        close(pipe_wc_parent[1]);
-
-        execlp("wc", "wc", "-l", (char*)NULL);
-        perror("Erro ao executar wc");
-        _exit(1); // Termina com erro se execlp falhar.
-    } else if (pid_wc < 0) {
-        perror("Erro no fork para wc");
-        close(pipe_grep_wc[0]); close(pipe_grep_wc[1]);
-        close(pipe_wc_parent[0]); close(pipe_wc_parent[1]);
-        waitpid(pid_grep, NULL, 0); // Limpa processo grep.
-        return -1;
+    if (index_queue_count + n > index_queue_capacity) {
+        int new_capacity = index_queue_capacity ? index_queue_capacity : BULK_CHUNK_DOCS;
+        while (new_capacity < index_queue_count + n) new_capacity *= 2;
+        int* bigger = realloc(index_queue, new_capacity * sizeof(int));
+        if (!bigger) {
+            pthread_mutex_unlock(&index_queue_mutex);
+            write(STDERR_FILENO, "Aviso: sem memória para a fila de indexação. Os documentos do lote ficam fora do índice.\n",
+                strlen("Aviso: sem memória para a fila de indexação. Os documentos do lote ficam fora do índice.\n"));
+            return;
+        }
+        index_queue = bigger;
+        index_queue_capacity = new_capacity;
     }
-
-    // Processo pai.
-    close(pipe_grep_wc[0]); // Fecha ambas as extremidades do pipe grep->wc.
-    close(pipe_grep_wc[1]);
-    close(pipe_wc_parent[1]); // Fecha escrita do pipe wc->parent.
-
-    char buffer[32];
-    ssize_t bytes_read = read(pipe_wc_parent[0], buffer, sizeof(buffer) - 1);
-    if (bytes_read > 0) {
-        buffer[bytes_read] = '\0';
-        line_count = atoi(buffer);
-    } else if (bytes_read == 0) { // EOF, pode significar 0 linhas.
-        line_count = 0;
-    } else {
-        perror("Erro ao ler do pipe wc->parent");
-        line_count = -1; // Erro na leitura.
+    for (int i = 0; i < n; i++) {
+        index_queue[index_queue_count++] = docs[i].id;
     }
+    pthread_cond_signal(&index_queue_cond);
+    pthread_mutex_unlock(&index_queue_mutex);
+}
 
-    close(pipe_wc_parent[0]); // Fecha leitura do pipe wc->parent.
-
-    // Espera pelos processos filho.
-    waitpid(pid_grep, NULL, 0);
-    waitpid(pid_wc, NULL, 0);
-
-    return line_count;
+/**
+ * @brief Devolve o número de documentos de BULK_ADD que ainda não estão no índice.
+ */
+static int index_pending_count() {
+    pthread_mutex_lock(&index_queue_mutex);
+    int pending = index_queue_count - index_queue_head + index_queue_busy;
+    pthread_mutex_unlock(&index_queue_mutex);
+    return pending;
 }
 
 /**
- * @brief Procura documentos que contêm uma palavra-chave, de forma sequencial.
+ * @brief Adiciona um lote de documentos recebido depois do pedido (BULK_ADD).
  *
- * Itera sobre os documentos na cache e depois no ficheiro de persistência,
- * utilizando 'grep -q' para verificar a presença da palavra-chave.
+ * Os IDs de todo o lote são reservados de uma vez, por isso o documento na posição i recebe
+ * sempre o ID primeiro + i - 1 (os IDs dos rejeitados ficam por usar). Os documentos são lidos
+ * e verificados em blocos de BULK_CHUNK_DOCS sem o store_lock; cada bloco válido é acrescentado
+ * ao log com uma só escrita e aplicado em memória com o lock em modo escrita (as consultas
+ * correm entre blocos). Há um único fdatasync no fim do lote. Os documentos não passam pela
+ * cache (um lote grande só a esvaziaria): são lidos do log quando forem consultados. Também
+ * não são indexados aqui: ficam na fila da indexação em segundo plano (ver index_main).
  *
- * @param keyword A palavra-chave a procurar.
- * @param result_ids Array de inteiros onde os IDs dos documentos encontrados serão armazenados.
- * @return O número de IDs de documentos encontrados e adicionados a result_ids.
+ * Gere o store_lock sozinha.
+ *
+ * @param req O pedido (origem do lote e número de documentos).
+ * @param resp Recebe o estado e o relatório (ver BULK_ADD em Document_Struct.h).
  */
-int search_documents_with_keyword_serial(char* keyword, int* result_ids) {
-    int count = 0;
-
-    // Procura na cache.
-    for (int i = 0; i < cache.num_docs && count < MAX_RESULT_IDS; i++) {
-        if (count_lines_with_keyword(cache.docs[i], keyword) > 0) {
-            result_ids[count++] = cache.docs[i]->id;
-        }
+void bulk_add_documents(const Request* req, Response* resp) {
+    // O lote é aberto antes de qualquer verificação: com FIFOs, o cliente está bloqueado a abri-lo para escrita.
+    BatchInput in;
+    if (open_batch_input(req, sizeof(Document), &in) != 0) {
+        resp->status = -5;
+        return;
     }
-
-    // Procura no ficheiro "database.bin" (documentos não presentes na cache).
-    int fd = open("database.bin", O_RDONLY);
-    if (fd < 0) {
-        return count; // Retorna o que foi encontrado na cache se o disco não puder ser lido.
+    int n = req->batch_size;
+    if (n <= 0 || n > BULK_MAX_DOCS) {
+        close_batch_input(&in);
+        resp->status = -2;
+        return;
     }
 
-    int next_id_disk, num_docs_disk;
-    read(fd, &next_id_disk, sizeof(int));
-    read(fd, &num_docs_disk, sizeof(int));
-
-    Document disk_doc;
-    while (read(fd, &disk_doc, sizeof(Document)) == sizeof(Document) && count < MAX_RESULT_IDS) {
-        int in_cache = 0;
-        // Verifica se o documento do disco já foi processado (estava na cache).
-        for (int i = 0; i < count; i++) { // Compara com os já adicionados a result_ids (vindos da cache).
-            if (result_ids[i] == disk_doc.id) {
-                in_cache = 1;
-                break;
-            }
-        }
-        // Adicionalmente, verifica explicitamente contra a cache atual,
-        // pois `count_lines_with_keyword` acima já adicionou os da cache.
-        // Esta segunda verificação é para o caso de o ID estar na cache mas não ter a keyword.
-        if (!in_cache) {
-            for (int i = 0; i < cache.num_docs; i++) {
-                if (cache.docs[i]->id == disk_doc.id) {
-                    in_cache = 1;
-                    break;
-                }
-            }
-        }
+    // Relatório: primeiro ID, número de adicionados e um par (posição, erro) por rejeitado.
+    int* report = malloc((2 + 2 * (size_t)n) * sizeof(int));
+    Document* chunk = malloc(BULK_CHUNK_DOCS * sizeof(Document));
+    off_t* offsets = malloc(BULK_CHUNK_DOCS * sizeof(off_t));
+    int* positions = malloc(BULK_CHUNK_DOCS * sizeof(int));
+    if (!report || !chunk || !offsets || !positions) {
+        perror("Erro ao alocar memória para o lote");
+        close_batch_input(&in);
+        free(report);
+        free(chunk);
+        free(offsets);
+        free(positions);
+        resp->status = -5;
+        return;
+    }
 
+    pthread_rwlock_wrlock(&store_lock);
+    int first_id = next_id;
+    int ids_left = (n <= INT_MAX - next_id); // O lote não pode fazer next_id ultrapassar INT_MAX.
+    if (ids_left) next_id += n;
+    pthread_rwlock_unlock(&store_lock);
+    if (!ids_left) {
+        close_batch_input(&in);
+        free(report);
+        free(chunk);
+        free(offsets);
+        free(positions);
+        resp->status = -2;
+        return;
+    }
 
-        if (!in_cache) {
-            char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
-            snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, disk_doc.path);
+    int added = 0;
+    int num_report = 2;
+    for (int done = 0; done < n; ) {
+        int want = (n - done < BULK_CHUNK_DOCS) ? n - done : BULK_CHUNK_DOCS;
+        int got = read_batch_items(&in, chunk, sizeof(Document), want);
 
-            // Usa grep -q para verificar a existência da keyword.
-            int pipefd[2];
-            if (pipe(pipefd) == -1) {
-                perror("Erro ao criar pipe para grep -q na pesquisa sequencial");
+        int accepted = 0;
+        for (int i = 0; i < got; i++) {
+            int status = validate_batch_document(&chunk[i]);
+            if (status != 0) {
+                report[num_report++] = done + i + 1;
+                report[num_report++] = status;
                 continue;
             }
+            if (accepted != i) chunk[accepted] = chunk[i];
+            chunk[accepted].id = first_id + done + i;
+            positions[accepted] = done + i + 1;
+            accepted++;
+        }
 
-            pid_t pid = fork();
-            if (pid == 0) { // Filho.
-                close(pipefd[0]); // Não usado pelo filho.
-                // Não precisamos do output do grep, apenas do status de saída.
-                // Redirecionar stdout e stderr para /dev/null se quisermos silenciar o grep.
-                int dev_null_fd = open("/dev/null", O_WRONLY);
-                if (dev_null_fd != -1) {
-                    dup2(dev_null_fd, STDOUT_FILENO);
-                    dup2(dev_null_fd, STDERR_FILENO);
-                    close(dev_null_fd);
+        if (accepted > 0) {
+            pthread_rwlock_wrlock(&store_lock);
+            // Faz crescer a tabela uma só vez (para o maior ID do bloco) antes de guardar ponteiros.
+            int ok = (doc_table_slot_create(&doc_table, chunk[accepted - 1].id) != NULL) &&
+                     doc_log_append_batch(&doc_log, chunk, accepted, next_id, offsets) == 0;
+            if (ok) {
+                for (int i = 0; i < accepted; i++) {
+                    DocSlot* slot = doc_table_slot(&doc_table, chunk[i].id);
+                    slot->disk_offset = offsets[i];
+                    slot->in_log = 1;
+                    doc_table_set_path(slot, chunk[i].path);
+                    if (meta_enabled && meta_index_add(&meta_index, &chunk[i]) != 0) disable_meta_index();
                 }
-                execlp("grep", "grep", "-q", keyword, full_path, (char*)NULL);
-                _exit(127); // Se execlp falhar.
-            } else if (pid > 0) { // Pai.
-                close(pipefd[1]); // Não usado pelo pai.
-                close(pipefd[0]); // Não precisamos ler nada.
-
-                int status;
-                waitpid(pid, &status, 0);
-                if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-                    // Grep encontrou a keyword (status 0).
-                    result_ids[count++] = disk_doc.id;
+                num_documents += accepted;
+                store_modified = 1;
+                added += accepted;
+                // Outro pedido reservou IDs depois deste lote: pode já haver pesquisas guardadas
+                // que cobrem IDs acima deste bloco sem o terem lido (ver Result_Cache.h).
+                if (next_id > first_id + n) result_cache_add_documents(&result_cache, chunk[0].id);
+            }
+            int index_later = ok && index_enabled;
+            pthread_rwlock_unlock(&store_lock);
+            if (index_later) enqueue_for_indexing(chunk, accepted);
+            if (!ok) {
+                perror("Erro ao escrever o lote no log da base de dados");
+                for (int i = 0; i < accepted; i++) {
+                    report[num_report++] = positions[i];
+                    report[num_report++] = -5;
                 }
-            } else { // Erro no fork.
-                perror("Erro no fork para grep -q na pesquisa sequencial");
-                close(pipefd[0]);
-                close(pipefd[1]);
             }
         }
-    }
-    close(fd);
-    return count;
-}
-
-
-/**
- * @brief Função executada por cada processo filho na pesquisa paralela.
- *
- * Processa um subconjunto de tarefas de pesquisa (documentos), verifica a presença
- * da palavra-chave usando `count_lines_with_keyword` e escreve os IDs encontrados
- * num ficheiro temporário.
- *
- * @param tasks_chunk Ponteiro para o array de SearchTask (subconjunto de tarefas).
- * @param num_tasks_in_chunk Número de tarefas no subconjunto.
- * @param keyword A palavra-chave a procurar.
- * @param temp_file_path Caminho para o ficheiro temporário onde os resultados do filho serão escritos.
- */
-void process_search_tasks_child(const SearchTask* tasks_chunk, int num_tasks_in_chunk, const char* keyword, const char* temp_file_path) {
-    char child_debug_msg[256];
-    int len = snprintf(child_debug_msg, sizeof(child_debug_msg),
-                    "DEBUG: Filho PID %d iniciado para processar %d tarefas. Ficheiro temp: %s\n",
-                    getpid(), num_tasks_in_chunk, temp_file_path);
-    write(STDOUT_FILENO, child_debug_msg, len);
-
-    int found_ids[MAX_RESULT_IDS];
-    int child_count = 0;
 
-    for (int i = 0; i < num_tasks_in_chunk; i++) {
-        const SearchTask* current_task = &tasks_chunk[i];
-        Document temp_doc_for_count; // Documento temporário.
-
-        temp_doc_for_count.id = current_task->id;
-        strncpy(temp_doc_for_count.path, current_task->path, MAX_PATH_SIZE -1);
-        temp_doc_for_count.path[MAX_PATH_SIZE - 1] = '\0';
-
-        if (count_lines_with_keyword(&temp_doc_for_count, keyword) > 0) {
-            if (child_count < MAX_RESULT_IDS) {
-                found_ids[child_count++] = current_task->id;
-            } else {
-                // Limite de resultados do filho atingido.
-                break;
+        done += got;
+        if (got < want) { // O cliente fechou o FIFO antes de enviar o lote todo.
+            for (int pos = done + 1; pos <= n; pos++) {
+                report[num_report++] = pos;
+                report[num_report++] = -6;
             }
+            break;
         }
     }
+    close_batch_input(&in);
+    free(chunk);
+    free(offsets);
+    free(positions);
 
-    // Escreve os resultados no ficheiro temporário.
-    int temp_fd = open(temp_file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (temp_fd < 0) {
-        char error_msg[128];
-        snprintf(error_msg, sizeof(error_msg), "DEBUG: Filho PID %d ERRO ao abrir ficheiro temp %s: %s\n", getpid(), temp_file_path, strerror(errno));
-        write(STDERR_FILENO, error_msg, strlen(error_msg));
-        exit(1); // Termina com erro.
+    // Um único fdatasync para o lote inteiro (com -B 0, fica para a thread periódica).
+    resp->status = 0;
+    if (doc_log.sync_batch > 0 && doc_log_sync(&doc_log) != 0) {
+        perror("Erro ao sincronizar o log da base de dados");
+        resp->status = -5;
     }
+    pthread_rwlock_wrlock(&store_lock);
+    maybe_compact_store();
+    pthread_rwlock_unlock(&store_lock);
 
-    write(temp_fd, &child_count, sizeof(int)); // Escreve número de IDs.
-    if (child_count > 0) {
-        write(temp_fd, found_ids, child_count * sizeof(int)); // Escreve os IDs.
-    }
-    close(temp_fd);
+    report[0] = first_id;
+    report[1] = added;
+    resp->ids = report;
+    resp->num_ids = num_report;
 
-    len = snprintf(child_debug_msg, sizeof(child_debug_msg),
-                    "DEBUG: Filho PID %d terminou. Encontrou %d IDs. Escritos em %s\n",
-                    getpid(), child_count, temp_file_path);
-    write(STDOUT_FILENO, child_debug_msg, len);
-    exit(0); // Filho termina com sucesso.
+    char msg[160];
+    int len = snprintf(msg, sizeof(msg), "BULK_ADD do cliente %d: %d de %d documentos adicionados (IDs a partir de %d).\n",
+                       req->client_pid, added, n, first_id);
+    write(STDOUT_FILENO, msg, len);
 }
 
 /**
- * @brief Procura documentos que contêm uma palavra-chave, de forma paralela.
+ * @brief Procura um documento pelo seu ID, primeiro na cache e depois no ficheiro de persistência.
  *
- * Distribui a pesquisa por vários processos filho. Cada filho processa um subconjunto
- * de documentos (da cache e do disco) e escreve os seus resultados num ficheiro temporário.
- * O processo pai depois agrega os resultados. Se o número de processos pedidos for <= 1
- * ou o número de tarefas for baixo, recorre à pesquisa sequencial.
+ * A tabela de documentos indica diretamente se o documento está na cache e, caso contrário,
+ * o offset do seu registo em disco, na fotografia ou no log (um único `pread`).
+ * Um acerto atualiza a política da cache; um documento lido do disco é colocado na cache
+ * (retirando outro, escolhido pela política, se estiver cheia).
  *
- * @param keyword A palavra-chave a procurar.
- * @param result_ids Array de inteiros onde os IDs dos documentos encontrados serão armazenados.
- * @param nr_processes_requested O número de processos filho a utilizar para a pesquisa.
- * @return O número total de IDs de documentos encontrados.
+ * O documento é copiado para `out`: o chamador nunca fica com um ponteiro para a cache,
+ * que pode ser alterada por outra thread assim que o store_lock for libertado.
+ * Deve ser chamada com o store_lock adquirido (leitura ou escrita).
+ *
+ * @param id O ID do documento a procurar.
+ * @param out Estrutura onde o documento encontrado é copiado.
+ * @return 0 se o documento foi encontrado, -1 caso contrário.
  */
-int search_documents_with_keyword_parallel(char* keyword, int* result_ids, int nr_processes_requested) {
-    char debug_msg[256];
-    int len;
-
-    len = snprintf(debug_msg, sizeof(debug_msg),
-                    "DEBUG: Iniciando pesquisa paralela com keyword '%s' e %d processos pedidos.\n",
-                    keyword, nr_processes_requested);
-    write(STDOUT_FILENO, debug_msg, len);
-
-    SearchTask all_tasks[MAX_DOCS * 2]; // Array para todas as tarefas de pesquisa (cache + disco).
-    int num_total_tasks = 0;
-    int processed_ids_for_task_list[MAX_DOCS * 2]; // Para evitar duplicados ao construir all_tasks.
-    int num_processed_ids_for_task_list = 0;
-
-    // Adiciona tarefas da CACHE.
-    for (int i = 0; i < cache.num_docs; i++) {
-        if (cache.docs[i] != NULL && num_total_tasks < MAX_DOCS * 2) {
-            all_tasks[num_total_tasks].id = cache.docs[i]->id;
-            strncpy(all_tasks[num_total_tasks].path, cache.docs[i]->path, MAX_PATH_SIZE -1);
-            all_tasks[num_total_tasks].path[MAX_PATH_SIZE -1] = '\0';
-            num_total_tasks++;
-
-            if(num_processed_ids_for_task_list < MAX_DOCS * 2)
-                processed_ids_for_task_list[num_processed_ids_for_task_list++] = cache.docs[i]->id;
-        }
-    }
-
-    // Adiciona tarefas do DISCO (apenas as que não estão na cache).
-    int fd_disk = open("database.bin", O_RDONLY);
-    if (fd_disk >= 0) {
-        int next_id_disk_header, num_docs_in_db_header;
-        if (read(fd_disk, &next_id_disk_header, sizeof(int)) == sizeof(int) &&
-            read(fd_disk, &num_docs_in_db_header, sizeof(int)) == sizeof(int)) {
-            Document disk_doc;
-            for (int i = 0; i < num_docs_in_db_header && num_total_tasks < MAX_DOCS * 2; ++i) {
-                if (read(fd_disk, &disk_doc, sizeof(Document)) != sizeof(Document)) break;
-
-                int already_in_tasks = 0;
-                for (int k = 0; k < num_processed_ids_for_task_list; k++) {
-                    if (disk_doc.id == processed_ids_for_task_list[k]) {
-                        already_in_tasks = 1;
-                        break;
-                    }
-                }
-                if (!already_in_tasks) {
-                    all_tasks[num_total_tasks].id = disk_doc.id;
-                    strncpy(all_tasks[num_total_tasks].path, disk_doc.path, MAX_PATH_SIZE-1);
-                    all_tasks[num_total_tasks].path[MAX_PATH_SIZE-1] = '\0';
-                    num_total_tasks++;
-                     if(num_processed_ids_for_task_list < MAX_DOCS * 2) // Adiciona ao tracker
-                        processed_ids_for_task_list[num_processed_ids_for_task_list++] = disk_doc.id;
-                }
-            }
-        }
-        close(fd_disk);
-    } else {
-        write(STDOUT_FILENO, "DEBUG: Base de dados 'database.bin' não encontrada na pesquisa paralela. A pesquisa prosseguirá com a cache.\n",
-            strlen("DEBUG: Base de dados 'database.bin' não encontrada na pesquisa paralela. A pesquisa prosseguirá com a cache.\n"));
+int find_document(int id, Document* out) {
+    pthread_mutex_lock(&cache_mutex);
+    DocSlot* slot = doc_table_slot(&doc_table, id);
+    if (!slot) {
+        pthread_mutex_unlock(&cache_mutex);
+        return -1; // ID nunca atribuído.
     }
-
-
-    if (num_total_tasks == 0) {
-        write(STDOUT_FILENO, "DEBUG: Nenhuma tarefa de pesquisa para processar.\n", strlen("DEBUG: Nenhuma tarefa de pesquisa para processar.\n"));
+    if (slot->cached) {
+        memcpy(out, slot->cached, sizeof(Document)); // Encontrado na cache.
+        doc_cache_touch(&cache, slot->cached);
+        pthread_mutex_unlock(&cache_mutex);
         return 0;
     }
-
-    int actual_nr_processes = nr_processes_requested;
-    if (actual_nr_processes <= 0) actual_nr_processes = 1;
-    if (actual_nr_processes > num_total_tasks) actual_nr_processes = num_total_tasks;
-    if (actual_nr_processes > 20) actual_nr_processes = 20; // Limite de segurança de processos.
-
-    // Se poucos processos ou tarefas, usar versão sequencial.
-    const int SERIAL_THRESHOLD_TASKS = 10; // Limiar de tarefas.
-    if (actual_nr_processes <= 1 || num_total_tasks <= SERIAL_THRESHOLD_TASKS) {
-        len = snprintf(debug_msg, sizeof(debug_msg),
-                        "DEBUG: A usar versão sequencial para pesquisa. Tarefas: %d, Processos: %d.\n",
-                        num_total_tasks, actual_nr_processes);
-        write(STDOUT_FILENO, debug_msg, len);
-        // A função sequencial já lida com cache e disco.
-        return search_documents_with_keyword_serial(keyword, result_ids);
-    }
-
-    len = snprintf(debug_msg, sizeof(debug_msg),
-                    "DEBUG: A usar pesquisa paralela com %d processos para %d tarefas totais.\n",
-                    actual_nr_processes, num_total_tasks);
-    write(STDOUT_FILENO, debug_msg, len);
-
-    pid_t pids[actual_nr_processes];
-    char temp_files[actual_nr_processes][64];
-    int tasks_per_process = num_total_tasks / actual_nr_processes;
-    int remainder_tasks = num_total_tasks % actual_nr_processes;
-    int current_task_index = 0;
-
-    // Cria processos filho.
-    for (int i = 0; i < actual_nr_processes; i++) {
-        int tasks_for_this_child = tasks_per_process + (i < remainder_tasks ? 1 : 0);
-        if (tasks_for_this_child == 0) {
-            pids[i] = -1; // Marca como sem trabalho.
-            snprintf(temp_files[i], sizeof(temp_files[i]), "/tmp/search_results_empty_%d_%d.tmp", getpid(), i);
-            // Cria ficheiro vazio para consistência ou trata pids[i] == -1 na recolha.
-            int empty_fd = open(temp_files[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if(empty_fd >=0) { int zero_count = 0; write(empty_fd, &zero_count, sizeof(int)); close(empty_fd); }
-            continue;
-        }
-
-        snprintf(temp_files[i], sizeof(temp_files[i]), "/tmp/search_results_child_%d_%d.tmp", getpid(), i);
-        pids[i] = fork();
-        if (pids[i] == 0) { // Processo Filho.
-            process_search_tasks_child(&all_tasks[current_task_index], tasks_for_this_child, keyword, temp_files[i]);
-            // process_search_tasks_child faz exit().
-        } else if (pids[i] < 0) {
-            perror("Erro ao criar processo filho para pesquisa paralela");
-            pids[i] = -1; // Marca como falha.
-             int error_fd = open(temp_files[i], O_WRONLY | O_CREAT | O_TRUNC, 0644); // Tenta criar ficheiro vazio.
-            if(error_fd >=0) { int zero_count = 0; write(error_fd, &zero_count, sizeof(int)); close(error_fd); }
-        }
-        current_task_index += tasks_for_this_child;
+    off_t offset = slot->disk_offset;
+    int in_log = slot->in_log;
+    if (offset < 0) {
+        pthread_mutex_unlock(&cache_mutex);
+        return -1; // Documento removido.
     }
+    cache.misses++;
+    if (!in_log) database_fd(); // Abre a fotografia (uma única vez) enquanto o mutex está adquirido.
+    pthread_mutex_unlock(&cache_mutex);
 
-    // Espera pelos processos filho.
-    for (int i = 0; i < actual_nr_processes; i++) {
-        if (pids[i] > 0) {
-            waitpid(pids[i], NULL, 0);
-        }
+    // Lê o registo diretamente do offset conhecido (sem bloquear outros leitores).
+    if (read_disk_document(offset, in_log, id, out) != 0) {
+        return -1; // Documento removido, ou erro de leitura.
     }
 
-    // Agrega resultados dos ficheiros temporários.
-    int final_count = 0;
-    for (int i = 0; i < actual_nr_processes; i++) {
-        int temp_fd = open(temp_files[i], O_RDONLY);
-        if (temp_fd >= 0) {
-            int num_ids_from_child = 0;
-            if (read(temp_fd, &num_ids_from_child, sizeof(int)) == sizeof(int) && num_ids_from_child > 0) {
-                if (final_count + num_ids_from_child <= MAX_RESULT_IDS) {
-                    read(temp_fd, result_ids + final_count, num_ids_from_child * sizeof(int));
-                    final_count += num_ids_from_child;
-                } else {
-                    // Buffer de resultados principal cheio, descarta restantes.
-                    // Lê para limpar o ficheiro, mas não adiciona.
-                    int temp_buffer[MAX_RESULT_IDS]; // Buffer temporário para descartar.
-                    read(temp_fd, temp_buffer, num_ids_from_child * sizeof(int));
-                    write(STDOUT_FILENO, "DEBUG: MAX_RESULT_IDS atingido no pai ao agregar resultados.\n",
-                        strlen("DEBUG: MAX_RESULT_IDS atingido no pai ao agregar resultados.\n"));
-                }
-            }
-            close(temp_fd);
-            unlink(temp_files[i]); // Apaga ficheiro temporário.
-        }
-    }
-    return final_count;
+    // Adiciona à cache (outra thread pode tê-lo colocado entretanto).
+    pthread_mutex_lock(&cache_mutex);
+    if (!slot->cached) cache_insert(slot, out);
+    pthread_mutex_unlock(&cache_mutex);
+    return 0;
 }
 
-
 /**
- * @brief Guarda os documentos da cache (se modificada) no ficheiro de persistência "database.bin".
+ * @brief Remove um documento: regista uma lápide no log e retira-o da cache e do índice.
+ *
+ * Remover custa um único registo acrescentado ao log (O(1)); o registo antigo só desaparece
+ * do disco na próxima compactação (ver `compact_store`).
  *
- * Escreve o `next_id`, o número total de documentos e depois cada documento da cache.
+ * @param id O ID do documento a remover.
+ * @return 0 em caso de sucesso, -1 se o documento não for encontrado ou ocorrer um erro.
  */
-void save_documents() {
-    if (!cache.modified) return; // Não guarda se não houver modificações.
+int remove_document(int id) {
+    DocSlot* slot = doc_table_slot(&doc_table, id);
+    if (!slot || (!slot->cached && slot->disk_offset < 0)) {
+        // O índice nunca deve devolver um ID que as restantes operações não encontram.
+        // (Não faz nada se o documento não estiver indexado.)
+        index_remove_document(&search_index, id);
+        return -1; // Documento não encontrado em lado nenhum.
+    }
+    // Os índices de metadados são indexados pelos valores: é preciso o documento para o retirar.
+    Document old;
+    if (meta_enabled && read_slot_document(slot, &old) != 0) disable_meta_index();
 
-    int fd = open("database.bin", O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (fd < 0) {
-        perror("Erro ao abrir/criar ficheiro da base de dados para escrita");
-        return;
+    // Regista primeiro a remoção no log. Se falhar, o documento voltaria no próximo
+    // arranque: nada é alterado e o cliente é informado do erro.
+    Document tombstone;
+    memset(&tombstone, 0, sizeof(Document));
+    tombstone.id = id;
+    if (doc_log_append(&doc_log, LOG_DELETE, &tombstone, next_id) < 0) {
+        perror("Erro ao escrever no log da base de dados");
+        return -1;
     }
+    slot->disk_offset = -1;
+    slot->in_log = 0;
+    doc_table_set_path(slot, NULL);
+    num_documents--;
+    store_modified = 1;
 
-    write(STDOUT_FILENO, "A gravar documentos na base de dados...\n", strlen("A gravar documentos na base de dados...\n"));
+    index_remove_document(&search_index, id); // Retira o documento de todas as listas do índice.
+    if (meta_enabled) meta_index_remove(&meta_index, &old);
+    cache_remove(slot);
+    result_cache_remove_document(&result_cache, id);
 
-    write(fd, &next_id, sizeof(int)); // Guarda o próximo ID.
-    write(fd, &cache.num_docs, sizeof(int)); // Guarda o número de documentos.
+    return 0; // Sucesso.
+}
 
-    for (int i = 0; i < cache.num_docs; i++) {
-        if (cache.docs[i] != NULL) { // Verifica se o ponteiro é válido.
-            write(fd, cache.docs[i], sizeof(Document));
-        }
-    }
-    close(fd);
+// Parâmetros de uma pesquisa sobre um ficheiro mapeado (ver `scan_mapped_file`).
+typedef struct {
+    const Matcher* matcher;
+    int stop_at_first;
+} MappedScan;
 
-    char msg[64];
-    snprintf(msg, sizeof(msg), "Gravados %d documentos com sucesso.\n", cache.num_docs);
-    write(STDOUT_FILENO, msg, strlen(msg));
-    cache.modified = 0; // Reset da flag de modificação.
+/**
+ * @brief Conta as linhas com a palavra-chave no conteúdo mapeado de um ficheiro (ver File_Map.h).
+ */
+static long scan_mapped_file(const char* data, size_t size, int nul_terminated, void* ctx) {
+    const MappedScan* scan = ctx;
+    // O regexec pode ler até ao '\0' (ver matcher_count_lines_fd): sem ele, lê-se com read.
+    if (!scan->matcher->is_literal && !nul_terminated) return FILE_MAP_UNAVAILABLE;
+    server_metrics_add_bytes(&metrics, (long)size);
+    return matcher_count_lines_buffer(scan->matcher, data, size, scan->stop_at_first);
 }
 
 /**
- * @brief Carrega os documentos do ficheiro de persistência "database.bin" para a cache.
+ * @brief Conta as linhas do ficheiro de um documento que contêm a palavra-chave, usando um Matcher.
  *
- * Lê o `next_id`, o número total de documentos e depois cada documento,
- * adicionando-os à cache até ao limite da cache.
+ * A pesquisa é feita dentro do servidor (ver Matcher.h), sobre o ficheiro mapeado em memória
+ * (cache de mapeamentos, sem cópias) ou, se não puder ser mapeado, lido em blocos. Se
+ * `matcher` for NULL (palavra-chave não suportada em processo), recorre ao pipeline original
+ * `grep | wc -l`.
+ *
+ * @param doc_path Caminho do documento, relativo à pasta base.
+ * @param matcher Matcher já inicializado para a palavra-chave, ou NULL.
+ * @param keyword A palavra-chave (usada apenas no recurso ao grep).
+ * @param stop_at_first Se diferente de 0, basta saber se existe pelo menos uma linha.
+ * @return O número de linhas encontradas, ou -1 em caso de erro.
  */
-void load_documents() {
-    int fd = open("database.bin", O_RDONLY);
-    next_id = 1; // Valor por defeito se o ficheiro não existir.
-    cache.num_docs = 0;
-    cache.modified = 0;
+long count_lines_with_matcher(const char* doc_path, const Matcher* matcher, const char* keyword, int stop_at_first) {
+    char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2]; // +2 para '/' e '\0'.
+    snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, doc_path);
 
-    if (fd < 0) {
-        if (errno == ENOENT) {
-            write(STDOUT_FILENO, "Ficheiro da base de dados 'database.bin' não encontrado. A iniciar com estado vazio.\n",
-                strlen("Ficheiro da base de dados 'database.bin' não encontrado. A iniciar com estado vazio.\n"));
-        } else {
-            perror("Erro ao tentar abrir 'database.bin' para leitura");
+    if (matcher) {
+        if (file_maps_enabled) {
+            MappedScan scan = { matcher, stop_at_first };
+            long count = file_map_scan(&file_maps, full_path, scan_mapped_file, &scan);
+            if (count != FILE_MAP_UNAVAILABLE) return count;
         }
-        return;
+        int fd = open(full_path, O_RDONLY);
+        if (fd < 0) return -1;
+        struct stat st;
+        if (fstat(fd, &st) == 0) server_metrics_add_bytes(&metrics, (long)st.st_size);
+        long count = matcher_count_lines_fd(matcher, fd, stop_at_first);
+        close(fd);
+        return count;
     }
+    return matcher_count_lines_exec(full_path, keyword);
+}
 
-    write(STDOUT_FILENO, "A carregar documentos do disco ('database.bin')...\n", strlen("A carregar documentos do disco ('database.bin')...\n"));
+/**
+ * @brief Conta o número de linhas num ficheiro de documento que contêm uma determinada palavra-chave.
+ *
+ * Devolve as mesmas contagens que `grep keyword ficheiro | wc -l`, mas sem criar processos
+ * (exceto para palavras-chave que o Matcher não suporta).
+ *
+ * @param doc Ponteiro para o Documento cujo ficheiro será analisado.
+ * @param keyword A palavra-chave a procurar.
+ * @return O número de linhas encontradas, ou -1 em caso de erro.
+ */
+int count_lines_with_keyword(Document* doc, const char* keyword) {
+    if (!doc || !keyword) return -1;
 
-    if (read(fd, &next_id, sizeof(int)) != sizeof(int)) {
-        write(STDERR_FILENO, "Erro ao ler next_id do 'database.bin'. A iniciar com estado vazio.\n", strlen("Erro ao ler next_id do 'database.bin'. A iniciar com estado vazio.\n"));
-        next_id = 1; cache.num_docs = 0; close(fd); return;
-    }
+    Matcher matcher;
+    int has_matcher = (matcher_init(&matcher, keyword) == 0);
+    long line_count = count_lines_with_matcher(doc->path, has_matcher ? &matcher : NULL, keyword, 0);
+    if (has_matcher) matcher_destroy(&matcher);
 
-    int total_docs_on_disk;
-    if (read(fd, &total_docs_on_disk, sizeof(int)) != sizeof(int)) {
-        write(STDERR_FILENO, "Erro ao ler total_docs_on_disk do 'database.bin'. A iniciar com estado vazio.\n", strlen("Erro ao ler total_docs_on_disk do 'database.bin'. A iniciar com estado vazio.\n"));
-        next_id = 1; cache.num_docs = 0; close(fd); return;
-    }
+    return (int)line_count;
+}
+
+/**
+ * @brief Faz `stat` ao ficheiro de um documento e invalida a cache de resultados se ele mudou.
+ *
+ * @return 1 se o ficheiro mudou desde a última utilização, 0 caso contrário.
+ */
+static int check_result_cache_file(int id, const char* doc_path) {
+    char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+    struct stat st;
+    snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, doc_path);
+    return result_cache_check_file(&result_cache, id, stat(full_path, &st) == 0 ? &st : NULL);
+}
+
+/**
+ * @brief COUNT_LINES com a cache de resultados: só lê o ficheiro se a contagem não estiver guardada.
+ *
+ * @param doc Documento (cópia obtida com o store_lock).
+ * @param generation Geração da cache lida com o store_lock, junto com o documento.
+ * @return O número de linhas encontradas, ou -1 em caso de erro.
+ */
+int count_lines_cached(Document* doc, const char* keyword, unsigned long generation) {
+    long count;
+    int changed = check_result_cache_file(doc->id, doc->path);
+    if (!changed && result_cache_get_count(&result_cache, doc->id, keyword, &count) == 0) return (int)count;
+
+    int line_count = count_lines_with_keyword(doc, keyword);
+    // Se o ficheiro mudou, a geração avançou e a contagem só fica guardada no pedido seguinte.
+    if (line_count >= 0 && !changed) result_cache_put_count(&result_cache, doc->id, keyword, line_count, generation);
+    return line_count;
+}
+
+// Localização de um elemento de MULTI_QUERY, para ler os documentos pela ordem do disco.
+typedef struct {
+    long long key;  // -1 na cache; depois a fotografia e o log, cada um por offset.
+    int position;   // Posição no lote.
+} QueryOrder;
+
+static int compare_query_order(const void* a, const void* b) {
+    const QueryOrder* x = a;
+    const QueryOrder* y = b;
+    if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return x->position - y->position;
+}
+
+/**
+ * @brief Consulta um lote de IDs recebido depois do pedido (MULTI_QUERY).
+ *
+ * Os documentos são procurados com um só store_lock (modo leitura): primeiro os que estão na
+ * cache, depois os do disco por ordem de ficheiro e offset (leituras sequenciais em vez de
+ * saltos pela fotografia). Cada documento passa pela cache como num QUERY_DOC.
+ *
+ * Gere o store_lock sozinha.
+ *
+ * @param req O pedido (origem do lote e número de IDs).
+ * @param resp Recebe o estado e os documentos (ver MULTI_QUERY em Document_Struct.h).
+ */
+void multi_query_documents(const Request* req, Response* resp) {
+    BatchInput in;
+    if (open_batch_input(req, sizeof(int), &in) != 0) {
+        resp->status = -5;
+        return;
+    }
+    int n = req->batch_size;
+    if (n <= 0 || n > MULTI_MAX_ITEMS) {
+        close_batch_input(&in);
+        resp->status = -2;
+        return;
+    }
+    int* ids = malloc((size_t)n * sizeof(int));
+    QueryOrder* order = malloc((size_t)n * sizeof(QueryOrder));
+    Document* docs = calloc(n, sizeof(Document)); // id 0: inexistente (ou não recebido).
+    if (!ids || !order || !docs) {
+        perror("Erro ao alocar memória para o lote");
+        close_batch_input(&in);
+        free(ids);
+        free(order);
+        free(docs);
+        resp->status = -5;
+        return;
+    }
+    int got = read_batch_items(&in, ids, sizeof(int), n);
+    close_batch_input(&in);
+
+    pthread_rwlock_rdlock(&store_lock);
+    pthread_mutex_lock(&cache_mutex); // Os ponteiros da cache só são estáveis com o mutex.
+    for (int i = 0; i < got; i++) {
+        const DocSlot* slot = doc_table_slot(&doc_table, ids[i]);
+        order[i].position = i;
+        if (!slot || (!slot->cached && slot->disk_offset < 0)) order[i].key = LLONG_MAX; // Inexistente.
+        else if (slot->cached) order[i].key = -1;
+        else order[i].key = (slot->in_log ? (1LL << 62) : 0) + slot->disk_offset;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    qsort(order, got, sizeof(QueryOrder), compare_query_order);
+    for (int k = 0; k < got && order[k].key != LLONG_MAX; k++) {
+        int i = order[k].position;
+        if (find_document(ids[i], &docs[i]) != 0) memset(&docs[i], 0, sizeof(Document));
+    }
+    pthread_rwlock_unlock(&store_lock);
+
+    free(ids);
+    free(order);
+    resp->docs = docs;
+    resp->num_docs = n;
+    resp->status = (got < n) ? -6 : 0;
+}
+
+// Pesquisa de várias palavras-chave sobre um ficheiro mapeado (ver `scan_mapped_file_multi`).
+typedef struct {
+    const MultiMatcher* mm;
+    int stop_at_first;
+    long* counts;
+} MappedMultiScan;
+
+/**
+ * @brief Conta as linhas de cada palavra-chave de um MultiMatcher no conteúdo mapeado de um ficheiro.
+ */
+static long scan_mapped_file_multi(const char* data, size_t size, int nul_terminated, void* ctx) {
+    const MappedMultiScan* scan = ctx;
+    // O regexec pode ler até ao '\0' (ver matcher_count_lines_fd): sem ele, lê-se com read.
+    if (multi_matcher_needs_nul(scan->mm) && !nul_terminated) return FILE_MAP_UNAVAILABLE;
+    server_metrics_add_bytes(&metrics, (long)size);
+    return multi_matcher_count_lines_buffer(scan->mm, data, size, scan->stop_at_first, scan->counts);
+}
+
+/**
+ * @brief Conta, para as palavras-chave de um MultiMatcher, as linhas do ficheiro de um documento.
+ *
+ * Como `count_lines_with_matcher`, mas todas as palavras-chave são procuradas na mesma
+ * passagem pelo ficheiro mapeado (ou, se não puder ser mapeado, lido em blocos); ver
+ * Multi_Matcher.h. As palavras-chave que o Matcher não suporta recorrem ao grep.
+ *
+ * @param doc_path Caminho do documento, relativo à pasta base.
+ * @param mm MultiMatcher já inicializado (pode ser partilhado entre threads).
+ * @param stop_at_first Se diferente de 0, basta saber se cada palavra-chave ocorre (contagens 0 ou 1).
+ * @param counts Recebe o número de linhas de cada palavra-chave (-1 em caso de erro).
+ * @return 0 em caso de sucesso, -1 se o ficheiro não pôde ser lido.
+ */
+int count_lines_with_multi_matcher(const char* doc_path, const MultiMatcher* mm, int stop_at_first, long* counts) {
+    char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+    snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, doc_path);
+
+    long result = FILE_MAP_UNAVAILABLE;
+    if (file_maps_enabled) {
+        MappedMultiScan scan = { mm, stop_at_first, counts };
+        result = file_map_scan(&file_maps, full_path, scan_mapped_file_multi, &scan);
+    }
+    if (result == FILE_MAP_UNAVAILABLE) {
+        int fd = open(full_path, O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0) server_metrics_add_bytes(&metrics, (long)st.st_size);
+        result = (fd >= 0) ? multi_matcher_count_lines_fd(mm, fd, stop_at_first, counts) : -1;
+        if (fd >= 0) close(fd);
+    }
+    if (result < 0) {
+        for (int k = 0; k < mm->num_keywords; k++) counts[k] = -1;
+        return -1;
+    }
+
+    for (int k = 0; k < mm->num_keywords; k++) {
+        if (mm->kind[k] == MULTI_MATCHER_UNSUPPORTED) {
+            counts[k] = matcher_count_lines_exec(full_path, mm->keywords[k]);
+            if (stop_at_first && counts[k] > 0) counts[k] = 1;
+        } else if (mm->kind[k] == MULTI_MATCHER_DUPLICATE && mm->kind[mm->alias[k]] == MULTI_MATCHER_UNSUPPORTED) {
+            counts[k] = counts[mm->alias[k]]; // A primeira igual vem antes e já foi contada.
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Conta, para várias palavras-chave, as linhas do ficheiro de um documento, lendo-o uma só vez.
+ *
+ * As palavras-chave são procuradas em grupos de até MULTI_MATCHER_MAX_KEYWORDS, cada grupo numa
+ * só passagem (ver `count_lines_with_multi_matcher`).
+ *
+ * @param doc_path Caminho do documento, relativo à pasta base.
+ * @param keywords As palavras-chave.
+ * @param num Número de palavras-chave.
+ * @param counts Recebe o número de linhas de cada palavra-chave (-1 em caso de erro).
+ */
+void count_lines_multi(const char* doc_path, const char* const* keywords, int num, long* counts) {
+    for (int first = 0; first < num; first += MULTI_MATCHER_MAX_KEYWORDS) {
+        int size = (num - first < MULTI_MATCHER_MAX_KEYWORDS) ? num - first : MULTI_MATCHER_MAX_KEYWORDS;
+        MultiMatcher mm;
+        if (multi_matcher_init(&mm, keywords + first, size) != 0) {
+            for (int k = 0; k < size; k++) counts[first + k] = -1;
+            continue;
+        }
+        count_lines_with_multi_matcher(doc_path, &mm, 0, counts + first);
+        multi_matcher_destroy(&mm);
+    }
+}
+
+// Documento de um grupo de elementos de MULTI_COUNT (ver `multi_count_lines`).
+typedef struct {
+    int start, end;              // Elementos do grupo: order[start .. end-1].
+    int found;                   // 1 se o documento existe.
+    char path[MAX_PATH_SIZE];    // Caminho do documento (cópia obtida com o store_lock).
+} CountGroup;
+
+static int compare_count_items(const void* a, const void* b, void* ctx) {
+    const CountItem* items = ctx;
+    const CountItem* x = &items[*(const int*)a];
+    const CountItem* y = &items[*(const int*)b];
+    if (x->id != y->id) return (x->id > y->id) - (x->id < y->id);
+    int c = strcmp(x->keyword, y->keyword);
+    return c ? c : *(const int*)a - *(const int*)b;
+}
+
+/**
+ * @brief Conta as linhas de um grupo (um documento, várias palavras-chave) para MULTI_COUNT.
+ *
+ * As contagens guardadas na cache de resultados são reutilizadas; as restantes palavras-chave
+ * (distintas) são procuradas com uma só abertura do ficheiro (ver `count_lines_multi`).
+ */
+static void count_group_lines(const CountItem* items, const int* order, const CountGroup* group,
+                              unsigned long generation, int* counts) {
+    int id = items[order[group->start]].id;
+    int changed = check_result_cache_file(id, group->path);
+    int size = group->end - group->start;
+    const char** keywords = malloc(size * sizeof(char*));
+    int* first = malloc(size * sizeof(int)); // Primeiro elemento (em order) de cada palavra-chave procurada.
+    long* found = malloc(size * sizeof(long));
+    if (!keywords || !first || !found) {
+        free(keywords);
+        free(first);
+        free(found);
+        return; // As contagens ficam a -1.
+    }
+
+    int num = 0;
+    for (int k = group->start; k < group->end; k++) {
+        const CountItem* item = &items[order[k]];
+        if (k > group->start && strcmp(item->keyword, items[order[k - 1]].keyword) == 0) {
+            counts[order[k]] = counts[order[k - 1]]; // Palavra-chave repetida: já contada (ou pendente).
+            continue;
+        }
+        long count;
+        if (!changed && result_cache_get_count(&result_cache, id, item->keyword, &count) == 0) {
+            counts[order[k]] = (int)count;
+            continue;
+        }
+        keywords[num] = item->keyword;
+        first[num++] = k;
+    }
+
+    if (num > 0) {
+        count_lines_multi(group->path, keywords, num, found);
+        for (int j = 0; j < num; j++) {
+            // Se o ficheiro mudou, a geração avançou e a contagem só fica guardada no pedido seguinte.
+            if (found[j] >= 0 && !changed) result_cache_put_count(&result_cache, id, keywords[j], found[j], generation);
+            for (int k = first[j]; k < group->end && (k == first[j] || strcmp(items[order[k]].keyword, keywords[j]) == 0); k++) {
+                counts[order[k]] = (int)found[j];
+            }
+        }
+    }
+    free(keywords);
+    free(first);
+    free(found);
+}
+
+/**
+ * @brief Conta as linhas de um lote de pares (ID, palavra-chave) recebido depois do pedido (MULTI_COUNT).
+ *
+ * Os pares são agrupados por documento: os documentos são procurados com um só store_lock e
+ * cada ficheiro é aberto uma única vez para todas as palavras-chave que o visam (pares
+ * repetidos são contados uma só vez). Os ficheiros são lidos sem o lock, como em COUNT_LINES.
+ *
+ * Gere o store_lock sozinha.
+ *
+ * @param req O pedido (origem do lote e número de pares).
+ * @param resp Recebe o estado e as contagens (ver MULTI_COUNT em Document_Struct.h).
+ */
+void multi_count_lines(const Request* req, Response* resp) {
+    BatchInput in;
+    if (open_batch_input(req, sizeof(CountItem), &in) != 0) {
+        resp->status = -5;
+        return;
+    }
+    int n = req->batch_size;
+    if (n <= 0 || n > MULTI_MAX_ITEMS) {
+        close_batch_input(&in);
+        resp->status = -2;
+        return;
+    }
+    CountItem* items = malloc((size_t)n * sizeof(CountItem));
+    int* order = malloc((size_t)n * sizeof(int));
+    int* counts = malloc((size_t)n * sizeof(int));
+    CountGroup* groups = malloc((size_t)n * sizeof(CountGroup));
+    if (!items || !order || !counts || !groups) {
+        perror("Erro ao alocar memória para o lote");
+        close_batch_input(&in);
+        free(items);
+        free(order);
+        free(counts);
+        free(groups);
+        resp->status = -5;
+        return;
+    }
+    int got = read_batch_items(&in, items, sizeof(CountItem), n);
+    close_batch_input(&in);
+
+    for (int i = 0; i < n; i++) counts[i] = -1;
+    for (int i = 0; i < got; i++) {
+        items[i].keyword[MAX_KEYWORD_SIZE - 1] = '\0'; // Os dados vêm de outro processo.
+        order[i] = i;
+    }
+    qsort_r(order, got, sizeof(int), compare_count_items, items);
+
+    // Um grupo por documento distinto, com o seu caminho (copiado com o lock).
+    int num_groups = 0;
+    pthread_rwlock_rdlock(&store_lock);
+    unsigned long generation = result_cache_generation(&result_cache);
+    for (int k = 0; k < got; k++) {
+        if (k > 0 && items[order[k]].id == items[order[k - 1]].id) {
+            groups[num_groups - 1].end = k + 1;
+            continue;
+        }
+        CountGroup* group = &groups[num_groups++];
+        Document doc;
+        group->start = k;
+        group->end = k + 1;
+        group->found = (find_document(items[order[k]].id, &doc) == 0);
+        if (group->found) memcpy(group->path, doc.path, MAX_PATH_SIZE);
+    }
+    pthread_rwlock_unlock(&store_lock);
+
+    for (int g = 0; g < num_groups; g++) {
+        if (groups[g].found) count_group_lines(items, order, &groups[g], generation, counts);
+    }
+
+    free(items);
+    free(order);
+    free(groups);
+    resp->ids = counts;
+    resp->num_ids = n;
+    resp->status = (got < n) ? -6 : 0;
+}
+
+static int compare_ids(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Resolve, com o índice invertido, as tarefas de pesquisa que não precisam de ler o ficheiro.
+ *
+ * Só atua quando o índice está ativo e a palavra-chave é composta apenas por caracteres
+ * de palavra (ver `index_can_answer`); caso contrário devolve 0 e todas as tarefas ficam
+ * SEARCH_TASK_SCAN (pesquisa por leitura dos ficheiros, sequencial ou paralela).
+ *
+ * O índice reflete o conteúdo dos ficheiros no momento em que foram indexados. Só os
+ * candidatos (documentos das listas) são verificados (data e tamanho do ficheiro, um `stat`):
+ * os que mudaram desde a indexação ficam SEARCH_TASK_SCAN e são lidos, os restantes
+ * SEARCH_TASK_INDEX_HIT. Os outros documentos indexados ficam SEARCH_TASK_INDEX_MISS sem
+ * `stat` (ver Inverted_Index.h) e os que não estão no índice (ex: lote por indexar) são lidos.
+ * Os documentos alterados só voltam a ser indexados no próximo arranque (ver `load_search_index`).
+ * Deve ser chamada com o store_lock adquirido, tal como `collect_search_tasks`.
+ *
+ * @param keyword A palavra-chave a procurar.
+ * @param tasks Tarefas criadas por `collect_search_tasks` (apenas documentos existentes).
+ * @param num_tasks Número de tarefas.
+ * @return 1 se o índice foi usado, 0 caso contrário.
+ */
+int resolve_search_tasks_with_index(const char* keyword, SearchTask* tasks, int num_tasks) {
+    if (!index_enabled || !index_can_answer(keyword)) return 0;
+
+    int max_hits = search_index.max_doc_id + 1; // Cada ID indexado aparece no máximo uma vez.
+    int* hits = malloc(max_hits * sizeof(int));
+    if (!hits) return 0;
+    int num_hits = index_search(&search_index, keyword, hits, max_hits);
+    if (num_hits < 0) {
+        free(hits);
+        return 0;
+    }
+
+    // Tarefas e resultados estão por ordem de ID: percorre-os em paralelo.
+    for (int i = 0, h = 0; i < num_tasks; i++) {
+        while (h < num_hits && hits[h] < tasks[i].id) h++;
+        if (h < num_hits && hits[h] == tasks[i].id) {
+            char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+            snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, tasks[i].path);
+            // Um candidato cujo ficheiro mudou desde a indexação é lido.
+            tasks[i].index_state = index_document_is_current(&search_index, tasks[i].id, full_path) ? SEARCH_TASK_INDEX_HIT
+                                                                                                 : SEARCH_TASK_SCAN;
+        } else {
+            tasks[i].index_state = index_has_document(&search_index, tasks[i].id) ? SEARCH_TASK_INDEX_MISS : SEARCH_TASK_SCAN;
+        }
+    }
+    free(hits);
+    return 1;
+}
+
+/**
+ * @brief Constrói a lista de documentos a pesquisar (todos os documentos existentes), por ordem de ID.
+ *
+ * Os caminhos vêm da tabela de documentos, em memória; só um documento sem caminho na tabela
+ * (faltou memória ao guardá-lo) é lido do disco. Deve ser chamada com o store_lock adquirido
+ * (leitura ou escrita).
+ *
+ * @param tasks Array onde as tarefas são escritas.
+ * @param max_tasks Capacidade de tasks.
+ * @return O número de tarefas criadas.
+ */
+int collect_search_tasks(SearchTask* tasks, int max_tasks) {
+    int num_tasks = 0;
+
+    pthread_mutex_lock(&cache_mutex); // Outros leitores podem estar a colocar documentos na cache.
+    database_fd();
+    for (int id = 1; id < doc_table.capacity && num_tasks < max_tasks; id++) {
+        const DocSlot* slot = &doc_table.slots[id];
+        if (!slot->cached && slot->disk_offset < 0) continue; // ID livre ou removido.
+
+        Document doc;
+        const char* path = slot->path;
+        if (!path) {
+            if (read_slot_document(slot, &doc) != 0) continue;
+            path = doc.path;
+        }
+        tasks[num_tasks].id = id;
+        strncpy(tasks[num_tasks].path, path, MAX_PATH_SIZE - 1);
+        tasks[num_tasks].path[MAX_PATH_SIZE - 1] = '\0';
+        tasks[num_tasks].index_state = SEARCH_TASK_SCAN;
+        tasks[num_tasks].score = 0.0;
+        num_tasks++;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    return num_tasks;
+}
+
+/**
+ * @brief Indica se o documento de uma tarefa contém a palavra-chave.
+ *
+ * Tarefas já resolvidas pelo índice não leem o ficheiro; as restantes param a leitura na
+ * primeira linha encontrada (equivalente a 'grep -q').
+ *
+ * @return 1 se o documento contém a palavra-chave, 0 caso contrário.
+ */
+int search_task_matches(const SearchTask* task, const Matcher* matcher, const char* keyword) {
+    if (task->index_state == SEARCH_TASK_INDEX_HIT) return 1;
+    if (task->index_state == SEARCH_TASK_INDEX_MISS) return 0;
+    return count_lines_with_matcher(task->path, matcher, keyword, 1) > 0;
+}
+
+/**
+ * @brief Percorre uma lista de tarefas na thread atual e guarda os IDs dos documentos com a palavra-chave.
+ *
+ * @param result_ids Array com espaço para num_tasks IDs.
+ * @return O número de IDs escritos em result_ids.
+ */
+int search_tasks_serial(const SearchTask* tasks, int num_tasks, const Matcher* matcher, const char* keyword, int* result_ids) {
+    int count = 0;
+    for (int i = 0; i < num_tasks; i++) {
+        if (search_task_matches(&tasks[i], matcher, keyword)) {
+            result_ids[count++] = tasks[i].id;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Procura documentos que contêm uma palavra-chave, de forma sequencial.
+ *
+ * @param tasks Documentos a pesquisar (cópia obtida com o store_lock; ver `search_documents`).
+ * @param num_tasks Número de tarefas.
+ * @param keyword A palavra-chave a procurar.
+ * @param result_ids Array com espaço para num_tasks IDs, onde os IDs encontrados são armazenados.
+ * @return O número de IDs de documentos encontrados e adicionados a result_ids.
+ */
+int search_documents_serial(const SearchTask* tasks, int num_tasks, const char* keyword, int* result_ids) {
+    // Compila a palavra-chave uma única vez para todos os documentos.
+    Matcher matcher;
+    const Matcher* m = (matcher_init(&matcher, keyword) == 0) ? &matcher : NULL;
+
+    int count = search_tasks_serial(tasks, num_tasks, m, keyword, result_ids);
+
+    if (m) matcher_destroy(&matcher);
+    return count;
+}
+
+/**
+ * @brief Pesquisa uma lista de tarefas pelo método adequado (índice, pool ou sequencial).
+ *
+ * @param result_ids Array com espaço para num_tasks IDs; recebe os IDs por ordem crescente.
+ * @return O número de IDs encontrados.
+ */
+static int scan_search_tasks(const SearchTask* tasks, int num_tasks, const char* keyword, int* result_ids,
+                             int used_index, int nr_processes) {
+    int count;
+    if (used_index) {
+        // Quase tudo foi respondido pelo índice; só os ficheiros alterados são lidos.
+        count = search_documents_serial(tasks, num_tasks, keyword, result_ids);
+        qsort(result_ids, count, sizeof(int), compare_ids);
+    } else if (nr_processes > 1) {
+        count = search_documents_parallel(tasks, num_tasks, keyword, result_ids, nr_processes);
+    } else {
+        count = search_documents_serial(tasks, num_tasks, keyword, result_ids);
+    }
+    return count;
+}
+
+/**
+ * @brief Verifica, para a cache de resultados, os ficheiros de que depende uma pesquisa.
+ *
+ * Depende do ficheiro todo o documento cuja resposta não veio de uma ausência no índice: os
+ * lidos (SEARCH_TASK_SCAN, o que inclui todos quando a palavra-chave não é resolúvel pelo
+ * índice ou este está desligado), os encontrados pelo índice e os que estão na lista de IDs.
+ * Um documento lido sem correspondência também conta: se o ficheiro passar a conter a
+ * palavra-chave, a pesquisa guardada deixa de estar certa. Os SEARCH_TASK_INDEX_MISS seguem o
+ * índice, tal como sem a cache (ver `resolve_search_tasks_with_index`).
+ *
+ * @param tasks Tarefas da pesquisa, por ordem de ID (dão o caminho de cada documento).
+ * @param ids IDs por ordem crescente (os que não estão nas tarefas foram removidos e são ignorados).
+ * @return 1 se algum ficheiro mudou desde a última utilização, 0 caso contrário.
+ */
+static int check_result_cache_files(const SearchTask* tasks, int num_tasks, const int* ids, int num_ids) {
+    int changed = 0;
+    for (int t = 0, i = 0; t < num_tasks; t++) {
+        while (i < num_ids && ids[i] < tasks[t].id) i++;
+        int listed = i < num_ids && ids[i] == tasks[t].id;
+        if (listed || tasks[t].index_state != SEARCH_TASK_INDEX_MISS) {
+            changed |= check_result_cache_file(tasks[t].id, tasks[t].path);
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Procura documentos que contêm uma palavra-chave (SEARCH_DOCS).
+ *
+ * O store_lock só é mantido enquanto se copia a lista de documentos e se consulta o índice;
+ * a leitura dos ficheiros é feita sem o lock, para que uma pesquisa longa não atrase
+ * ADD/DELETE nem os pedidos que ficariam à espera atrás deles. O resultado corresponde aos
+ * documentos existentes no momento da cópia.
+ *
+ * Passa pela cache de resultados (ver Result_Cache.h): depois de verificar que nenhum dos
+ * ficheiros de que a entrada depende mudou (`check_result_cache_files`), uma palavra-chave já
+ * pesquisada só lê os documentos adicionados desde então. A identificação dos ficheiros é
+ * registada antes da leitura, para que uma alteração durante a pesquisa seja vista na
+ * seguinte; o resultado só é guardado se nenhum mudou desde a última utilização.
+ *
+ * @param keyword A palavra-chave a procurar.
+ * @param result_ids Recebe um array (alocado com malloc, a libertar pelo chamador) com os IDs
+ * dos documentos encontrados, ou NULL se não houver resultados.
+ * @param nr_processes Número de processos pedido pelo cliente (pesquisa paralela se > 1).
+ * @return O número de IDs de documentos encontrados.
+ */
+int search_documents(const char* keyword, int** result_ids, int nr_processes) {
+    *result_ids = NULL;
+
+    // Há no máximo um documento por posição da tabela; tarefas e resultados ficam no heap.
+    pthread_rwlock_rdlock(&store_lock);
+    int max_tasks = doc_table.capacity;
+    SearchTask* tasks = malloc(max_tasks * sizeof(SearchTask));
+    int* ids = malloc(max_tasks * sizeof(int));
+    if (!tasks || !ids) {
+        pthread_rwlock_unlock(&store_lock);
+        perror("Erro ao alocar lista de tarefas de pesquisa");
+        free(tasks);
+        free(ids);
+        return 0;
+    }
+    int num_tasks = collect_search_tasks(tasks, max_tasks);
+    int used_index = resolve_search_tasks_with_index(keyword, tasks, num_tasks);
+    // Lida com o lock: um DELETE_DOC posterior à cópia avança a geração e o resultado não fica guardado.
+    unsigned long generation = result_cache_generation(&result_cache);
+    pthread_rwlock_unlock(&store_lock);
+    int max_id = (num_tasks > 0) ? tasks[num_tasks - 1].id : 0;
+
+    int* cached_ids = NULL;
+    int num_cached = 0, cached_max_id = 0, cache_hit = 0;
+    if (result_cache_get_search(&result_cache, keyword, max_id, &cached_ids, &num_cached, &cached_max_id) == 0) {
+        cache_hit = !check_result_cache_files(tasks, num_tasks, cached_ids, num_cached);
+        if (!cache_hit) { // Um ficheiro mudou: a entrada já saiu da cache.
+            free(cached_ids);
+            cached_ids = NULL;
+        }
+    }
+
+    int count;
+    if (cache_hit) {
+        // Só os documentos com ID acima do coberto pela entrada (adicionados depois) são lidos.
+        int first_new = 0;
+        while (first_new < num_tasks && tasks[first_new].id <= cached_max_id) first_new++;
+        int num_new = num_tasks - first_new;
+        int* merged = malloc((num_cached + num_new + 1) * sizeof(int)); // +1: nunca malloc(0).
+        if (!merged) {
+            perror("Erro ao alocar resultado da pesquisa");
+            free(cached_ids);
+            free(tasks);
+            free(ids);
+            return 0;
+        }
+        if (num_cached > 0) memcpy(merged, cached_ids, num_cached * sizeof(int));
+        int changed = check_result_cache_files(tasks + first_new, num_new, NULL, 0);
+        count = num_cached + scan_search_tasks(tasks + first_new, num_new, keyword, merged + num_cached, used_index, nr_processes);
+        if (num_new > 0 && !changed) result_cache_put_search(&result_cache, keyword, merged, count, max_id, generation);
+        free(cached_ids);
+        free(ids);
+        ids = merged;
+    } else {
+        int changed = result_cache.max_bytes > 0 ? check_result_cache_files(tasks, num_tasks, NULL, 0) : 1;
+        count = scan_search_tasks(tasks, num_tasks, keyword, ids, used_index, nr_processes);
+        if (!changed) result_cache_put_search(&result_cache, keyword, ids, count, max_id, generation);
+    }
+    free(tasks);
+    if (count > 0) {
+        *result_ids = ids;
+    } else {
+        free(ids);
+    }
+    return count;
+}
+
+/**
+ * @brief Contexto da pesquisa de um item no pool (ver `search_documents_parallel`).
+ */
+typedef struct {
+    const SearchTask* tasks;
+    const Matcher* matcher;
+    const char* keyword;
+} PoolScan;
+
+/**
+ * @brief Pesquisa o documento de uma tarefa (chamada numa thread do pool).
+ */
+static int pool_scan_task(int item, void* ctx) {
+    const PoolScan* scan = ctx;
+    return search_task_matches(&scan->tasks[item], scan->matcher, scan->keyword);
+}
+
+/**
+ * @brief Custo de cada tarefa para o pool: o tamanho do ficheiro (0 se já resolvida pelo índice ou inexistente).
+ */
+static void search_task_weights(const SearchTask* tasks, int num_tasks, long* weights) {
+    for (int i = 0; i < num_tasks; i++) {
+        char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+        struct stat st;
+        snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, tasks[i].path);
+        weights[i] = (tasks[i].index_state == SEARCH_TASK_SCAN && stat(full_path, &st) == 0) ? (long)st.st_size : 0;
+    }
+}
+
+/**
+ * @brief Procura documentos que contêm uma palavra-chave, de forma paralela.
+ *
+ * Os documentos são pesquisados pelas threads do pool de pesquisa (ver Search_Pool.h),
+ * escalonados pelo tamanho dos ficheiros: os maiores começam primeiro e as threads livres
+ * roubam trabalho às ocupadas. Os resultados ficam em memória, um por tarefa, e são
+ * recolhidos pela ordem das tarefas (por ID). Com poucas tarefas, sem pool ou se faltar
+ * memória, recorre à pesquisa sequencial.
+ *
+ * @param tasks Documentos a pesquisar (cópia obtida com o store_lock; ver `search_documents`).
+ * @param num_tasks Número de tarefas.
+ * @param keyword A palavra-chave a procurar.
+ * @param result_ids Array com espaço para num_tasks IDs, onde os IDs encontrados são armazenados.
+ * @param nr_processes Número de processos pedido pelo cliente (> 1 para usar o pool; as threads
+ * usadas são as do pool, opção -P).
+ * @return O número total de IDs de documentos encontrados.
+ */
+int search_documents_parallel(const SearchTask* tasks, int num_tasks, const char* keyword, int* result_ids, int nr_processes) {
+    if (nr_processes <= 1 || num_tasks <= SEARCH_SERIAL_THRESHOLD_TASKS || search_pool.num_threads == 0) {
+        return search_documents_serial(tasks, num_tasks, keyword, result_ids);
+    }
+
+    long* weights = malloc(num_tasks * sizeof(long));
+    unsigned char* matched = malloc(num_tasks);
+    if (!weights || !matched) {
+        free(weights);
+        free(matched);
+        return search_documents_serial(tasks, num_tasks, keyword, result_ids);
+    }
+    search_task_weights(tasks, num_tasks, weights);
+
+    // Compila a palavra-chave uma vez; as threads do pool partilham o Matcher (só leitura).
+    Matcher matcher;
+    const Matcher* m = (matcher_init(&matcher, keyword) == 0) ? &matcher : NULL;
+    PoolScan scan = { tasks, m, keyword };
+
+    int count = 0;
+    if (search_pool_run(&search_pool, num_tasks, weights, pool_scan_task, &scan, matched) == 0) {
+        for (int i = 0; i < num_tasks; i++) {
+            if (matched[i]) result_ids[count++] = tasks[i].id;
+        }
+    } else {
+        count = search_tasks_serial(tasks, num_tasks, m, keyword, result_ids);
+    }
+
+    if (m) matcher_destroy(&matcher);
+    free(weights);
+    free(matched);
+    return count;
+}
+
+
+/**
+ * @brief Marca, com o índice invertido, os documentos sem nenhuma das palavras-chave de um MULTI_SEARCH.
+ *
+ * Só atua quando o índice está ativo e todas as palavras-chave podem ser respondidas por ele
+ * (ver `index_can_answer`). O índice diz que documentos contêm cada palavra-chave, mas não em
+ * quantas linhas: os documentos indexados que não contêm nenhuma ficam SEARCH_TASK_INDEX_MISS
+ * e não são lidos (sem `stat`, ver `resolve_search_tasks_with_index`); os restantes ficam
+ * SEARCH_TASK_SCAN. Deve ser chamada com o store_lock adquirido.
+ */
+static void prune_multi_search_tasks(const char* const* keywords, int num, SearchTask* tasks, int num_tasks) {
+    if (!index_enabled) return;
+    for (int k = 0; k < num; k++) {
+        if (!index_can_answer(keywords[k])) return;
+    }
+
+    int max_hits = search_index.max_doc_id + 1;
+    int* hits = malloc(max_hits * sizeof(int));
+    unsigned char* any_hit = calloc(max_hits, 1); // any_hit[id]: o documento contém alguma palavra-chave.
+    int ok = (hits && any_hit);
+    for (int k = 0; ok && k < num; k++) {
+        int num_hits = index_search(&search_index, keywords[k], hits, max_hits);
+        if (num_hits < 0) ok = 0;
+        for (int i = 0; i < num_hits; i++) any_hit[hits[i]] = 1;
+    }
+    for (int i = 0; ok && i < num_tasks; i++) {
+        if (tasks[i].id < max_hits && !any_hit[tasks[i].id] && index_has_document(&search_index, tasks[i].id)) {
+            tasks[i].index_state = SEARCH_TASK_INDEX_MISS;
+        }
+    }
+    free(hits);
+    free(any_hit);
+}
+
+/**
+ * @brief Contagem não nula de uma palavra-chave num documento de um MULTI_SEARCH.
+ */
+typedef struct {
+    int keyword;                // Posição da palavra-chave no lote.
+    int count;                  // Número de linhas (> 0).
+} KeywordCount;
+
+/**
+ * @brief Contexto de um MULTI_SEARCH (ver `multi_search_documents`).
+ *
+ * Só as contagens não nulas são guardadas, uma lista por tarefa: uma matriz densa
+ * documentos x palavras-chave seria quase toda zeros e, com muitos documentos, ocuparia GiB.
+ */
+typedef struct {
+    const SearchTask* tasks;
+    const MultiMatcher* mm;
+    KeywordCount** hits;        // Contagens não nulas de cada tarefa (NULL se nenhuma).
+    int* num_hits;              // Número de elementos de hits[i].
+    int failed;                 // 1 se faltou memória para alguma lista.
+} MultiSearchScan;
+
+/**
+ * @brief Conta as linhas de todas as palavras-chave no documento de uma tarefa (numa thread do pool ou na atual).
+ *
+ * @return 1 se o documento contém alguma palavra-chave, 0 caso contrário.
+ */
+static int multi_search_task(int item, void* ctx) {
+    MultiSearchScan* scan = ctx;
+    long counts[MULTI_SEARCH_MAX_KEYWORDS];
+    if (scan->tasks[item].index_state == SEARCH_TASK_INDEX_MISS) return 0;
+    if (count_lines_with_multi_matcher(scan->tasks[item].path, scan->mm, 0, counts) != 0) return 0;
+
+    int found = 0;
+    for (int k = 0; k < scan->mm->num_keywords; k++) found += (counts[k] > 0);
+    if (found == 0) return 0;
+    KeywordCount* hits = malloc(found * sizeof(KeywordCount));
+    if (!hits) {
+        __atomic_store_n(&scan->failed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    int pos = 0;
+    for (int k = 0; k < scan->mm->num_keywords; k++) {
+        if (counts[k] > 0) hits[pos++] = (KeywordCount){ k, (int)counts[k] };
+    }
+    scan->hits[item] = hits;
+    scan->num_hits[item] = found;
+    return 1;
+}
+
+/**
+ * @brief Conta as linhas de várias palavras-chave em todos os documentos (MULTI_SEARCH).
+ *
+ * As palavras-chave chegam depois do pedido. Cada documento é lido uma só vez
+ * para todas elas (ver Multi_Matcher.h): o custo cresce com o tamanho dos ficheiros e não com
+ * o número de palavras-chave. Como em SEARCH_DOCS, o store_lock só é mantido enquanto se
+ * copia a lista de documentos e se consulta o índice (ver `prune_multi_search_tasks`), e os
+ * documentos são lidos pelo pool de pesquisa se `nr_processes` > 1.
+ *
+ * Gere o store_lock sozinha.
+ *
+ * @param req O pedido (origem do lote, número de palavras-chave e `nr_processes`).
+ * @param resp Recebe o estado e os resultados (ver MULTI_SEARCH em Document_Struct.h).
+ */
+void multi_search_documents(const Request* req, Response* resp) {
+    BatchInput in;
+    if (open_batch_input(req, MAX_KEYWORD_SIZE, &in) != 0) {
+        resp->status = -5;
+        return;
+    }
+    int n = req->batch_size;
+    if (n <= 0 || n > MULTI_SEARCH_MAX_KEYWORDS) {
+        close_batch_input(&in);
+        resp->status = -2;
+        return;
+    }
+    char (*items)[MAX_KEYWORD_SIZE] = malloc((size_t)n * MAX_KEYWORD_SIZE);
+    const char** keywords = malloc(n * sizeof(char*));
+    if (!items || !keywords) {
+        perror("Erro ao alocar memória para o lote");
+        close_batch_input(&in);
+        free(items);
+        free(keywords);
+        resp->status = -5;
+        return;
+    }
+    int got = read_batch_items(&in, items, MAX_KEYWORD_SIZE, n);
+    close_batch_input(&in);
+    for (int k = 0; k < got; k++) {
+        items[k][MAX_KEYWORD_SIZE - 1] = '\0'; // Os dados vêm de outro processo.
+        keywords[k] = items[k];
+    }
+
+    MultiMatcher mm;
+    int have_matcher = (got > 0 && multi_matcher_init(&mm, keywords, got) == 0);
+    SearchTask* tasks = NULL;
+    int num_tasks = 0;
+    if (have_matcher) {
+        pthread_rwlock_rdlock(&store_lock);
+        int max_tasks = doc_table.capacity;
+        tasks = malloc(max_tasks * sizeof(SearchTask));
+        if (tasks) {
+            num_tasks = collect_search_tasks(tasks, max_tasks);
+            prune_multi_search_tasks(keywords, got, tasks, num_tasks);
+        }
+        pthread_rwlock_unlock(&store_lock);
+    }
+
+    KeywordCount** hits = calloc(num_tasks + 1, sizeof(KeywordCount*)); // +1: nunca calloc(0).
+    int* num_hits = calloc(num_tasks + 1, sizeof(int));
+    long* weights = malloc((num_tasks + 1) * sizeof(long));
+    unsigned char* matched = malloc(num_tasks + 1);
+    if ((got > 0 && !have_matcher) || (have_matcher && !tasks) || !hits || !num_hits || !weights || !matched) {
+        perror("Erro ao preparar a pesquisa de várias palavras-chave");
+        if (have_matcher) multi_matcher_destroy(&mm);
+        free(items);
+        free(keywords);
+        free(tasks);
+        free(hits);
+        free(num_hits);
+        free(weights);
+        free(matched);
+        resp->status = -5;
+        return;
+    }
+
+    MultiSearchScan scan = { tasks, &mm, hits, num_hits, 0 };
+    int parallel = (req->nr_processes > 1 && num_tasks > SEARCH_SERIAL_THRESHOLD_TASKS && search_pool.num_threads > 0);
+    if (parallel) search_task_weights(tasks, num_tasks, weights);
+    if (!parallel || search_pool_run(&search_pool, num_tasks, weights, multi_search_task, &scan, matched) != 0) {
+        for (int i = 0; i < num_tasks; i++) multi_search_task(i, &scan);
+    }
+
+    // Para cada palavra-chave: o número de documentos e os pares (ID, linhas), por ordem de ID.
+    // As listas das tarefas (por ordem de ID) são distribuídas pelas posições de cada palavra-chave.
+    size_t* next = calloc(n, sizeof(size_t)); // Próxima posição livre de cada palavra-chave.
+    size_t total = n;
+    for (int i = 0; i < num_tasks; i++) total += 2 * (size_t)num_hits[i];
+    int* ids = (next && !scan.failed) ? malloc(total * sizeof(int)) : NULL;
+    if (ids) {
+        for (int i = 0; i < num_tasks; i++) {
+            for (int h = 0; h < num_hits[i]; h++) next[hits[i][h].keyword]++;
+        }
+        size_t pos = 0;
+        for (int k = 0; k < n; k++) {
+            size_t documents = next[k];
+            ids[pos] = (int)documents;
+            next[k] = pos + 1;
+            pos += 1 + 2 * documents;
+        }
+        for (int i = 0; i < num_tasks; i++) {
+            for (int h = 0; h < num_hits[i]; h++) {
+                size_t at = next[hits[i][h].keyword];
+                ids[at] = tasks[i].id;
+                ids[at + 1] = hits[i][h].count;
+                next[hits[i][h].keyword] = at + 2;
+            }
+        }
+    }
+
+    if (have_matcher) multi_matcher_destroy(&mm);
+    for (int i = 0; i < num_tasks; i++) free(hits[i]);
+    free(items);
+    free(keywords);
+    free(tasks);
+    free(hits);
+    free(num_hits);
+    free(next);
+    free(weights);
+    free(matched);
+    resp->ids = ids;
+    resp->num_ids = ids ? (int)total : 0;
+    resp->status = !ids ? -5 : (got < n) ? -6 : 0;
+}
+
+/**
+ * @brief Lista de documentos de um termo de uma consulta, obtida do índice (ver `resolve_query_with_index`).
+ *
+ * Exata se o índice pode responder ao termo (`index_can_answer`); para um termo literal com
+ * outros caracteres (ex: uma frase), os candidatos com todas as suas palavras
+ * (`index_search_words`); caso contrário, todos os documentos. Fica restrita ao universo.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int query_term_postings(const char* term, const IdList* universe, IdList* out, int* exact) {
+    *exact = index_can_answer(term);
+    Matcher matcher;
+    int literal = *exact;
+    if (!literal && matcher_init(&matcher, term) == 0) {
+        literal = matcher.is_literal;
+        matcher_destroy(&matcher);
+    }
+    IdList hits = { NULL, 0 };
+    if (literal) {
+        int max_hits = search_index.max_doc_id + 1;
+        hits.ids = malloc(max_hits * sizeof(int));
+        if (!hits.ids) return -1;
+        hits.count = *exact ? index_search(&search_index, term, hits.ids, max_hits)
+                            : index_search_words(&search_index, term, hits.ids, max_hits);
+    }
+    if (hits.count < 0 || !literal) { // Sem informação do índice: qualquer documento.
+        free(hits.ids);
+        *exact = 0;
+        out->count = universe->count;
+        out->ids = malloc((universe->count + 1) * sizeof(int));
+        if (!out->ids) return -1;
+        memcpy(out->ids, universe->ids, universe->count * sizeof(int));
+        return 0;
+    }
+    int result = id_list_intersect(&hits, universe, out);
+    free(hits.ids);
+    return result;
+}
+
+/**
+ * @brief Resolve, com o índice invertido, as tarefas de uma consulta que não precisam de ler o ficheiro.
+ *
+ * Os documentos indexados formam o universo; a consulta é avaliada sobre as listas de cada
+ * termo (ver `search_query_eval_lists`). Se o resultado for exato, os documentos ficam
+ * SEARCH_TASK_INDEX_HIT ou _MISS; se for só um superconjunto, os documentos fora dele ficam
+ * SEARCH_TASK_INDEX_MISS e os restantes são lidos. Como em `resolve_search_tasks_with_index`,
+ * só os documentos do resultado são verificados com `stat`: os alterados desde a indexação
+ * ficam SEARCH_TASK_SCAN, tal como os que não estão no índice. Se faltar memória, todas as
+ * tarefas ficam SEARCH_TASK_SCAN. Deve ser chamada com o store_lock adquirido.
+ */
+static void resolve_query_with_index(const SearchQuery* query, SearchTask* tasks, int num_tasks) {
+    if (!index_enabled) return;
+
+    IdList universe = { malloc((num_tasks + 1) * sizeof(int)), 0 };
+    IdList* terms = calloc(query->num_terms, sizeof(IdList));
+    int* exact = malloc(query->num_terms * sizeof(int));
+    int ok = (universe.ids && terms && exact);
+    for (int i = 0; ok && i < num_tasks; i++) {
+        if (index_has_document(&search_index, tasks[i].id)) universe.ids[universe.count++] = tasks[i].id;
+    }
+    for (int t = 0; ok && t < query->num_terms; t++) {
+        ok = (query_term_postings(query->terms[t], &universe, &terms[t], &exact[t]) == 0);
+    }
+
+    IdList result;
+    int result_exact;
+    if (ok && search_query_eval_lists(query, terms, exact, &universe, &result, &result_exact) == 0) {
+        // Tarefas e listas estão por ordem de ID: percorre-as em paralelo.
+        int u = 0, r = 0;
+        for (int i = 0; i < num_tasks; i++) {
+            if (u == universe.count || universe.ids[u] != tasks[i].id) continue; // Fora do índice: lê-se.
+            u++;
+            while (r < result.count && result.ids[r] < tasks[i].id) r++;
+            if (r == result.count || result.ids[r] != tasks[i].id) {
+                tasks[i].index_state = SEARCH_TASK_INDEX_MISS;
+                continue;
+            }
+            char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+            snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, tasks[i].path);
+            if (result_exact && index_document_is_current(&search_index, tasks[i].id, full_path)) {
+                tasks[i].index_state = SEARCH_TASK_INDEX_HIT;
+            } // Superconjunto ou candidato alterado: lê-se.
+        }
+        free(result.ids);
+    }
+    for (int t = 0; terms && t < query->num_terms; t++) free(terms[t].ids);
+    free(terms);
+    free(exact);
+    free(universe.ids);
+}
+
+/**
+ * @brief Contexto de um SEARCH_QUERY (ver `search_query_documents`).
+ */
+typedef struct {
+    const SearchTask* tasks;
+    const SearchQuery* query;
+    const MultiMatcher* mm;     // Termos da consulta, pela ordem de query->terms.
+} QueryScan;
+
+/**
+ * @brief Indica se o documento de uma tarefa corresponde à consulta (numa thread do pool ou na atual).
+ *
+ * Os termos são todos procurados numa só passagem pelo ficheiro; cada um pára na primeira
+ * linha encontrada (equivalente a 'grep -q').
+ */
+static int query_scan_task(int item, void* ctx) {
+    const QueryScan* scan = ctx;
+    const SearchTask* task = &scan->tasks[item];
+    if (task->index_state == SEARCH_TASK_INDEX_HIT) return 1;
+    if (task->index_state == SEARCH_TASK_INDEX_MISS) return 0;
+
+    long counts[QUERY_MAX_TERMS];
+    unsigned char found[QUERY_MAX_TERMS];
+    count_lines_with_multi_matcher(task->path, scan->mm, 1, counts); // Em caso de erro, -1: nenhum termo.
+    for (int t = 0; t < scan->query->num_terms; t++) found[t] = (counts[t] > 0);
+    return search_query_matches(scan->query, found);
+}
+
+/**
+ * @brief Procura os documentos que correspondem a uma consulta booleana/de frase (SEARCH_QUERY).
+ *
+ * O texto da consulta chega depois do pedido (ver Search_Query.h). Com o índice
+ * ativo, a consulta é avaliada sobre as listas de documentos de cada termo e só os documentos
+ * que o índice não resolve são lidos (ver `resolve_query_with_index`); sem índice, cada
+ * documento é lido uma só vez para todos os termos. Como em SEARCH_DOCS, o store_lock só é
+ * mantido enquanto se copia a lista de documentos e se consulta o índice, e os documentos
+ * são lidos pelo pool de pesquisa se `nr_processes` > 1.
+ *
+ * Gere o store_lock sozinha.
+ *
+ * @param req O pedido (origem do lote, tamanho da consulta e `nr_processes`).
+ * @param resp Recebe o estado e os IDs encontrados, por ordem crescente.
+ */
+void search_query_documents(const Request* req, Response* resp) {
+    BatchInput in;
+    if (open_batch_input(req, 1, &in) != 0) {
+        resp->status = -5;
+        return;
+    }
+    int n = req->batch_size;
+    if (n <= 0 || n >= MAX_QUERY_SIZE) {
+        close_batch_input(&in);
+        resp->status = -2;
+        return;
+    }
+    char text[MAX_QUERY_SIZE];
+    int got = read_batch_items(&in, text, 1, n);
+    close_batch_input(&in);
+    if (got < n) {
+        resp->status = -6;
+        return;
+    }
+    text[got] = '\0';
+
+    SearchQuery* query = malloc(sizeof(SearchQuery));
+    const char* keywords[QUERY_MAX_TERMS];
+    char error[128];
+    if (!query) {
+        resp->status = -5;
+        return;
+    }
+    if (search_query_parse(text, query, error, sizeof(error)) != 0) {
+        char msg[MAX_QUERY_SIZE + 192];
+        snprintf(msg, sizeof(msg), "Consulta inválida do cliente %d (%s): %s\n", req->client_pid, error, text);
+        write(STDERR_FILENO, msg, strlen(msg));
+        free(query);
+        resp->status = -2;
+        return;
+    }
+    for (int t = 0; t < query->num_terms; t++) keywords[t] = query->terms[t];
+    MultiMatcher mm;
+    if (multi_matcher_init(&mm, keywords, query->num_terms) != 0) {
+        free(query);
+        resp->status = -5;
+        return;
+    }
+
+    pthread_rwlock_rdlock(&store_lock);
+    int max_tasks = doc_table.capacity;
+    SearchTask* tasks = malloc(max_tasks * sizeof(SearchTask));
+    int num_tasks = 0;
+    if (tasks) {
+        num_tasks = collect_search_tasks(tasks, max_tasks);
+        resolve_query_with_index(query, tasks, num_tasks);
+    }
+    pthread_rwlock_unlock(&store_lock);
+
+    int* ids = malloc((num_tasks + 1) * sizeof(int));
+    long* weights = malloc((num_tasks + 1) * sizeof(long));
+    unsigned char* matched = malloc(num_tasks + 1);
+    if (!tasks || !ids || !weights || !matched) {
+        perror("Erro ao preparar a consulta");
+        multi_matcher_destroy(&mm);
+        free(query);
+        free(tasks);
+        free(ids);
+        free(weights);
+        free(matched);
+        resp->status = -5;
+        return;
+    }
+
+    QueryScan scan = { tasks, query, &mm };
+    int parallel = (req->nr_processes > 1 && num_tasks > SEARCH_SERIAL_THRESHOLD_TASKS && search_pool.num_threads > 0);
+    if (parallel) search_task_weights(tasks, num_tasks, weights);
+    if (!parallel || search_pool_run(&search_pool, num_tasks, weights, query_scan_task, &scan, matched) != 0) {
+        for (int i = 0; i < num_tasks; i++) matched[i] = query_scan_task(i, &scan);
+    }
+    int count = 0;
+    for (int i = 0; i < num_tasks; i++) {
+        if (matched[i]) ids[count++] = tasks[i].id;
+    }
+
+    multi_matcher_destroy(&mm);
+    free(query);
+    free(tasks);
+    free(weights);
+    free(matched);
+    if (count > 0) {
+        resp->ids = ids;
+    } else {
+        free(ids);
+    }
+    resp->num_ids = count;
+    resp->status = 0;
+}
+
+/**
+ * @brief Contexto de um RANKED_SEARCH (ver `ranked_search_documents`).
+ *
+ * Cada documento é pontuado assim que as suas frequências são conhecidas (pelo índice ou ao
+ * ler o ficheiro) e vai logo para o TopK: não há nenhum array por documento da coleção além
+ * da lista de tarefas.
+ */
+typedef struct {
+    const SearchTask* tasks;
+    const Matcher* matcher;     // Palavra-chave (NULL: não suportada em processo).
+    const char* keyword;
+    const char* const* words;   // Palavras da palavra-chave (0 palavras: pontuação por linhas).
+    int num_words;
+    int single_word;            // A palavra-chave é uma só palavra: tf > 0 equivale a conter a palavra-chave.
+    const long* weights;        // Tamanho do ficheiro de cada tarefa (`search_task_weights`).
+    int collect_stats;          // 1 na primeira passagem sem índice: só acumula as estatísticas da coleção.
+    int64_t total_length;       // Primeira passagem: soma dos comprimentos dos documentos.
+    long doc_freqs[RANK_MAX_WORDS]; // Primeira passagem: documentos com cada palavra.
+    long num_matched;           // Sem palavras: documentos com a palavra-chave (df).
+    double idfs[RANK_MAX_WORDS];
+    double avg_length;          // Comprimento médio dos documentos da coleção.
+    TopK top;
+    pthread_mutex_t top_mutex;  // Protege `top` (as tarefas correm nas threads do pool).
+} RankScan;
+
+/**
+ * @brief Pontuação BM25 de um documento, com as estatísticas da coleção já em `scan`.
+ */
+static double rank_score(const RankScan* scan, const long* tfs, int64_t length) {
+    double score = 0.0;
+    for (int w = 0; w < scan->num_words; w++) {
+        score += bm25_term_score(scan->idfs[w], tfs[w], length, scan->avg_length);
+    }
+    return score;
+}
+
+static void rank_push(RankScan* scan, int id, double score) {
+    pthread_mutex_lock(&scan->top_mutex);
+    top_k_push(&scan->top, id, score);
+    pthread_mutex_unlock(&scan->top_mutex);
+}
+
+/**
+ * @brief Obtém do índice as estatísticas da coleção e pontua os documentos atualizados (ver `ranked_search_documents`).
+ *
+ * Os documentos indexados a que falta alguma palavra ficam SEARCH_TASK_INDEX_MISS; os que as
+ * têm todas e não mudaram desde a indexação ficam SEARCH_TASK_INDEX_HIT (com a pontuação em
+ * `score`); os restantes ficam SEARCH_TASK_SCAN e são lidos e pontuados com as mesmas
+ * estatísticas. As listas de documentos de cada palavra
+ * são percorridas em paralelo com as tarefas (ambas por ordem de ID). Deve ser chamada com o
+ * store_lock adquirido.
+ *
+ * @return 1 se o índice foi usado, 0 caso contrário (sem índice ou sem memória).
+ */
+static int resolve_ranked_tasks_with_index(RankScan* scan, SearchTask* tasks, int num_tasks) {
+    if (!index_enabled || search_index.num_docs == 0) return 0;
+
+    int max_hits = search_index.max_doc_id + 1;
+    int* hits[RANK_MAX_WORDS];
+    int* hit_tfs[RANK_MAX_WORDS];
+    int num_hits[RANK_MAX_WORDS];
+    int ok = 1, w;
+    for (w = 0; ok && w < scan->num_words; w++) {
+        hits[w] = malloc(max_hits * sizeof(int));
+        hit_tfs[w] = malloc(max_hits * sizeof(int));
+        num_hits[w] = (hits[w] && hit_tfs[w]) ? index_term_frequencies(&search_index, scan->words[w], hits[w], hit_tfs[w], max_hits) : -1;
+        ok = (num_hits[w] >= 0);
+    }
+    int num_lists = w; // Listas alocadas (a última pode ter falhado).
+
+    if (ok) {
+        scan->avg_length = (double)search_index.total_length / search_index.num_docs;
+        for (w = 0; w < scan->num_words; w++) scan->idfs[w] = bm25_idf(search_index.num_docs, num_hits[w]);
+
+        int cursor[RANK_MAX_WORDS] = { 0 };
+        long tfs[RANK_MAX_WORDS];
+        for (int i = 0; i < num_tasks; i++) {
+            int present = 1;
+            for (w = 0; w < scan->num_words; w++) {
+                while (cursor[w] < num_hits[w] && hits[w][cursor[w]] < tasks[i].id) cursor[w]++;
+                int found = (cursor[w] < num_hits[w] && hits[w][cursor[w]] == tasks[i].id);
+                tfs[w] = found ? hit_tfs[w][cursor[w]] : 0;
+                present &= found;
+            }
+            if (!present) { // Só os candidatos são verificados com `stat` (ver `resolve_search_tasks_with_index`).
+                if (index_has_document(&search_index, tasks[i].id)) tasks[i].index_state = SEARCH_TASK_INDEX_MISS;
+                continue;
+            }
+            char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+            snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, tasks[i].path);
+            if (!index_document_is_current(&search_index, tasks[i].id, full_path)) continue; // Alterado: lê-se.
+            tasks[i].index_state = SEARCH_TASK_INDEX_HIT;
+            tasks[i].score = rank_score(scan, tfs, index_document_length(&search_index, tasks[i].id));
+        }
+    }
+    for (w = 0; w < num_lists; w++) {
+        free(hits[w]);
+        free(hit_tfs[w]);
+    }
+    return ok;
+}
+
+/**
+ * @brief Pontua o documento de uma tarefa e põe-no no TopK se contiver a palavra-chave (numa thread do pool ou na atual).
+ *
+ * Com palavras, os documentos por ler são tokenizados como no índice
+ * (`index_file_term_frequencies`); se a palavra-chave não for uma só palavra, os que têm
+ * todas as palavras ainda são confirmados com o Matcher (ex: "New York" em linhas diferentes).
+ * Sem palavras (expressões regulares), a frequência é o número de linhas com a palavra-chave e
+ * a pontuação entra sem o IDF, que é o mesmo para todos (ver `ranked_search_documents`).
+ * Com `collect_stats`, só acumula o comprimento e as palavras do documento.
+ *
+ * @return 1 se o documento contém a palavra-chave, 0 caso contrário.
+ */
+static int rank_scan_task(int item, void* ctx) {
+    RankScan* scan = ctx;
+    const SearchTask* task = &scan->tasks[item];
+    if (scan->num_words == 0) {
+        long lines = count_lines_with_matcher(task->path, scan->matcher, scan->keyword, 0);
+        if (lines <= 0) return 0;
+        __atomic_fetch_add(&scan->num_matched, 1, __ATOMIC_RELAXED);
+        rank_push(scan, task->id, bm25_term_score(1.0, lines, scan->weights[item], scan->avg_length));
+        return 1;
+    }
+
+    if (task->index_state == SEARCH_TASK_INDEX_MISS) return 0;
+    double score = task->score;
+    if (task->index_state == SEARCH_TASK_SCAN) {
+        char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+        long tfs[RANK_MAX_WORDS];
+        int64_t length;
+        snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, task->path);
+        if (index_file_term_frequencies(full_path, scan->words, scan->num_words, tfs, &length) != 0) return 0;
+        server_metrics_add_bytes(&metrics, scan->weights[item]);
+        if (scan->collect_stats) {
+            __atomic_fetch_add(&scan->total_length, length, __ATOMIC_RELAXED);
+            for (int w = 0; w < scan->num_words; w++) {
+                if (tfs[w] > 0) __atomic_fetch_add(&scan->doc_freqs[w], 1, __ATOMIC_RELAXED);
+            }
+            return 0;
+        }
+        for (int w = 0; w < scan->num_words; w++) {
+            if (tfs[w] == 0) return 0;
+        }
+        score = rank_score(scan, tfs, length);
+    }
+    if (!scan->single_word && count_lines_with_matcher(task->path, scan->matcher, scan->keyword, 1) <= 0) return 0;
+    rank_push(scan, task->id, score);
+    return 1;
+}
+
+/**
+ * @brief Corre `rank_scan_task` em todas as tarefas (no pool de pesquisa se `parallel`).
+ */
+static void run_rank_scan(RankScan* scan, int num_tasks, const long* weights, unsigned char* matched, int parallel) {
+    if (!parallel || search_pool_run(&search_pool, num_tasks, weights, rank_scan_task, scan, matched) != 0) {
+        for (int i = 0; i < num_tasks; i++) matched[i] = rank_scan_task(i, scan);
+    }
+}
+
+/**
+ * @brief Devolve os k documentos mais relevantes para uma palavra-chave (RANKED_SEARCH).
+ *
+ * Os documentos considerados são os mesmos de SEARCH_DOCS e são pontuados com o BM25 (ver
+ * Ranking.h). Se a palavra-chave for literal, cada uma das suas palavras (sequências de bytes
+ * de termo, como no índice) é um termo do BM25: com o índice ativo, as frequências, os
+ * comprimentos e as estatísticas da coleção vêm dele e só os documentos alterados desde a
+ * indexação (pontuados com as estatísticas do índice) ou, numa frase, os candidatos a
+ * confirmar são lidos; sem índice, os documentos são lidos duas vezes: a primeira só para as
+ * estatísticas da coleção, a segunda para os pontuar. Para as restantes palavras-chave, a
+ * frequência é o número de linhas e o comprimento o tamanho do ficheiro; como só há um termo,
+ * o IDF multiplica todas as pontuações por igual e é aplicado no fim, aos k melhores.
+ * Cada documento pontuado vai logo para o TopK (O(k) de memória além da lista de tarefas);
+ * o empate é desfeito pelo menor ID.
+ *
+ * Como em SEARCH_DOCS, o store_lock só é mantido enquanto se copia a lista de documentos e se
+ * consulta o índice, e os documentos são lidos pelo pool de pesquisa se `nr_processes` > 1.
+ * Gere o store_lock sozinha.
+ *
+ * @param req O pedido (palavra-chave, `top_k` e `nr_processes`).
+ * @param resp Recebe o estado e os pares (ID, pontuação em milésimas), do mais relevante para o menos.
+ */
+void ranked_search_documents(const Request* req, Response* resp) {
+    if (req->top_k <= 0) {
+        resp->status = -2;
+        return;
+    }
+    char keyword[MAX_KEYWORD_SIZE];
+    snprintf(keyword, sizeof(keyword), "%.*s", MAX_KEYWORD_SIZE - 1, req->keyword);
+
+    Matcher matcher;
+    const Matcher* m = (matcher_init(&matcher, keyword) == 0) ? &matcher : NULL;
+    char word_buf[RANK_MAX_WORDS][MAX_KEYWORD_SIZE];
+    const char* words[RANK_MAX_WORDS];
+    int num_words = (m && m->is_literal) ? index_text_words(keyword, word_buf, RANK_MAX_WORDS) : 0;
+    for (int w = 0; w < num_words; w++) words[w] = word_buf[w];
+
+    RankScan* scan = calloc(1, sizeof(RankScan));
+    pthread_rwlock_rdlock(&store_lock);
+    int max_tasks = doc_table.capacity;
+    SearchTask* tasks = malloc(max_tasks * sizeof(SearchTask));
+    int num_tasks = 0, used_index = 0;
+    if (scan && tasks) {
+        *scan = (RankScan){ .tasks = tasks, .matcher = m, .keyword = keyword, .words = words, .num_words = num_words,
+                            .single_word = (num_words == 1 && index_can_answer(keyword)) };
+        num_tasks = collect_search_tasks(tasks, max_tasks);
+        if (num_words > 0) used_index = resolve_ranked_tasks_with_index(scan, tasks, num_tasks);
+    }
+    pthread_rwlock_unlock(&store_lock);
+
+    int k = (req->top_k < num_tasks) ? req->top_k : num_tasks;
+    long* weights = malloc((num_tasks + 1) * sizeof(long));
+    unsigned char* matched = malloc(num_tasks + 1);
+    int have_top = (scan && k > 0 && top_k_init(&scan->top, k) == 0);
+    if (!scan || !tasks || !weights || !matched || (k > 0 && !have_top)) {
+        perror("Erro ao preparar a pesquisa ordenada");
+        if (have_top) top_k_free(&scan->top);
+        if (m) matcher_destroy(&matcher);
+        free(scan);
+        free(tasks);
+        free(weights);
+        free(matched);
+        resp->status = -5;
+        return;
+    }
+    pthread_mutex_init(&scan->top_mutex, NULL);
+    search_task_weights(tasks, num_tasks, weights);
+    scan->weights = weights;
+    int parallel = (req->nr_processes > 1 && num_tasks > SEARCH_SERIAL_THRESHOLD_TASKS && search_pool.num_threads > 0);
+
+    // Estatísticas da coleção: as do índice (já em scan), ou as dos documentos da lista.
+    if (num_words == 0) {
+        int64_t total_length = 0;
+        for (int i = 0; i < num_tasks; i++) total_length += weights[i];
+        scan->avg_length = (num_tasks > 0) ? (double)total_length / num_tasks : 0.0;
+    } else if (!used_index) {
+        scan->collect_stats = 1;
+        run_rank_scan(scan, num_tasks, weights, matched, parallel);
+        scan->collect_stats = 0;
+        scan->avg_length = (num_tasks > 0) ? (double)scan->total_length / num_tasks : 0.0;
+        for (int w = 0; w < num_words; w++) scan->idfs[w] = bm25_idf(num_tasks, scan->doc_freqs[w]);
+    }
+    if (k > 0) run_rank_scan(scan, num_tasks, weights, matched, parallel);
+
+    int count = have_top ? top_k_sort(&scan->top) : 0;
+    double idf = (num_words == 0) ? bm25_idf(num_tasks, scan->num_matched) : 1.0;
+    int* ids = (count > 0) ? malloc(2 * count * sizeof(int)) : NULL;
+    if (count > 0 && !ids) perror("Erro ao ordenar a pesquisa");
+    for (int r = 0; ids && r < count; r++) {
+        ids[2 * r] = scan->top.docs[r].id;
+        ids[2 * r + 1] = (int)(scan->top.docs[r].score * idf * RANK_SCORE_SCALE + 0.5);
+    }
+
+    if (have_top) top_k_free(&scan->top);
+    pthread_mutex_destroy(&scan->top_mutex);
+    if (m) matcher_destroy(&matcher);
+    free(scan);
+    free(tasks);
+    free(weights);
+    free(matched);
+    resp->ids = ids;
+    resp->num_ids = ids ? 2 * count : 0;
+    resp->status = (count > 0 && !ids) ? -5 : 0;
+}
+
+/**
+ * @brief Indica se um documento satisfaz um pedido META_SEARCH (sem os índices de metadados).
+ */
+static int meta_document_matches(const Request* req, const Document* doc) {
+    int year;
+    switch (req->meta_field) {
+        case META_AUTHOR: return meta_author_matches(doc->authors, req->doc.authors);
+        case META_YEAR:
+            year = meta_year_value(doc->year);
+            return year >= 0 && year >= req->year_from && year <= req->year_to;
+        default: return meta_title_matches(doc->title, req->doc.title, req->meta_field == META_TITLE_PREFIX);
+    }
+}
+
+static int compare_year_order(const void* a, const void* b) {
+    const Document* x = a;
+    const Document* y = b;
+    int year_x = meta_year_value(x->year), year_y = meta_year_value(y->year);
+    if (year_x != year_y) return (year_x > year_y) - (year_x < year_y);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/**
+ * @brief Procura documentos pelos metadados: autor, intervalo de anos ou título (META_SEARCH).
+ *
+ * Os índices de metadados (ver Meta_Index.h) dão os IDs sem percorrer a coleção; só esses
+ * documentos são lidos, e os candidatos de uma pesquisa no título são confirmados no próprio
+ * título. Se os índices estiverem desativados, todos os documentos são lidos e verificados.
+ * Corre com o store_lock em modo leitura.
+ *
+ * @param req O pedido (campo, texto em `doc.authors` ou `doc.title`, ou o intervalo de anos).
+ * @param resp Recebe o estado e os documentos (ver META_SEARCH em Document_Struct.h).
+ */
+void meta_search_documents(const Request* req, Response* resp) {
+    char text[MAX_TITLE_SIZE + MAX_AUTHORS_SIZE];
+    int valid;
+    switch (req->meta_field) {
+        case META_AUTHOR: valid = meta_normalize(req->doc.authors, MAX_AUTHORS_SIZE, text, sizeof(text)) > 0; break;
+        case META_YEAR: valid = req->year_from <= req->year_to; break;
+        case META_TITLE:
+        case META_TITLE_PREFIX: valid = meta_normalize(req->doc.title, MAX_TITLE_SIZE, text, sizeof(text)) > 0; break;
+        default: valid = 0;
+    }
+    if (!valid) {
+        resp->status = -2;
+        return;
+    }
+
+    int* ids = NULL;
+    int count;
+    int exact = 1;
+    int scanned = !meta_enabled;
+    if (!scanned) {
+        if (req->meta_field == META_AUTHOR) count = meta_index_by_author(&meta_index, req->doc.authors, &ids);
+        else if (req->meta_field == META_YEAR) count = meta_index_by_year(&meta_index, req->year_from, req->year_to, &ids);
+        else count = meta_index_by_title(&meta_index, req->doc.title, req->meta_field == META_TITLE_PREFIX, &ids, &exact);
+    } else {
+        // Sem índices: todos os documentos são candidatos.
+        ids = malloc(((size_t)num_documents + 1) * sizeof(int));
+        count = ids ? 0 : -1;
+        for (int id = 1; ids && id < doc_table.capacity && count < num_documents; id++) {
+            const DocSlot* slot = &doc_table.slots[id];
+            if (slot->cached || slot->disk_offset >= 0) ids[count++] = id;
+        }
+        exact = 0;
+    }
+    Document* docs = (count >= 0) ? malloc(((size_t)count + 1) * sizeof(Document)) : NULL;
+    if (!docs) {
+        perror("Erro ao alocar memória para a pesquisa de metadados");
+        free(ids);
+        resp->status = -5;
+        return;
+    }
+
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        if (find_document(ids[i], &docs[found]) != 0) continue;
+        if (exact || meta_document_matches(req, &docs[found])) found++;
+    }
+    free(ids);
+    if (scanned && req->meta_field == META_YEAR) qsort(docs, found, sizeof(Document), compare_year_order);
+
+    resp->docs = docs;
+    resp->num_docs = found;
+    resp->status = 0;
+}
+
+/**
+ * @brief Sincroniza uma diretoria (torna duráveis as criações e renomeações nela feitas).
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int fsync_directory(const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return -1;
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Compacta o armazenamento: incorpora o log numa nova fotografia "database.bin".
+ *
+ * Escreve o cabeçalho, o registo compacto de cada documento vivo (da cache ou do disco), o
+ * dicionário de autores e os índices de metadados (ver Doc_Record.h) num ficheiro
+ * temporário, que substitui "database.bin" com `rename` (atómico); só depois o log é
+ * esvaziado. Se o processo terminar a meio, o arranque seguinte encontra a fotografia antiga e
+ * o log completo, ou a nova fotografia e um log cujos registos já estão nela (reaplicá-los não
+ * muda nada). A fotografia é sempre escrita no formato atual (é assim que uma fotografia antiga
+ * é migrada). Deve ser chamada com o store_lock em modo escrita.
+ *
+ * @return O número de documentos gravados, ou -1 em caso de erro (fotografia e log anteriores intactos).
+ */
+int compact_store() {
+    const char* tmp_path = "database.bin.tmp";
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Erro ao criar ficheiro temporário da base de dados");
+        return -1;
+    }
+
+    off_t* new_offsets = malloc(doc_table.capacity * sizeof(off_t));
+    unsigned char* buffer = malloc(COMPACT_BUFFER_SIZE);
+    if (!new_offsets || !buffer) {
+        perror("Erro ao alocar memória para a compactação");
+        free(new_offsets);
+        free(buffer);
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    AuthorDict authors;
+    author_dict_init(&authors);
+    // Os índices de metadados são reconstruídos com os documentos gravados (volta a ativá-los
+    // se tinham sido desativados); sem memória, a fotografia é gravada sem eles.
+    MetaIndex meta;
+    int meta_ok = (meta_index_init(&meta) == 0);
+    DbHeader header = { DB_MAGIC, DB_VERSION, next_id, 0, 0, 0, 0, 0 }; // Os restantes campos são escritos no fim.
+    int ok = (write(fd, &header, sizeof(header)) == sizeof(header));
+    off_t offset = sizeof(header);
+    size_t used = 0;
+    int count = 0;
+    for (int id = 0; ok && id < doc_table.capacity; id++) {
+        const DocSlot* slot = &doc_table.slots[id];
+        new_offsets[id] = -1;
+        if (id == 0 || (!slot->cached && slot->disk_offset < 0)) continue;
+
+        Document doc;
+        int64_t author = -1;
+        if (read_slot_document(slot, &doc) == 0) {
+            author = author_dict_intern(&authors, doc.authors, strnlen(doc.authors, MAX_AUTHORS_SIZE));
+        }
+        if (author < 0) {
+            ok = 0; // Nunca perder um documento: aborta e mantém o estado anterior.
+            break;
+        }
+        if (used + DOC_RECORD_MAX > COMPACT_BUFFER_SIZE) {
+            ok = (write(fd, buffer, used) == (ssize_t)used);
+            used = 0;
+        }
+        int len = doc_record_encode(&doc, (uint32_t)author, buffer + used);
+        if (meta_ok && meta_index_add(&meta, &doc) != 0) meta_ok = 0;
+        new_offsets[id] = offset;
+        offset += len;
+        used += len;
+        count++;
+    }
+    if (ok && used > 0) ok = (write(fd, buffer, used) == (ssize_t)used);
+    free(buffer);
+    if (ok) ok = (author_dict_write(&authors, fd) == 0);
+    if (ok && meta_ok) {
+        off_t meta_offset = lseek(fd, 0, SEEK_CUR);
+        ok = (meta_offset > 0 && meta_index_write(&meta, fd) == 0);
+        header.meta_offset = meta_offset;
+    }
+    if (ok) {
+        header.count = count;
+        header.dict_offset = offset;
+        header.dict_count = authors.count;
+        ok = (pwrite(fd, &header, sizeof(header), 0) == sizeof(header));
+    }
+    if (ok) ok = (fsync(fd) == 0);
+    if (close(fd) != 0) ok = 0;
+    if (ok) ok = (rename(tmp_path, "database.bin") == 0);
+    if (!ok) {
+        perror("Erro ao escrever a nova fotografia da base de dados");
+        unlink(tmp_path);
+        free(new_offsets);
+        author_dict_free(&authors);
+        meta_index_free(&meta);
+        return -1;
+    }
+    // O rename tem de ser durável antes de esvaziar o log; se não for, o log fica (reaplicá-lo não muda nada).
+    int durable = (fsync_directory(".") == 0);
+
+    // A nova fotografia está no lugar: os documentos passam a ser lidos dela.
+    close_database_fd();
+    author_dict_free(&db_authors);
+    db_authors = authors;
+    db_version = DB_VERSION;
+    if (meta_ok) {
+        meta_index_free(&meta_index);
+        meta_index = meta;
+        meta_enabled = 1;
+    } else {
+        meta_index_free(&meta);
+    }
+    for (int id = 0; id < doc_table.capacity; id++) {
+        doc_table.slots[id].disk_offset = new_offsets[id];
+        doc_table.slots[id].in_log = 0;
+    }
+    free(new_offsets);
+    if (!durable) {
+        perror("Aviso: erro ao sincronizar a pasta da base de dados; o log não é esvaziado");
+    } else if (doc_log_reset(&doc_log) != 0) {
+        // Não é grave: os registos que ficarem no log já estão na fotografia.
+        perror("Aviso: erro ao esvaziar o log da base de dados");
+    }
+    num_documents = count;
+    store_modified = 0;
+    return count;
+}
+
+/**
+ * @brief Compacta o armazenamento se o log já for maior do que a fotografia (ver LOG_COMPACT_MIN_RECORDS).
+ *
+ * Chamada depois de cada ADD_DOC/DELETE_DOC, com o store_lock em modo escrita.
+ */
+void maybe_compact_store() {
+    if (doc_log.num_records < LOG_COMPACT_MIN_RECORDS || doc_log.num_records <= num_documents) return;
+
+    char msg[128];
+    int len = snprintf(msg, sizeof(msg), "A compactar a base de dados (%d registos no log)...\n", doc_log.num_records);
+    write(STDOUT_FILENO, msg, len);
+    int saved = compact_store();
+    if (saved >= 0) {
+        len = snprintf(msg, sizeof(msg), "Compactação concluída: %d documentos em 'database.bin'.\n", saved);
+        write(STDOUT_FILENO, msg, len);
+    }
+}
+
+/**
+ * @brief Grava a base de dados no encerramento, compactando o log (se houver alterações).
+ */
+void save_documents() {
+    if (doc_log.num_records == 0 && !store_modified) return; // Não há nada para incorporar.
+
+    write(STDOUT_FILENO, "A gravar documentos na base de dados...\n", strlen("A gravar documentos na base de dados...\n"));
+    int saved = compact_store();
+    if (saved < 0) {
+        // O log continua intacto: as alterações serão reaplicadas no próximo arranque.
+        write(STDERR_FILENO, "Erro na compactação; as alterações ficam no log.\n", strlen("Erro na compactação; as alterações ficam no log.\n"));
+        return;
+    }
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Gravados %d documentos com sucesso.\n", saved);
+    write(STDOUT_FILENO, msg, strlen(msg));
+}
+
+/**
+ * @brief Grava todo o estado no encerramento (SHUTDOWN ou SIGINT/SIGTERM): base de dados e índice.
+ *
+ * Deve ser chamada com o store_lock em modo escrita, ou depois de as trabalhadoras terminarem.
+ */
+void persist_state() {
+    if (store_modified || doc_log.num_records > 0) {
+        write(STDOUT_FILENO, "A gravar base de dados...\n", strlen("A gravar base de dados...\n"));
+        save_documents();
+    } else {
+        write(STDOUT_FILENO, "Nenhuma alteração pendente para gravar.\n", strlen("Nenhuma alteração pendente para gravar.\n"));
+    }
+    if (index_enabled && search_index.modified) {
+        if (index_save(&search_index, INDEX_FILE) == 0) {
+            write(STDOUT_FILENO, "Índice de pesquisa gravado em '" INDEX_FILE "'.\n", strlen("Índice de pesquisa gravado em '" INDEX_FILE "'.\n"));
+        } else {
+            perror("Erro ao gravar o índice de pesquisa");
+        }
+    }
+}
+
+/**
+ * @brief Escreve as estatísticas da cache (acertos, falhas, remoções), para ajudar a escolher o seu tamanho.
+ *
+ * Só as consultas por ID (QUERY_DOC e COUNT_LINES) passam pela cache. Inclui também a
+ * utilização da cache de mapeamentos dos ficheiros.
+ */
+void report_cache_stats() {
+    unsigned long lookups = cache.hits + cache.misses;
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg),
+                       "Cache %s (%d/%d documentos): %lu acertos, %lu falhas (taxa de acerto %.1f%%), %lu remoções.\n",
+                       doc_cache_policy_name(cache.policy), cache.num_docs, cache.capacity,
+                       cache.hits, cache.misses, lookups ? 100.0 * cache.hits / lookups : 0.0, cache.evictions);
+    write(STDOUT_FILENO, msg, len);
+
+    if (file_maps_enabled) {
+        len = snprintf(msg, sizeof(msg),
+                       "Mapeamentos (mmap): %d ficheiros (%zu KiB), %lu reutilizados, %lu mapeados, %lu remapeados após alteração.\n",
+                       file_maps.count, file_maps.mapped_bytes / 1024, file_maps.hits, file_maps.misses, file_maps.remaps);
+        write(STDOUT_FILENO, msg, len);
+    }
+    if (search_pool.num_threads > 0) {
+        len = snprintf(msg, sizeof(msg), "Pool de pesquisa: %d threads, %ld documentos roubados entre threads.\n",
+                       search_pool.num_threads, search_pool.steals);
+        write(STDOUT_FILENO, msg, len);
+    }
+    if (result_cache.max_bytes > 0) {
+        len = snprintf(msg, sizeof(msg),
+                       "Cache de resultados (%d entradas, %zu KiB): pesquisas %lu acertos (%lu parciais), %lu falhas; "
+                       "contagens %lu acertos, %lu falhas; %lu invalidadas, %lu removidas.\n",
+                       result_cache.count, result_cache.bytes / 1024, result_cache.search_hits, result_cache.search_partial,
+                       result_cache.search_misses, result_cache.count_hits, result_cache.count_misses,
+                       result_cache.invalidations, result_cache.evictions);
+        write(STDOUT_FILENO, msg, len);
+    }
+}
+
+/**
+ * @brief Thread de sincronização: faz fdatasync do log a cada sync_interval_ms (se houver registos por sincronizar).
+ *
+ * Limita o tempo durante o qual uma alteração confirmada ao cliente pode ser perdida numa
+ * falha do sistema, sem obrigar cada ADD/DELETE a esperar pelo disco.
+ *
+ * @param arg Não usado.
+ * @return NULL.
+ */
+void* sync_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&sync_thread_mutex);
+    while (!sync_thread_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += sync_interval_ms / 1000;
+        deadline.tv_nsec += (long)(sync_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&sync_thread_cond, &sync_thread_mutex, &deadline);
+        if (sync_thread_stop) break;
+
+        pthread_mutex_unlock(&sync_thread_mutex);
+        if (doc_log_sync(&doc_log) != 0) {
+            perror("Erro ao sincronizar o log da base de dados");
+        }
+        pthread_mutex_lock(&sync_thread_mutex);
+    }
+    pthread_mutex_unlock(&sync_thread_mutex);
+    return NULL;
+}
+
+/**
+ * @brief Indexa um bloco de documentos de BULK_ADD (ver index_main).
+ *
+ * Lê os caminhos com o store_lock em leitura, indexa os ficheiros sem o lock num índice
+ * privado e só adquire o lock em escrita para o juntar ao índice do servidor.
+ */
+static void index_document_batch(const int* ids, int n) {
+    Document docs[INDEX_BATCH_DOCS];
+    int found[INDEX_BATCH_DOCS];
+
+    pthread_rwlock_rdlock(&store_lock);
+    int enabled = index_enabled;
+    pthread_mutex_lock(&cache_mutex); // Outros leitores podem estar a colocar documentos na cache.
+    database_fd();
+    for (int i = 0; i < n; i++) {
+        const DocSlot* slot = doc_table_slot(&doc_table, ids[i]);
+        found[i] = slot && (slot->cached || slot->disk_offset >= 0);
+        if (found[i] && slot->path) {
+            snprintf(docs[i].path, MAX_PATH_SIZE, "%s", slot->path); // Só o caminho é preciso.
+        } else if (found[i]) {
+            found[i] = (read_slot_document(slot, &docs[i]) == 0);
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    pthread_rwlock_unlock(&store_lock);
+
+    InvertedIndex batch;
+    if (!enabled || index_init(&batch) != 0) return; // Sem índice, as pesquisas leem os ficheiros.
+    for (int i = 0; i < n; i++) {
+        if (!found[i]) continue; // Já removido.
+        char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+        snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, docs[i].path);
+        index_add_file(&batch, ids[i], full_path); // Um ficheiro ilegível fica fora do índice (é lido nas pesquisas).
+    }
+
+    pthread_rwlock_wrlock(&store_lock);
+    if (index_enabled) {
+        if (index_merge(&search_index, &batch, 0) != 0) {
+            disable_search_index();
+        } else {
+            for (int i = 0; i < n; i++) {
+                const DocSlot* slot = doc_table_slot(&doc_table, ids[i]);
+                if (!slot || (!slot->cached && slot->disk_offset < 0)) {
+                    index_remove_document(&search_index, ids[i]); // Removido enquanto era indexado.
+                }
+            }
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    index_free(&batch);
+}
+
+/**
+ * @brief Thread de indexação em segundo plano dos documentos de BULK_ADD.
+ *
+ * Indexar um lote grande com o store_lock em escrita bloquearia o servidor durante todo o
+ * lote; em vez disso, BULK_ADD só põe os IDs na fila e esta thread indexa-os em blocos de
+ * INDEX_BATCH_DOCS (ver index_document_batch). Até lá, as pesquisas leem os ficheiros desses
+ * documentos, tal como os de qualquer documento fora do índice (ver index_document_is_current).
+ * Os que ficarem na fila ao encerrar são indexados no próximo arranque (ver load_search_index).
+ *
+ * @param arg Não usado.
+ * @return NULL.
+ */
+void* index_main(void* arg) {
+    (void)arg;
+    int ids[INDEX_BATCH_DOCS];
+    pthread_mutex_lock(&index_queue_mutex);
+    for (;;) {
+        while (!index_thread_stop && index_queue_head == index_queue_count) {
+            pthread_cond_wait(&index_queue_cond, &index_queue_mutex);
+        }
+        if (index_thread_stop) break;
+
+        int n = index_queue_count - index_queue_head;
+        if (n > INDEX_BATCH_DOCS) n = INDEX_BATCH_DOCS;
+        memcpy(ids, index_queue + index_queue_head, n * sizeof(int));
+        index_queue_head += n;
+        index_queue_busy = n;
+        pthread_mutex_unlock(&index_queue_mutex);
+
+        index_document_batch(ids, n);
+
+        pthread_mutex_lock(&index_queue_mutex);
+        index_queue_busy = 0;
+    }
+    pthread_mutex_unlock(&index_queue_mutex);
+    return NULL;
+}
+
+/**
+ * @brief Regista um documento lido da fotografia: posição na tabela e, se houver espaço, na cache.
+ *
+ * @param index_meta 1 se o documento deve entrar nos índices de metadados (não lidos da fotografia).
+ * @return 1 se foi colocado na cache, 0 se ficou apenas no disco, -1 se faltar memória.
+ */
+static int load_snapshot_document(const Document* doc, off_t offset, int index_meta) {
+    DocSlot* slot = doc_table_slot_create(&doc_table, doc->id);
+    if (!slot) {
+        perror("Erro de alocação de memória para a tabela de documentos");
+        return -1;
+    }
+    slot->disk_offset = offset;
+    doc_table_set_path(slot, doc->path);
+    num_documents++;
+    if (index_meta && meta_enabled && meta_index_add(&meta_index, doc) != 0) disable_meta_index();
+
+    if (cache.num_docs >= cache.capacity) return 0; // Fica apenas no disco.
+    cache_insert(slot, doc);
+    return 1;
+}
+
+/**
+ * @brief Lê os registos de uma fotografia no formato antigo (Document de tamanho fixo).
+ *
+ * @return O número de documentos colocados na cache.
+ */
+static int load_legacy_documents(int fd, int total_docs_on_disk) {
+    Document doc_from_disk;
+    int loaded_count = 0;
+    for (int i = 0; i < total_docs_on_disk; i++) {
+        off_t offset = 2 * sizeof(int) + (off_t)i * sizeof(Document);
+        if (pread(fd, &doc_from_disk, sizeof(Document), offset) != sizeof(Document)) {
+            write(STDERR_FILENO, "Erro ao ler registo de documento do 'database.bin' ou fim inesperado. Carregamento parcial.\n",
+                strlen("Erro ao ler registo de documento do 'database.bin' ou fim inesperado. Carregamento parcial.\n"));
+            break;
+        }
+        int cached = load_snapshot_document(&doc_from_disk, offset, 1);
+        if (cached < 0) break;
+        loaded_count += cached;
+    }
+    return loaded_count;
+}
+
+/**
+ * @brief Lê os registos compactos de uma fotografia (ver Doc_Record.h).
+ *
+ * Os registos são lidos sequencialmente em blocos de COMPACT_BUFFER_SIZE bytes.
+ *
+ * @param records_offset Offset do primeiro registo (o tamanho do cabeçalho da versão).
+ * @param index_meta 1 se os documentos devem entrar nos índices de metadados (fotografia sem eles).
+ * @return O número de documentos colocados na cache.
+ */
+static int load_compact_documents(int fd, const DbHeader* header, off_t records_offset, int index_meta) {
+    unsigned char* buffer = malloc(COMPACT_BUFFER_SIZE);
+    if (!buffer) {
+        perror("Erro ao alocar memória para o carregamento da base de dados");
+        return 0;
+    }
+    off_t buffer_offset = records_offset; // Offset no ficheiro de buffer[0].
+    size_t have = 0, pos = 0;
+    int loaded_count = 0;
+    for (int i = 0; i < header->count; i++) {
+        off_t next_offset = buffer_offset + (off_t)have;
+        if (have - pos < DOC_RECORD_MAX && next_offset < header->dict_offset) {
+            memmove(buffer, buffer + pos, have - pos);
+            buffer_offset += pos;
+            have -= pos;
+            pos = 0;
+            size_t want = COMPACT_BUFFER_SIZE - have;
+            if ((off_t)want > header->dict_offset - next_offset) want = header->dict_offset - next_offset;
+            ssize_t n = pread(fd, buffer + have, want, next_offset);
+            if (n > 0) have += n;
+        }
+
+        Document doc;
+        int len = doc_record_decode(buffer + pos, have - pos, &db_authors, &doc);
+        if (len < 0) {
+            write(STDERR_FILENO, "Erro ao ler registo de documento do 'database.bin' ou fim inesperado. Carregamento parcial.\n",
+                strlen("Erro ao ler registo de documento do 'database.bin' ou fim inesperado. Carregamento parcial.\n"));
+            break;
+        }
+        int cached = load_snapshot_document(&doc, buffer_offset + (off_t)pos, index_meta);
+        if (cached < 0) break;
+        loaded_count += cached;
+        pos += len;
+    }
+    free(buffer);
+    return loaded_count;
+}
+
+/**
+ * @brief Carrega os documentos da fotografia "database.bin" para a cache.
+ *
+ * As alterações posteriores à fotografia estão no log e são aplicadas a seguir por `replay_log`.
+ * Lê o cabeçalho (`next_id` e o número total de documentos) e depois cada documento,
+ * adicionando-os à cache até ao limite da cache. O offset de todos os registos
+ * (incluindo os que não cabem na cache) fica guardado na tabela de documentos.
+ * Uma fotografia no formato antigo é lida como tal (ver `migrate_store`). Os índices de
+ * metadados são lidos da fotografia ou, se ela não os tiver (ou estiverem ilegíveis),
+ * construídos a partir dos documentos lidos.
+ *
+ * @return 0 em caso de sucesso (ou fotografia inexistente), -1 se a fotografia não puder ser
+ * usada sem risco de a reescrever por cima (versão desconhecida ou dicionário ilegível).
+ */
+int load_documents() {
+    int fd = open("database.bin", O_RDONLY);
+    next_id = 1; // Valor por defeito se o ficheiro não existir.
+    store_modified = 0;
+    db_version = 0;
+    meta_index_free(&meta_index);
+    meta_enabled = (meta_index_init(&meta_index) == 0);
+
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            write(STDOUT_FILENO, "Ficheiro da base de dados 'database.bin' não encontrado. A iniciar com estado vazio.\n",
+                strlen("Ficheiro da base de dados 'database.bin' não encontrado. A iniciar com estado vazio.\n"));
+        } else {
+            perror("Erro ao tentar abrir 'database.bin' para leitura");
+        }
+        return 0;
+    }
+
+    write(STDOUT_FILENO, "A carregar documentos do disco ('database.bin')...\n", strlen("A carregar documentos do disco ('database.bin')...\n"));
+
+    DbHeader header;
+    ssize_t header_len = pread(fd, &header, sizeof(header), 0);
+    int legacy_header[2]; // Formato antigo: next_id e número de documentos.
+    memcpy(legacy_header, &header, sizeof(legacy_header));
+    off_t records_offset = sizeof(header);
+    int meta_loaded = 0;
+    if (header_len >= (ssize_t)sizeof(uint32_t) && header.magic == DB_MAGIC) {
+        char msg[160];
+        int compact_v2 = (header_len >= DB_HEADER_V2_SIZE && header.version == DB_VERSION_COMPACT_V2);
+        if (!compact_v2 && (header_len != sizeof(header) || header.version != DB_VERSION)) {
+            snprintf(msg, sizeof(msg), "Formato de 'database.bin' não suportado (versão %u). O servidor não arranca para não o reescrever.\n",
+                     header_len >= DB_HEADER_V2_SIZE ? header.version : 0);
+            write(STDERR_FILENO, msg, strlen(msg));
+            close(fd);
+            return -1;
+        }
+        if (author_dict_read(&db_authors, fd, header.dict_offset, header.dict_count) != 0) {
+            write(STDERR_FILENO, "Erro ao ler o dicionário de autores do 'database.bin'. O servidor não arranca para não o reescrever.\n",
+                strlen("Erro ao ler o dicionário de autores do 'database.bin'. O servidor não arranca para não o reescrever.\n"));
+            close(fd);
+            return -1;
+        }
+        if (compact_v2) {
+            records_offset = DB_HEADER_V2_SIZE;
+            header.meta_offset = 0; // Ainda sem índices de metadados: são construídos abaixo.
+        }
+        if (meta_enabled && header.meta_offset > 0) {
+            meta_loaded = (meta_index_read(&meta_index, fd, header.meta_offset) == 0);
+            if (!meta_loaded) {
+                write(STDERR_FILENO, "Aviso: índices de metadados do 'database.bin' ilegíveis. A reconstruí-los.\n",
+                    strlen("Aviso: índices de metadados do 'database.bin' ilegíveis. A reconstruí-los.\n"));
+                meta_index_free(&meta_index);
+                meta_enabled = (meta_index_init(&meta_index) == 0);
+            }
+        }
+        db_version = header.version;
+        next_id = header.next_id;
+    } else if (header_len >= (ssize_t)sizeof(legacy_header)) {
+        db_version = DB_VERSION_LEGACY;
+        next_id = legacy_header[0];
+        header.count = legacy_header[1];
+    } else {
+        write(STDERR_FILENO, "Erro ao ler o cabeçalho do 'database.bin'. A iniciar com estado vazio.\n", strlen("Erro ao ler o cabeçalho do 'database.bin'. A iniciar com estado vazio.\n"));
+        close(fd);
+        return 0;
+    }
 
     char msg[128];
-    snprintf(msg, sizeof(msg), "Encontrados %d documentos no disco. Próximo ID a ser usado: %d\n", total_docs_on_disk, next_id);
+    snprintf(msg, sizeof(msg), "Encontrados %d documentos no disco (formato %d). Próximo ID a ser usado: %d\n", header.count, db_version, next_id);
+    write(STDOUT_FILENO, msg, strlen(msg));
+
+    int loaded_count = (db_version == DB_VERSION_LEGACY) ? load_legacy_documents(fd, header.count)
+                                                         : load_compact_documents(fd, &header, records_offset, !meta_loaded);
+    close(fd);
+
+    char msg_loaded_info[128];
+    snprintf(msg_loaded_info, sizeof(msg_loaded_info), "Foram efetivamente adicionados %d documentos à cache nesta sessão de carregamento.\n", loaded_count);
+    write(STDOUT_FILENO, msg_loaded_info, strlen(msg_loaded_info));
+
+    snprintf(msg, sizeof(msg), "%d documentos carregados para a cache.\n", cache.num_docs);
+    write(STDOUT_FILENO, msg, strlen(msg));
+    store_modified = 0; // A base de dados acabou de ser carregada, não está modificada.
+    return 0;
+}
+
+/**
+ * @brief Reescreve no formato atual uma fotografia no formato antigo (uma única vez, no arranque).
+ *
+ * Deve ser chamada depois de `load_documents` e `replay_log`, antes de as trabalhadoras
+ * arrancarem; o log é incorporado na nova fotografia, como em qualquer compactação.
+ */
+void migrate_store() {
+    if (db_version != DB_VERSION_LEGACY) return;
+
+    struct stat before, after;
+    int have_before = (stat("database.bin", &before) == 0);
+    char msg[160];
+    int len = snprintf(msg, sizeof(msg), "A converter 'database.bin' para o formato compacto (versão %d)...\n", DB_VERSION);
+    write(STDOUT_FILENO, msg, len);
+    int saved = compact_store();
+    if (saved < 0) {
+        // A fotografia antiga continua a ser lida; a conversão é tentada de novo na próxima compactação.
+        write(STDERR_FILENO, "Erro na conversão; a fotografia antiga continua em uso.\n", strlen("Erro na conversão; a fotografia antiga continua em uso.\n"));
+        return;
+    }
+    if (have_before && stat("database.bin", &after) == 0) {
+        len = snprintf(msg, sizeof(msg), "Conversão concluída: %d documentos, %lld -> %lld bytes.\n",
+                       saved, (long long)before.st_size, (long long)after.st_size);
+    } else {
+        len = snprintf(msg, sizeof(msg), "Conversão concluída: %d documentos.\n", saved);
+    }
+    write(STDOUT_FILENO, msg, len);
+}
+
+/**
+ * @brief Aplica um registo do log ao estado carregado da fotografia (ver `replay_log`).
+ */
+static void apply_log_record(int op, const Document* doc, off_t doc_offset, int record_next_id, void* ctx) {
+    int* applied = ctx;
+    if (record_next_id > next_id) next_id = record_next_id;
+
+    DocSlot* slot = doc_table_slot_create(&doc_table, doc->id);
+    if (!slot) {
+        perror("Erro de alocação de memória para a tabela de documentos");
+        return;
+    }
+    int existed = (slot->cached || slot->disk_offset >= 0);
+    if (existed && meta_enabled) {
+        Document old;
+        if (read_slot_document(slot, &old) == 0) meta_index_remove(&meta_index, &old);
+        else disable_meta_index();
+    }
+    if (op == LOG_UPSERT && meta_enabled && meta_index_add(&meta_index, doc) != 0) disable_meta_index();
+
+    if (op == LOG_UPSERT) {
+        if (slot->cached) {
+            memcpy(slot->cached, doc, sizeof(Document));
+        } else if (cache.num_docs < cache.capacity) {
+            cache_insert(slot, doc);
+        }
+        slot->disk_offset = doc_offset;
+        slot->in_log = 1;
+        doc_table_set_path(slot, doc->path);
+        if (!existed) num_documents++;
+    } else {
+        cache_remove(slot);
+        slot->disk_offset = -1;
+        slot->in_log = 0;
+        doc_table_set_path(slot, NULL);
+        if (existed) num_documents--;
+    }
+    (*applied)++;
+}
+
+/**
+ * @brief Abre o log "database.log" e reaplica, por ordem, as alterações posteriores à fotografia.
+ */
+void replay_log() {
+    if (doc_log_open(&doc_log, LOG_FILE, sync_batch) != 0) {
+        perror("Erro ao abrir o log da base de dados ('" LOG_FILE "')");
+        return;
+    }
+    int applied = 0;
+    if (doc_log_replay(&doc_log, apply_log_record, &applied) < 0) {
+        perror("Erro ao ler o log da base de dados");
+    }
+    if (applied > 0) {
+        char msg[160];
+        int len = snprintf(msg, sizeof(msg), "Reaplicados %d registos de '" LOG_FILE "'. Documentos: %d. Próximo ID: %d\n",
+                           applied, num_documents, next_id);
+        write(STDOUT_FILENO, msg, len);
+    }
+    store_modified = 0;
+}
+
+/**
+ * @brief Carrega o índice invertido de "index.bin" e reconcilia-o com a base de dados.
+ *
+ * Deve ser chamada depois de `load_documents` e `replay_log`.
+ * Documentos da base de dados que não estão no índice (ou cujo ficheiro mudou desde a
+ * indexação) são indexados; documentos do índice que já não existem na base de dados
+ * são removidos. Sem "index.bin", o índice é construído de raiz.
+ */
+void load_search_index() {
+    index_enabled = 0;
+    if (index_init(&search_index) != 0) {
+        perror("Erro ao inicializar o índice de pesquisa");
+        return;
+    }
+    if (index_load(&search_index, INDEX_FILE) != 0) {
+        write(STDOUT_FILENO, "Índice '" INDEX_FILE "' inexistente ou inválido. A construir índice a partir da base de dados...\n",
+            strlen("Índice '" INDEX_FILE "' inexistente ou inválido. A construir índice a partir da base de dados...\n"));
+    }
+    if (index_enable_term_grams(&search_index) != 0) {
+        perror("Erro ao criar a tabela de trigramas do índice (as pesquisas percorrem o vocabulário)");
+    }
+
+    int* live_ids = NULL;
+    int num_live = 0, live_capacity = 0, reindexed = 0, failed = 0;
+
+    for (int id = 1; id < doc_table.capacity; id++) {
+        const DocSlot* slot = &doc_table.slots[id];
+        if (!slot->cached && slot->disk_offset < 0) continue; // ID livre ou removido.
+
+        Document disk_doc;
+        if (read_slot_document(slot, &disk_doc) != 0) {
+            failed = 1; // Documento ilegível: o índice não o pode representar.
+            continue;
+        }
+        if (num_live == live_capacity) {
+            live_capacity = live_capacity ? live_capacity * 2 : 256;
+            int* bigger = realloc(live_ids, live_capacity * sizeof(int));
+            if (!bigger) { failed = 1; break; }
+            live_ids = bigger;
+        }
+        live_ids[num_live++] = disk_doc.id;
+
+        char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
+        snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, disk_doc.path);
+        if (!index_document_is_current(&search_index, disk_doc.id, full_path)) {
+            if (index_add_file(&search_index, disk_doc.id, full_path) == 0) reindexed++;
+            else failed = 1; // Ficheiro ilegível: o índice não o pode representar.
+        }
+    }
+
+    if (!failed) {
+        index_retain_documents(&search_index, live_ids, num_live);
+        index_enabled = 1;
+    }
+    free(live_ids);
+
+    char msg[192];
+    snprintf(msg, sizeof(msg), "Índice de pesquisa: %d documentos, %d termos (%d documentos (re)indexados)%s.\n",
+             search_index.num_docs, search_index.num_terms, reindexed,
+             failed ? "; índice desativado, as pesquisas vão ler os ficheiros" : "");
     write(STDOUT_FILENO, msg, strlen(msg));
+}
+
+
+/**
+ * @brief Trata sinais do sistema operativo (SIGINT, SIGTERM).
+ *
+ * Apenas pede o encerramento: a thread principal deixa de aceitar pedidos, espera que as
+ * trabalhadoras terminem os que já recebeu e grava o estado, como num SHUTDOWN.
+ * (Instalado sem SA_RESTART, para que o epoll_pwait do ciclo de eventos volte com EINTR e
+ * verifique stop_requested.)
+ *
+ * @param sig O sinal recebido.
+ */
+void handle_signals(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) {
+        stop_requested = 1;
+        const char* msg = "\nRecebido sinal para terminar o servidor. A gravar alterações pendentes...\n";
+        write(STDOUT_FILENO, msg, strlen(msg));
+    }
+}
+
+/**
+ * @brief Reúne as métricas do servidor (STATS): as das threads, as das caches e a fila.
+ *
+ * Deve ser chamada com o store_lock adquirido (leitura), por causa de num_documents.
+ */
+void collect_server_stats(ServerStats* stats) {
+    server_metrics_snapshot(&metrics, stats);
+    pthread_mutex_lock(&cache_mutex);
+    stats->cache_hits = cache.hits;
+    stats->cache_misses = cache.misses;
+    stats->cache_evictions = cache.evictions;
+    pthread_mutex_unlock(&cache_mutex);
+    pthread_mutex_lock(&result_cache.mutex);
+    stats->result_hits = result_cache.search_hits + result_cache.count_hits;
+    stats->result_misses = result_cache.search_misses + result_cache.count_misses;
+    stats->result_evictions = result_cache.evictions;
+    pthread_mutex_unlock(&result_cache.mutex);
+    stats->queue_depth = request_queue_depth(&request_queue) + __atomic_load_n(&backlog_depth, __ATOMIC_RELAXED);
+    stats->num_documents = num_documents;
+    stats->index_pending = index_pending_count();
+}
+
+/**
+ * @brief Processa um pedido recebido de um cliente.
+ *
+ * Executa a operação solicitada (adicionar, consultar, remover, contar linhas,
+ * pesquisar, desligar) e prepara a resposta a ser enviada de volta ao cliente.
+ *
+ * @param req A estrutura Request contendo os detalhes do pedido do cliente.
+ * @return Uma estrutura Response contendo o resultado da operação e o estado.
+ */
+Response process_request(Request req) {
+    Response resp;
+    memset(&resp, 0, sizeof(Response)); // Inicializa a resposta.
+    char log_msg[512]; // Buffer para mensagens de log.
+
+    // Log do pedido recebido.
+    switch (req.operation) {
+        case ADD_DOC:
+            snprintf(log_msg, sizeof(log_msg), "Recebido pedido ADD_DOC do cliente %d. Título: %.50s...\n", req.client_pid, req.doc.title);
+            break;
+        case QUERY_DOC:
+            snprintf(log_msg, sizeof(log_msg), "Recebido pedido QUERY_DOC do cliente %d. ID: %d\n", req.client_pid, req.doc.id);
+            break;
+        default:
+            snprintf(log_msg, sizeof(log_msg), "Recebido pedido operação %d do cliente %d\n", req.operation, req.client_pid);
+    }
+    write(STDOUT_FILENO, log_msg, strlen(log_msg));
+
+    // DELETE_DOC e SHUTDOWN alteram o estado e correm em exclusivo; QUERY_DOC e META_SEARCH só
+    // leem.
+    // COUNT_LINES e SEARCH_DOCS gerem o lock sozinhas: só o seguram enquanto copiam o que
+    // precisam, e leem os ficheiros sem ele (senão um ADD/DELETE que chegasse durante uma
+    // pesquisa longa ficaria à espera, e com ele todos os pedidos seguintes). ADD_DOC e BULK_ADD
+    // também: leem e verificam os documentos sem o lock e só o adquirem para os aplicar; MULTI_QUERY,
+    // MULTI_COUNT, MULTI_SEARCH e SEARCH_QUERY leem o lote do cliente sem o lock. RANKED_SEARCH
+    // é uma pesquisa como SEARCH_DOCS.
+    int writes_state = (req.operation == DELETE_DOC || req.operation == SHUTDOWN);
+    int locks_itself = (req.operation == ADD_DOC || req.operation == COUNT_LINES || req.operation == SEARCH_DOCS ||
+                        req.operation == BULK_ADD ||
+                        req.operation == MULTI_QUERY || req.operation == MULTI_COUNT || req.operation == MULTI_SEARCH ||
+                        req.operation == SEARCH_QUERY || req.operation == RANKED_SEARCH);
+    if (writes_state) pthread_rwlock_wrlock(&store_lock);
+    else if (!locks_itself) pthread_rwlock_rdlock(&store_lock);
+
+    switch (req.operation) {
+        case ADD_DOC:
+            add_document_request(&req, &resp);
+            break;
+        case QUERY_DOC:
+            if (find_document(req.doc.id, &resp.doc) == 0) {
+                resp.status = 0;
+            } else {
+                resp.status = -1; // Não encontrado.
+            }
+            break;
+        case DELETE_DOC:
+            resp.status = remove_document(req.doc.id);
+            if (resp.status == 0) maybe_compact_store();
+            break;
+        case COUNT_LINES: {
+            Document doc_to_count;
+            pthread_rwlock_rdlock(&store_lock);
+            int found = find_document(req.doc.id, &doc_to_count);
+            unsigned long generation = result_cache_generation(&result_cache);
+            pthread_rwlock_unlock(&store_lock);
+            if (found == 0) {
+                resp.count = count_lines_cached(&doc_to_count, req.keyword, generation);
+                resp.status = (resp.count >=0) ? 0 : -1; // Sucesso se contagem >= 0.
+            } else {
+                resp.status = -1;
+            }
+            break;
+        }
+        case SEARCH_DOCS:
+            resp.num_ids = search_documents(req.keyword, &resp.ids, req.nr_processes);
+            resp.status = 0; // Pesquisa sempre retorna 0, mesmo que num_ids seja 0.
+            break;
+        case SHUTDOWN:
+            write(STDOUT_FILENO, "Comando SHUTDOWN recebido.\n", strlen("Comando SHUTDOWN recebido.\n"));
+            persist_state();
+            resp.status = 0;
+            break;
+        case BULK_ADD:
+            bulk_add_documents(&req, &resp);
+            break;
+        case STATS:
+            collect_server_stats(&resp.stats);
+            resp.status = 0;
+            break;
+        case MULTI_QUERY:
+            multi_query_documents(&req, &resp);
+            break;
+        case MULTI_COUNT:
+            multi_count_lines(&req, &resp);
+            break;
+        case MULTI_SEARCH:
+            multi_search_documents(&req, &resp);
+            break;
+        case SEARCH_QUERY:
+            search_query_documents(&req, &resp);
+            break;
+        case RANKED_SEARCH:
+            ranked_search_documents(&req, &resp);
+            break;
+        case META_SEARCH:
+            meta_search_documents(&req, &resp);
+            break;
+        default:
+            resp.status = -2; // Operação inválida.
+    }
+    if (!locks_itself) pthread_rwlock_unlock(&store_lock);
+    return resp;
+}
+
+/**
+ * @brief Acrescenta uma trama (cabeçalho + dados) ao buffer de uma resposta.
+ */
+static void append_frame(char* buf, size_t* len, const ResponseHeader* header, const void* payload) {
+    memcpy(buf + *len, header, sizeof(ResponseHeader));
+    if (header->payload_len > 0) memcpy(buf + *len + sizeof(ResponseHeader), payload, header->payload_len);
+    *len += sizeof(ResponseHeader) + header->payload_len;
+}
+
+/**
+ * @brief Codifica a resposta a um pedido nas tramas que seguem para o cliente.
+ *
+ * A resposta segue em tramas de até RESPONSE_MAX_FRAME bytes (ver ResponseHeader): uma só
+ * para a maioria das operações, várias para uma pesquisa com muitos resultados. Cada trama
+ * é depois escrita com um único `write` (ver `client_session_flush`).
+ *
+ * @param req O pedido (operação).
+ * @param resp A resposta a codificar.
+ * @param len Recebe o número de bytes.
+ * @return As tramas (alocadas com malloc), ou NULL se faltar memória.
+ */
+static char* encode_response(const Request* req, const Response* resp, size_t* len) {
+    int num_frames = 1;
+    int chunked = ((req->operation == SEARCH_DOCS || req->operation == BULK_ADD || req->operation == MULTI_COUNT ||
+                    req->operation == MULTI_SEARCH || req->operation == SEARCH_QUERY ||
+                    req->operation == RANKED_SEARCH) && resp->num_ids > 0);
+    int docs_chunked = ((req->operation == MULTI_QUERY || req->operation == META_SEARCH) && resp->num_docs > 0);
+    if (chunked) num_frames = (resp->num_ids + SEARCH_IDS_PER_FRAME - 1) / SEARCH_IDS_PER_FRAME;
+    if (docs_chunked) num_frames = (resp->num_docs + QUERY_DOCS_PER_FRAME - 1) / QUERY_DOCS_PER_FRAME;
+    char* buf = malloc((size_t)num_frames * RESPONSE_MAX_FRAME);
+    *len = 0;
+    if (!buf) return NULL;
+
+    ResponseHeader header;
+    memset(&header, 0, sizeof(ResponseHeader));
+    header.operation = req->operation;
+    header.status = resp->status;
+
+    if (chunked) {
+        // Blocos de inteiros (IDs de uma pesquisa, relatório de um lote); uma pesquisa sem
+        // resultados segue abaixo, numa só trama sem dados.
+        for (int sent = 0; sent < resp->num_ids; ) {
+            int chunk = resp->num_ids - sent;
+            if (chunk > SEARCH_IDS_PER_FRAME) chunk = SEARCH_IDS_PER_FRAME;
+            header.value = chunk;
+            header.payload_len = chunk * sizeof(int);
+            header.flags = (sent + chunk < resp->num_ids) ? RESPONSE_MORE : 0;
+            append_frame(buf, len, &header, resp->ids + sent);
+            sent += chunk;
+        }
+    } else if (docs_chunked) {
+        // Blocos de documentos (MULTI_QUERY, pela ordem dos IDs pedidos; META_SEARCH).
+        for (int sent = 0; sent < resp->num_docs; ) {
+            int chunk = resp->num_docs - sent;
+            if (chunk > QUERY_DOCS_PER_FRAME) chunk = QUERY_DOCS_PER_FRAME;
+            header.value = chunk;
+            header.payload_len = chunk * sizeof(Document);
+            header.flags = (sent + chunk < resp->num_docs) ? RESPONSE_MORE : 0;
+            append_frame(buf, len, &header, resp->docs + sent);
+            sent += chunk;
+        }
+    } else {
+        const void* payload = NULL;
+        if (req->operation == ADD_DOC) {
+            header.value = resp->doc.id;
+        } else if (req->operation == COUNT_LINES) {
+            header.value = resp->count;
+        } else if (req->operation == QUERY_DOC && resp->status == 0) {
+            header.payload_len = sizeof(Document);
+            payload = &resp->doc;
+        } else if (req->operation == STATS && resp->status == 0) {
+            header.payload_len = sizeof(ServerStats);
+            payload = &resp->stats;
+        }
+        append_frame(buf, len, &header, payload);
+    }
+    return buf;
+}
+
+/**
+ * @brief Ciclo de uma thread trabalhadora: retira pedidos da fila, processa-os e entrega as
+ * respostas codificadas ao ciclo de eventos (que as escreve aos clientes).
+ *
+ * Regista a latência de cada pedido (de o retirar da fila até a resposta estar codificada)
+ * nas métricas. Termina quando a fila é fechada e fica vazia.
+ *
+ * @param arg Não usado.
+ * @return NULL.
+ */
+void* worker_main(void* arg) {
+    (void)arg;
+    Request req;
+    while (request_queue_pop(&request_queue, &req) == 0) {
+        long long start_us = server_metrics_now_us();
+        Response resp = process_request(req);
+        if (req.batch_fd >= 0) close(req.batch_fd);
+        // O ciclo de eventos conta uma resposta por pedido: sem ela, nunca terminaria.
+        Reply* reply = malloc(sizeof(Reply));
+        if (!reply) {
+            perror("Erro fatal ao alocar resposta");
+            exit(EXIT_FAILURE);
+        }
+        reply->client_pid = req.client_pid;
+        reply->operation = req.operation;
+        reply->session = req.session;
+        reply->frames = encode_response(&req, &resp, &reply->len);
+        free(resp.ids);
+        free(resp.docs);
+        server_metrics_record(&metrics, req.operation, resp.status, server_metrics_now_us() - start_us);
+        reply_queue_push(&reply_queue, reply);
+    }
+    return NULL;
+}
+
+// --- Ciclo de eventos da thread principal ---
+// Uma só thread espera (epoll) por pedidos (no SERVER_PIPE, ou nas ligações ao SERVER_SOCKET),
+// por respostas prontas (eventfd da ReplyQueue) e por clientes prontos a receber o resto de
+// uma resposta. Nenhum descritor de cliente é bloqueante: uma resposta que não cabe no FIFO
+// (ou no socket) fica na tabela de clientes até o epoll indicar EPOLLOUT, e um cliente que não
+// a lê até ao prazo (opção -T) é fechado. Um cliente lento ou morto nunca atrasa os outros.
+//
+// Os pedidos lidos passam por uma fila local (backlog) antes da RequestQueue: só entram nesta
+// quando há lugar, para que a thread principal nunca bloqueie em `request_queue_push`. Com
+// FIFOs, o SERVER_PIPE deixa de ser lido enquanto o backlog estiver cheio (contrapressão); com
+// o socket, cada ligação tem no máximo um pedido por responder e só volta a ser lida depois.
+
+// Marcadores dos descritores do servidor nos eventos do epoll (os dos clientes levam a sua
+// ClientSession).
+static char server_marker, reply_marker;
+
+/**
+ * @brief Estado do ciclo de eventos.
+ */
+typedef struct {
+    int epoll_fd;
+    int server_fd;          // SERVER_PIPE aberto para leitura, ou o socket a escutar.
+    int server_keep_fd;     // SERVER_PIPE aberto para escrita pelo servidor (nunca lê EOF), ou -1.
+    int server_events;      // Eventos pedidos ao epoll para server_fd.
+    char fifo_buf[64 * sizeof(Request)]; // Pedidos lidos do SERVER_PIPE (o último pode estar incompleto).
+    size_t fifo_len;
+    Request* backlog;       // Fila circular de pedidos lidos à espera de lugar na RequestQueue.
+    int backlog_head;
+    int backlog_count;
+    int backlog_capacity;
+    int in_flight;          // Pedidos entregues às trabalhadoras sem resposta recebida.
+    int accepting;          // 0 depois de um SHUTDOWN ou sinal: deixa de ler pedidos.
+    int shutdown_requested; // 1 se recebeu SHUTDOWN (processado quando tudo o resto acabar).
+    Request shutdown_req;
+    long long next_timeout_check_ms;
+    sigset_t wait_mask;     // Máscara de sinais durante o epoll_pwait (deixa passar SIGINT/SIGTERM).
+} EventLoop;
 
-    Document doc_from_disk;
-    int loaded_count = 0;
-    for (int i = 0; i < total_docs_on_disk && cache.num_docs < cache.max_size; i++) {
-        if (read(fd, &doc_from_disk, sizeof(Document)) == sizeof(Document)) {
-            cache.docs[cache.num_docs] = malloc(sizeof(Document));
-            if (cache.docs[cache.num_docs] != NULL) {
-                memcpy(cache.docs[cache.num_docs], &doc_from_disk, sizeof(Document));
-                cache.num_docs++;
-                loaded_count++;
-            } else {
-                perror("Erro de alocação de memória ao carregar documento da base de dados para a cache");
-                break; // Para de carregar se não houver memória.
-            }
+/**
+ * @brief Relógio monotónico em milissegundos (prazos das respostas).
+ */
+static long long monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Atualiza os eventos pedidos ao epoll para um descritor (só se mudarem).
+ */
+static void set_epoll_events(EventLoop* loop, int fd, void* ptr, int* current, int events) {
+    if (*current == events) return;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = ptr;
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    *current = events;
+}
+
+/**
+ * @brief Eventos que um cliente deve pedir ao epoll, conforme o seu estado.
+ *
+ * Com uma resposta pendente, espera por EPOLLOUT. Uma ligação ao socket sem pedido por
+ * responder espera pelo próximo pedido (EPOLLIN). Sem nenhum evento pedido, o epoll indica
+ * na mesma EPOLLERR/EPOLLHUP (o cliente fechou o seu lado).
+ */
+static void update_client_events(EventLoop* loop, ClientSession* s) {
+    int events = 0;
+    if (s->out) events = EPOLLOUT;
+    else if (s->kind == CLIENT_SOCKET && !s->busy && loop->accepting) events = EPOLLIN;
+    set_epoll_events(loop, s->fd, s, &s->epoll_events, events);
+}
+
+/**
+ * @brief Regista um descritor de cliente na tabela e no epoll.
+ *
+ * @return A entrada, ou NULL em caso de erro (o descritor é fechado).
+ */
+static ClientSession* add_client(EventLoop* loop, int client_pid, int fd, int kind) {
+    ClientSession* s = client_table_add(&clients, client_pid, fd, kind);
+    if (!s) {
+        close(fd);
+        return NULL;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (kind == CLIENT_SOCKET && loop->accepting) ? EPOLLIN : 0;
+    ev.data.ptr = s;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        perror("Erro ao registar cliente (epoll_ctl)");
+        client_table_remove(&clients, s);
+        return NULL;
+    }
+    s->epoll_events = ev.events;
+    return s;
+}
+
+/**
+ * @brief Escreve o que puder da resposta pendente de um cliente.
+ *
+ * Quando a resposta acaba de ser escrita, um pedido sem sessão fecha o FIFO e uma ligação ao
+ * socket volta a aceitar pedidos. Se a escrita falhar (o cliente fechou o seu lado), o
+ * cliente é retirado.
+ */
+static void flush_client(EventLoop* loop, ClientSession* s) {
+    int result = client_session_flush(&clients, s, monotonic_ms() + reply_timeout_ms);
+    if (result < 0) {
+        char error_msg[200];
+        snprintf(error_msg, sizeof(error_msg), "Erro ao escrever resposta para o cliente %d: %s\n", s->client_pid, strerror(errno));
+        write(STDERR_FILENO, error_msg, strlen(error_msg));
+        client_table_remove(&clients, s);
+        return;
+    }
+    if (result == 1) {
+        s->busy = 0;
+        if (s->kind == CLIENT_FIFO_ONCE) {
+            client_table_remove(&clients, s); // Fecha o pipe do cliente.
+            return;
+        }
+    }
+    update_client_events(loop, s);
+}
+
+/**
+ * @brief Entrega uma resposta ao seu cliente: encontra (ou abre) o descritor e começa a escrevê-la.
+ *
+ * Com FIFOs, um pedido sem sessão abre o FIFO do cliente para esta resposta; um pedido em
+ * sessão reutiliza o descritor aberto no SESSION_BEGIN. Com o socket, a resposta segue pela
+ * ligação do cliente. Se o cliente já não existir, a resposta é descartada.
+ *
+ * @param reply A resposta (libertada aqui).
+ */
+static void deliver_reply(EventLoop* loop, Reply* reply) {
+    ClientSession* s = NULL;
+    if (transport == TRANSPORT_UNIX || reply->session == SESSION_ACTIVE) {
+        s = client_table_find(&clients, reply->client_pid);
+    }
+    if (!s && transport == TRANSPORT_FIFO && reply->frames) {
+        if (reply->session == SESSION_BEGIN) {
+            ClientSession* old = client_table_find(&clients, reply->client_pid);
+            if (old) client_table_remove(&clients, old); // Cliente anterior com o mesmo PID.
+        }
+        int fd = client_pipe_open(reply->client_pid);
+        if (fd >= 0) {
+            int kind = (reply->session == SESSION_NONE) ? CLIENT_FIFO_ONCE : CLIENT_FIFO_SESSION;
+            s = add_client(loop, reply->client_pid, fd, kind);
+        }
+    }
+
+    if (!s || !reply->frames) {
+        if (reply->frames) {
+            char error_msg[200];
+            snprintf(error_msg, sizeof(error_msg), "Cliente %d indisponível: resposta descartada (%s).\n",
+                     reply->client_pid, (transport == TRANSPORT_UNIX) ? "ligação fechada" : strerror(errno));
+            write(STDERR_FILENO, error_msg, strlen(error_msg));
         } else {
-            write(STDERR_FILENO, "Erro ao ler registo de documento do 'database.bin' ou fim inesperado. Carregamento parcial.\n",
-                strlen("Erro ao ler registo de documento do 'database.bin' ou fim inesperado. Carregamento parcial.\n"));
-            break;
+            write(STDERR_FILENO, "Erro ao codificar resposta: memória insuficiente.\n",
+                  strlen("Erro ao codificar resposta: memória insuficiente.\n"));
         }
+        if (s) {
+            s->busy = 0;
+            update_client_events(loop, s);
+        }
+        free(reply->frames);
+        free(reply);
+        return;
     }
-    close(fd);
 
-    char msg_loaded_info[128];
-    snprintf(msg_loaded_info, sizeof(msg_loaded_info), "Foram efetivamente adicionados %d documentos à cache nesta sessão de carregamento.\n", loaded_count);
-    write(STDOUT_FILENO, msg_loaded_info, strlen(msg_loaded_info));
+    if (client_session_queue(&clients, s, reply->frames, reply->len, monotonic_ms() + reply_timeout_ms) != 0) {
+        write(STDERR_FILENO, "Erro ao guardar resposta: memória insuficiente.\n",
+              strlen("Erro ao guardar resposta: memória insuficiente.\n"));
+        client_table_remove(&clients, s);
+    } else {
+        flush_client(loop, s);
+    }
+    free(reply);
+}
 
-    snprintf(msg, sizeof(msg), "%d documentos carregados para a cache.\n", cache.num_docs);
-    write(STDOUT_FILENO, msg, strlen(msg));
-    cache.modified = 0; // Cache acabou de ser carregada, não está modificada.
+/**
+ * @brief Fecha os clientes que não leram a resposta até ao prazo.
+ */
+static void expire_clients(long long now) {
+    for (int i = clients.count - 1; i >= 0; i--) {
+        ClientSession* s = clients.sessions[i];
+        if (s->out && now >= s->deadline_ms) {
+            char msg[160];
+            snprintf(msg, sizeof(msg), "Cliente %d não leu a resposta em %d ms: descartada.\n", s->client_pid, reply_timeout_ms);
+            write(STDERR_FILENO, msg, strlen(msg));
+            client_table_remove(&clients, s);
+        }
+    }
 }
 
+/**
+ * @brief Deixa de ler pedidos (SHUTDOWN ou sinal); os já lidos continuam a ser processados.
+ */
+static void stop_accepting(EventLoop* loop) {
+    if (!loop->accepting) return;
+    loop->accepting = 0;
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, loop->server_fd, NULL);
+    for (int i = 0; i < clients.count; i++) {
+        update_client_events(loop, clients.sessions[i]);
+    }
+}
 
 /**
- * @brief Trata sinais do sistema operativo (SIGINT, SIGTERM).
+ * @brief Indica se o pedido é seguido de um lote (ver BATCH_PIPE_FORMAT).
+ */
+static int has_batch(int operation) {
+    return operation == BULK_ADD || operation == MULTI_QUERY || operation == MULTI_COUNT ||
+           operation == MULTI_SEARCH || operation == SEARCH_QUERY;
+}
+
+/**
+ * @brief Trata um pedido acabado de ler: SHUTDOWN e END_SESSION aqui, os outros vão para o backlog.
  *
- * Em caso de receção de SIGINT ou SIGTERM, liberta a memória da cache,
- * remove o pipe do servidor e termina o processo. Não guarda documentos neste caso.
+ * @param conn A ligação de onde veio o pedido (socket), ou NULL (SERVER_PIPE).
+ */
+static void handle_request(EventLoop* loop, Request* req, ClientSession* conn) {
+    if (req->operation == END_SESSION) {
+        // O cliente só o envia depois de ler a última resposta. Com o socket, a ligação é a sessão.
+        ClientSession* s = conn ? NULL : client_table_find(&clients, req->client_pid);
+        if (s && s->kind == CLIENT_FIFO_SESSION) client_table_remove(&clients, s);
+        if (conn) update_client_events(loop, conn);
+        return;
+    }
+    if (conn) conn->busy = 1;
+    if (req->operation == SHUTDOWN) {
+        // O SHUTDOWN só é processado depois de todos os pedidos anteriores terminarem,
+        // para que nenhuma alteração aconteça depois de a base de dados ser gravada.
+        loop->shutdown_req = *req;
+        loop->shutdown_requested = 1;
+        stop_accepting(loop);
+        return;
+    }
+    if (loop->backlog_count == loop->backlog_capacity) {
+        int new_capacity = loop->backlog_capacity * 2;
+        Request* grown = malloc(new_capacity * sizeof(Request));
+        if (!grown) {
+            write(STDERR_FILENO, "Erro: memória insuficiente para o pedido: descartado.\n",
+                  strlen("Erro: memória insuficiente para o pedido: descartado.\n"));
+            if (req->batch_fd >= 0) {
+                shutdown(req->batch_fd, SHUT_RD); // O lote por ler seria lido como pedidos.
+                close(req->batch_fd);
+            }
+            if (conn) conn->busy = 0;
+            return;
+        }
+        for (int i = 0; i < loop->backlog_count; i++) {
+            grown[i] = loop->backlog[(loop->backlog_head + i) % loop->backlog_capacity];
+        }
+        free(loop->backlog);
+        loop->backlog = grown;
+        loop->backlog_head = 0;
+        loop->backlog_capacity = new_capacity;
+    }
+    loop->backlog[(loop->backlog_head + loop->backlog_count) % loop->backlog_capacity] = *req;
+    loop->backlog_count++;
+    if (conn) update_client_events(loop, conn);
+}
+
+/**
+ * @brief Passa pedidos do backlog para a RequestQueue enquanto houver lugar (sem bloquear).
  *
- * @param sig O sinal recebido.
+ * Com FIFOs, suspende a leitura do SERVER_PIPE enquanto o backlog estiver cheio.
  */
-void handle_signals(int sig) {
-    if (sig == SIGINT || sig == SIGTERM) {
-        write(STDOUT_FILENO, "\nRecebido sinal para terminar o servidor (sem guardar alterações pendentes).\n", strlen("\nRecebido sinal para terminar o servidor (sem guardar alterações pendentes).\n"));
+static void dispatch_backlog(EventLoop* loop) {
+    while (loop->backlog_count > 0 && loop->in_flight < REQUEST_QUEUE_CAPACITY) {
+        // in_flight >= pedidos na fila: há lugar, o push não bloqueia.
+        request_queue_push(&request_queue, &loop->backlog[loop->backlog_head]);
+        loop->backlog_head = (loop->backlog_head + 1) % loop->backlog_capacity;
+        loop->backlog_count--;
+        loop->in_flight++;
+    }
+    __atomic_store_n(&backlog_depth, loop->backlog_count, __ATOMIC_RELAXED);
+    if (transport == TRANSPORT_FIFO && loop->accepting) {
+        set_epoll_events(loop, loop->server_fd, &server_marker, &loop->server_events,
+                         loop->backlog_count < SERVER_BACKLOG_LIMIT ? EPOLLIN : 0);
+    }
+}
 
-        for (int i = 0; i < cache.num_docs; i++) {
-            if(cache.docs[i]) free(cache.docs[i]);
+/**
+ * @brief Lê os pedidos disponíveis no SERVER_PIPE (sem bloquear).
+ */
+static void read_server_pipe(EventLoop* loop) {
+    while (loop->accepting && loop->backlog_count < SERVER_BACKLOG_LIMIT) {
+        ssize_t n = read(loop->server_fd, loop->fifo_buf + loop->fifo_len, sizeof(loop->fifo_buf) - loop->fifo_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN) perror("Erro na leitura do pipe do servidor");
+            return;
         }
-        unlink(SERVER_PIPE); // Remove o FIFO do servidor.
-        exit(0);
+        loop->fifo_len += n;
+        size_t used = 0;
+        while (loop->fifo_len - used >= sizeof(Request)) {
+            Request req;
+            memcpy(&req, loop->fifo_buf + used, sizeof(Request));
+            used += sizeof(Request);
+            req.batch_fd = -1; // O lote segue pelo FIFO de lote.
+            handle_request(loop, &req, NULL);
+        }
+        memmove(loop->fifo_buf, loop->fifo_buf + used, loop->fifo_len - used);
+        loop->fifo_len -= used;
     }
 }
 
 /**
- * @brief Processa um pedido recebido de um cliente.
+ * @brief Aceita as ligações pendentes ao SERVER_SOCKET.
  *
- * Executa a operação solicitada (adicionar, consultar, remover, contar linhas,
- * pesquisar, desligar) e prepara a resposta a ser enviada de volta ao cliente.
+ * O PID do cliente é o do processo do outro lado da ligação (SO_PEERCRED), e não o que
+ * vem nos pedidos.
+ */
+static void accept_clients(EventLoop* loop) {
+    for (;;) {
+        int fd = accept4(loop->server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE) {
+                // Sem descritores livres: deixa de aceitar até um cliente sair (ver o ciclo de eventos).
+                perror("Erro ao aceitar ligação");
+                set_epoll_events(loop, loop->server_fd, &server_marker, &loop->server_events, 0);
+            } else if (errno != EAGAIN) {
+                perror("Erro ao aceitar ligação");
+            }
+            return;
+        }
+        struct ucred cred;
+        socklen_t cred_len = sizeof(cred);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0) {
+            perror("Erro ao identificar o cliente da ligação");
+            close(fd);
+            continue;
+        }
+        add_client(loop, cred.pid, fd, CLIENT_SOCKET);
+    }
+}
+
+/**
+ * @brief Trata um evento de um cliente: pedido numa ligação, espaço para escrever, ou fim.
+ */
+static void handle_client_event(EventLoop* loop, ClientSession* s, int events) {
+    if (s->fd < 0) return; // Retirado por outro evento deste ciclo.
+    if (events & EPOLLOUT) {
+        flush_client(loop, s);
+        if (s->fd < 0) return;
+    }
+    if ((events & EPOLLIN) && s->kind == CLIENT_SOCKET && !s->busy && loop->accepting) {
+        Request req;
+        // MSG_TRUNC: devolve o tamanho real da mensagem, para recusar uma que não seja um pedido.
+        ssize_t n = recv(s->fd, &req, sizeof(Request), MSG_TRUNC);
+        if (n == sizeof(Request)) {
+            req.client_pid = s->client_pid; // A resposta segue por esta ligação.
+            // O lote segue pela ligação: a trabalhadora lê-o de uma cópia, que continua válida
+            // mesmo que a ligação seja retirada da tabela entretanto.
+            req.batch_fd = has_batch(req.operation) ? fcntl(s->fd, F_DUPFD_CLOEXEC, 0) : -1;
+            if (has_batch(req.operation) && req.batch_fd < 0) {
+                perror("Erro ao duplicar a ligação do cliente");
+                client_table_remove(&clients, s);
+                return;
+            }
+            handle_request(loop, &req, s);
+            return;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        // Fim da ligação (ou erro, ou mensagem que não é um pedido): deixa de a servir.
+        client_table_remove(&clients, s);
+        return;
+    }
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        // O cliente fechou o seu lado (FIFO sem leitor, ou ligação fechada).
+        client_table_remove(&clients, s);
+    }
+}
+
+/**
+ * @brief Cria o ponto de entrada dos pedidos: o SERVER_PIPE ou, com o socket, o SERVER_SOCKET a escutar.
  *
- * @param req A estrutura Request contendo os detalhes do pedido do cliente.
- * @return Uma estrutura Response contendo o resultado da operação e o estado.
+ * O SERVER_PIPE é aberto para leitura sem bloquear e também para escrita pelo próprio
+ * servidor, para que nunca leia EOF quando o último cliente o fecha.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
  */
-Response process_request(Request req) {
-    Response resp;
-    memset(&resp, 0, sizeof(Response)); // Inicializa a resposta.
-    char log_msg[512]; // Buffer para mensagens de log.
+static int create_server_endpoint(EventLoop* loop) {
+    loop->server_keep_fd = -1;
+    if (transport == TRANSPORT_FIFO) {
+        unlink(SERVER_PIPE); // Remove o pipe se já existir.
+        if (mkfifo(SERVER_PIPE, 0666) < 0) { // Cria o FIFO do servidor.
+            perror("Erro ao criar pipe do servidor (mkfifo)");
+            return -1;
+        }
+        loop->server_fd = open(SERVER_PIPE, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        loop->server_keep_fd = (loop->server_fd >= 0) ? open(SERVER_PIPE, O_WRONLY | O_CLOEXEC) : -1;
+        if (loop->server_keep_fd < 0) {
+            perror("Erro ao abrir pipe do servidor");
+            if (loop->server_fd >= 0) close(loop->server_fd);
+            unlink(SERVER_PIPE);
+            return -1;
+        }
+        write(STDOUT_FILENO, "FIFO do servidor criado em " SERVER_PIPE "\n", strlen("FIFO do servidor criado em " SERVER_PIPE "\n"));
+        return 0;
+    }
 
-    // Log do pedido recebido.
-    switch (req.operation) {
-        case ADD_DOC:
-            snprintf(log_msg, sizeof(log_msg), "Recebido pedido ADD_DOC do cliente %d. Título: %.50s...\n", req.client_pid, req.doc.title);
-            break;
-        case QUERY_DOC:
-            snprintf(log_msg, sizeof(log_msg), "Recebido pedido QUERY_DOC do cliente %d. ID: %d\n", req.client_pid, req.doc.id);
-            break;
-        default:
-            snprintf(log_msg, sizeof(log_msg), "Recebido pedido operação %d do cliente %d\n", req.operation, req.client_pid);
+    loop->server_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (loop->server_fd < 0) {
+        perror("Erro ao criar socket do servidor");
+        return -1;
     }
-    write(STDOUT_FILENO, log_msg, strlen(log_msg));
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+    unlink(SERVER_SOCKET); // Remove o socket se já existir.
+    if (bind(loop->server_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(loop->server_fd, SOCKET_BACKLOG) != 0) {
+        perror("Erro ao criar socket do servidor (bind/listen)");
+        close(loop->server_fd);
+        return -1;
+    }
+    write(STDOUT_FILENO, "Socket do servidor criado em " SERVER_SOCKET "\n", strlen("Socket do servidor criado em " SERVER_SOCKET "\n"));
+    return 0;
+}
 
+/**
+ * @brief Fecha e remove o SERVER_PIPE ou o SERVER_SOCKET (limpeza final).
+ */
+static void remove_server_endpoint(EventLoop* loop) {
+    close(loop->server_fd);
+    if (loop->server_keep_fd >= 0) close(loop->server_keep_fd);
+    unlink(transport == TRANSPORT_FIFO ? SERVER_PIPE : SERVER_SOCKET);
+}
 
-    switch (req.operation) {
-        case ADD_DOC: {
-            char full_path[MAX_PATH_SIZE + sizeof(base_folder) + 2];
-            if (snprintf(full_path, sizeof(full_path), "%s/%s", base_folder, req.doc.path) >= (int)sizeof(full_path)) {
-                write(STDERR_FILENO, "Erro: Caminho completo do ficheiro excede o buffer.\n", strlen("Erro: Caminho completo do ficheiro excede o buffer.\n"));
-                resp.status = -4; // Caminho muito longo.
-            } else if (access(full_path, R_OK) == 0) { // Verifica se o ficheiro existe e é legível.
-                int added_id = add_document(&req.doc);
-                if (added_id >= 0) {
-                    resp.doc.id = added_id;
-                    resp.status = 0; // Sucesso.
-                } else {
-                    resp.status = -5; // Falha interna ao adicionar (ex: malloc).
+/**
+ * @brief Prepara o ciclo de eventos: epoll com o ponto de entrada dos pedidos e o eventfd das respostas.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+static int event_loop_init(EventLoop* loop) {
+    memset(loop, 0, sizeof(EventLoop));
+    loop->accepting = 1;
+    loop->backlog_capacity = REQUEST_QUEUE_CAPACITY;
+    loop->backlog = malloc(loop->backlog_capacity * sizeof(Request));
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!loop->backlog || loop->epoll_fd < 0) {
+        perror("Erro ao preparar o ciclo de eventos");
+        free(loop->backlog);
+        if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+        return -1;
+    }
+    if (create_server_endpoint(loop) != 0) {
+        free(loop->backlog);
+        close(loop->epoll_fd);
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &server_marker;
+    int ok = (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->server_fd, &ev) == 0);
+    loop->server_events = EPOLLIN;
+    ev.data.ptr = &reply_marker;
+    ok = ok && (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, reply_queue.event_fd, &ev) == 0);
+    if (!ok) {
+        perror("Erro ao preparar o ciclo de eventos (epoll_ctl)");
+        remove_server_endpoint(loop);
+        free(loop->backlog);
+        close(loop->epoll_fd);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta o ciclo de eventos e remove o ponto de entrada dos pedidos.
+ */
+static void event_loop_destroy(EventLoop* loop) {
+    remove_server_endpoint(loop);
+    close(loop->epoll_fd);
+    free(loop->backlog);
+}
+
+/**
+ * @brief Corre o ciclo de eventos até um SHUTDOWN ou sinal, e até todas as respostas serem entregues.
+ *
+ * Depois de deixar de ler pedidos, continua até as trabalhadoras responderem a todos os que
+ * já tinha lido e essas respostas serem escritas (ou expirarem). Um SHUTDOWN é processado
+ * aqui, nesse momento (nenhum outro pedido está a decorrer), e a sua resposta é a última.
+ *
+ * @return 1 se terminou com um SHUTDOWN, 0 caso contrário.
+ */
+static int run_event_loop(EventLoop* loop) {
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int shutdown_done = 0;
+    for (;;) {
+        if (stop_requested) stop_accepting(loop);
+        if (!loop->accepting && loop->backlog_count == 0 && loop->in_flight == 0) {
+            if (loop->shutdown_requested && !shutdown_done) {
+                Response resp = process_request(loop->shutdown_req);
+                Reply* reply = malloc(sizeof(Reply));
+                if (reply) {
+                    reply->client_pid = loop->shutdown_req.client_pid;
+                    reply->operation = SHUTDOWN;
+                    reply->session = loop->shutdown_req.session;
+                    reply->frames = encode_response(&loop->shutdown_req, &resp, &reply->len);
+                    deliver_reply(loop, reply);
                 }
-            } else {
-                snprintf(log_msg, sizeof(log_msg), "Erro ADD_DOC: Ficheiro '%s' não encontrado ou sem permissão (errno: %d %s).\n", full_path, errno, strerror(errno));
-                write(STDERR_FILENO, log_msg, strlen(log_msg));
-                resp.status = -3; // Ficheiro inválido/inacessível.
+                shutdown_done = 1;
             }
-            break;
+            if (clients.pending == 0) break;
         }
-        case QUERY_DOC: {
-            Document* doc_found = find_document(req.doc.id);
-            if (doc_found) {
-                memcpy(&resp.doc, doc_found, sizeof(Document));
-                resp.status = 0;
-                // Se doc_found foi alocado temporariamente por find_document (cache cheia),
-                // essa memória precisa ser libertada após esta cópia.
-                // Assumindo que process_request é o único chamador de find_document que pode causar isto:
-                int was_from_disk_temp = 1; // Assumir que pode ser temporário.
-                for(int i=0; i < cache.num_docs; ++i) { if(cache.docs[i] == doc_found) { was_from_disk_temp = 0; break;} }
-                if(was_from_disk_temp) free(doc_found); // Liberta a cópia temporária.
 
-            } else {
-                resp.status = -1; // Não encontrado.
-            }
-            break;
+        // Com respostas pendentes (ou o socket sem aceitar ligações), acorda periodicamente
+        // para verificar os prazos.
+        int waiting = (clients.pending > 0 || (transport == TRANSPORT_UNIX && loop->accepting && loop->server_events == 0));
+        int num_events = epoll_pwait(loop->epoll_fd, events, EPOLL_MAX_EVENTS, waiting ? TIMEOUT_CHECK_MS : -1,
+                                     &loop->wait_mask);
+        if (num_events < 0) {
+            if (errno == EINTR) continue; // Sinal: o ciclo verifica stop_requested.
+            perror("Erro fatal no epoll_pwait");
+            stop_requested = 1;
+            continue;
         }
-        case DELETE_DOC:
-            resp.status = remove_document(req.doc.id);
-            break;
-        case COUNT_LINES: {
-            Document* doc_to_count = find_document(req.doc.id);
-            if (doc_to_count) {
-                resp.count = count_lines_with_keyword(doc_to_count, req.keyword);
-                resp.status = (resp.count >=0) ? 0 : -1; // Sucesso se contagem >= 0.
 
-                int was_from_disk_temp = 1;
-                for(int i=0; i < cache.num_docs; ++i) { if(cache.docs[i] == doc_to_count) { was_from_disk_temp = 0; break;} }
-                if(was_from_disk_temp) free(doc_to_count);
+        int replies_ready = 0;
+        for (int i = 0; i < num_events; i++) {
+            void* ptr = events[i].data.ptr;
+            if (ptr == &reply_marker) {
+                replies_ready = 1;
+            } else if (ptr == &server_marker) {
+                if (transport == TRANSPORT_FIFO) read_server_pipe(loop);
+                else if (loop->accepting) accept_clients(loop);
             } else {
-                resp.status = -1;
+                handle_client_event(loop, (ClientSession*)ptr, events[i].events);
             }
-            break;
         }
-        case SEARCH_DOCS:
-            if (req.nr_processes > 1) {
-                resp.num_ids = search_documents_with_keyword_parallel(req.keyword, resp.ids, req.nr_processes);
-            } else {
-                resp.num_ids = search_documents_with_keyword_serial(req.keyword, resp.ids);
+        if (replies_ready) {
+            Reply* reply = reply_queue_take_all(&reply_queue);
+            while (reply) {
+                Reply* next = reply->next;
+                loop->in_flight--;
+                deliver_reply(loop, reply);
+                reply = next;
             }
-            resp.status = 0; // Pesquisa sempre retorna 0, mesmo que num_ids seja 0.
-            break;
-        case SHUTDOWN:
-            if (cache.modified) {
-                write(STDOUT_FILENO, "Comando SHUTDOWN recebido. A gravar base de dados...\n", strlen("Comando SHUTDOWN recebido. A gravar base de dados...\n"));
-                save_documents();
-            } else {
-                write(STDOUT_FILENO, "Comando SHUTDOWN recebido. Nenhuma alteração pendente para gravar.\n", strlen("Comando SHUTDOWN recebido. Nenhuma alteração pendente para gravar.\n"));
+        }
+        dispatch_backlog(loop);
+
+        long long now = monotonic_ms();
+        if (now >= loop->next_timeout_check_ms) {
+            loop->next_timeout_check_ms = now + TIMEOUT_CHECK_MS;
+            if (clients.pending > 0) expire_clients(now);
+            if (transport == TRANSPORT_UNIX && loop->accepting && loop->server_events == 0) {
+                set_epoll_events(loop, loop->server_fd, &server_marker, &loop->server_events, EPOLLIN);
             }
-            resp.status = 0;
-            break;
-        default:
-            resp.status = -2; // Operação inválida.
+        }
+        client_table_reap(&clients); // Nenhum evento deste ciclo refere já as entradas retiradas.
     }
-    return resp;
+    return loop->shutdown_requested;
 }
 
 /**
  * @brief Função principal do servidor.
  *
- * Inicializa o servidor, carrega documentos, cria o pipe do servidor,
- * e entra num loop para receber e processar pedidos de clientes.
+ * Inicializa o servidor, carrega documentos, cria o pipe (ou socket) do servidor e lança as
+ * threads trabalhadoras. A thread principal corre o ciclo de eventos (ver run_event_loop): lê
+ * pedidos do SERVER_PIPE (ou das ligações ao SERVER_SOCKET), coloca-os na fila, de onde as
+ * trabalhadoras os processam em paralelo, e escreve as respostas aos clientes sem bloquear.
  * Termina após um pedido SHUTDOWN ou receção de sinal SIGINT/SIGTERM.
  *
  * @param argc Número de argumentos da linha de comandos.
  * @param argv Array de strings dos argumentos da linha de comandos.
- * argv[1] deve ser a pasta de documentos.
- * argv[2] (opcional) o tamanho da cache.
+ * O primeiro argumento posicional é a pasta de documentos e o segundo (opcional) o tamanho da cache.
+ * Opção -w N: número de threads trabalhadoras (por defeito DEFAULT_WORKERS).
+ * Opções -B N e -S MS: durabilidade do log (ver DEFAULT_SYNC_BATCH e DEFAULT_SYNC_INTERVAL_MS).
+ * Opção -p lru|clock: política de substituição da cache (por defeito LRU).
+ * Opção -m MiB: limite dos ficheiros mapeados em memória (0 desativa o mmap).
+ * Opção -t fifo|unix: transporte dos pedidos e respostas (por defeito FIFOs; ver SERVER_SOCKET).
+ * Opção -T MS: prazo para um cliente ler a sua resposta (por defeito DEFAULT_REPLY_TIMEOUT_MS).
+ * Opção -P N: threads da pesquisa paralela (por defeito, os processadores disponíveis; 0 desativa).
+ * Opção -R MiB: limite da cache de resultados das pesquisas (por defeito 16 MiB; 0 desativa).
  * @return 0 em caso de terminação bem-sucedida, 1 em caso de erro.
  */
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        write(STDERR_FILENO, "Uso: ./dserver pasta_documentos [tamanho_cache]\n", strlen("Uso: ./dserver pasta_documentos [tamanho_cache]\n"));
+    setlocale(LC_ALL, ""); // O Matcher deve interpretar as palavras-chave como o grep que substitui.
+    const char* usage = "Uso: ./dserver pasta_documentos [tamanho_cache] [-w num_trabalhadoras] "
+                        "[-B registos_por_fsync] [-S intervalo_fsync_ms] [-p lru|clock] [-m limite_mmap_MiB] [-t fifo|unix] [-T prazo_resposta_ms] [-P threads_pesquisa] [-R cache_resultados_MiB]\n";
+    int num_workers = DEFAULT_WORKERS;
+    int cache_policy = CACHE_POLICY_LRU;
+    long file_map_mb = DEFAULT_FILE_MAP_MB;
+    reply_timeout_ms = DEFAULT_REPLY_TIMEOUT_MS;
+    int search_threads = search_pool_default_threads();
+    long result_cache_mb = RESULT_CACHE_DEFAULT_BYTES / (1024 * 1024);
+    int opt;
+    while ((opt = getopt(argc, argv, "w:B:S:p:m:t:T:P:R:")) != -1) {
+        switch (opt) {
+            case 'w':
+                num_workers = atoi(optarg);
+                break;
+            case 'p':
+                cache_policy = doc_cache_parse_policy(optarg);
+                if (cache_policy < 0) {
+                    write(STDERR_FILENO, usage, strlen(usage));
+                    return 1;
+                }
+                break;
+            case 'B':
+                sync_batch = atoi(optarg);
+                break;
+            case 'm':
+                file_map_mb = atol(optarg);
+                break;
+            case 'S':
+                sync_interval_ms = atoi(optarg);
+                break;
+            case 't':
+                if (strcmp(optarg, "fifo") == 0) {
+                    transport = TRANSPORT_FIFO;
+                } else if (strcmp(optarg, "unix") == 0) {
+                    transport = TRANSPORT_UNIX;
+                } else {
+                    write(STDERR_FILENO, usage, strlen(usage));
+                    return 1;
+                }
+                break;
+            case 'T':
+                reply_timeout_ms = atoi(optarg);
+                break;
+            case 'P':
+                search_threads = atoi(optarg);
+                break;
+            case 'R':
+                result_cache_mb = atol(optarg);
+                break;
+            default:
+                write(STDERR_FILENO, usage, strlen(usage));
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        write(STDERR_FILENO, usage, strlen(usage));
         return 1;
     }
-    strcpy(base_folder, argv[1]); // Copia a pasta base dos documentos.
-
-    // Configura o tamanho da cache.
-    int requested_cache_size = (argc > 2) ? atoi(argv[2]) : 100; // Padrão 100.
-    if (requested_cache_size > MAX_DOCS) {
+    if (num_workers < 1 || num_workers > MAX_WORKERS) {
         char warning_msg[128];
         snprintf(warning_msg, sizeof(warning_msg),
-                "Aviso: Tamanho da cache pedido (%d) excede o máximo (%d). A usar %d.\n",
-                requested_cache_size, MAX_DOCS, MAX_DOCS);
+                "Aviso: Número de trabalhadoras inválido (%d). A usar %d.\n", num_workers, DEFAULT_WORKERS);
         write(STDOUT_FILENO, warning_msg, strlen(warning_msg));
-        cache.max_size = MAX_DOCS;
-    } else if (requested_cache_size <= 0) {
+        num_workers = DEFAULT_WORKERS;
+    }
+    if (sync_batch < 0 || sync_interval_ms < 0) {
+        write(STDOUT_FILENO, "Aviso: Parâmetros de sincronização inválidos. A usar os valores por defeito.\n",
+            strlen("Aviso: Parâmetros de sincronização inválidos. A usar os valores por defeito.\n"));
+        sync_batch = DEFAULT_SYNC_BATCH;
+        sync_interval_ms = DEFAULT_SYNC_INTERVAL_MS;
+    }
+    if (reply_timeout_ms <= 0) {
+        write(STDOUT_FILENO, "Aviso: Prazo de resposta inválido. A usar o valor por defeito.\n",
+            strlen("Aviso: Prazo de resposta inválido. A usar o valor por defeito.\n"));
+        reply_timeout_ms = DEFAULT_REPLY_TIMEOUT_MS;
+    }
+    if (search_threads < 0 || search_threads > SEARCH_POOL_MAX_THREADS) {
+        write(STDOUT_FILENO, "Aviso: Número de threads de pesquisa inválido. A usar o valor por defeito.\n",
+            strlen("Aviso: Número de threads de pesquisa inválido. A usar o valor por defeito.\n"));
+        search_threads = search_pool_default_threads();
+    }
+    if (result_cache_mb < 0) {
+        write(STDOUT_FILENO, "Aviso: Tamanho da cache de resultados inválido. A usar o valor por defeito.\n",
+            strlen("Aviso: Tamanho da cache de resultados inválido. A usar o valor por defeito.\n"));
+        result_cache_mb = RESULT_CACHE_DEFAULT_BYTES / (1024 * 1024);
+    }
+    strncpy(base_folder, argv[optind], sizeof(base_folder) - 1); // Copia a pasta base dos documentos.
+    base_folder[sizeof(base_folder) - 1] = '\0';
+
+    // Configura o tamanho e a política da cache.
+    int cache_size = (optind + 1 < argc) ? atoi(argv[optind + 1]) : DEFAULT_CACHE_SIZE;
+    if (cache_size <= 0) {
         write(STDOUT_FILENO, "Aviso: Tamanho da cache inválido. A usar tamanho padrão 100.\n", strlen("Aviso: Tamanho da cache inválido. A usar tamanho padrão 100.\n"));
-        cache.max_size = 100;
-    } else {
-        cache.max_size = requested_cache_size;
+        cache_size = DEFAULT_CACHE_SIZE;
+    }
+    if (doc_cache_init(&cache, cache_size, cache_policy) != 0) {
+        perror("Erro ao alocar a cache");
+        return 1;
+    }
+    if (file_map_mb < 0) {
+        write(STDOUT_FILENO, "Aviso: Limite de mapeamentos inválido. A usar o valor por defeito.\n",
+            strlen("Aviso: Limite de mapeamentos inválido. A usar o valor por defeito.\n"));
+        file_map_mb = DEFAULT_FILE_MAP_MB;
     }
-    cache.num_docs = 0;
-    cache.modified = 0;
+    // Com -m 0 os ficheiros são sempre lidos com read.
+    file_maps_enabled = (file_map_mb > 0 &&
+                         file_map_cache_init(&file_maps, FILE_MAP_DEFAULT_ENTRIES, (size_t)file_map_mb * 1024 * 1024) == 0);
+    // Com -R 0 (ou sem memória) a cache de resultados fica desligada.
+    if (result_cache_init(&result_cache, (size_t)result_cache_mb * 1024 * 1024) != 0) result_cache.max_bytes = 0;
 
-    signal(SIGINT, handle_signals);  // Configura handler para Ctrl+C.
-    signal(SIGTERM, handle_signals); // Configura handler para kill.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signals;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0; // Sem SA_RESTART: o epoll_pwait do ciclo de eventos é interrompido.
+    sigaction(SIGINT, &sa, NULL);  // Configura handler para Ctrl+C.
+    sigaction(SIGTERM, &sa, NULL); // Configura handler para kill.
+    signal(SIGPIPE, SIG_IGN);        // Um cliente que desaparece não deve terminar o servidor.
 
-    write(STDOUT_FILENO, "A iniciar servidor...\n", strlen("A iniciar servidor...\n"));
-    load_documents(); // Carrega documentos do disco.
+    // Dá prioridade aos escritores: um fluxo contínuo de leituras não pode adiar ADD/DELETE indefinidamente.
+    pthread_rwlockattr_t lock_attr;
+    pthread_rwlockattr_init(&lock_attr);
+    pthread_rwlockattr_setkind_np(&lock_attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&store_lock, &lock_attr);
+    pthread_rwlockattr_destroy(&lock_attr);
 
-    unlink(SERVER_PIPE); // Remove o pipe se já existir.
-    if (mkfifo(SERVER_PIPE, 0666) < 0) { // Cria o FIFO do servidor.
-        perror("Erro ao criar pipe do servidor (mkfifo)");
+    write(STDOUT_FILENO, "A iniciar servidor...\n", strlen("A iniciar servidor...\n"));
+    if (doc_table_init(&doc_table, 0) != 0) { // Cresce com os IDs carregados e atribuídos.
+        perror("Erro ao alocar a tabela de documentos");
         return 1;
     }
-    write(STDOUT_FILENO, "FIFO do servidor criado em " SERVER_PIPE "\n", strlen("FIFO do servidor criado em " SERVER_PIPE "\n"));
+    if (load_documents() != 0) return 1; // Carrega documentos do disco.
+    replay_log(); // Aplica as alterações registadas depois da última fotografia.
+    migrate_store(); // Converte uma fotografia no formato antigo.
+    load_search_index(); // Carrega (ou constrói) o índice invertido.
 
-    char init_msg[256];
-    snprintf(init_msg, sizeof(init_msg), "Servidor iniciado. Pasta de documentos: %s. Tamanho da cache: %d\n", base_folder, cache.max_size);
-    write(STDOUT_FILENO, init_msg, strlen(init_msg));
-
-    // Abre o FIFO para leitura (bloqueante).
-    int server_fd = open(SERVER_PIPE, O_RDONLY);
-    if (server_fd < 0) {
-        perror("Erro ao abrir pipe do servidor para leitura");
-        unlink(SERVER_PIPE); // Limpeza.
+    // Cada cliente ligado (ou com uma resposta pendente) ocupa um descritor: usa o limite máximo.
+    struct rlimit fd_limit;
+    if (getrlimit(RLIMIT_NOFILE, &fd_limit) == 0 && fd_limit.rlim_cur < fd_limit.rlim_max) {
+        fd_limit.rlim_cur = fd_limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &fd_limit);
+    }
+    EventLoop loop;
+    if (client_table_init(&clients) != 0 || reply_queue_init(&reply_queue) != 0 || event_loop_init(&loop) != 0) {
+        write(STDERR_FILENO, "Erro ao inicializar o ciclo de eventos.\n", strlen("Erro ao inicializar o ciclo de eventos.\n"));
         return 1;
     }
-    write(STDOUT_FILENO, "A aguardar ligações de clientes...\n", strlen("A aguardar ligações de clientes...\n"));
 
-    int running = 1;
-    while (running) {
-        Request current_req;
-        ssize_t bytes_read = read(server_fd, &current_req, sizeof(Request));
+    char init_msg[384];
+    snprintf(init_msg, sizeof(init_msg), "Servidor iniciado. Pasta de documentos: %s. Tamanho da cache: %d (%s). Trabalhadoras: %d. Threads de pesquisa: %d\n",
+             base_folder, cache.capacity, doc_cache_policy_name(cache.policy), num_workers, search_threads);
+    write(STDOUT_FILENO, init_msg, strlen(init_msg));
 
-        if (bytes_read <= 0) { // Erro ou EOF.
-            if (bytes_read < 0) perror("Erro na leitura do pipe do servidor");
-            else write(STDOUT_FILENO, "EOF no pipe do servidor, a reabrir...\n", strlen("EOF no pipe do servidor, a reabrir...\n"));
+    // Lança as threads trabalhadoras e a de sincronização do log. Os sinais de terminação ficam
+    // bloqueados em todas as threads; a principal só os recebe dentro do epoll_pwait (sem
+    // perder um sinal que chegue entre verificar stop_requested e esperar).
+    sigset_t termination_signals;
+    sigemptyset(&termination_signals);
+    sigaddset(&termination_signals, SIGINT);
+    sigaddset(&termination_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &termination_signals, &loop.wait_mask);
 
-            close(server_fd); // Fecha e reabre o pipe para aceitar novas conexões.
-            server_fd = open(SERVER_PIPE, O_RDONLY);
-            if (server_fd < 0) {
-                perror("Erro fatal ao reabrir pipe do servidor");
-                running = 0; // Termina o servidor.
-            }
-            continue;
+    if (request_queue_init(&request_queue) != 0) {
+        write(STDERR_FILENO, "Erro ao inicializar a fila de pedidos.\n", strlen("Erro ao inicializar a fila de pedidos.\n"));
+        event_loop_destroy(&loop);
+        return 1;
+    }
+    // Uma parte das métricas por trabalhadora e por thread de pesquisa (ver Server_Metrics.h).
+    if (server_metrics_init(&metrics, num_workers + search_threads + 1) != 0) {
+        write(STDOUT_FILENO, "Aviso: Sem memória para as métricas. STATS devolve só as das caches.\n",
+            strlen("Aviso: Sem memória para as métricas. STATS devolve só as das caches.\n"));
+    }
+    if (search_threads > 0 && search_pool_init(&search_pool, search_threads) != 0) {
+        write(STDOUT_FILENO, "Aviso: Não foi possível criar o pool de pesquisa. A pesquisa será sequencial.\n",
+            strlen("Aviso: Não foi possível criar o pool de pesquisa. A pesquisa será sequencial.\n"));
+    }
+    pthread_t workers[MAX_WORKERS];
+    int started_workers = 0;
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0) {
+            perror("Erro ao criar thread trabalhadora");
+            break;
         }
+        started_workers++;
+    }
+    if (started_workers == 0) {
+        search_pool_destroy(&search_pool);
+        event_loop_destroy(&loop);
+        return 1;
+    }
+    pthread_t sync_thread;
+    int sync_thread_started = (sync_interval_ms > 0 && pthread_create(&sync_thread, NULL, sync_main, NULL) == 0);
+    pthread_t index_thread;
+    int index_thread_started = (pthread_create(&index_thread, NULL, index_main, NULL) == 0);
+    if (!index_thread_started) {
+        write(STDOUT_FILENO, "Aviso: Não foi possível criar a thread de indexação. Os lotes ficam fora do índice até ao próximo arranque.\n",
+            strlen("Aviso: Não foi possível criar a thread de indexação. Os lotes ficam fora do índice até ao próximo arranque.\n"));
+    }
 
-        Response current_resp = process_request(current_req); // Processa o pedido.
+    write(STDOUT_FILENO, "A aguardar ligações de clientes...\n", strlen("A aguardar ligações de clientes...\n"));
 
-        char client_pipe_name[128];
-        snprintf(client_pipe_name, sizeof(client_pipe_name), CLIENT_PIPE_FORMAT, current_req.client_pid);
+    int shutdown_requested = run_event_loop(&loop);
 
-        int client_fd = open(client_pipe_name, O_WRONLY); // Abre o pipe do cliente para escrita.
-        if (client_fd < 0) {
-            char error_msg[200];
-            snprintf(error_msg, sizeof(error_msg), "Erro ao abrir pipe do cliente %s para escrita: %s\n", client_pipe_name, strerror(errno));
-            write(STDERR_FILENO, error_msg, strlen(error_msg));
-        } else {
-            ssize_t bytes_written = write(client_fd, &current_resp, sizeof(Response));
-            if (bytes_written != sizeof(Response)) {
-                char error_msg[200];
-                snprintf(error_msg, sizeof(error_msg), "Erro ao escrever resposta para o cliente %s: %s\n", client_pipe_name, strerror(errno));
-                write(STDERR_FILENO, error_msg, strlen(error_msg));
-            }
-            close(client_fd); // Fecha o pipe do cliente.
-        }
+    // Deixa as trabalhadoras esvaziar a fila e espera que terminem.
+    request_queue_close(&request_queue);
+    for (int i = 0; i < started_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    request_queue_destroy(&request_queue);
 
-        if (current_req.operation == SHUTDOWN) {
-            running = 0; // Termina o loop principal.
-            write(STDOUT_FILENO, "Servidor a encerrar após pedido SHUTDOWN.\n", strlen("Servidor a encerrar após pedido SHUTDOWN.\n"));
-        }
+    // Para a indexação em segundo plano antes de gravar o estado (o resto da fila fica para o
+    // próximo arranque).
+    if (index_thread_started) {
+        pthread_mutex_lock(&index_queue_mutex);
+        index_thread_stop = 1;
+        pthread_cond_signal(&index_queue_cond);
+        pthread_mutex_unlock(&index_queue_mutex);
+        pthread_join(index_thread, NULL);
     }
+    free(index_queue);
 
-    close(server_fd);
-    unlink(SERVER_PIPE); // Limpeza final do pipe do servidor.
+    if (shutdown_requested) {
+        write(STDOUT_FILENO, "Servidor a encerrar após pedido SHUTDOWN.\n", strlen("Servidor a encerrar após pedido SHUTDOWN.\n"));
+    } else if (stop_requested) {
+        persist_state(); // As trabalhadoras já terminaram: nenhum pedido altera o estado.
+        write(STDOUT_FILENO, "Servidor a encerrar após sinal.\n", strlen("Servidor a encerrar após sinal.\n"));
+    }
 
-    // Liberta memória da cache.
-    for (int i = 0; i < cache.num_docs; i++) {
-        if (cache.docs[i]) free(cache.docs[i]);
+    if (sync_thread_started) {
+        pthread_mutex_lock(&sync_thread_mutex);
+        sync_thread_stop = 1;
+        pthread_cond_signal(&sync_thread_cond);
+        pthread_mutex_unlock(&sync_thread_mutex);
+        pthread_join(sync_thread, NULL);
     }
+
+    event_loop_destroy(&loop); // Limpeza final do pipe (ou socket) do servidor.
+    client_table_destroy(&clients); // Os clientes em sessão (ou ligados) leem EOF.
+    reply_queue_destroy(&reply_queue);
+
+    report_cache_stats();
+
+    // Liberta memória da cache e do índice.
+    doc_cache_free(&cache);
+    if (file_maps_enabled) file_map_cache_destroy(&file_maps);
+    search_pool_destroy(&search_pool);
+    result_cache_destroy(&result_cache);
+    server_metrics_destroy(&metrics);
+    index_free(&search_index);
+    doc_table_free(&doc_table);
+    close_database_fd();
+    author_dict_free(&db_authors);
+    meta_index_free(&meta_index);
+    doc_log_close(&doc_log);
+    pthread_rwlock_destroy(&store_lock);
     write(STDOUT_FILENO, "Memória da cache libertada.\nServidor terminado.\n", strlen("Memória da cache libertada.\nServidor terminado.\n"));
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "Document_Struct.h"
+#include "File_Map.h"
+#include <sys/mman.h>   // Para mmap, munmap, madvise
+#include <setjmp.h>     // Para sigsetjmp, siglongjmp (recuperação de SIGBUS)
+
+// Ponto de retorno da pesquisa em curso nesta thread (NULL fora de `file_map_scan`).
+static __thread sigjmp_buf* scan_guard = NULL;
+
+/**
+ * @brief Trata SIGBUS: se a thread está a pesquisar um mapeamento, aborta essa pesquisa.
+ *
+ * Fora de uma pesquisa o sinal não vem de um mapeamento da cache: repõe o tratamento por
+ * defeito e volta a gerá-lo (termina o processo, como sem este handler).
+ */
+static void handle_sigbus(int sig) {
+    if (scan_guard) siglongjmp(*scan_guard, 1);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * @brief Indica se um mapeamento corresponde ao estado atual do ficheiro.
+ */
+static int same_file(const FileMapping* e, const struct stat* st) {
+    return e->dev == st->st_dev && e->ino == st->st_ino && e->size == (size_t)st->st_size &&
+           e->mtime.tv_sec == st->st_mtim.tv_sec && e->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Desfaz um mapeamento e liberta a sua memória (deve estar fora da cache e sem utilizadores).
+ */
+static void unmap_entry(FileMapCache* cache, FileMapping* e) {
+    if (e->data) munmap((void*)e->data, e->size);
+    cache->mapped_bytes -= e->size;
+    free(e->path);
+    free(e);
+}
+
+/**
+ * @brief Retira da cache o mapeamento na posição i (desfeito já, ou quando deixar de estar em uso).
+ */
+static void remove_entry(FileMapCache* cache, int i) {
+    FileMapping* e = cache->entries[i];
+    cache->entries[i] = cache->entries[--cache->count];
+    if (e->refs > 0) {
+        e->detached = 1;
+    } else {
+        unmap_entry(cache, e);
+    }
+}
+
+/**
+ * @brief Retira da cache o mapeamento sem utilizadores usado há mais tempo.
+ *
+ * @return 0 se algum saiu, -1 se todos estão em uso.
+ */
+static int evict_one(FileMapCache* cache) {
+    int victim = -1;
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i]->refs == 0 &&
+            (victim < 0 || cache->entries[i]->last_use < cache->entries[victim]->last_use)) {
+            victim = i;
+        }
+    }
+    if (victim < 0) return -1;
+    remove_entry(cache, victim);
+    return 0;
+}
+
+/**
+ * @brief Mapeia um ficheiro (com o mutex adquirido).
+ *
+ * @return O novo mapeamento, ou NULL se o ficheiro não puder ser mapeado.
+ */
+static FileMapping* map_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    FileMapping* e = calloc(1, sizeof(FileMapping));
+    if (!e || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || !(e->path = strdup(path))) {
+        if (e) free(e->path);
+        free(e);
+        close(fd);
+        return NULL;
+    }
+    e->size = st.st_size;
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->mtime = st.st_mtim;
+    if (e->size > 0) {
+        void* data = mmap(NULL, e->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            free(e->path);
+            free(e);
+            close(fd);
+            return NULL;
+        }
+        // A pesquisa percorre o ficheiro do início ao fim: leitura antecipada agressiva,
+        // e pedido para começar já a trazer as páginas para memória.
+        madvise(data, e->size, MADV_SEQUENTIAL);
+        madvise(data, e->size, MADV_WILLNEED);
+        e->data = data;
+    }
+    close(fd); // O mapeamento mantém-se válido depois de fechar o descritor.
+    return e;
+}
+
+/**
+ * @brief Obtém (e marca como em uso) o mapeamento atual de um ficheiro.
+ *
+ * @param st Estado atual do ficheiro (stat feito pelo chamador).
+ * @return O mapeamento, ou NULL se o ficheiro não puder ser mapeado dentro dos limites.
+ */
+static FileMapping* acquire(FileMapCache* cache, const char* path, const struct stat* st) {
+    pthread_mutex_lock(&cache->mutex);
+    for (int i = 0; i < cache->count; i++) {
+        FileMapping* e = cache->entries[i];
+        if (strcmp(e->path, path) != 0) continue;
+        if (same_file(e, st)) {
+            e->refs++;
+            e->last_use = ++cache->tick;
+            cache->hits++;
+            pthread_mutex_unlock(&cache->mutex);
+            return e;
+        }
+        remove_entry(cache, i); // O ficheiro mudou: volta a ser mapeado.
+        cache->remaps++;
+        break;
+    }
+
+    size_t size = st->st_size;
+    if (size > cache->max_bytes) {
+        pthread_mutex_unlock(&cache->mutex);
+        return NULL; // Demasiado grande para a cache: o chamador lê-o com read.
+    }
+    while (cache->count == cache->capacity || cache->mapped_bytes + size > cache->max_bytes) {
+        if (evict_one(cache) != 0) {
+            pthread_mutex_unlock(&cache->mutex);
+            return NULL; // Tudo em uso.
+        }
+    }
+
+    FileMapping* e = map_file(path);
+    if (e) {
+        e->refs = 1;
+        e->last_use = ++cache->tick;
+        cache->entries[cache->count++] = e;
+        cache->mapped_bytes += e->size;
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return e;
+}
+
+/**
+ * @brief Liberta um mapeamento obtido com `acquire`.
+ *
+ * @param invalidate 1 para o retirar da cache (ex: o ficheiro foi truncado durante a pesquisa).
+ */
+static void release(FileMapCache* cache, FileMapping* e, int invalidate) {
+    pthread_mutex_lock(&cache->mutex);
+    if (invalidate && !e->detached) {
+        for (int i = 0; i < cache->count; i++) {
+            if (cache->entries[i] == e) {
+                remove_entry(cache, i);
+                break;
+            }
+        }
+    }
+    if (--e->refs == 0 && e->detached) unmap_entry(cache, e);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * @brief Inicializa uma cache vazia e instala o tratamento de SIGBUS.
+ *
+ * @param cache A cache.
+ * @param capacity Número máximo de ficheiros mapeados.
+ * @param max_bytes Total máximo de bytes mapeados (ficheiros maiores nunca são mapeados).
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int file_map_cache_init(FileMapCache* cache, int capacity, size_t max_bytes) {
+    memset(cache, 0, sizeof(FileMapCache));
+    if (capacity < 1) return -1;
+    cache->entries = malloc(capacity * sizeof(FileMapping*));
+    if (!cache->entries) return -1;
+    cache->capacity = capacity;
+    cache->max_bytes = max_bytes;
+    if (pthread_mutex_init(&cache->mutex, NULL) != 0) {
+        free(cache->entries);
+        return -1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigbus;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGBUS, &sa, NULL);
+    return 0;
+}
+
+/**
+ * @brief Desfaz todos os mapeamentos (nenhuma pesquisa pode estar a decorrer).
+ */
+void file_map_cache_destroy(FileMapCache* cache) {
+    if (!cache->entries) return;
+    for (int i = 0; i < cache->count; i++) {
+        unmap_entry(cache, cache->entries[i]);
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->count = 0;
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+/**
+ * @brief Pesquisa um ficheiro através do seu mapeamento em memória.
+ *
+ * @param cache A cache de mapeamentos.
+ * @param path Caminho completo do ficheiro.
+ * @param fn Função que pesquisa o conteúdo mapeado.
+ * @param ctx Ponteiro passado a `fn`.
+ * @return O valor devolvido por `fn`, ou FILE_MAP_UNAVAILABLE se o ficheiro não puder ser
+ * mapeado (inexistente, demasiado grande, cache toda em uso) ou tiver sido truncado durante
+ * a pesquisa. Nesse caso o chamador deve ler o ficheiro de outra forma.
+ */
+long file_map_scan(FileMapCache* cache, const char* path, FileMapScanFn fn, void* ctx) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return FILE_MAP_UNAVAILABLE;
+
+    FileMapping* e = acquire(cache, path, &st);
+    if (!e) return FILE_MAP_UNAVAILABLE;
+
+    // Os bytes entre o fim do ficheiro e o fim da sua última página valem '\0'.
+    long page_size = sysconf(_SC_PAGESIZE);
+    int nul_terminated = (e->size > 0 && page_size > 0 && e->size % page_size != 0);
+
+    sigjmp_buf guard;
+    sigjmp_buf* previous_guard = scan_guard;
+    volatile long result = FILE_MAP_UNAVAILABLE;
+    int truncated = 0;
+    if (sigsetjmp(guard, 1) == 0) {
+        scan_guard = &guard;
+        result = fn(e->data, e->size, nul_terminated, ctx);
+    } else {
+        truncated = 1; // SIGBUS: o ficheiro encolheu depois de ser mapeado.
+    }
+    scan_guard = previous_guard;
+
+    release(cache, e, truncated);
+    return truncated ? FILE_MAP_UNAVAILABLE : result;
+}
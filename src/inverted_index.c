@@ -0,0 +1,1151 @@
+#define _GNU_SOURCE // Para memmem.
+#include "Document_Struct.h"
+#include "Inverted_Index.h"
+
+#define INDEX_INITIAL_CAPACITY 1024     // Posições iniciais da tabela de termos (potência de 2).
+#define INDEX_IO_BUFFER (64 * 1024)     // Tamanho dos blocos de leitura/escrita (bytes).
+
+/**
+ * @brief Indica se um byte pertence a um termo (ver regras de tokenização em Inverted_Index.h).
+ */
+static int is_term_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+/**
+ * @brief Função de hash FNV-1a sobre os bytes do termo.
+ */
+static uint32_t hash_term(const char* term, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)term[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Devolve a posição da tabela com o termo indicado, ou a posição livre onde deveria ficar.
+ */
+static Posting* find_slot(Posting* table, int capacity, const char* term, size_t len) {
+    uint32_t mask = (uint32_t)capacity - 1;
+    uint32_t i = hash_term(term, len) & mask;
+    while (table[i].term != NULL) {
+        if ((size_t)table[i].term_len == len && memcmp(table[i].term, term, len) == 0) {
+            return &table[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return &table[i];
+}
+
+/**
+ * @brief Duplica a capacidade da tabela de termos e reinsere todas as entradas.
+ */
+static int grow_table(InvertedIndex* idx) {
+    int new_capacity = idx->capacity * 2;
+    Posting* new_table = calloc(new_capacity, sizeof(Posting));
+    if (!new_table) return -1;
+
+    for (int i = 0; i < idx->capacity; i++) {
+        if (idx->table[i].term != NULL) {
+            *find_slot(new_table, new_capacity, idx->table[i].term, idx->table[i].term_len) = idx->table[i];
+        }
+    }
+    free(idx->table);
+    idx->table = new_table;
+    idx->capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief Junta os 3 bytes de um trigrama num inteiro (nunca 0: os bytes de termo não são nulos).
+ */
+static uint32_t pack_gram(const char* s) {
+    return ((uint32_t)(unsigned char)s[0] << 16) | ((uint32_t)(unsigned char)s[1] << 8) | (unsigned char)s[2];
+}
+
+/**
+ * @brief Devolve a posição da tabela com o trigrama indicado, ou a posição livre onde deveria ficar.
+ */
+static GramList* find_gram(GramList* table, int capacity, uint32_t gram) {
+    uint32_t mask = (uint32_t)capacity - 1;
+    uint32_t i = (gram * 2654435761u) & mask;
+    while (table[i].gram != 0 && table[i].gram != gram) {
+        i = (i + 1) & mask;
+    }
+    return &table[i];
+}
+
+/**
+ * @brief Duplica a capacidade da tabela de trigramas (ou cria-a) e reinsere todas as entradas.
+ */
+static int grow_grams(InvertedIndex* idx) {
+    int new_capacity = idx->grams_capacity ? idx->grams_capacity * 2 : INDEX_INITIAL_CAPACITY;
+    GramList* new_table = calloc(new_capacity, sizeof(GramList));
+    if (!new_table) return -1;
+
+    for (int i = 0; i < idx->grams_capacity; i++) {
+        if (idx->grams[i].gram != 0) {
+            *find_gram(new_table, new_capacity, idx->grams[i].gram) = idx->grams[i];
+        }
+    }
+    free(idx->grams);
+    idx->grams = new_table;
+    idx->grams_capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief Acrescenta um termo novo às listas de todos os seus trigramas.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha de alocação.
+ */
+static int add_term_grams(InvertedIndex* idx, const char* term, size_t len, int term_id) {
+    for (size_t i = 0; i + 3 <= len; i++) {
+        if ((idx->num_grams + 1) * 10 >= idx->grams_capacity * 7 && grow_grams(idx) != 0) return -1;
+        GramList* g = find_gram(idx->grams, idx->grams_capacity, pack_gram(term + i));
+        if (g->gram == 0) {
+            g->gram = pack_gram(term + i);
+            idx->num_grams++;
+        }
+        // O termo é o mais recente: se já está na lista (trigrama repetido), é o último.
+        if (g->num_terms > 0 && g->term_ids[g->num_terms - 1] == term_id) continue;
+        if (g->num_terms == g->capacity) {
+            int new_capacity = g->capacity ? g->capacity * 2 : 4;
+            int* bigger = realloc(g->term_ids, new_capacity * sizeof(int));
+            if (!bigger) return -1;
+            g->term_ids = bigger;
+            g->capacity = new_capacity;
+        }
+        g->term_ids[g->num_terms++] = term_id;
+    }
+    return 0;
+}
+
+/**
+ * @brief Procura um termo na tabela e cria-o (com lista vazia) se ainda não existir.
+ *
+ * @return A entrada do termo, ou NULL em caso de falha de alocação.
+ */
+static Posting* get_or_insert_term(InvertedIndex* idx, const char* term, size_t len) {
+    // Mantém a taxa de ocupação abaixo de 70% para que a sondagem linear se mantenha curta.
+    if ((idx->num_terms + 1) * 10 >= idx->capacity * 7 && grow_table(idx) != 0) {
+        return NULL;
+    }
+
+    Posting* slot = find_slot(idx->table, idx->capacity, term, len);
+    if (slot->term == NULL) {
+        if (idx->num_terms == idx->terms_capacity) {
+            int new_capacity = idx->terms_capacity ? idx->terms_capacity * 2 : INDEX_INITIAL_CAPACITY;
+            char** bigger = realloc(idx->terms, new_capacity * sizeof(char*));
+            if (!bigger) return NULL;
+            idx->terms = bigger;
+            idx->terms_capacity = new_capacity;
+        }
+        slot->term = malloc(len + 1);
+        if (!slot->term) return NULL;
+        memcpy(slot->term, term, len);
+        slot->term[len] = '\0';
+        slot->term_len = (int)len;
+        slot->doc_ids = NULL;
+        slot->tfs = NULL;
+        slot->num_docs = 0;
+        slot->capacity = 0;
+        slot->term_id = idx->num_terms;
+        idx->terms[idx->num_terms++] = slot->term;
+        if (idx->grams_capacity > 0 && add_term_grams(idx, term, len, slot->term_id) != 0) return NULL;
+    }
+    return slot;
+}
+
+/**
+ * @brief Procura um ID numa lista ordenada (pesquisa binária).
+ *
+ * @return A posição do ID, ou -(posição de inserção) - 1 se não existir.
+ */
+static int find_sorted(const int* ids, int n, int id) {
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ids[mid] == id) return mid;
+        if (ids[mid] < id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+/**
+ * @brief Conta `tf` ocorrências do termo no documento: acrescenta o ID à lista (mantendo-a
+ * ordenada e sem repetições) ou, se já lá estiver, soma-as à sua frequência.
+ *
+ * @return 1 se o ID foi acrescentado, 0 se já estava na lista, -1 em caso de falha de alocação.
+ */
+static int posting_add(Posting* p, int doc_id, int tf) {
+    int pos;
+    if (p->num_docs > 0 && p->doc_ids[p->num_docs - 1] == doc_id) {
+        p->tfs[p->num_docs - 1] += tf; // Caso comum: o documento que está a ser indexado.
+        return 0;
+    }
+    if (p->num_docs == 0 || p->doc_ids[p->num_docs - 1] < doc_id) {
+        pos = p->num_docs; // Caso comum: IDs crescentes.
+    } else {
+        pos = find_sorted(p->doc_ids, p->num_docs, doc_id);
+        if (pos >= 0) { // Já presente (várias ocorrências no mesmo documento).
+            p->tfs[pos] += tf;
+            return 0;
+        }
+        pos = -pos - 1;
+    }
+
+    if (p->num_docs == p->capacity) {
+        int new_capacity = p->capacity ? p->capacity * 2 : 4;
+        int* bigger = realloc(p->doc_ids, new_capacity * sizeof(int));
+        if (!bigger) return -1;
+        p->doc_ids = bigger;
+        bigger = realloc(p->tfs, new_capacity * sizeof(int));
+        if (!bigger) return -1;
+        p->tfs = bigger;
+        p->capacity = new_capacity;
+    }
+    memmove(p->doc_ids + pos + 1, p->doc_ids + pos, (p->num_docs - pos) * sizeof(int));
+    memmove(p->tfs + pos + 1, p->tfs + pos, (p->num_docs - pos) * sizeof(int));
+    p->doc_ids[pos] = doc_id;
+    p->tfs[pos] = tf;
+    p->num_docs++;
+    return 1;
+}
+
+/**
+ * @brief Remove um ID da lista de um termo, se estiver presente.
+ */
+static void posting_remove(Posting* p, int doc_id) {
+    int pos = find_sorted(p->doc_ids, p->num_docs, doc_id);
+    if (pos < 0) return;
+    memmove(p->doc_ids + pos, p->doc_ids + pos + 1, (p->num_docs - pos - 1) * sizeof(int));
+    memmove(p->tfs + pos, p->tfs + pos + 1, (p->num_docs - pos - 1) * sizeof(int));
+    p->num_docs--;
+}
+
+/**
+ * @brief Procura um documento na lista de documentos indexados.
+ *
+ * @return A posição na lista, ou -(posição de inserção) - 1 se não existir.
+ */
+static int find_indexed_doc(const InvertedIndex* idx, int doc_id) {
+    int lo = 0, hi = idx->num_docs - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (idx->docs[mid].id == doc_id) return mid;
+        if (idx->docs[mid].id < doc_id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Codifica os números de termos de um documento: ordena-os e guarda as diferenças entre
+ * números seguidos em varint (7 bits por byte), em geral um byte por termo.
+ *
+ * @param term_ids Os números (distintos); ficam ordenados.
+ * @param size Recebe o número de bytes.
+ * @return O buffer (alocado com malloc), ou NULL em caso de falha de alocação.
+ */
+static unsigned char* encode_term_ids(int* term_ids, int num_terms, int* size) {
+    if (num_terms > 1) qsort(term_ids, num_terms, sizeof(int), compare_ints);
+    int bytes = 0;
+    for (int i = 0; i < num_terms; i++) {
+        unsigned delta = (unsigned)(term_ids[i] - (i > 0 ? term_ids[i - 1] : 0));
+        do { bytes++; delta >>= 7; } while (delta);
+    }
+    unsigned char* buf = malloc(bytes > 0 ? bytes : 1);
+    if (!buf) return NULL;
+    unsigned char* out = buf;
+    for (int i = 0; i < num_terms; i++) {
+        unsigned delta = (unsigned)(term_ids[i] - (i > 0 ? term_ids[i - 1] : 0));
+        while (delta >= 0x80) {
+            *out++ = (unsigned char)(delta | 0x80);
+            delta >>= 7;
+        }
+        *out++ = (unsigned char)delta;
+    }
+    *size = bytes;
+    return buf;
+}
+
+/**
+ * @brief Lê o próximo número de termo de uma lista codificada por `encode_term_ids`.
+ */
+static int decode_next_term_id(const unsigned char** pos, int previous) {
+    unsigned delta = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = *(*pos)++;
+        delta |= (unsigned)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return previous + (int)delta;
+}
+
+/**
+ * @brief Regista um documento como indexado (com o estado do ficheiro), mantendo a ordem por ID.
+ *
+ * @param term_ids Números dos termos distintos do documento (ficam ordenados; o chamador
+ * continua dono da lista).
+ * @return 0 em caso de sucesso, -1 em caso de falha de alocação.
+ */
+static int register_indexed_doc(InvertedIndex* idx, int doc_id, int64_t mtime, int64_t size, int64_t length,
+                                int* term_ids, int num_terms) {
+    int encoded_size = 0;
+    unsigned char* encoded = encode_term_ids(term_ids, num_terms, &encoded_size);
+    if (!encoded) return -1;
+
+    int pos = find_indexed_doc(idx, doc_id);
+    if (pos >= 0) {
+        idx->total_length -= idx->docs[pos].length;
+        free(idx->docs[pos].term_ids);
+    } else {
+        pos = -pos - 1;
+        if (idx->num_docs == idx->docs_capacity) {
+            int new_capacity = idx->docs_capacity ? idx->docs_capacity * 2 : 64;
+            IndexedDoc* bigger = realloc(idx->docs, new_capacity * sizeof(IndexedDoc));
+            if (!bigger) { free(encoded); return -1; }
+            idx->docs = bigger;
+            idx->docs_capacity = new_capacity;
+        }
+        memmove(idx->docs + pos + 1, idx->docs + pos, (idx->num_docs - pos) * sizeof(IndexedDoc));
+        idx->num_docs++;
+    }
+    idx->docs[pos].id = doc_id;
+    idx->docs[pos].mtime = mtime;
+    idx->docs[pos].size = size;
+    idx->docs[pos].length = length;
+    idx->docs[pos].term_ids = encoded;
+    idx->docs[pos].term_ids_size = encoded_size;
+    idx->docs[pos].num_terms = num_terms;
+    idx->total_length += length;
+    if (doc_id > idx->max_doc_id) idx->max_doc_id = doc_id;
+    return 0;
+}
+
+/**
+ * @brief Inicializa um índice vazio.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha de alocação.
+ */
+int index_init(InvertedIndex* idx) {
+    memset(idx, 0, sizeof(InvertedIndex));
+    idx->table = calloc(INDEX_INITIAL_CAPACITY, sizeof(Posting));
+    if (!idx->table) return -1;
+    idx->capacity = INDEX_INITIAL_CAPACITY;
+    return 0;
+}
+
+/**
+ * @brief Passa a manter a tabela de trigramas dos termos (ver `index_term_frequencies`).
+ *
+ * Só o índice onde se pesquisa precisa dela; os índices privados de um documento ou de um
+ * bloco (ver `index_merge`) não a têm, para não atrasar a indexação. `index_load` substitui o
+ * conteúdo do índice, por isso deve ser chamada depois.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha de alocação (o índice continua válido e
+ * as pesquisas percorrem o vocabulário).
+ */
+int index_enable_term_grams(InvertedIndex* idx) {
+    if (idx->grams_capacity > 0) return 0;
+    if (grow_grams(idx) != 0) return -1;
+    for (int t = 0; t < idx->num_terms; t++) {
+        if (add_term_grams(idx, idx->terms[t], strlen(idx->terms[t]), t) != 0) {
+            for (int i = 0; i < idx->grams_capacity; i++) free(idx->grams[i].term_ids);
+            free(idx->grams); // Tabela incompleta: não pode excluir termos.
+            idx->grams = NULL;
+            idx->grams_capacity = 0;
+            idx->num_grams = 0;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta toda a memória do índice.
+ */
+void index_free(InvertedIndex* idx) {
+    if (idx->table) {
+        for (int i = 0; i < idx->capacity; i++) {
+            free(idx->table[i].term);
+            free(idx->table[i].doc_ids);
+            free(idx->table[i].tfs);
+        }
+    }
+    free(idx->table);
+    free(idx->terms);
+    for (int i = 0; i < idx->grams_capacity; i++) {
+        free(idx->grams[i].term_ids);
+    }
+    free(idx->grams);
+    for (int i = 0; i < idx->num_docs; i++) {
+        free(idx->docs[i].term_ids);
+    }
+    free(idx->docs);
+    memset(idx, 0, sizeof(InvertedIndex));
+}
+
+/**
+ * @brief Função chamada para cada termo de um ficheiro (ver `tokenize_file`).
+ *
+ * @return 0 para continuar, -1 para parar com erro.
+ */
+typedef int (*TermFn)(const char* term, size_t len, void* ctx);
+
+/**
+ * @brief Lê um ficheiro aberto em blocos e chama `fn` para cada ocorrência de um termo.
+ *
+ * Um termo partido entre dois blocos é acumulado num buffer próprio.
+ *
+ * @return O número de termos (ocorrências), ou -1 em caso de erro de leitura/alocação ou se
+ * `fn` falhar.
+ */
+static int64_t tokenize_file(int fd, TermFn fn, void* ctx) {
+    char* chunk = malloc(INDEX_IO_BUFFER);
+    size_t term_capacity = 256;
+    char* term = malloc(term_capacity);
+    size_t term_len = 0;
+    int64_t count = 0;
+    int result = (chunk && term) ? 0 : -1;
+
+    while (result == 0) {
+        ssize_t n = read(fd, chunk, INDEX_IO_BUFFER);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { result = -1; break; }
+
+        for (ssize_t i = 0; i < n && result == 0; i++) {
+            if (is_term_byte((unsigned char)chunk[i])) {
+                if (term_len == term_capacity) {
+                    char* bigger = realloc(term, term_capacity * 2);
+                    if (!bigger) { result = -1; break; }
+                    term = bigger;
+                    term_capacity *= 2;
+                }
+                term[term_len++] = chunk[i];
+            } else if (term_len > 0) {
+                result = fn(term, term_len, ctx);
+                count++;
+                term_len = 0;
+            }
+        }
+        if (n == 0) break; // EOF.
+    }
+
+    if (result == 0 && term_len > 0) { // Último termo do ficheiro.
+        result = fn(term, term_len, ctx);
+        count++;
+    }
+    free(chunk);
+    free(term);
+    return (result == 0) ? count : -1;
+}
+
+// Documento a ser indexado (ver `add_term_occurrence`).
+typedef struct {
+    InvertedIndex* idx;
+    int doc_id;
+    int* term_ids;      // Números dos termos distintos já vistos no documento.
+    int num_terms;
+    int terms_capacity;
+} IndexedFile;
+
+static int add_term_occurrence(const char* term, size_t len, void* ctx) {
+    IndexedFile* file = ctx;
+    Posting* p = get_or_insert_term(file->idx, term, len);
+    int added = p ? posting_add(p, file->doc_id, 1) : -1;
+    if (added <= 0) return added;
+
+    // Primeira ocorrência do termo no documento: guarda-o na lista de termos do documento.
+    if (file->num_terms == file->terms_capacity) {
+        int new_capacity = file->terms_capacity ? file->terms_capacity * 2 : 64;
+        int* bigger = realloc(file->term_ids, new_capacity * sizeof(int));
+        if (!bigger) return -1;
+        file->term_ids = bigger;
+        file->terms_capacity = new_capacity;
+    }
+    file->term_ids[file->num_terms++] = p->term_id;
+    return 0;
+}
+
+/**
+ * @brief Indexa (ou reindexa) o conteúdo de um ficheiro sob o ID indicado.
+ *
+ * Lê o ficheiro em blocos e conta cada ocorrência de um termo na lista desse termo (ver
+ * `posting_add`); o número total de termos fica como comprimento do documento.
+ *
+ * @param idx O índice.
+ * @param doc_id ID do documento.
+ * @param full_path Caminho completo do ficheiro.
+ * @return 0 em caso de sucesso, -1 se o ficheiro não puder ser lido ou faltar memória
+ * (nesse caso o documento não fica no índice).
+ */
+int index_add_file(InvertedIndex* idx, int doc_id, const char* full_path) {
+    int fd = open(full_path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) { close(fd); return -1; }
+
+    if (find_indexed_doc(idx, doc_id) >= 0) {
+        index_remove_document(idx, doc_id); // Reindexação: descarta os termos antigos.
+    }
+
+    IndexedFile file = { idx, doc_id, NULL, 0, 0 };
+    int64_t length = tokenize_file(fd, add_term_occurrence, &file);
+    close(fd);
+
+    int result = (length >= 0) ? 0 : -1;
+    if (result == 0) {
+        result = register_indexed_doc(idx, doc_id, (int64_t)st.st_mtime, (int64_t)st.st_size, length, file.term_ids,
+                                      file.num_terms);
+    } else if (register_indexed_doc(idx, doc_id, 0, 0, 0, file.term_ids, file.num_terms) == 0) {
+        index_remove_document(idx, doc_id); // Remove o que possa ter ficado indexado parcialmente.
+    }
+    free(file.term_ids);
+    idx->modified = 1;
+    return result;
+}
+
+/**
+ * @brief Remove um documento de todas as listas do índice onde aparece.
+ *
+ * Percorre só os termos do próprio documento (pesquisa binária em cada lista). Não depende do
+ * conteúdo atual do ficheiro, por isso continua correto mesmo que o ficheiro tenha mudado ou
+ * desaparecido.
+ *
+ * @param idx O índice.
+ * @param doc_id ID do documento a remover.
+ */
+void index_remove_document(InvertedIndex* idx, int doc_id) {
+    int pos = find_indexed_doc(idx, doc_id);
+    if (pos < 0) return;
+
+    IndexedDoc* doc = &idx->docs[pos];
+    const unsigned char* ids = doc->term_ids;
+    int term_id = 0;
+    for (int i = 0; i < doc->num_terms; i++) {
+        term_id = decode_next_term_id(&ids, term_id);
+        const char* term = idx->terms[term_id];
+        posting_remove(find_slot(idx->table, idx->capacity, term, strlen(term)), doc_id);
+    }
+    free(doc->term_ids);
+    idx->total_length -= doc->length;
+    memmove(idx->docs + pos, idx->docs + pos + 1, (idx->num_docs - pos - 1) * sizeof(IndexedDoc));
+    idx->num_docs--;
+    idx->modified = 1;
+}
+
+/**
+ * @brief Junta a um índice os documentos de outro, construído à parte (ex: sem o lock do servidor).
+ *
+ * Os documentos de `src` que já estejam em `dst` são reindexados. Só percorre os termos de
+ * `src`, por isso o custo não depende do tamanho de `dst`.
+ *
+ * @param dst O índice de destino.
+ * @param src O índice com os documentos a juntar (não é alterado).
+ * @param id_offset Valor somado aos IDs de `src` (0 se já são os definitivos).
+ * @return 0 em caso de sucesso, -1 em caso de falha de alocação (nesse caso nenhum documento
+ * de `src` fica em `dst`).
+ */
+int index_merge(InvertedIndex* dst, const InvertedIndex* src, int id_offset) {
+    for (int i = 0; i < src->num_docs; i++) {
+        index_remove_document(dst, src->docs[i].id + id_offset); // Reindexação: descarta os termos antigos.
+    }
+
+    // Listas de termos dos documentos em dst (ver IndexedDoc), paralelas a src->docs.
+    int** terms = calloc(src->num_docs > 0 ? src->num_docs : 1, sizeof(int*));
+    int* counts = calloc(src->num_docs > 0 ? src->num_docs : 1, sizeof(int));
+    int result = (terms && counts) ? 0 : -1;
+    for (int i = 0; i < src->num_docs && result == 0; i++) {
+        terms[i] = malloc((src->docs[i].num_terms > 0 ? src->docs[i].num_terms : 1) * sizeof(int));
+        if (!terms[i]) result = -1;
+    }
+
+    for (int i = 0; i < src->capacity && result == 0; i++) {
+        const Posting* sp = &src->table[i];
+        if (sp->term == NULL || sp->num_docs == 0) continue;
+        Posting* p = get_or_insert_term(dst, sp->term, sp->term_len);
+        if (!p) { result = -1; break; }
+        for (int j = 0; j < sp->num_docs; j++) {
+            int pos = find_indexed_doc(src, sp->doc_ids[j]);
+            if (pos < 0 || counts[pos] == src->docs[pos].num_terms) continue; // Não pertence a um documento de src.
+            int added = posting_add(p, sp->doc_ids[j] + id_offset, sp->tfs[j]);
+            if (added < 0) { result = -1; break; }
+            if (added == 1) terms[pos][counts[pos]++] = p->term_id;
+        }
+    }
+
+    for (int i = 0; terms && i < src->num_docs; i++) {
+        const IndexedDoc* d = &src->docs[i];
+        if (terms[i] && register_indexed_doc(dst, d->id + id_offset, d->mtime, d->size, d->length, terms[i],
+                                             counts[i]) != 0) {
+            result = -1;
+        }
+        free(terms[i]);
+    }
+    if (result != 0) { // Desfaz o que possa ter ficado junto parcialmente.
+        for (int i = 0; i < src->num_docs; i++) index_remove_document(dst, src->docs[i].id + id_offset);
+    }
+    free(terms);
+    free(counts);
+    dst->modified = 1;
+    return result;
+}
+
+/**
+ * @brief Indica se um documento está indexado e se o ficheiro não mudou desde então.
+ *
+ * @return 1 se o documento está indexado e o ficheiro tem a mesma data e tamanho, 0 caso contrário.
+ */
+int index_document_is_current(const InvertedIndex* idx, int doc_id, const char* full_path) {
+    int pos = find_indexed_doc(idx, doc_id);
+    if (pos < 0) return 0;
+
+    struct stat st;
+    if (stat(full_path, &st) < 0) return 0;
+    return idx->docs[pos].mtime == (int64_t)st.st_mtime && idx->docs[pos].size == (int64_t)st.st_size;
+}
+
+/**
+ * @brief Indica se um documento está indexado (sem verificar o ficheiro; ver `index_document_is_current`).
+ */
+int index_has_document(const InvertedIndex* idx, int doc_id) {
+    return find_indexed_doc(idx, doc_id) >= 0;
+}
+
+/**
+ * @brief Remove do índice todos os documentos que não estão na lista de IDs vivos.
+ *
+ * Usado no arranque para reconciliar um índice persistido com a base de dados.
+ *
+ * @param idx O índice.
+ * @param live_ids IDs dos documentos existentes (qualquer ordem).
+ * @param num_live Número de IDs em live_ids.
+ */
+void index_retain_documents(InvertedIndex* idx, const int* live_ids, int num_live) {
+    int* sorted = malloc((num_live > 0 ? num_live : 1) * sizeof(int));
+    if (!sorted) return;
+    memcpy(sorted, live_ids, num_live * sizeof(int));
+    qsort(sorted, num_live, sizeof(int), compare_ints);
+
+    for (int i = idx->num_docs - 1; i >= 0; i--) {
+        if (find_sorted(sorted, num_live, idx->docs[i].id) < 0) {
+            index_remove_document(idx, idx->docs[i].id);
+        }
+    }
+    free(sorted);
+}
+
+/**
+ * @brief Indica se o índice consegue responder exatamente a uma pesquisa por esta palavra-chave.
+ *
+ * @return 1 se a palavra-chave é não vazia e composta apenas por bytes de termo, 0 caso contrário.
+ */
+int index_can_answer(const char* keyword) {
+    if (!keyword || keyword[0] == '\0') return 0;
+    for (const char* p = keyword; *p; p++) {
+        if (!is_term_byte((unsigned char)*p)) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Devolve os IDs dos documentos que contêm a palavra-chave (mesma semântica do grep).
+ *
+ * Une as listas de todos os termos que contêm a palavra-chave como substring.
+ * Os IDs são devolvidos por ordem crescente.
+ *
+ * @param idx O índice.
+ * @param keyword Palavra-chave (deve satisfazer `index_can_answer`).
+ * @param result_ids Array onde os IDs encontrados serão escritos.
+ * @param max_results Capacidade de result_ids.
+ * @return O número de IDs escritos, ou -1 em caso de falha de alocação.
+ */
+int index_search(const InvertedIndex* idx, const char* keyword, int* result_ids, int max_results) {
+    return index_term_frequencies(idx, keyword, result_ids, NULL, max_results);
+}
+
+// Ocorrências de um termo num documento, para a união das listas (ver `index_term_frequencies`).
+typedef struct {
+    int doc_id;
+    int tf;
+} DocFrequency;
+
+static int compare_doc_frequencies(const void* a, const void* b) {
+    int x = ((const DocFrequency*)a)->doc_id, y = ((const DocFrequency*)b)->doc_id;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Junta às listas escolhidas a do termo `term_id`, se o termo contiver a palavra-chave.
+ */
+static void match_term(const InvertedIndex* idx, int term_id, const char* keyword, size_t keyword_len,
+                       const Posting** matched, int* num_matched) {
+    const char* term = idx->terms[term_id];
+    const Posting* p = find_slot(idx->table, idx->capacity, term, strlen(term));
+    if (p->num_docs == 0 || (size_t)p->term_len < keyword_len) return;
+    if (memmem(p->term, p->term_len, keyword, keyword_len) == NULL) return;
+    matched[(*num_matched)++] = p;
+}
+
+/**
+ * @brief Como `index_search`, devolvendo também a frequência da palavra-chave em cada documento.
+ *
+ * A frequência é o número de ocorrências de termos que contêm a palavra-chave (a soma das
+ * frequências de todos esses termos no documento), a mesma contagem que
+ * `index_file_term_frequencies` faz lendo o ficheiro.
+ *
+ * Os termos candidatos vêm da lista mais curta entre os trigramas da palavra-chave (um termo
+ * que a contém tem todos eles); com menos de 3 bytes, ou sem a tabela de trigramas
+ * (`index_enable_term_grams`), são todos os termos. As listas dos
+ * termos que a contêm são unidas num array do tamanho da soma das suas listas, e não da
+ * coleção: o custo cresce com os resultados.
+ *
+ * @param result_tfs Array onde as frequências são escritas, paralelo a result_ids (pode ser NULL).
+ * @return O número de IDs escritos, ou -1 em caso de falha de alocação.
+ */
+int index_term_frequencies(const InvertedIndex* idx, const char* keyword, int* result_ids, int* result_tfs,
+                           int max_results) {
+    size_t keyword_len = strlen(keyword);
+    const GramList* shortest = NULL;
+    for (size_t i = 0; idx->grams_capacity > 0 && i + 3 <= keyword_len; i++) {
+        const GramList* g = find_gram(idx->grams, idx->grams_capacity, pack_gram(keyword + i));
+        if (g->gram == 0) return 0; // Nenhum termo tem este trigrama.
+        if (!shortest || g->num_terms < shortest->num_terms) shortest = g;
+    }
+
+    int max_matched = shortest ? shortest->num_terms : idx->num_terms;
+    const Posting** matched = malloc((max_matched > 0 ? max_matched : 1) * sizeof(Posting*));
+    if (!matched) return -1;
+    int num_matched = 0;
+    for (int i = 0; i < max_matched; i++) {
+        match_term(idx, shortest ? shortest->term_ids[i] : i, keyword, keyword_len, matched, &num_matched);
+    }
+
+    int count = 0;
+    if (num_matched == 1) { // Uma só lista: já está ordenada e sem repetições.
+        const Posting* p = matched[0];
+        count = (p->num_docs < max_results) ? p->num_docs : max_results;
+        memcpy(result_ids, p->doc_ids, count * sizeof(int));
+        if (result_tfs) memcpy(result_tfs, p->tfs, count * sizeof(int));
+    } else if (num_matched > 1) {
+        size_t total = 0;
+        for (int m = 0; m < num_matched; m++) total += matched[m]->num_docs;
+        DocFrequency* all = malloc(total * sizeof(DocFrequency));
+        if (!all) {
+            free(matched);
+            return -1;
+        }
+        size_t n = 0;
+        for (int m = 0; m < num_matched; m++) {
+            for (int j = 0; j < matched[m]->num_docs; j++) {
+                all[n].doc_id = matched[m]->doc_ids[j];
+                all[n++].tf = matched[m]->tfs[j];
+            }
+        }
+        qsort(all, n, sizeof(DocFrequency), compare_doc_frequencies);
+        for (size_t j = 0; j < n && count < max_results; ) {
+            int id = all[j].doc_id, tf = 0;
+            while (j < n && all[j].doc_id == id) tf += all[j++].tf;
+            if (result_tfs) result_tfs[count] = tf;
+            result_ids[count++] = id;
+        }
+        free(all);
+    }
+    free(matched);
+    return count;
+}
+
+/**
+ * @brief Devolve o comprimento (número de termos) de um documento indexado.
+ *
+ * @return O comprimento, ou -1 se o documento não estiver indexado.
+ */
+int64_t index_document_length(const InvertedIndex* idx, int doc_id) {
+    int pos = find_indexed_doc(idx, doc_id);
+    return (pos >= 0) ? idx->docs[pos].length : -1;
+}
+
+// Contagem das palavras num ficheiro (ver `count_word_occurrence`).
+typedef struct {
+    const char* const* words;
+    const size_t* word_lens;
+    int num_words;
+    long* tfs;
+} WordCounts;
+
+static int count_word_occurrence(const char* term, size_t len, void* ctx) {
+    WordCounts* counts = ctx;
+    for (int w = 0; w < counts->num_words; w++) {
+        if (len >= counts->word_lens[w] && memmem(term, len, counts->words[w], counts->word_lens[w]) != NULL) {
+            counts->tfs[w]++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Conta, lendo o ficheiro, as frequências de várias palavras e o comprimento do documento.
+ *
+ * Usa a mesma tokenização e contagem que o índice (ver `index_term_frequencies`), para os
+ * documentos que não estão indexados ou mudaram desde a indexação.
+ *
+ * @param full_path Caminho completo do ficheiro.
+ * @param words Palavras (cada uma deve satisfazer `index_can_answer`).
+ * @param num_words Número de palavras.
+ * @param tfs Recebe a frequência de cada palavra.
+ * @param length Recebe o número de termos do documento.
+ * @return 0 em caso de sucesso, -1 se o ficheiro não puder ser lido ou faltar memória.
+ */
+int index_file_term_frequencies(const char* full_path, const char* const* words, int num_words, long* tfs,
+                                int64_t* length) {
+    size_t* word_lens = malloc((num_words > 0 ? num_words : 1) * sizeof(size_t));
+    if (!word_lens) return -1;
+    for (int w = 0; w < num_words; w++) {
+        word_lens[w] = strlen(words[w]);
+        tfs[w] = 0;
+    }
+
+    int fd = open(full_path, O_RDONLY);
+    if (fd < 0) {
+        free(word_lens);
+        return -1;
+    }
+    WordCounts counts = { words, word_lens, num_words, tfs };
+    *length = tokenize_file(fd, count_word_occurrence, &counts);
+    close(fd);
+    free(word_lens);
+    return (*length >= 0) ? 0 : -1;
+}
+
+/**
+ * @brief Devolve os documentos que contêm todas as palavras de um texto literal (candidatos).
+ *
+ * Cada sequência maximal de bytes de termo do texto (ex: "New" e "York" em "New York") fica,
+ * em qualquer ocorrência do texto, dentro de um só termo do documento: os documentos que
+ * contêm o texto estão entre os que contêm cada uma delas (`index_search`). O contrário não
+ * é garantido (as palavras podem estar em linhas diferentes), por isso o resultado é só um
+ * superconjunto, a confirmar lendo os ficheiros.
+ *
+ * @param idx O índice.
+ * @param text Texto literal (sem metacaracteres de expressões regulares).
+ * @param result_ids Array onde os IDs são escritos, por ordem crescente.
+ * @param max_results Capacidade de result_ids.
+ * @return O número de IDs escritos, ou -1 se o texto não tiver palavras ou faltar memória.
+ */
+int index_search_words(const InvertedIndex* idx, const char* text, int* result_ids, int max_results) {
+    int max_hits = idx->max_doc_id + 1;
+    int* hits = malloc(max_hits * sizeof(int));
+    if (!hits) return -1;
+
+    int count = -1;
+    const char* p = text;
+    while (*p) {
+        if (!is_term_byte((unsigned char)*p)) {
+            p++;
+            continue;
+        }
+        const char* start = p;
+        while (*p && is_term_byte((unsigned char)*p)) p++;
+        char* word = strndup(start, p - start);
+        int num_hits = word ? index_search(idx, word, hits, max_hits) : -1;
+        free(word);
+        if (num_hits < 0) {
+            count = -1;
+            break;
+        }
+        if (count < 0) { // Primeira palavra.
+            count = (num_hits < max_results) ? num_hits : max_results;
+            memcpy(result_ids, hits, count * sizeof(int));
+            continue;
+        }
+        int kept = 0, j = 0; // Interseção (ambas ordenadas), no próprio result_ids.
+        for (int i = 0; i < count; i++) {
+            while (j < num_hits && hits[j] < result_ids[i]) j++;
+            if (j < num_hits && hits[j] == result_ids[i]) result_ids[kept++] = result_ids[i];
+        }
+        count = kept;
+    }
+    free(hits);
+    return count;
+}
+
+/**
+ * @brief Separa um texto nas suas palavras (sequências maximais de bytes de termo).
+ *
+ * @param words Recebe as palavras (terminadas em '\0'; o texto deve ter menos de MAX_KEYWORD_SIZE bytes).
+ * @param max_words Capacidade de words.
+ * @return O número de palavras escritas.
+ */
+int index_text_words(const char* text, char (*words)[MAX_KEYWORD_SIZE], int max_words) {
+    int count = 0;
+    const char* p = text;
+    while (*p && count < max_words) {
+        if (!is_term_byte((unsigned char)*p)) {
+            p++;
+            continue;
+        }
+        size_t len = 0;
+        while (p[len] && is_term_byte((unsigned char)p[len]) && len < MAX_KEYWORD_SIZE - 1) len++;
+        memcpy(words[count], p, len);
+        words[count++][len] = '\0';
+        p += len;
+    }
+    return count;
+}
+
+// --- Persistência ---
+// Formato de index.bin (inteiros em formato nativo):
+//   uint32 magic, uint32 versão, int32 num_docs, int32 num_termos, int32 max_doc_id
+//   num_docs x { int32 id, int64 mtime, int64 size, int64 número de termos }
+//   num_termos x { int32 comprimento, bytes do termo, int32 n, n x int32 id, n x int32 frequência }
+// É escrito num ficheiro temporário e renomeado, para nunca deixar um índice meio escrito.
+
+typedef struct {
+    int fd;
+    char* buf;
+    size_t used;
+    int failed;
+} IndexWriter;
+
+static void writer_put(IndexWriter* w, const void* data, size_t len) {
+    const char* src = data;
+    while (len > 0 && !w->failed) {
+        size_t space = INDEX_IO_BUFFER - w->used;
+        size_t n = len < space ? len : space;
+        memcpy(w->buf + w->used, src, n);
+        w->used += n;
+        src += n;
+        len -= n;
+        if (w->used == INDEX_IO_BUFFER) {
+            if (write(w->fd, w->buf, w->used) != (ssize_t)w->used) w->failed = 1;
+            w->used = 0;
+        }
+    }
+}
+
+static void writer_flush(IndexWriter* w) {
+    if (w->used > 0 && !w->failed) {
+        if (write(w->fd, w->buf, w->used) != (ssize_t)w->used) w->failed = 1;
+    }
+    w->used = 0;
+}
+
+/**
+ * @brief Grava o índice em disco.
+ *
+ * @param idx O índice.
+ * @param path Caminho do ficheiro (normalmente INDEX_FILE).
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int index_save(const InvertedIndex* idx, const char* path) {
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    IndexWriter w = { open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644), malloc(INDEX_IO_BUFFER), 0, 0 };
+    if (w.fd < 0 || !w.buf) {
+        if (w.fd >= 0) close(w.fd);
+        free(w.buf);
+        return -1;
+    }
+
+    int num_terms = 0;
+    for (int i = 0; i < idx->capacity; i++) {
+        if (idx->table[i].term != NULL && idx->table[i].num_docs > 0) num_terms++;
+    }
+
+    uint32_t magic = INDEX_MAGIC, version = INDEX_VERSION;
+    writer_put(&w, &magic, sizeof(magic));
+    writer_put(&w, &version, sizeof(version));
+    writer_put(&w, &idx->num_docs, sizeof(int));
+    writer_put(&w, &num_terms, sizeof(int));
+    writer_put(&w, &idx->max_doc_id, sizeof(int));
+
+    for (int i = 0; i < idx->num_docs; i++) {
+        writer_put(&w, &idx->docs[i].id, sizeof(int));
+        writer_put(&w, &idx->docs[i].mtime, sizeof(int64_t));
+        writer_put(&w, &idx->docs[i].size, sizeof(int64_t));
+        writer_put(&w, &idx->docs[i].length, sizeof(int64_t));
+    }
+
+    for (int i = 0; i < idx->capacity; i++) {
+        const Posting* p = &idx->table[i];
+        if (p->term == NULL || p->num_docs == 0) continue; // Termos sem documentos não são gravados.
+        writer_put(&w, &p->term_len, sizeof(int));
+        writer_put(&w, p->term, p->term_len);
+        writer_put(&w, &p->num_docs, sizeof(int));
+        writer_put(&w, p->doc_ids, p->num_docs * sizeof(int));
+        writer_put(&w, p->tfs, p->num_docs * sizeof(int));
+    }
+    writer_flush(&w);
+    free(w.buf);
+
+    if (close(w.fd) < 0 || w.failed || rename(tmp_path, path) < 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lê `len` bytes do buffer de carregamento, verificando os limites.
+ */
+static int reader_get(const char** pos, const char* end, void* out, size_t len) {
+    if ((size_t)(end - *pos) < len) return -1;
+    memcpy(out, *pos, len);
+    *pos += len;
+    return 0;
+}
+
+/**
+ * @brief Reconstrói a lista de termos de cada documento a partir das listas dos termos (o
+ * ficheiro só guarda estas últimas).
+ *
+ * Percorre os termos por ordem de número, por isso cada lista já sai ordenada: basta uma
+ * passagem para medir os bytes de cada uma e outra para as escrever.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória ou se uma lista referir um documento
+ * que não está registado.
+ */
+static int build_document_terms(InvertedIndex* idx) {
+    int n = idx->num_docs > 0 ? idx->num_docs : 1;
+    int* sizes = calloc(n, sizeof(int));
+    int* last = calloc(n, sizeof(int)); // Último número de termo de cada documento.
+    int result = (sizes && last) ? 0 : -1;
+
+    for (int pass = 0; pass < 2 && result == 0; pass++) {
+        for (int t = 0; t < idx->num_terms && result == 0; t++) {
+            const Posting* p = find_slot(idx->table, idx->capacity, idx->terms[t], strlen(idx->terms[t]));
+            for (int j = 0; j < p->num_docs; j++) {
+                int pos = find_indexed_doc(idx, p->doc_ids[j]);
+                if (pos < 0) { result = -1; break; }
+                IndexedDoc* doc = &idx->docs[pos];
+                unsigned delta = (unsigned)(t - last[pos]);
+                last[pos] = t;
+                if (pass == 0) {
+                    do { sizes[pos]++; delta >>= 7; } while (delta);
+                    doc->num_terms++;
+                    continue;
+                }
+                while (delta >= 0x80) {
+                    doc->term_ids[doc->term_ids_size++] = (unsigned char)(delta | 0x80);
+                    delta >>= 7;
+                }
+                doc->term_ids[doc->term_ids_size++] = (unsigned char)delta;
+            }
+        }
+        for (int i = 0; pass == 0 && i < idx->num_docs && result == 0; i++) {
+            free(idx->docs[i].term_ids); // Lista vazia de register_indexed_doc.
+            idx->docs[i].term_ids = malloc(sizes[i] > 0 ? sizes[i] : 1);
+            if (!idx->docs[i].term_ids) result = -1;
+            last[i] = 0;
+        }
+    }
+    free(sizes);
+    free(last);
+    return result;
+}
+
+/**
+ * @brief Carrega o índice a partir do disco, substituindo o conteúdo atual.
+ *
+ * @param idx O índice (já inicializado).
+ * @param path Caminho do ficheiro.
+ * @return 0 em caso de sucesso, -1 se o ficheiro não existir ou estiver corrompido
+ * (nesse caso o índice fica vazio).
+ */
+int index_load(InvertedIndex* idx, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    char* data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = malloc(st.st_size);
+    }
+    if (!data) { close(fd); return -1; }
+
+    size_t total = 0;
+    while (total < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + total, st.st_size - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += n;
+    }
+    close(fd);
+
+    index_free(idx);
+    if (index_init(idx) != 0) { free(data); return -1; }
+
+    const char* pos = data;
+    const char* end = data + total;
+    uint32_t magic = 0, version = 0;
+    int num_docs = 0, num_terms = 0, max_doc_id = 0;
+    int ok = reader_get(&pos, end, &magic, sizeof(magic)) == 0 &&
+             reader_get(&pos, end, &version, sizeof(version)) == 0 &&
+             reader_get(&pos, end, &num_docs, sizeof(int)) == 0 &&
+             reader_get(&pos, end, &num_terms, sizeof(int)) == 0 &&
+             reader_get(&pos, end, &max_doc_id, sizeof(int)) == 0 &&
+             magic == INDEX_MAGIC && version == INDEX_VERSION && num_docs >= 0 && num_terms >= 0;
+
+    for (int i = 0; ok && i < num_docs; i++) {
+        IndexedDoc d;
+        ok = reader_get(&pos, end, &d.id, sizeof(int)) == 0 &&
+             reader_get(&pos, end, &d.mtime, sizeof(int64_t)) == 0 &&
+             reader_get(&pos, end, &d.size, sizeof(int64_t)) == 0 &&
+             reader_get(&pos, end, &d.length, sizeof(int64_t)) == 0 &&
+             d.id >= 0 && d.length >= 0 &&
+             register_indexed_doc(idx, d.id, d.mtime, d.size, d.length, NULL, 0) == 0;
+    }
+
+    for (int i = 0; ok && i < num_terms; i++) {
+        int term_len = 0, n = 0;
+        ok = reader_get(&pos, end, &term_len, sizeof(int)) == 0 && term_len > 0 && term_len <= end - pos;
+        if (!ok) break;
+        const char* term = pos;
+        pos += term_len;
+        ok = reader_get(&pos, end, &n, sizeof(int)) == 0 && n >= 0 && (size_t)n <= (end - pos) / (2 * sizeof(int));
+        if (!ok) break;
+
+        Posting* p = get_or_insert_term(idx, term, term_len);
+        int* ids = malloc((n > 0 ? n : 1) * sizeof(int));
+        int* tfs = malloc((n > 0 ? n : 1) * sizeof(int));
+        ok = p != NULL && ids != NULL && tfs != NULL && p->doc_ids == NULL;
+        if (!ok) { free(ids); free(tfs); break; }
+        memcpy(ids, pos, n * sizeof(int));
+        pos += n * sizeof(int);
+        memcpy(tfs, pos, n * sizeof(int));
+        pos += n * sizeof(int);
+        for (int j = 0; j < n && ok; j++) {
+            if (ids[j] < 0 || tfs[j] <= 0) ok = 0;
+            else if (ids[j] > idx->max_doc_id) idx->max_doc_id = ids[j]; // Protege a união em index_search.
+        }
+        p->doc_ids = ids;
+        p->tfs = tfs;
+        p->num_docs = n;
+        p->capacity = n > 0 ? n : 1;
+    }
+    free(data);
+    if (ok) ok = build_document_terms(idx) == 0;
+
+    if (!ok) {
+        index_free(idx);
+        index_init(idx);
+        return -1;
+    }
+    if (max_doc_id > idx->max_doc_id) idx->max_doc_id = max_doc_id;
+    idx->modified = 0;
+    return 0;
+}
@@ -0,0 +1,425 @@
+#define _GNU_SOURCE // Para memmem e memrchr.
+#include "Document_Struct.h"
+#include "Matcher.h"
+#include <pthread.h>    // Para pthread_once (deteção do processador feita uma única vez)
+
+#if defined(__x86_64__)
+#include <immintrin.h>  // Para as intrínsecas SSE2 e AVX2
+#define MATCHER_HAVE_X86_KERNELS 1
+#endif
+
+/**
+ * @brief Indica se a palavra-chave contém metacaracteres de uma expressão regular básica (BRE).
+ *
+ * Em BRE (o modo por defeito do grep) apenas `\ . [ * ^ $` têm significado especial;
+ * `+ ? { } | ( )` são literais a menos que sejam precedidos por '\'.
+ *
+ * @param keyword A palavra-chave a analisar.
+ * @return 1 se a palavra-chave pode ser procurada como texto literal, 0 caso contrário.
+ */
+static int is_literal_keyword(const char* keyword) {
+    return strpbrk(keyword, "\\.[*^$") == NULL;
+}
+
+static int best_kernel = MATCHER_KERNEL_SCALAR;
+static pthread_once_t best_kernel_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Escolhe o núcleo mais rápido suportado pelo processador (CPUID).
+ */
+static void detect_best_kernel(void) {
+#ifdef MATCHER_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    best_kernel = __builtin_cpu_supports("avx2") ? MATCHER_KERNEL_AVX2 : MATCHER_KERNEL_SSE2;
+#else
+    best_kernel = MATCHER_KERNEL_SCALAR;
+#endif
+}
+
+/**
+ * @brief Devolve o núcleo de pesquisa literal mais rápido suportado por este processador.
+ */
+int matcher_best_kernel(void) {
+    pthread_once(&best_kernel_once, detect_best_kernel);
+    return best_kernel;
+}
+
+/**
+ * @brief Indica se um núcleo pode ser usado neste processador.
+ */
+int matcher_kernel_supported(int kernel) {
+    return kernel >= MATCHER_KERNEL_SCALAR && kernel <= matcher_best_kernel();
+}
+
+/**
+ * @brief Devolve o nome de um núcleo, para mensagens.
+ */
+const char* matcher_kernel_name(int kernel) {
+    switch (kernel) {
+        case MATCHER_KERNEL_SSE2: return "SSE2";
+        case MATCHER_KERNEL_AVX2: return "AVX2";
+        default: return "escalar";
+    }
+}
+
+/**
+ * @brief Conta as linhas com a palavra-chave literal com `memmem` (núcleo escalar).
+ *
+ * Salta de ocorrência em ocorrência e, após cada uma, para o início da linha seguinte,
+ * para que várias ocorrências na mesma linha contem apenas uma vez.
+ */
+static long count_literal_scalar(const char* p, const char* end, const char* kw, size_t kw_len, int stop_at_first) {
+    long count = 0;
+    while (p < end) {
+        const char* hit = memmem(p, end - p, kw, kw_len);
+        if (!hit) break;
+        count++;
+        if (stop_at_first) break;
+
+        const char* nl = memchr(hit + kw_len, '\n', end - (hit + kw_len));
+        if (!nl) break; // Ocorrência na última linha (sem '\n').
+        p = nl + 1;
+    }
+    return count;
+}
+
+#ifdef MATCHER_HAVE_X86_KERNELS
+// Os núcleos vetoriais seguem o mesmo contrato que `count_literal_scalar`. Para cada bloco de
+// W posições (16 ou 32), comparam o primeiro byte da palavra-chave com o bloco que começa em
+// i e o último byte com o bloco que começa em i + kw_len - 1: cada bit da máscara resultante é
+// uma posição candidata, confirmada com `memcmp` dos bytes do meio. Depois de uma ocorrência,
+// o '\n' seguinte procura-se primeiro na máscara de '\n' do mesmo bloco e só depois com memchr.
+// O fim do bloco (menos de W + kw_len - 1 bytes) é tratado pelo núcleo escalar.
+
+/**
+ * @brief Núcleo SSE2 (16 posições por iteração). Requer kw_len >= 1.
+ */
+static long count_literal_sse2(const char* buf, size_t len, const char* kw, size_t kw_len, int stop_at_first) {
+    const __m128i first = _mm_set1_epi8(kw[0]);
+    const __m128i last = _mm_set1_epi8(kw[kw_len - 1]);
+    const __m128i newline = _mm_set1_epi8('\n');
+    long count = 0;
+    size_t i = 0;
+
+    while (i + kw_len - 1 + 16 <= len) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(buf + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(buf + i + kw_len - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                        _mm_cmpeq_epi8(block_last, last)));
+        size_t next = i + 16;
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (kw_len <= 2 || memcmp(buf + i + bit + 1, kw + 1, kw_len - 2) == 0) {
+                count++;
+                if (stop_at_first) return count;
+                unsigned after = bit + kw_len; // Primeira posição (relativa a i) depois da ocorrência.
+                unsigned newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(block_first, newline));
+                newlines = (after < 16) ? (newlines & (~0u << after)) : 0;
+                if (newlines) {
+                    next = i + __builtin_ctz(newlines) + 1;
+                } else {
+                    const char* nl = memchr(buf + i + after, '\n', len - (i + after));
+                    if (!nl) return count; // Ocorrência na última linha (sem '\n').
+                    next = nl - buf + 1;
+                }
+                break;
+            }
+            mask &= mask - 1;
+        }
+        i = next;
+    }
+    if (i < len) count += count_literal_scalar(buf + i, buf + len, kw, kw_len, stop_at_first);
+    return count;
+}
+
+/**
+ * @brief Núcleo AVX2 (32 posições por iteração). Requer kw_len >= 1 e um processador com AVX2.
+ */
+__attribute__((target("avx2")))
+static long count_literal_avx2(const char* buf, size_t len, const char* kw, size_t kw_len, int stop_at_first) {
+    const __m256i first = _mm256_set1_epi8(kw[0]);
+    const __m256i last = _mm256_set1_epi8(kw[kw_len - 1]);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    long count = 0;
+    size_t i = 0;
+
+    while (i + kw_len - 1 + 32 <= len) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(buf + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(buf + i + kw_len - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                                        _mm256_cmpeq_epi8(block_last, last)));
+        size_t next = i + 32;
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (kw_len <= 2 || memcmp(buf + i + bit + 1, kw + 1, kw_len - 2) == 0) {
+                count++;
+                if (stop_at_first) return count;
+                unsigned after = bit + kw_len;
+                unsigned newlines = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block_first, newline));
+                newlines = (after < 32) ? (newlines & (~0u << after)) : 0;
+                if (newlines) {
+                    next = i + __builtin_ctz(newlines) + 1;
+                } else {
+                    const char* nl = memchr(buf + i + after, '\n', len - (i + after));
+                    if (!nl) return count;
+                    next = nl - buf + 1;
+                }
+                break;
+            }
+            mask &= mask - 1;
+        }
+        i = next;
+    }
+    if (i < len) count += count_literal_scalar(buf + i, buf + len, kw, kw_len, stop_at_first);
+    return count;
+}
+#endif
+
+/**
+ * @brief Prepara um Matcher para a palavra-chave indicada.
+ *
+ * @param m Matcher a inicializar.
+ * @param keyword A palavra-chave (não é copiada).
+ * @return 0 em caso de sucesso, -1 se a palavra-chave não for suportada em processo
+ * (contém '\n' ou é uma expressão inválida). Nesse caso o Matcher não precisa de ser destruído.
+ */
+int matcher_init(Matcher* m, const char* keyword) {
+    if (!m || !keyword) return -1;
+    if (strchr(keyword, '\n') != NULL) return -1; // O grep trata cada linha como um padrão distinto.
+
+    m->keyword = keyword;
+    m->keyword_len = strlen(keyword);
+    m->is_literal = is_literal_keyword(keyword);
+    m->kernel = matcher_best_kernel();
+
+    // REG_NEWLINE impede que '.' e listas negadas atravessem '\n' e faz '^'/'$' coincidir com
+    // limites de linha, pelo que uma procura sobre um bloco inteiro equivale a procurar linha a linha.
+    if (!m->is_literal && regcomp(&m->regex, keyword, REG_NEWLINE) != 0) {
+        return -1; // Expressão inválida: deixa o grep decidir (e reportar) como antes.
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta os recursos associados a um Matcher inicializado com sucesso.
+ *
+ * @param m O Matcher a destruir.
+ */
+void matcher_destroy(Matcher* m) {
+    if (m && !m->is_literal) {
+        regfree(&m->regex);
+    }
+}
+
+/**
+ * @brief Conta as linhas de um bloco de memória que contêm a palavra-chave.
+ *
+ * O bloco é tratado como uma sequência de linhas terminadas por '\n'; uma última linha
+ * sem '\n' também conta (tal como no grep).
+ *
+ * @param m Matcher já inicializado.
+ * @param buf Início do bloco.
+ * @param len Tamanho do bloco em bytes.
+ * @param stop_at_first Se diferente de 0, pára na primeira linha encontrada (equivalente a `grep -q`).
+ * @return O número de linhas com pelo menos uma ocorrência.
+ */
+long matcher_count_lines_buffer(const Matcher* m, const char* buf, size_t len, int stop_at_first) {
+    const char* p = buf;
+    const char* end = buf + len;
+    long count = 0;
+
+    if (m->is_literal) {
+#ifdef MATCHER_HAVE_X86_KERNELS
+        if (m->keyword_len > 0 && m->kernel == MATCHER_KERNEL_AVX2) {
+            return count_literal_avx2(buf, len, m->keyword, m->keyword_len, stop_at_first);
+        }
+        if (m->keyword_len > 0 && m->kernel == MATCHER_KERNEL_SSE2) {
+            return count_literal_sse2(buf, len, m->keyword, m->keyword_len, stop_at_first);
+        }
+#endif
+        return count_literal_scalar(p, end, m->keyword, m->keyword_len, stop_at_first);
+    }
+
+    // Expressão regular: procura no resto do bloco de uma só vez (REG_STARTEND delimita-o sem
+    // copiar) e, após cada ocorrência, continua no início da linha seguinte. Evita uma chamada
+    // a `regexec` por linha, cujo custo fixo dominava em ficheiros com muitas linhas curtas.
+    while (p < end) {
+        regmatch_t match;
+        match.rm_so = 0;
+        match.rm_eo = end - p;
+        if (regexec(&m->regex, p, 1, &match, REG_STARTEND) != 0) break;
+        count++;
+        if (stop_at_first) break;
+
+        const char* hit = p + match.rm_so;
+        const char* nl = memchr(hit, '\n', end - hit);
+        if (!nl) break; // Ocorrência na última linha (sem '\n').
+        p = nl + 1;
+    }
+    return count;
+}
+
+/**
+ * @brief Conta as linhas de um ficheiro aberto que contêm a palavra-chave.
+ *
+ * Lê o ficheiro em blocos de MATCHER_READ_CHUNK bytes e processa apenas linhas completas;
+ * o resto do bloco (linha partida) é transportado para a leitura seguinte. Se uma linha
+ * não couber no buffer, o buffer é duplicado. O buffer termina sempre em '\0' (byte extra),
+ * porque algumas implementações de `regexec` (ex: sanitizers) fazem `strlen` da entrada
+ * mesmo com REG_STARTEND.
+ *
+ * @param m Matcher já inicializado.
+ * @param fd Descritor aberto para leitura.
+ * @param stop_at_first Se diferente de 0, pára na primeira linha encontrada.
+ * @return O número de linhas encontradas, ou -1 em caso de erro de leitura/alocação.
+ */
+long matcher_count_lines_fd(const Matcher* m, int fd, int stop_at_first) {
+    size_t capacity = MATCHER_READ_CHUNK;
+    size_t used = 0;
+    long total = 0;
+    char* buf = malloc(capacity + 1);
+    if (!buf) return -1;
+
+    for (;;) {
+        if (used == capacity) { // Linha maior do que o buffer.
+            char* bigger = realloc(buf, capacity * 2 + 1);
+            if (!bigger) { free(buf); return -1; }
+            buf = bigger;
+            capacity *= 2;
+        }
+
+        ssize_t n = read(fd, buf + used, capacity - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return -1;
+        }
+        if (n == 0) break; // EOF.
+        used += n;
+        buf[used] = '\0';
+
+        const char* last_nl = memrchr(buf, '\n', used);
+        if (!last_nl) continue;
+
+        size_t complete = last_nl - buf + 1;
+        total += matcher_count_lines_buffer(m, buf, complete, stop_at_first);
+        if (stop_at_first && total > 0) { free(buf); return total; }
+
+        memmove(buf, buf + complete, used - complete);
+        used -= complete;
+        buf[used] = '\0';
+    }
+
+    if (used > 0) { // Última linha sem '\n'.
+        total += matcher_count_lines_buffer(m, buf, used, stop_at_first);
+    }
+    free(buf);
+    return total;
+}
+
+/**
+ * @brief Conta as linhas de um ficheiro (por caminho) que contêm a palavra-chave.
+ *
+ * @param m Matcher já inicializado.
+ * @param path Caminho completo do ficheiro.
+ * @param stop_at_first Se diferente de 0, pára na primeira linha encontrada.
+ * @return O número de linhas encontradas, ou -1 se o ficheiro não puder ser lido.
+ */
+long matcher_count_lines_file(const Matcher* m, const char* path, int stop_at_first) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    long count = matcher_count_lines_fd(m, fd, stop_at_first);
+    close(fd);
+    return count;
+}
+
+/**
+ * @brief Conta linhas com a palavra-chave através de `grep keyword path | wc -l`.
+ *
+ * Implementação original (dois processos filho ligados por pipes). Mantida como recurso
+ * para palavras-chave que o Matcher não suporta e como referência nos benchmarks.
+ *
+ * @param path Caminho completo do ficheiro.
+ * @param keyword A palavra-chave a procurar.
+ * @return O número de linhas encontradas, ou -1 em caso de erro.
+ */
+long matcher_count_lines_exec(const char* path, const char* keyword) {
+    int pipe_grep_wc[2] = {-1, -1};
+    int pipe_wc_parent[2] = {-1, -1};
+    pid_t pid_grep, pid_wc;
+    long line_count = -1;
+
+    if (pipe(pipe_grep_wc) < 0 || pipe(pipe_wc_parent) < 0) {
+        perror("Erro ao criar pipes para contagem de linhas");
+        if (pipe_grep_wc[0] >= 0) { close(pipe_grep_wc[0]); close(pipe_grep_wc[1]); }
+        if (pipe_wc_parent[0] >= 0) { close(pipe_wc_parent[0]); close(pipe_wc_parent[1]); }
+        return -1;
+    }
+
+    // Fork para 'grep'.
+    pid_grep = fork();
+    if (pid_grep == 0) { // Processo filho (grep).
+        close(pipe_grep_wc[0]); // Fecha leitura do pipe grep->wc.
+        dup2(pipe_grep_wc[1], STDOUT_FILENO); // Redireciona stdout para escrita no pipe grep->wc.
+        close(pipe_grep_wc[1]); // Fecha escrita do pipe grep->wc.
+
+        close(pipe_wc_parent[0]); // Fecha extremidades não usadas do pipe wc->parent.
+        close(pipe_wc_parent[1]);
+
+        execlp("grep", "grep", keyword, path, (char*)NULL);
+        perror("Erro ao executar grep");
+        _exit(1); // Termina com erro se execlp falhar.
+    } else if (pid_grep < 0) {
+        perror("Erro no fork para grep");
+        close(pipe_grep_wc[0]); close(pipe_grep_wc[1]);
+        close(pipe_wc_parent[0]); close(pipe_wc_parent[1]);
+        return -1;
+    }
+
+    // Fork para 'wc'.
+    pid_wc = fork();
+    if (pid_wc == 0) { // Processo filho (wc).
+        close(pipe_grep_wc[1]); // Fecha escrita do pipe grep->wc.
+        dup2(pipe_grep_wc[0], STDIN_FILENO); // Redireciona stdin para leitura do pipe grep->wc.
+        close(pipe_grep_wc[0]); // Fecha leitura do pipe grep->wc.
+
+        close(pipe_wc_parent[0]); // Fecha leitura do pipe wc->parent.
+        dup2(pipe_wc_parent[1], STDOUT_FILENO); // Redireciona stdout para escrita no pipe wc->parent.
+        close(pipe_wc_parent[1]);
+
+        execlp("wc", "wc", "-l", (char*)NULL);
+        perror("Erro ao executar wc");
+        _exit(1); // Termina com erro se execlp falhar.
+    } else if (pid_wc < 0) {
+        perror("Erro no fork para wc");
+        close(pipe_grep_wc[0]); close(pipe_grep_wc[1]);
+        close(pipe_wc_parent[0]); close(pipe_wc_parent[1]);
+        waitpid(pid_grep, NULL, 0); // Limpa processo grep.
+        return -1;
+    }
+
+    // Processo pai.
+    close(pipe_grep_wc[0]); // Fecha ambas as extremidades do pipe grep->wc.
+    close(pipe_grep_wc[1]);
+    close(pipe_wc_parent[1]); // Fecha escrita do pipe wc->parent.
+
+    char buffer[32];
+    ssize_t bytes_read = read(pipe_wc_parent[0], buffer, sizeof(buffer) - 1);
+    if (bytes_read > 0) {
+        buffer[bytes_read] = '\0';
+        line_count = atol(buffer);
+    } else if (bytes_read == 0) { // EOF, pode significar 0 linhas.
+        line_count = 0;
+    } else {
+        perror("Erro ao ler do pipe wc->parent");
+        line_count = -1; // Erro na leitura.
+    }
+
+    close(pipe_wc_parent[0]); // Fecha leitura do pipe wc->parent.
+
+    // Espera pelos processos filho.
+    waitpid(pid_grep, NULL, 0);
+    waitpid(pid_wc, NULL, 0);
+
+    return line_count;
+}
@@ -0,0 +1,588 @@
+#define _GNU_SOURCE // Para memmem.
+#include "Meta_Index.h"
+#include <errno.h>      // Para errno, EINTR
+#include <limits.h>     // Para INT_MIN, INT_MAX
+#include <stdlib.h>     // Para malloc, realloc, calloc, free, qsort
+#include <string.h>     // Para memcpy, memmove, memchr, memmem, strndup
+#include <sys/stat.h>   // Para fstat
+#include <unistd.h>     // Para write, pread
+
+#define META_INITIAL_CAPACITY 1024  // Posições iniciais de cada tabela (potência de 2).
+#define META_IO_BUFFER (64 * 1024)  // Tamanho dos blocos de escrita (bytes).
+
+/**
+ * @brief Normaliza um texto (ver Meta_Index.h): minúsculas, espaços seguidos reduzidos a um, sem espaços nas pontas.
+ *
+ * Os bytes de controlo contam como espaço (as marcas META_TITLE_START/END nunca aparecem no resultado).
+ *
+ * @param text O texto (até `max` bytes ou ao primeiro '\0').
+ * @param out Recebe o texto normalizado, terminado em '\0'.
+ * @param out_size Capacidade de out (basta max + 1).
+ * @return O comprimento do texto normalizado.
+ */
+size_t meta_normalize(const char* text, size_t max, char* out, size_t out_size) {
+    size_t len = 0;
+    int pending_space = 0;
+    for (size_t i = 0; i < max && text[i] != '\0' && len + 1 < out_size; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c <= ' ') {
+            pending_space = (len > 0);
+            continue;
+        }
+        if (pending_space && len + 2 < out_size) out[len++] = ' ';
+        pending_space = 0;
+        out[len++] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : (char)c;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Valor numérico de um ano (só algarismos, até MAX_YEAR_SIZE - 1).
+ *
+ * @return O ano, ou -1 se não for um número.
+ */
+int meta_year_value(const char* year) {
+    size_t len = strnlen(year, MAX_YEAR_SIZE);
+    if (len == 0 || len >= MAX_YEAR_SIZE) return -1;
+    int value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (year[i] < '0' || year[i] > '9') return -1;
+        value = value * 10 + (year[i] - '0');
+    }
+    return value;
+}
+
+/**
+ * @brief Separa o campo `authors` nos seus autores normalizados (separados por ';').
+ *
+ * @param names Recebe os autores, seguidos, cada um terminado em '\0' (espaço para MAX_AUTHORS_SIZE + 1 bytes).
+ * @return O número de autores (os vazios são ignorados).
+ */
+static int split_authors(const char* authors, char* names) {
+    int count = 0;
+    size_t total = strnlen(authors, MAX_AUTHORS_SIZE);
+    size_t used = 0;
+    for (size_t start = 0; start < total; ) {
+        const char* sep = memchr(authors + start, ';', total - start);
+        size_t part = sep ? (size_t)(sep - (authors + start)) : total - start;
+        size_t len = meta_normalize(authors + start, part, names + used, MAX_AUTHORS_SIZE + 1 - used);
+        if (len > 0) {
+            used += len + 1;
+            count++;
+        }
+        start += part + 1;
+    }
+    return count;
+}
+
+/**
+ * @brief Indica se algum dos autores do campo `authors` é o autor indicado (depois de normalizados).
+ */
+int meta_author_matches(const char* authors, const char* author) {
+    char wanted[MAX_AUTHORS_SIZE + 1];
+    char names[MAX_AUTHORS_SIZE + 1];
+    meta_normalize(author, MAX_AUTHORS_SIZE, wanted, sizeof(wanted));
+    const char* name = names;
+    for (int n = split_authors(authors, names); n > 0; n--) {
+        if (strcmp(name, wanted) == 0) return 1;
+        name += strlen(name) + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Indica se o título contém (ou, com `prefix`, começa por) o texto, depois de normalizados.
+ */
+int meta_title_matches(const char* title, const char* text, int prefix) {
+    char t[MAX_TITLE_SIZE + 1], q[MAX_TITLE_SIZE + 1];
+    meta_normalize(title, MAX_TITLE_SIZE, t, sizeof(t));
+    size_t len = meta_normalize(text, MAX_TITLE_SIZE, q, sizeof(q));
+    return prefix ? strncmp(t, q, len) == 0 : strstr(t, q) != NULL;
+}
+
+// --- Tabelas de dispersão chave -> IDs ---
+
+static uint32_t hash_key(const char* key, size_t len) {
+    uint32_t h = 2166136261u; // FNV-1a.
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)key[i]) * 16777619u;
+    return h;
+}
+
+static int table_init(MetaTable* table) {
+    table->slots = calloc(META_INITIAL_CAPACITY, sizeof(MetaPosting));
+    table->capacity = table->slots ? META_INITIAL_CAPACITY : 0;
+    table->count = 0;
+    return table->slots ? 0 : -1;
+}
+
+static void table_free(MetaTable* table) {
+    for (int i = 0; i < table->capacity; i++) {
+        free(table->slots[i].key);
+        free(table->slots[i].ids);
+    }
+    free(table->slots);
+    memset(table, 0, sizeof(MetaTable));
+}
+
+/**
+ * @brief Posição com a chave indicada, ou a posição livre onde deveria ficar.
+ */
+static MetaPosting* find_slot(MetaPosting* slots, int capacity, const char* key, size_t len) {
+    uint32_t mask = (uint32_t)capacity - 1;
+    uint32_t i = hash_key(key, len) & mask;
+    while (slots[i].key != NULL) {
+        if (strncmp(slots[i].key, key, len) == 0 && slots[i].key[len] == '\0') return &slots[i];
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+/**
+ * @brief Lista de uma chave, ou NULL se a chave não existir.
+ */
+static const MetaPosting* table_get(const MetaTable* table, const char* key, size_t len) {
+    const MetaPosting* p = find_slot(table->slots, table->capacity, key, len);
+    return p->key ? p : NULL;
+}
+
+/**
+ * @brief Lista de uma chave, criada (vazia) se ainda não existir.
+ *
+ * @return A lista, ou NULL se faltar memória.
+ */
+static MetaPosting* table_insert(MetaTable* table, const char* key, size_t len) {
+    if ((table->count + 1) * 2 > table->capacity) { // Carga máxima de 50%.
+        int new_capacity = table->capacity * 2;
+        MetaPosting* slots = calloc(new_capacity, sizeof(MetaPosting));
+        if (!slots) return NULL;
+        for (int i = 0; i < table->capacity; i++) {
+            if (table->slots[i].key) {
+                *find_slot(slots, new_capacity, table->slots[i].key, strlen(table->slots[i].key)) = table->slots[i];
+            }
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->capacity = new_capacity;
+    }
+    MetaPosting* p = find_slot(table->slots, table->capacity, key, len);
+    if (!p->key) {
+        p->key = strndup(key, len);
+        if (!p->key) return NULL;
+        table->count++;
+    }
+    return p;
+}
+
+/**
+ * @brief Posição de um ID numa lista ordenada, ou -(posição de inserção) - 1 se não estiver.
+ */
+static int find_id(const int* ids, int n, int id) {
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ids[mid] == id) return mid;
+        if (ids[mid] < id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -lo - 1;
+}
+
+static int posting_add(MetaPosting* p, int id) {
+    int pos = (p->num_ids == 0 || p->ids[p->num_ids - 1] < id) ? -p->num_ids - 1 : find_id(p->ids, p->num_ids, id);
+    if (pos >= 0) return 0; // Já presente (ex: trigrama repetido no título).
+    pos = -pos - 1;
+    if (p->num_ids == p->capacity) {
+        int new_capacity = p->capacity ? p->capacity * 2 : 4;
+        int* grown = realloc(p->ids, new_capacity * sizeof(int));
+        if (!grown) return -1;
+        p->ids = grown;
+        p->capacity = new_capacity;
+    }
+    memmove(p->ids + pos + 1, p->ids + pos, (p->num_ids - pos) * sizeof(int));
+    p->ids[pos] = id;
+    p->num_ids++;
+    return 0;
+}
+
+static void posting_remove(MetaTable* table, const char* key, size_t len, int id) {
+    MetaPosting* p = find_slot(table->slots, table->capacity, key, len);
+    if (!p->key) return;
+    int pos = find_id(p->ids, p->num_ids, id);
+    if (pos < 0) return;
+    memmove(p->ids + pos, p->ids + pos + 1, (p->num_ids - pos - 1) * sizeof(int));
+    p->num_ids--; // A chave fica na tabela, sem documentos (não é gravada).
+}
+
+/**
+ * @brief Título normalizado com as marcas de início e de fim (ver Meta_Index.h).
+ *
+ * @param out Espaço para MAX_TITLE_SIZE + 3 bytes.
+ * @return O comprimento.
+ */
+static size_t marked_title(const char* title, char* out) {
+    out[0] = META_TITLE_START;
+    size_t len = 1 + meta_normalize(title, MAX_TITLE_SIZE, out + 1, MAX_TITLE_SIZE + 1);
+    out[len++] = META_TITLE_END;
+    out[len] = '\0';
+    return len;
+}
+
+// --- Índice ---
+
+/**
+ * @brief Inicializa os índices vazios.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int meta_index_init(MetaIndex* mi) {
+    memset(mi, 0, sizeof(MetaIndex));
+    if (table_init(&mi->authors) != 0 || table_init(&mi->trigrams) != 0) {
+        meta_index_free(mi);
+        return -1;
+    }
+    return 0;
+}
+
+void meta_index_free(MetaIndex* mi) {
+    table_free(&mi->authors);
+    table_free(&mi->trigrams);
+    free(mi->years);
+    memset(mi, 0, sizeof(MetaIndex));
+}
+
+/**
+ * @brief Primeira posição do índice de anos com (ano, ID) >= (year, id).
+ */
+static int year_lower_bound(const MetaIndex* mi, int year, int id) {
+    int lo = 0, hi = mi->num_years;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const YearEntry* e = &mi->years[mid];
+        if (e->year < year || (e->year == year && e->id < id)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Acrescenta um documento aos três índices.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória (o documento pode ter ficado só em parte
+ * dos índices: o chamador deve deixar de os usar).
+ */
+int meta_index_add(MetaIndex* mi, const Document* doc) {
+    char names[MAX_AUTHORS_SIZE + 1];
+    const char* name = names;
+    for (int n = split_authors(doc->authors, names); n > 0; n--) {
+        size_t len = strlen(name);
+        MetaPosting* p = table_insert(&mi->authors, name, len);
+        if (!p || posting_add(p, doc->id) != 0) return -1;
+        name += len + 1;
+    }
+
+    int year = meta_year_value(doc->year);
+    if (year >= 0) {
+        if (mi->num_years == mi->years_capacity) {
+            int new_capacity = mi->years_capacity ? mi->years_capacity * 2 : 256;
+            YearEntry* grown = realloc(mi->years, new_capacity * sizeof(YearEntry));
+            if (!grown) return -1;
+            mi->years = grown;
+            mi->years_capacity = new_capacity;
+        }
+        int pos = year_lower_bound(mi, year, doc->id);
+        if (pos == mi->num_years || mi->years[pos].year != year || mi->years[pos].id != doc->id) {
+            memmove(mi->years + pos + 1, mi->years + pos, (mi->num_years - pos) * sizeof(YearEntry));
+            mi->years[pos].year = year;
+            mi->years[pos].id = doc->id;
+            mi->num_years++;
+        }
+    }
+
+    char title[MAX_TITLE_SIZE + 3];
+    size_t len = marked_title(doc->title, title);
+    for (size_t i = 0; i + 3 <= len; i++) {
+        MetaPosting* p = table_insert(&mi->trigrams, title + i, 3);
+        if (!p || posting_add(p, doc->id) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Remove um documento dos três índices (com os metadados com que foi acrescentado).
+ */
+void meta_index_remove(MetaIndex* mi, const Document* doc) {
+    char names[MAX_AUTHORS_SIZE + 1];
+    const char* name = names;
+    for (int n = split_authors(doc->authors, names); n > 0; n--) {
+        posting_remove(&mi->authors, name, strlen(name), doc->id);
+        name += strlen(name) + 1;
+    }
+
+    int year = meta_year_value(doc->year);
+    int pos = (year >= 0) ? year_lower_bound(mi, year, doc->id) : mi->num_years;
+    if (pos < mi->num_years && mi->years[pos].year == year && mi->years[pos].id == doc->id) {
+        memmove(mi->years + pos, mi->years + pos + 1, (mi->num_years - pos - 1) * sizeof(YearEntry));
+        mi->num_years--;
+    }
+
+    char title[MAX_TITLE_SIZE + 3];
+    size_t len = marked_title(doc->title, title);
+    for (size_t i = 0; i + 3 <= len; i++) {
+        posting_remove(&mi->trigrams, title + i, 3, doc->id);
+    }
+}
+
+/**
+ * @brief Copia uma lista de IDs para um array novo.
+ *
+ * @return O número de IDs, ou -1 se faltar memória.
+ */
+static int copy_ids(const int* src, int count, int** ids) {
+    *ids = malloc((count + 1) * sizeof(int)); // +1: nunca malloc(0).
+    if (!*ids) return -1;
+    memcpy(*ids, src, count * sizeof(int));
+    return count;
+}
+
+/**
+ * @brief Documentos de um autor (igualdade depois de normalizado).
+ *
+ * @param ids Recebe os IDs por ordem crescente (a libertar com free).
+ * @return O número de IDs, ou -1 se faltar memória.
+ */
+int meta_index_by_author(const MetaIndex* mi, const char* author, int** ids) {
+    char key[MAX_AUTHORS_SIZE + 1];
+    size_t len = meta_normalize(author, MAX_AUTHORS_SIZE, key, sizeof(key));
+    const MetaPosting* p = table_get(&mi->authors, key, len);
+    return p ? copy_ids(p->ids, p->num_ids, ids) : copy_ids(NULL, 0, ids);
+}
+
+/**
+ * @brief Documentos com o ano no intervalo [from, to].
+ *
+ * @param ids Recebe os IDs por ordem de ano e, no mesmo ano, de ID (a libertar com free).
+ * @return O número de IDs, ou -1 se faltar memória.
+ */
+int meta_index_by_year(const MetaIndex* mi, int from, int to, int** ids) {
+    int first = year_lower_bound(mi, from, INT_MIN);
+    int last = (to < INT_MAX) ? year_lower_bound(mi, to + 1, INT_MIN) : mi->num_years;
+    int count = (last > first) ? last - first : 0;
+    *ids = malloc((count + 1) * sizeof(int));
+    if (!*ids) return -1;
+    for (int i = 0; i < count; i++) (*ids)[i] = mi->years[first + i].id;
+    return count;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Documentos cujo título contém (ou, com `prefix`, começa por) o texto.
+ *
+ * @param ids Recebe os IDs por ordem crescente (a libertar com free).
+ * @param exact Recebe 1 se a lista é exata, 0 se são candidatos a confirmar com `meta_title_matches`.
+ * @return O número de IDs, ou -1 se faltar memória.
+ */
+int meta_index_by_title(const MetaIndex* mi, const char* text, int prefix, int** ids, int* exact) {
+    char pattern[MAX_TITLE_SIZE + 2];
+    size_t len = 0;
+    if (prefix) pattern[len++] = META_TITLE_START;
+    len += meta_normalize(text, MAX_TITLE_SIZE, pattern + len, sizeof(pattern) - len);
+    *exact = (len <= 3);
+
+    if (len < 3) {
+        // União das listas dos trigramas que contêm o padrão (exata: o padrão cabe num trigrama).
+        int total = 0;
+        for (int i = 0; i < mi->trigrams.capacity; i++) {
+            const MetaPosting* p = &mi->trigrams.slots[i];
+            if (p->key && len > 0 && memmem(p->key, 3, pattern, len)) total += p->num_ids;
+        }
+        *ids = malloc((total + 1) * sizeof(int));
+        if (!*ids) return -1;
+        int count = 0;
+        for (int i = 0; i < mi->trigrams.capacity; i++) {
+            const MetaPosting* p = &mi->trigrams.slots[i];
+            if (!p->key || len == 0 || !memmem(p->key, 3, pattern, len)) continue;
+            memcpy(*ids + count, p->ids, p->num_ids * sizeof(int));
+            count += p->num_ids;
+        }
+        qsort(*ids, count, sizeof(int), compare_ints);
+        int unique = 0;
+        for (int i = 0; i < count; i++) {
+            if (unique == 0 || (*ids)[unique - 1] != (*ids)[i]) (*ids)[unique++] = (*ids)[i];
+        }
+        return unique;
+    }
+
+    // Interseção das listas dos trigramas do padrão, a partir da mais curta.
+    const MetaPosting* shortest = NULL;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        const MetaPosting* p = table_get(&mi->trigrams, pattern + i, 3);
+        if (!p || p->num_ids == 0) return copy_ids(NULL, 0, ids); // Um trigrama ausente: nenhum título.
+        if (!shortest || p->num_ids < shortest->num_ids) shortest = p;
+    }
+    int count = copy_ids(shortest->ids, shortest->num_ids, ids);
+    for (size_t i = 0; count > 0 && i + 3 <= len; i++) {
+        const MetaPosting* p = table_get(&mi->trigrams, pattern + i, 3);
+        if (p == shortest) continue;
+        int kept = 0;
+        for (int j = 0; j < count; j++) {
+            if (find_id(p->ids, p->num_ids, (*ids)[j]) >= 0) (*ids)[kept++] = (*ids)[j];
+        }
+        count = kept;
+    }
+    return count;
+}
+
+// --- Persistência (secção de "database.bin"; formato em Meta_Index.h) ---
+
+typedef struct {
+    int fd;
+    char* buf;
+    size_t used;
+    int failed;
+} MetaWriter;
+
+static void writer_put(MetaWriter* w, const void* data, size_t len) {
+    const char* src = data;
+    while (len > 0 && !w->failed) {
+        size_t n = META_IO_BUFFER - w->used;
+        if (n > len) n = len;
+        memcpy(w->buf + w->used, src, n);
+        w->used += n;
+        src += n;
+        len -= n;
+        if (w->used == META_IO_BUFFER) {
+            if (write(w->fd, w->buf, w->used) != (ssize_t)w->used) w->failed = 1;
+            w->used = 0;
+        }
+    }
+}
+
+static void write_table(MetaWriter* w, const MetaTable* table, int fixed_len) {
+    int count = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->slots[i].key && table->slots[i].num_ids > 0) count++;
+    }
+    writer_put(w, &count, sizeof(int));
+    for (int i = 0; i < table->capacity; i++) {
+        const MetaPosting* p = &table->slots[i];
+        if (!p->key || p->num_ids == 0) continue; // Chaves sem documentos não são gravadas.
+        if (!fixed_len) {
+            unsigned char len = (unsigned char)strlen(p->key);
+            writer_put(w, &len, 1);
+            writer_put(w, p->key, len);
+        } else {
+            writer_put(w, p->key, fixed_len);
+        }
+        writer_put(w, &p->num_ids, sizeof(int));
+        writer_put(w, p->ids, p->num_ids * sizeof(int));
+    }
+}
+
+/**
+ * @brief Escreve os índices na posição atual de fd.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro de escrita ou de alocação.
+ */
+int meta_index_write(const MetaIndex* mi, int fd) {
+    MetaWriter w = { fd, malloc(META_IO_BUFFER), 0, 0 };
+    if (!w.buf) return -1;
+    write_table(&w, &mi->authors, 0);
+    write_table(&w, &mi->trigrams, 3);
+    writer_put(&w, &mi->num_years, sizeof(int));
+    writer_put(&w, mi->years, mi->num_years * sizeof(YearEntry));
+    if (w.used > 0 && !w.failed && write(fd, w.buf, w.used) != (ssize_t)w.used) w.failed = 1;
+    free(w.buf);
+    return w.failed ? -1 : 0;
+}
+
+/**
+ * @brief Lê `len` bytes da secção, verificando os limites.
+ */
+static int reader_get(const char** pos, const char* end, void* out, size_t len) {
+    if ((size_t)(end - *pos) < len) return -1;
+    memcpy(out, *pos, len);
+    *pos += len;
+    return 0;
+}
+
+static int read_table(MetaTable* table, const char** pos, const char* end, int fixed_len) {
+    int count;
+    if (reader_get(pos, end, &count, sizeof(int)) != 0 || count < 0) return -1;
+    for (int i = 0; i < count; i++) {
+        unsigned char len = (unsigned char)fixed_len;
+        if (!fixed_len && reader_get(pos, end, &len, 1) != 0) return -1;
+        if (len == 0 || (size_t)(end - *pos) < len || memchr(*pos, '\0', len)) return -1;
+        const char* key = *pos;
+        *pos += len;
+        int n;
+        if (reader_get(pos, end, &n, sizeof(int)) != 0 || n <= 0 || (size_t)n > (end - *pos) / sizeof(int)) return -1;
+
+        MetaPosting* p = table_insert(table, key, len);
+        if (!p || p->ids) return -1; // Chave repetida: secção inválida.
+        if (copy_ids((const int*)*pos, n, &p->ids) < 0) return -1;
+        p->num_ids = p->capacity = n;
+        *pos += n * sizeof(int);
+        for (int j = 0; j < n; j++) {
+            if (p->ids[j] <= 0 || (j > 0 && p->ids[j] <= p->ids[j - 1])) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Lê os índices escritos por `meta_index_write` (até ao fim do ficheiro), substituindo os atuais.
+ *
+ * @param offset Offset da secção no ficheiro.
+ * @return 0 em caso de sucesso, -1 se estiver truncada ou inválida ou faltar memória (nesse
+ * caso os índices ficam vazios e devem ser reconstruídos a partir dos documentos).
+ */
+int meta_index_read(MetaIndex* mi, int fd, off_t offset) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < offset) return -1;
+    size_t size = st.st_size - offset;
+    char* data = malloc(size + 1);
+    if (!data) return -1;
+    size_t have = 0;
+    while (have < size) {
+        ssize_t n = pread(fd, data + have, size - have, offset + have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        have += n;
+    }
+
+    meta_index_free(mi);
+    const char* pos = data;
+    const char* end = data + have;
+    int num_years = 0;
+    int ok = (meta_index_init(mi) == 0) &&
+             read_table(&mi->authors, &pos, end, 0) == 0 &&
+             read_table(&mi->trigrams, &pos, end, 3) == 0 &&
+             reader_get(&pos, end, &num_years, sizeof(int)) == 0 &&
+             num_years >= 0 && (size_t)num_years <= (end - pos) / sizeof(YearEntry);
+    if (ok) {
+        mi->years = malloc((num_years + 1) * sizeof(YearEntry));
+        ok = (mi->years != NULL);
+    }
+    if (ok) {
+        memcpy(mi->years, pos, num_years * sizeof(YearEntry));
+        mi->num_years = num_years;
+        mi->years_capacity = num_years + 1;
+        for (int i = 1; ok && i < num_years; i++) {
+            const YearEntry* a = &mi->years[i - 1];
+            const YearEntry* b = &mi->years[i];
+            ok = (a->year < b->year || (a->year == b->year && a->id < b->id));
+        }
+    }
+    free(data);
+    if (!ok) {
+        meta_index_free(mi);
+        meta_index_init(mi);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,539 @@
+#define _GNU_SOURCE // Para qsort_r e memrchr.
+#include "Document_Struct.h"
+#include "Multi_Matcher.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>  // Para as intrínsecas AVX2 (filtro dos pares iniciais)
+#define MULTI_MATCHER_HAVE_AVX2 1
+#endif
+
+/**
+ * @brief Ordena posições de palavras-chave pelo texto (e, em caso de empate, pela posição).
+ */
+static int compare_keywords(const void* a, const void* b, void* ctx) {
+    const char* const* keywords = ctx;
+    int x = *(const int*)a, y = *(const int*)b;
+    int c = strcmp(keywords[x], keywords[y]);
+    return c ? c : x - y;
+}
+
+/**
+ * @brief Preenche `alias` (primeira palavra-chave igual a cada uma), ordenando as posições.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int find_duplicates(MultiMatcher* mm) {
+    int* order = malloc(mm->num_keywords * sizeof(int));
+    if (!order) return -1;
+    for (int k = 0; k < mm->num_keywords; k++) order[k] = k;
+    qsort_r(order, mm->num_keywords, sizeof(int), compare_keywords, (void*)mm->keywords);
+    for (int i = 0; i < mm->num_keywords; i++) {
+        int same = (i > 0 && strcmp(mm->keywords[order[i]], mm->keywords[order[i - 1]]) == 0);
+        mm->alias[order[i]] = same ? mm->alias[order[i - 1]] : order[i];
+    }
+    free(order);
+    return 0;
+}
+
+/**
+ * @brief Constrói o autómato de Aho-Corasick das palavras-chave MULTI_MATCHER_LITERAL.
+ *
+ * Primeiro a trie (uma transição por byte de cada palavra-chave), depois, por largura, a
+ * ligação de falha de cada estado; as transições em falta passam a ser as do estado de falha,
+ * que está mais perto da raiz e por isso já está completo.
+ *
+ * @param total_len Soma dos comprimentos das palavras-chave literais.
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int build_automaton(MultiMatcher* mm, size_t total_len) {
+    int num_classes = 1, literal = 0;
+    for (int k = 0; k < mm->num_keywords; k++) {
+        if (mm->kind[k] != MULTI_MATCHER_LITERAL) continue;
+        const unsigned char* kw = (const unsigned char*)mm->keywords[k];
+        for (unsigned second = 0; second < 256; second++) { // Uma palavra-chave de um byte começa antes de qualquer byte.
+            unsigned pair = ((unsigned)kw[0] << 8) | (kw[1] ? kw[1] : second);
+            mm->pair_starts[pair >> 3] |= 1u << (pair & 7);
+            if (kw[1]) break;
+        }
+        unsigned char bucket = 1u << (literal++ % 8); // Grupo da palavra-chave (ver `nibble_masks`).
+        mm->nibble_masks[0][kw[0] & 0x0F] |= bucket;
+        mm->nibble_masks[1][kw[0] >> 4] |= bucket;
+        for (int nibble = 0; nibble < 16; nibble++) {
+            if (kw[1] && nibble != (kw[1] & 0x0F)) continue;
+            mm->nibble_masks[2][nibble] |= bucket;
+        }
+        for (int nibble = 0; nibble < 16; nibble++) {
+            if (kw[1] && nibble != (kw[1] >> 4)) continue;
+            mm->nibble_masks[3][nibble] |= bucket;
+        }
+        for (; *kw; kw++) {
+            if (!mm->byte_class[*kw]) mm->byte_class[*kw] = num_classes++; // '\n' nunca aparece: no máximo 255 bytes.
+        }
+    }
+    while ((1 << mm->class_shift) < num_classes) mm->class_shift++; // Linhas com 2^class_shift colunas.
+    num_classes = 1 << mm->class_shift;
+    mm->num_classes = num_classes;
+
+    size_t max_states = total_len + 1;
+    mm->next = calloc(max_states * num_classes, sizeof(int32_t)); // 0: sem transição (ainda).
+    mm->output = malloc(max_states * sizeof(int32_t));
+    mm->match_link = malloc(max_states * sizeof(int32_t));
+    mm->dict_link = malloc(max_states * sizeof(int32_t));
+    int32_t* fail = malloc(max_states * sizeof(int32_t));
+    int32_t* queue = malloc(max_states * sizeof(int32_t));
+    if (!mm->next || !mm->output || !mm->match_link || !mm->dict_link || !fail || !queue) {
+        free(fail);
+        free(queue);
+        return -1;
+    }
+
+    mm->num_states = 1;
+    mm->output[0] = -1;
+    for (int k = 0; k < mm->num_keywords; k++) {
+        if (mm->kind[k] != MULTI_MATCHER_LITERAL) continue;
+        int32_t state = 0;
+        for (const unsigned char* kw = (const unsigned char*)mm->keywords[k]; *kw; kw++) {
+            int32_t* edge = &mm->next[(size_t)state * num_classes + mm->byte_class[*kw]];
+            if (*edge == 0) {
+                mm->output[mm->num_states] = -1;
+                *edge = mm->num_states++;
+            }
+            state = *edge;
+        }
+        mm->output[state] = k;
+    }
+
+    // Por largura: a falha de cada estado (e as suas ligações de output) é calculada quando o
+    // estado entra na fila, e a sua linha da tabela é completada quando sai.
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    mm->match_link[0] = mm->dict_link[0] = -1;
+    queue[tail++] = 0;
+    while (head < tail) {
+        int32_t state = queue[head++];
+        int32_t* row = &mm->next[(size_t)state * num_classes];
+        const int32_t* fail_row = &mm->next[(size_t)fail[state] * num_classes];
+        for (int c = 0; c < num_classes; c++) {
+            int32_t child = row[c];
+            if (child == 0) { // Sem filho na trie: segue a transição do estado de falha.
+                if (state != 0) row[c] = fail_row[c];
+                continue;
+            }
+            fail[child] = (state == 0) ? 0 : fail_row[c];
+            mm->dict_link[child] = mm->match_link[fail[child]];
+            mm->match_link[child] = (mm->output[child] >= 0) ? child : mm->dict_link[child];
+            queue[tail++] = child;
+        }
+    }
+    free(fail);
+    free(queue);
+
+    // Cada transição passa a guardar a linha do destino (estado << class_shift), negativa
+    // (-linha - 1) se o destino tiver ocorrências: o ciclo de pesquisa só testa o sinal.
+    size_t num_entries = (size_t)mm->num_states * num_classes;
+    for (size_t i = 0; i < num_entries; i++) {
+        int32_t target = mm->next[i];
+        int32_t target_row = target << mm->class_shift;
+        mm->next[i] = (mm->match_link[target] >= 0) ? -target_row - 1 : target_row;
+    }
+    return 0;
+}
+
+/**
+ * @brief Prepara um MultiMatcher para as palavras-chave indicadas.
+ *
+ * @param mm MultiMatcher a inicializar.
+ * @param keywords As palavras-chave (não são copiadas).
+ * @param num_keywords Número de palavras-chave (1 a MULTI_MATCHER_MAX_KEYWORDS).
+ * @return 0 em caso de sucesso, -1 se faltar memória ou houver demasiadas palavras-chave
+ * (nesse caso o MultiMatcher não precisa de ser destruído).
+ */
+int multi_matcher_init(MultiMatcher* mm, const char* const* keywords, int num_keywords) {
+    memset(mm, 0, sizeof(MultiMatcher));
+    if (num_keywords <= 0 || num_keywords > MULTI_MATCHER_MAX_KEYWORDS) return -1;
+    mm->num_keywords = num_keywords;
+    mm->keywords = keywords;
+    mm->kind = calloc(num_keywords, 1); // Zeros: nada a destruir se a inicialização falhar a meio.
+    mm->alias = malloc(num_keywords * sizeof(int));
+    mm->matchers = malloc(num_keywords * sizeof(Matcher));
+    if (!mm->kind || !mm->alias || !mm->matchers || find_duplicates(mm) != 0) {
+        multi_matcher_destroy(mm);
+        return -1;
+    }
+
+    size_t total_len = 0;
+    for (int k = 0; k < num_keywords; k++) {
+        Matcher* m = &mm->matchers[k];
+        if (mm->alias[k] != k) {
+            mm->kind[k] = MULTI_MATCHER_DUPLICATE;
+        } else if (matcher_init(m, keywords[k]) != 0) {
+            mm->kind[k] = MULTI_MATCHER_UNSUPPORTED;
+        } else if (m->is_literal && m->keyword_len > 0) {
+            mm->kind[k] = MULTI_MATCHER_LITERAL; // O Matcher literal não tem recursos a libertar.
+            total_len += m->keyword_len;
+            mm->num_literals++;
+        } else {
+            mm->kind[k] = MULTI_MATCHER_SINGLE;
+            mm->num_single++;
+            mm->needs_nul = 1;
+        }
+    }
+    if (mm->num_literals < MULTI_MATCHER_AUTOMATON_MIN_KEYWORDS) {
+        // Poucas literais: uma passagem SIMD por palavra-chave é mais rápida que o autómato.
+        for (int k = 0; k < num_keywords; k++) {
+            if (mm->kind[k] == MULTI_MATCHER_LITERAL) mm->kind[k] = MULTI_MATCHER_SINGLE;
+        }
+        mm->num_single += mm->num_literals;
+        mm->num_literals = 0;
+    }
+
+    mm->kernel = matcher_best_kernel();
+    if (mm->num_literals > 0 && build_automaton(mm, total_len) != 0) {
+        multi_matcher_destroy(mm);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta os recursos de um MultiMatcher inicializado com sucesso.
+ */
+void multi_matcher_destroy(MultiMatcher* mm) {
+    for (int k = 0; mm->kind && mm->matchers && k < mm->num_keywords; k++) {
+        if (mm->kind[k] == MULTI_MATCHER_SINGLE) matcher_destroy(&mm->matchers[k]);
+    }
+    free(mm->kind);
+    free(mm->alias);
+    free(mm->matchers);
+    free(mm->next);
+    free(mm->output);
+    free(mm->match_link);
+    free(mm->dict_link);
+    memset(mm, 0, sizeof(MultiMatcher));
+}
+
+/**
+ * @brief Indica se a pesquisa pode ler até ao '\0' a seguir ao bloco (há expressões regulares;
+ * ver `matcher_count_lines_fd`).
+ */
+int multi_matcher_needs_nul(const MultiMatcher* mm) {
+    return mm->needs_nul;
+}
+
+/**
+ * @brief Indica se alguma palavra-chave pode começar em p (p[0] e p[1] são os seus dois primeiros bytes).
+ */
+static inline int pair_starts(const unsigned char* bits, const unsigned char* p) {
+    unsigned pair = ((unsigned)p[0] << 8) | p[1];
+    return bits[pair >> 3] & (1u << (pair & 7));
+}
+
+#ifdef MULTI_MATCHER_HAVE_AVX2
+/**
+ * @brief Avança até à primeira posição onde uma palavra-chave pode começar (32 posições por iteração).
+ *
+ * Para cada posição i, cada um dos quatro nibbles de buf[i] e buf[i + 1] dá (com `vpshufb`) os
+ * grupos de palavras-chave que o aceitam; a posição é candidata se algum grupo aceitar os
+ * quatro. Todas as posições onde uma palavra-chave começa são candidatas (o contrário não):
+ * cada candidata é confirmada no mapa de pares.
+ *
+ * @return Essa posição, ou a primeira posição a menos de 33 bytes do fim.
+ */
+__attribute__((target("avx2")))
+static const unsigned char* skip_nibbles_avx2(const MultiMatcher* mm, const unsigned char* p, const unsigned char* end) {
+    const __m256i low0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mm->nibble_masks[0]));
+    const __m256i high0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mm->nibble_masks[1]));
+    const __m256i low1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mm->nibble_masks[2]));
+    const __m256i high1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mm->nibble_masks[3]));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    while (end - p >= 33) {
+        __m256i first = _mm256_loadu_si256((const __m256i*)p);
+        __m256i second = _mm256_loadu_si256((const __m256i*)(p + 1));
+        __m256i groups = _mm256_and_si256(
+            _mm256_and_si256(_mm256_shuffle_epi8(low0, _mm256_and_si256(first, nibble)),
+                             _mm256_shuffle_epi8(high0, _mm256_and_si256(_mm256_srli_epi16(first, 4), nibble))),
+            _mm256_and_si256(_mm256_shuffle_epi8(low1, _mm256_and_si256(second, nibble)),
+                             _mm256_shuffle_epi8(high1, _mm256_and_si256(_mm256_srli_epi16(second, 4), nibble))));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(groups, zero));
+        for (; mask; mask &= mask - 1) { // Confirma as candidatas no mapa de pares.
+            const unsigned char* candidate = p + __builtin_ctz(mask);
+            if (pair_starts(mm->pair_starts, candidate)) return candidate;
+        }
+        p += 32;
+    }
+    return p;
+}
+#endif
+
+/**
+ * @brief Avança até à primeira posição onde uma palavra-chave pode começar (ver `pair_starts`).
+ *
+ * @return Essa posição, ou o último byte do bloco.
+ */
+static const unsigned char* skip_to_candidate(const MultiMatcher* mm, const unsigned char* p, const unsigned char* end) {
+#ifdef MULTI_MATCHER_HAVE_AVX2
+    if (mm->kernel == MATCHER_KERNEL_AVX2) {
+        p = skip_nibbles_avx2(mm, p, end);
+        if (end - p >= 33) return p;
+    }
+#endif
+    while (p + 1 < end && !pair_starts(mm->pair_starts, p)) p++;
+    return p;
+}
+
+/**
+ * @brief Contagens de uma pesquisa com o autómato num bloco (partilhadas pelos troços).
+ */
+typedef struct {
+    const unsigned char* start; // Início do bloco (as linhas são identificadas pelo offset do início).
+    long* counts;
+    int stop_at_first;
+    int* remaining;             // Palavras-chave ainda por encontrar (só com stop_at_first).
+} LiteralScan;
+
+/**
+ * @brief Troço do bloco percorrido pelo autómato (começa no início de uma linha).
+ */
+typedef struct {
+    const unsigned char* p;       // Próximo byte.
+    const unsigned char* end;
+    const unsigned char* scanned; // Os bytes antes deste já foram vistos à procura de '\n'.
+    size_t line_start;            // Início da linha de scanned[-1].
+    int32_t row;                  // Estado atual << class_shift.
+    size_t* last_line;            // Início da última linha contada de cada palavra-chave neste troço (SIZE_MAX: nenhuma).
+} ScanLane;
+
+/**
+ * @brief Conta as palavras-chave que terminam em lane->p - 1 (o estado lane->row tem ocorrências).
+ *
+ * @return 1 se, com stop_at_first, já foram todas encontradas.
+ */
+static int report_matches(const MultiMatcher* mm, ScanLane* lane, LiteralScan* scan) {
+    if (lane->p > lane->scanned) { // Início da linha da ocorrência (as palavras-chave não têm '\n').
+        const unsigned char* nl = memrchr(lane->scanned, '\n', lane->p - lane->scanned);
+        if (nl) lane->line_start = nl + 1 - scan->start;
+        lane->scanned = lane->p;
+    }
+    for (int32_t match = mm->match_link[lane->row >> mm->class_shift]; match >= 0; match = mm->dict_link[match]) {
+        int k = mm->output[match];
+        if (lane->last_line[k] == lane->line_start || (scan->stop_at_first && scan->counts[k] > 0)) continue;
+        lane->last_line[k] = lane->line_start;
+        scan->counts[k]++;
+        if (scan->stop_at_first && --*scan->remaining == 0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Percorre um troço até ao fim, um byte de cada vez (ver `count_literals`).
+ *
+ * @param use_filter Se diferente de 0, salta na raiz para o próximo par inicial (`skip_to_candidate`).
+ * @return 1 se, com stop_at_first, já foram todas encontradas.
+ */
+static int scan_lane(const MultiMatcher* mm, ScanLane* lane, LiteralScan* scan, int use_filter) {
+    const int32_t* table = mm->next;
+    const unsigned char* byte_class = mm->byte_class;
+    while (lane->p < lane->end) {
+        if (lane->row == 0 && use_filter) { // Na raiz: nenhuma ocorrência em curso.
+            lane->p = skip_to_candidate(mm, lane->p, lane->end);
+        }
+        int32_t next = table[lane->row + byte_class[*lane->p++]];
+        if (next >= 0) {
+            lane->row = next;
+            continue;
+        }
+        lane->row = -next - 1; // Estado com ocorrências (ver `build_automaton`).
+        if (report_matches(mm, lane, scan)) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Percorre um bloco com o autómato e soma as linhas de cada palavra-chave literal.
+ *
+ * Com poucas palavras-chave, o bloco é percorrido de uma vez com o filtro dos pares iniciais.
+ * Com muitas, o filtro deixaria passar quase todas as posições e cada byte custa uma consulta
+ * à tabela, que depende do resultado da anterior (latência de uma leitura da memória). O bloco
+ * é então repartido em MULTI_MATCHER_LANES troços, cortados no início de uma linha, e os troços
+ * avançam intercalados, um byte de cada por iteração: as consultas de troços diferentes são
+ * independentes e o processador fá-las em paralelo. As linhas de troços diferentes são
+ * distintas, por isso os troços somam às mesmas contagens.
+ *
+ * @param last_line Espaço para MULTI_MATCHER_LANES × num_keywords posições, com SIZE_MAX.
+ * @param remaining Palavras-chave ainda por encontrar (só com stop_at_first).
+ */
+static void count_literals(const MultiMatcher* mm, const char* buf, size_t len, int stop_at_first,
+                           long* counts, size_t* last_line, int* remaining) {
+    const unsigned char* start = (const unsigned char*)buf;
+    const unsigned char* end = start + len;
+    LiteralScan scan = { start, counts, stop_at_first, remaining };
+
+    if (mm->num_literals <= MULTI_MATCHER_FILTER_MAX_KEYWORDS || len < MULTI_MATCHER_LANE_MIN_BYTES) {
+        ScanLane lane = { start, end, start, 0, 0, last_line };
+        scan_lane(mm, &lane, &scan, mm->num_literals <= MULTI_MATCHER_FILTER_MAX_KEYWORDS);
+        return;
+    }
+
+    ScanLane lanes[MULTI_MATCHER_LANES];
+    const unsigned char* lane_start = start;
+    for (int l = 0; l < MULTI_MATCHER_LANES; l++) {
+        const unsigned char* lane_end = end;
+        if (l < MULTI_MATCHER_LANES - 1) {
+            const unsigned char* cut = start + len / MULTI_MATCHER_LANES * (l + 1);
+            if (cut < lane_start) cut = lane_start;
+            const unsigned char* nl = memchr(cut, '\n', end - cut);
+            if (nl) lane_end = nl + 1;
+        }
+        lanes[l] = (ScanLane){ lane_start, lane_end, lane_start, lane_start - start, 0, last_line + (size_t)l * mm->num_keywords };
+        lane_start = lane_end;
+    }
+
+    // Intercalado enquanto todos os troços têm bytes; o resto de cada um segue sozinho.
+    const int32_t* table = mm->next;
+    const unsigned char* byte_class = mm->byte_class;
+    size_t steps = SIZE_MAX;
+    for (int l = 0; l < MULTI_MATCHER_LANES; l++) {
+        if ((size_t)(lanes[l].end - lanes[l].p) < steps) steps = lanes[l].end - lanes[l].p;
+    }
+    for (size_t i = 0; i < steps; i++) {
+        for (int l = 0; l < MULTI_MATCHER_LANES; l++) {
+            ScanLane* lane = &lanes[l];
+            int32_t next = table[lane->row + byte_class[*lane->p++]];
+            if (next >= 0) {
+                lane->row = next;
+                continue;
+            }
+            lane->row = -next - 1;
+            if (report_matches(mm, lane, &scan)) return;
+        }
+    }
+    for (int l = 0; l < MULTI_MATCHER_LANES; l++) {
+        if (scan_lane(mm, &lanes[l], &scan, 0)) return;
+    }
+}
+
+/**
+ * @brief Soma a `counts` as linhas de um bloco de linhas completas (autómato e expressões regulares).
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int add_counts_buffer(const MultiMatcher* mm, const char* buf, size_t len, int stop_at_first,
+                             long* counts, int* remaining) {
+    if (mm->num_literals > 0) {
+        size_t size = (size_t)MULTI_MATCHER_LANES * mm->num_keywords * sizeof(size_t);
+        size_t* last_line = malloc(size);
+        if (!last_line) return -1;
+        memset(last_line, 0xFF, size); // SIZE_MAX em todas.
+        count_literals(mm, buf, len, stop_at_first, counts, last_line, remaining);
+        free(last_line);
+    }
+    for (int k = 0; k < mm->num_keywords; k++) {
+        if (mm->kind[k] != MULTI_MATCHER_SINGLE || (stop_at_first && counts[k] > 0)) continue;
+        long found = matcher_count_lines_buffer(&mm->matchers[k], buf, len, stop_at_first);
+        counts[k] += found;
+        if (stop_at_first && found > 0) --*remaining;
+    }
+    return 0;
+}
+
+/**
+ * @brief Prepara as contagens: 0 para as palavras-chave procuradas, -1 para as não suportadas.
+ *
+ * @return O número de palavras-chave distintas procuradas.
+ */
+static int reset_counts(const MultiMatcher* mm, long* counts) {
+    for (int k = 0; k < mm->num_keywords; k++) {
+        counts[k] = (mm->kind[k] == MULTI_MATCHER_UNSUPPORTED) ? -1 : 0;
+    }
+    return mm->num_literals + mm->num_single;
+}
+
+/**
+ * @brief Dá às palavras-chave repetidas a contagem da primeira igual.
+ */
+static void copy_duplicates(const MultiMatcher* mm, long* counts) {
+    for (int k = 0; k < mm->num_keywords; k++) {
+        if (mm->kind[k] == MULTI_MATCHER_DUPLICATE) counts[k] = counts[mm->alias[k]];
+    }
+}
+
+/**
+ * @brief Conta, para cada palavra-chave, as linhas de um bloco de memória que a contêm.
+ *
+ * @param mm MultiMatcher já inicializado.
+ * @param buf Início do bloco (com um '\0' em buf[len] se `multi_matcher_needs_nul`).
+ * @param len Tamanho do bloco em bytes.
+ * @param stop_at_first Se diferente de 0, basta saber se cada palavra-chave ocorre (contagens
+ * 0 ou 1; pára quando todas foram encontradas).
+ * @param counts Recebe as contagens, uma por palavra-chave (-1 se não for suportada).
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int multi_matcher_count_lines_buffer(const MultiMatcher* mm, const char* buf, size_t len, int stop_at_first, long* counts) {
+    int remaining = reset_counts(mm, counts);
+    if (remaining > 0 && add_counts_buffer(mm, buf, len, stop_at_first, counts, &remaining) != 0) return -1;
+    copy_duplicates(mm, counts);
+    return 0;
+}
+
+/**
+ * @brief Conta, para cada palavra-chave, as linhas de um ficheiro aberto que a contêm.
+ *
+ * Lê o ficheiro em blocos, como `matcher_count_lines_fd`, e procura todas as palavras-chave
+ * em cada bloco de linhas completas.
+ *
+ * @param mm MultiMatcher já inicializado.
+ * @param fd Descritor aberto para leitura.
+ * @param stop_at_first Ver `multi_matcher_count_lines_buffer`.
+ * @param counts Recebe as contagens, uma por palavra-chave (-1 se não for suportada).
+ * @return 0 em caso de sucesso, -1 em caso de erro de leitura/alocação.
+ */
+int multi_matcher_count_lines_fd(const MultiMatcher* mm, int fd, int stop_at_first, long* counts) {
+    int remaining = reset_counts(mm, counts);
+    size_t capacity = MATCHER_READ_CHUNK;
+    size_t used = 0;
+    char* buf = malloc(capacity + 1);
+    if (!buf) return -1;
+
+    while (remaining > 0 || !stop_at_first) {
+        if (used == capacity) { // Linha maior do que o buffer.
+            char* bigger = realloc(buf, capacity * 2 + 1);
+            if (!bigger) { free(buf); return -1; }
+            buf = bigger;
+            capacity *= 2;
+        }
+
+        ssize_t n = read(fd, buf + used, capacity - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return -1;
+        }
+        if (n == 0) break; // EOF.
+        used += n;
+        buf[used] = '\0';
+
+        const char* last_nl = memrchr(buf, '\n', used);
+        if (!last_nl) continue;
+
+        size_t complete = last_nl - buf + 1;
+        if (add_counts_buffer(mm, buf, complete, stop_at_first, counts, &remaining) != 0) {
+            free(buf);
+            return -1;
+        }
+
+        memmove(buf, buf + complete, used - complete);
+        used -= complete;
+        buf[used] = '\0';
+    }
+
+    if (used > 0 && (remaining > 0 || !stop_at_first) && // Última linha sem '\n'.
+        add_counts_buffer(mm, buf, used, stop_at_first, counts, &remaining) != 0) {
+        free(buf);
+        return -1;
+    }
+    free(buf);
+    copy_duplicates(mm, counts);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "Ranking.h"
+#include <math.h>       // Para log
+#include <stdlib.h>     // Para malloc, free, qsort
+
+/**
+ * @brief IDF do BM25 (sempre positivo, mesmo para palavras presentes em mais de metade dos documentos).
+ *
+ * @param num_docs Número de documentos da coleção (N).
+ * @param doc_freq Número de documentos com a palavra (df).
+ */
+double bm25_idf(int64_t num_docs, int64_t doc_freq) {
+    if (doc_freq > num_docs) doc_freq = num_docs; // Estatísticas de fontes diferentes (ver RANKED_SEARCH).
+    return log(1.0 + (num_docs - doc_freq + 0.5) / (doc_freq + 0.5));
+}
+
+/**
+ * @brief Contribuição de uma palavra para a pontuação BM25 de um documento.
+ *
+ * @param idf IDF da palavra (`bm25_idf`).
+ * @param tf Frequência da palavra no documento.
+ * @param doc_length Comprimento do documento.
+ * @param avg_length Comprimento médio dos documentos da coleção.
+ */
+double bm25_term_score(double idf, double tf, double doc_length, double avg_length) {
+    if (tf <= 0) return 0.0;
+    double norm = (avg_length > 0) ? doc_length / avg_length : 1.0;
+    return idf * tf * (BM25_K1 + 1) / (tf + BM25_K1 * (1 - BM25_B + BM25_B * norm));
+}
+
+/**
+ * @brief Indica se a fica atrás de b na ordenação (menor pontuação; em empate, maior ID).
+ */
+static int ranks_below(const ScoredDoc* a, const ScoredDoc* b) {
+    return a->score < b->score || (a->score == b->score && a->id > b->id);
+}
+
+/**
+ * @brief Inicializa um TopK vazio com capacidade para k documentos.
+ *
+ * @return 0 em caso de sucesso, -1 se k <= 0 ou faltar memória.
+ */
+int top_k_init(TopK* top, int k) {
+    top->count = 0;
+    top->k = k;
+    top->docs = (k > 0) ? malloc(k * sizeof(ScoredDoc)) : NULL;
+    return top->docs ? 0 : -1;
+}
+
+static void sift_down(TopK* top, int i) {
+    for (;;) {
+        int worst = i, left = 2 * i + 1, right = left + 1;
+        if (left < top->count && ranks_below(&top->docs[left], &top->docs[worst])) worst = left;
+        if (right < top->count && ranks_below(&top->docs[right], &top->docs[worst])) worst = right;
+        if (worst == i) return;
+        ScoredDoc tmp = top->docs[i];
+        top->docs[i] = top->docs[worst];
+        top->docs[worst] = tmp;
+        i = worst;
+    }
+}
+
+/**
+ * @brief Considera um documento: entra se ainda há lugar ou se é melhor do que o pior guardado.
+ */
+void top_k_push(TopK* top, int id, double score) {
+    ScoredDoc doc = { id, score };
+    if (top->count < top->k) {
+        int i = top->count++;
+        while (i > 0 && ranks_below(&doc, &top->docs[(i - 1) / 2])) { // Sobe enquanto for pior do que o pai.
+            top->docs[i] = top->docs[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        top->docs[i] = doc;
+    } else if (ranks_below(&top->docs[0], &doc)) {
+        top->docs[0] = doc;
+        sift_down(top, 0);
+    }
+}
+
+static int compare_rank(const void* a, const void* b) {
+    const ScoredDoc* x = a;
+    const ScoredDoc* y = b;
+    return ranks_below(x, y) ? 1 : ranks_below(y, x) ? -1 : 0;
+}
+
+/**
+ * @brief Ordena os documentos guardados do melhor para o pior (o TopK deixa de ser um monte).
+ *
+ * @return O número de documentos em top->docs.
+ */
+int top_k_sort(TopK* top) {
+    qsort(top->docs, top->count, sizeof(ScoredDoc), compare_rank);
+    return top->count;
+}
+
+void top_k_free(TopK* top) {
+    free(top->docs);
+    top->docs = NULL;
+    top->count = 0;
+}
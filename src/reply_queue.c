@@ -0,0 +1,68 @@
+#include "Document_Struct.h"
+#include "Reply_Queue.h"
+#include <stdint.h>       // Para uint64_t
+#include <sys/eventfd.h>  // Para eventfd
+
+/**
+ * @brief Inicializa uma fila vazia e o seu eventfd.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int reply_queue_init(ReplyQueue* q) {
+    q->head = q->tail = NULL;
+    q->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (q->event_fd < 0) return -1;
+    if (pthread_mutex_init(&q->mutex, NULL) != 0) {
+        close(q->event_fd);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta as respostas por retirar, o eventfd e o mutex.
+ */
+void reply_queue_destroy(ReplyQueue* q) {
+    Reply* r = q->head;
+    while (r) {
+        Reply* next = r->next;
+        free(r->frames);
+        free(r);
+        r = next;
+    }
+    q->head = q->tail = NULL;
+    close(q->event_fd);
+    pthread_mutex_destroy(&q->mutex);
+}
+
+/**
+ * @brief Acrescenta uma resposta (alocada com malloc; passa a pertencer à fila) e acorda o consumidor.
+ */
+void reply_queue_push(ReplyQueue* q, Reply* reply) {
+    reply->next = NULL;
+    pthread_mutex_lock(&q->mutex);
+    int was_empty = (q->head == NULL);
+    if (q->tail) q->tail->next = reply;
+    else q->head = reply;
+    q->tail = reply;
+    pthread_mutex_unlock(&q->mutex);
+    if (was_empty) { // Se a fila já tinha respostas, o consumidor já foi acordado.
+        uint64_t one = 1;
+        write(q->event_fd, &one, sizeof(one));
+    }
+}
+
+/**
+ * @brief Retira todas as respostas, pela ordem em que chegaram.
+ *
+ * @return A primeira resposta (ligadas por `next`; cada uma a libertar pelo chamador), ou NULL.
+ */
+Reply* reply_queue_take_all(ReplyQueue* q) {
+    uint64_t count;
+    read(q->event_fd, &count, sizeof(count)); // Rearma o eventfd (antes de esvaziar a lista).
+    pthread_mutex_lock(&q->mutex);
+    Reply* all = q->head;
+    q->head = q->tail = NULL;
+    pthread_mutex_unlock(&q->mutex);
+    return all;
+}
@@ -0,0 +1,93 @@
+#include "Request_Queue.h"
+
+/**
+ * @brief Inicializa uma fila vazia.
+ *
+ * @return 0 em caso de sucesso, -1 se não for possível criar as primitivas de sincronização.
+ */
+int request_queue_init(RequestQueue* q) {
+    q->head = 0;
+    q->count = 0;
+    q->closed = 0;
+    if (pthread_mutex_init(&q->mutex, NULL) != 0) return -1;
+    if (pthread_cond_init(&q->not_empty, NULL) != 0 || pthread_cond_init(&q->not_full, NULL) != 0) {
+        pthread_mutex_destroy(&q->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta as primitivas de sincronização da fila.
+ */
+void request_queue_destroy(RequestQueue* q) {
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    pthread_mutex_destroy(&q->mutex);
+}
+
+/**
+ * @brief Acrescenta um pedido à fila, bloqueando enquanto estiver cheia.
+ *
+ * @return 0 em caso de sucesso, -1 se a fila já tiver sido fechada.
+ */
+int request_queue_push(RequestQueue* q, const Request* req) {
+    pthread_mutex_lock(&q->mutex);
+    while (q->count == REQUEST_QUEUE_CAPACITY && !q->closed) {
+        pthread_cond_wait(&q->not_full, &q->mutex);
+    }
+    if (q->closed) {
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+    q->items[(q->head + q->count) % REQUEST_QUEUE_CAPACITY] = *req;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+/**
+ * @brief Retira o pedido mais antigo, bloqueando enquanto a fila estiver vazia.
+ *
+ * Depois de a fila ser fechada, os pedidos pendentes continuam a ser entregues.
+ *
+ * @return 0 se foi retirado um pedido, -1 se a fila está fechada e vazia (o trabalhador deve terminar).
+ */
+int request_queue_pop(RequestQueue* q, Request* out) {
+    pthread_mutex_lock(&q->mutex);
+    while (q->count == 0 && !q->closed) {
+        pthread_cond_wait(&q->not_empty, &q->mutex);
+    }
+    if (q->count == 0) {
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+    *out = q->items[q->head];
+    q->head = (q->head + 1) % REQUEST_QUEUE_CAPACITY;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+/**
+ * @brief Fecha a fila: novos pedidos são recusados e os trabalhadores em espera acordam.
+ */
+void request_queue_close(RequestQueue* q) {
+    pthread_mutex_lock(&q->mutex);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+/**
+ * @brief Devolve o número de pedidos à espera na fila.
+ */
+int request_queue_depth(RequestQueue* q) {
+    pthread_mutex_lock(&q->mutex);
+    int depth = q->count;
+    pthread_mutex_unlock(&q->mutex);
+    return depth;
+}
@@ -0,0 +1,367 @@
+#include "Document_Struct.h"
+#include "Result_Cache.h"
+
+/**
+ * @brief Dispersão (FNV-1a) da chave de uma entrada: tipo, documento e palavra-chave.
+ */
+static unsigned hash_key(int kind, int doc_id, const char* keyword) {
+    unsigned h = 2166136261u;
+    h = (h ^ (unsigned)kind) * 16777619u;
+    h = (h ^ (unsigned)doc_id) * 16777619u;
+    for (const unsigned char* p = (const unsigned char*)keyword; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Procura uma entrada (com o mutex adquirido).
+ */
+static ResultEntry* find_entry(ResultCache* cache, int kind, int doc_id, const char* keyword, unsigned hash) {
+    for (ResultEntry* e = cache->buckets[hash & (cache->num_buckets - 1)]; e; e = e->next_in_bucket) {
+        if (e->hash == hash && e->kind == kind && e->doc_id == doc_id && strcmp(e->keyword, keyword) == 0) return e;
+    }
+    return NULL;
+}
+
+static void lru_unlink(ResultCache* cache, ResultEntry* e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+    else cache->lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+    else cache->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(ResultCache* cache, ResultEntry* e) {
+    e->lru_prev = NULL;
+    e->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = e;
+    cache->lru_head = e;
+    if (!cache->lru_tail) cache->lru_tail = e;
+}
+
+/**
+ * @brief Retira e liberta uma entrada (com o mutex adquirido).
+ */
+static void remove_entry(ResultCache* cache, ResultEntry* e) {
+    ResultEntry** link = &cache->buckets[e->hash & (cache->num_buckets - 1)];
+    while (*link != e) link = &(*link)->next_in_bucket;
+    *link = e->next_in_bucket;
+    lru_unlink(cache, e);
+    cache->bytes -= e->bytes;
+    cache->count--;
+    free(e->keyword);
+    free(e->ids);
+    free(e);
+}
+
+/**
+ * @brief Retira todas as entradas de um tipo (ou as contagens de um documento, se doc_id > 0).
+ */
+static void remove_matching(ResultCache* cache, int kind, int doc_id) {
+    ResultEntry* e = cache->lru_head;
+    while (e) {
+        ResultEntry* next = e->lru_next;
+        if (e->kind == kind && (doc_id <= 0 || e->doc_id == doc_id)) {
+            remove_entry(cache, e);
+            cache->invalidations++;
+        }
+        e = next;
+    }
+}
+
+/**
+ * @brief Duplica a tabela de dispersão (quando há mais entradas do que posições).
+ */
+static void grow_buckets(ResultCache* cache) {
+    int new_num = cache->num_buckets * 2;
+    ResultEntry** grown = calloc(new_num, sizeof(ResultEntry*));
+    if (!grown) return; // As cadeias ficam mais longas.
+    for (int b = 0; b < cache->num_buckets; b++) {
+        ResultEntry* e = cache->buckets[b];
+        while (e) {
+            ResultEntry* next = e->next_in_bucket;
+            e->next_in_bucket = grown[e->hash & (new_num - 1)];
+            grown[e->hash & (new_num - 1)] = e;
+            e = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = grown;
+    cache->num_buckets = new_num;
+}
+
+/**
+ * @brief Guarda uma entrada nova, retirando as usadas há mais tempo até caber (com o mutex adquirido).
+ *
+ * Uma entrada já existente com a mesma chave é substituída.
+ *
+ * @return A entrada, ou NULL se não couber no limite ou faltar memória.
+ */
+static ResultEntry* insert_entry(ResultCache* cache, int kind, int doc_id, const char* keyword, size_t extra_bytes) {
+    unsigned hash = hash_key(kind, doc_id, keyword);
+    ResultEntry* old = find_entry(cache, kind, doc_id, keyword, hash);
+    if (old) remove_entry(cache, old);
+
+    size_t bytes = sizeof(ResultEntry) + strlen(keyword) + 1 + extra_bytes;
+    if (bytes > cache->max_bytes) return NULL;
+    while (cache->bytes + bytes > cache->max_bytes && cache->lru_tail) {
+        remove_entry(cache, cache->lru_tail);
+        cache->evictions++;
+    }
+
+    ResultEntry* e = calloc(1, sizeof(ResultEntry));
+    if (!e || !(e->keyword = strdup(keyword))) {
+        free(e);
+        return NULL;
+    }
+    e->kind = kind;
+    e->doc_id = doc_id;
+    e->bytes = bytes;
+    e->hash = hash;
+    if (cache->count >= cache->num_buckets) grow_buckets(cache);
+    int b = hash & (cache->num_buckets - 1);
+    e->next_in_bucket = cache->buckets[b];
+    cache->buckets[b] = e;
+    lru_push_front(cache, e);
+    cache->bytes += bytes;
+    cache->count++;
+    return e;
+}
+
+/**
+ * @brief Inicializa uma cache vazia.
+ *
+ * @param max_bytes Memória máxima das entradas (0 desliga a cache).
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int result_cache_init(ResultCache* cache, size_t max_bytes) {
+    memset(cache, 0, sizeof(ResultCache));
+    cache->max_bytes = max_bytes;
+    cache->num_buckets = 64;
+    pthread_mutex_init(&cache->mutex, NULL);
+    cache->buckets = calloc(cache->num_buckets, sizeof(ResultEntry*));
+    return cache->buckets ? 0 : -1;
+}
+
+/**
+ * @brief Liberta todas as entradas.
+ */
+void result_cache_destroy(ResultCache* cache) {
+    if (!cache->buckets) return;
+    while (cache->lru_head) remove_entry(cache, cache->lru_head);
+    free(cache->buckets);
+    free(cache->files);
+    pthread_mutex_destroy(&cache->mutex);
+    cache->buckets = NULL;
+    cache->files = NULL;
+}
+
+/**
+ * @brief Geração atual (ler antes de começar um cálculo que depois se guarda com put).
+ */
+unsigned long result_cache_generation(ResultCache* cache) {
+    pthread_mutex_lock(&cache->mutex);
+    unsigned long generation = cache->generation;
+    pthread_mutex_unlock(&cache->mutex);
+    return generation;
+}
+
+/**
+ * @brief Compara o ficheiro de um documento com o visto da última vez e invalida se mudou.
+ *
+ * Se mudou, saem as contagens do documento e todas as pesquisas, e a geração avança.
+ * A primeira vez que um documento é visto só regista o ficheiro.
+ *
+ * @param st Estado atual do ficheiro, ou NULL se não existe.
+ * @return 1 se o ficheiro mudou, 0 caso contrário.
+ */
+int result_cache_check_file(ResultCache* cache, int doc_id, const struct stat* st) {
+    if (cache->max_bytes == 0 || doc_id <= 0) return 0;
+    pthread_mutex_lock(&cache->mutex);
+    if (doc_id >= cache->files_capacity) {
+        int new_capacity = cache->files_capacity ? cache->files_capacity : 1024;
+        while (new_capacity <= doc_id) new_capacity *= 2;
+        ResultFileSig* grown = realloc(cache->files, new_capacity * sizeof(ResultFileSig));
+        if (!grown) {
+            // Sem o registo não se sabe se o ficheiro mudou: invalida por precaução.
+            remove_matching(cache, RESULT_ENTRY_COUNT, doc_id);
+            remove_matching(cache, RESULT_ENTRY_SEARCH, 0);
+            cache->generation++;
+            pthread_mutex_unlock(&cache->mutex);
+            return 1;
+        }
+        memset(grown + cache->files_capacity, 0, (new_capacity - cache->files_capacity) * sizeof(ResultFileSig));
+        cache->files = grown;
+        cache->files_capacity = new_capacity;
+    }
+
+    ResultFileSig current;
+    memset(&current, 0, sizeof(current));
+    current.known = 1;
+    if (st) {
+        current.dev = st->st_dev;
+        current.ino = st->st_ino;
+        current.size = st->st_size;
+        current.mtime = st->st_mtim;
+    } else {
+        current.missing = 1;
+    }
+    ResultFileSig* seen = &cache->files[doc_id];
+    int changed = seen->known && (seen->missing != current.missing || seen->dev != current.dev ||
+                                  seen->ino != current.ino || seen->size != current.size ||
+                                  seen->mtime.tv_sec != current.mtime.tv_sec ||
+                                  seen->mtime.tv_nsec != current.mtime.tv_nsec);
+    *seen = current;
+    if (changed) {
+        remove_matching(cache, RESULT_ENTRY_COUNT, doc_id);
+        remove_matching(cache, RESULT_ENTRY_SEARCH, 0);
+        cache->generation++;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return changed;
+}
+
+/**
+ * @brief Procura o resultado de uma pesquisa.
+ *
+ * @param current_max_id Maior ID de documento existente (para contar acertos parciais).
+ * @param ids Recebe uma cópia dos IDs (malloc, a libertar pelo chamador), ou NULL se vazia.
+ * @param num_ids Recebe o número de IDs.
+ * @param max_id Recebe o maior ID coberto: os documentos com ID superior ainda têm de ser lidos.
+ * @return 0 se encontrou, -1 caso contrário.
+ */
+int result_cache_get_search(ResultCache* cache, const char* keyword, int current_max_id, int** ids, int* num_ids, int* max_id) {
+    if (cache->max_bytes == 0) return -1;
+    unsigned hash = hash_key(RESULT_ENTRY_SEARCH, 0, keyword);
+    pthread_mutex_lock(&cache->mutex);
+    ResultEntry* e = find_entry(cache, RESULT_ENTRY_SEARCH, 0, keyword, hash);
+    int* copy = NULL;
+    if (e && e->num_ids > 0) {
+        copy = malloc(e->num_ids * sizeof(int));
+        if (copy) memcpy(copy, e->ids, e->num_ids * sizeof(int));
+        else e = NULL; // Sem memória para a cópia: trata como falha.
+    }
+    if (!e) {
+        cache->search_misses++;
+        pthread_mutex_unlock(&cache->mutex);
+        return -1;
+    }
+    lru_unlink(cache, e);
+    lru_push_front(cache, e);
+    cache->search_hits++;
+    if (e->max_id < current_max_id) cache->search_partial++;
+    *ids = copy;
+    *num_ids = e->num_ids;
+    *max_id = e->max_id;
+    pthread_mutex_unlock(&cache->mutex);
+    return 0;
+}
+
+/**
+ * @brief Guarda (ou substitui) o resultado de uma pesquisa.
+ *
+ * @param ids IDs encontrados, por ordem crescente.
+ * @param max_id Maior ID de documento coberto pela pesquisa.
+ * @param generation Geração lida antes de a pesquisa começar: se mudou, nada é guardado.
+ */
+void result_cache_put_search(ResultCache* cache, const char* keyword, const int* ids, int num_ids, int max_id, unsigned long generation) {
+    if (cache->max_bytes == 0) return;
+    pthread_mutex_lock(&cache->mutex);
+    if (generation == cache->generation) {
+        int* copy = (num_ids > 0) ? malloc(num_ids * sizeof(int)) : NULL;
+        if (num_ids == 0 || copy) {
+            ResultEntry* e = insert_entry(cache, RESULT_ENTRY_SEARCH, 0, keyword, num_ids * sizeof(int));
+            if (e) {
+                if (copy) memcpy(copy, ids, num_ids * sizeof(int));
+                e->ids = copy;
+                e->num_ids = num_ids;
+                e->max_id = max_id;
+                copy = NULL;
+            }
+        }
+        free(copy);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * @brief Procura a contagem de linhas de um documento com uma palavra-chave.
+ *
+ * @return 0 se encontrou (contagem em `count`), -1 caso contrário.
+ */
+int result_cache_get_count(ResultCache* cache, int doc_id, const char* keyword, long* count) {
+    if (cache->max_bytes == 0) return -1;
+    unsigned hash = hash_key(RESULT_ENTRY_COUNT, doc_id, keyword);
+    pthread_mutex_lock(&cache->mutex);
+    ResultEntry* e = find_entry(cache, RESULT_ENTRY_COUNT, doc_id, keyword, hash);
+    if (!e) {
+        cache->count_misses++;
+        pthread_mutex_unlock(&cache->mutex);
+        return -1;
+    }
+    lru_unlink(cache, e);
+    lru_push_front(cache, e);
+    cache->count_hits++;
+    *count = e->count;
+    pthread_mutex_unlock(&cache->mutex);
+    return 0;
+}
+
+/**
+ * @brief Guarda a contagem de linhas de um documento (ver `result_cache_put_search` para a geração).
+ */
+void result_cache_put_count(ResultCache* cache, int doc_id, const char* keyword, long count, unsigned long generation) {
+    if (cache->max_bytes == 0) return;
+    pthread_mutex_lock(&cache->mutex);
+    if (generation == cache->generation) {
+        ResultEntry* e = insert_entry(cache, RESULT_ENTRY_COUNT, doc_id, keyword, 0);
+        if (e) e->count = count;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * @brief Regista documentos que passam a existir com IDs a partir de `first_id`, abaixo de outros já visíveis.
+ *
+ * Acontece com os blocos de um BULK_ADD aplicados depois de um ADD_DOC (ou outro lote) com IDs
+ * superiores: as pesquisas que já cobrem `first_id` (`max_id` >= first_id) não os leram e saem.
+ * A geração avança, para que uma pesquisa a decorrer, que também não os viu, não fique guardada.
+ */
+void result_cache_add_documents(ResultCache* cache, int first_id) {
+    if (cache->max_bytes == 0) return;
+    pthread_mutex_lock(&cache->mutex);
+    ResultEntry* e = cache->lru_head;
+    while (e) {
+        ResultEntry* next = e->lru_next;
+        if (e->kind == RESULT_ENTRY_SEARCH && e->max_id >= first_id) {
+            remove_entry(cache, e);
+            cache->invalidations++;
+        }
+        e = next;
+    }
+    cache->generation++;
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * @brief Retira um documento removido (DELETE_DOC): sai das pesquisas e as suas contagens saem.
+ */
+void result_cache_remove_document(ResultCache* cache, int doc_id) {
+    if (cache->max_bytes == 0) return;
+    pthread_mutex_lock(&cache->mutex);
+    remove_matching(cache, RESULT_ENTRY_COUNT, doc_id);
+    for (ResultEntry* e = cache->lru_head; e; e = e->lru_next) {
+        if (e->kind != RESULT_ENTRY_SEARCH) continue;
+        for (int i = 0; i < e->num_ids; i++) {
+            if (e->ids[i] == doc_id) {
+                memmove(e->ids + i, e->ids + i + 1, (e->num_ids - i - 1) * sizeof(int));
+                e->num_ids--;
+                break;
+            }
+        }
+    }
+    if (doc_id > 0 && doc_id < cache->files_capacity) cache->files[doc_id].known = 0;
+    cache->generation++; // Uma pesquisa a decorrer ainda pode incluir o documento.
+    pthread_mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,317 @@
+#include "Document_Struct.h"
+#include "Search_Pool.h"
+
+/**
+ * @brief Uma pesquisa submetida ao pool (vive na pilha de quem chama `search_pool_run`).
+ */
+typedef struct SearchJob {
+    SearchPoolFn fn;
+    void* ctx;
+    unsigned char* matched;     // Resultado de cada item.
+    int remaining;              // Itens por terminar (atualizado atomicamente).
+    int finished;               // 1 quando remaining chega a 0 (protegido por mutex).
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+} SearchJob;
+
+/**
+ * @brief Argumento de cada thread: o pool e a sua fila.
+ */
+typedef struct {
+    SearchPool* pool;
+    int self;
+} SearchThreadArg;
+
+/**
+ * @brief Par (tamanho, posição) usado para ordenar os itens de uma pesquisa.
+ */
+typedef struct {
+    long weight;
+    int index;
+} WeightedItem;
+
+static int compare_weight_desc(const void* a, const void* b) {
+    const WeightedItem* x = a;
+    const WeightedItem* y = b;
+    if (x->weight != y->weight) return (x->weight < y->weight) - (x->weight > y->weight);
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+/**
+ * @brief Acrescenta um item ao fim de uma fila (com o mutex da fila adquirido).
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int deque_push_back(SearchDeque* d, SearchPoolItem item) {
+    if (d->count == d->capacity) {
+        int new_capacity = d->capacity ? d->capacity * 2 : 64;
+        SearchPoolItem* grown = malloc(new_capacity * sizeof(SearchPoolItem));
+        if (!grown) return -1;
+        for (int i = 0; i < d->count; i++) {
+            grown[i] = d->items[(d->head + i) % d->capacity];
+        }
+        free(d->items);
+        d->items = grown;
+        d->head = 0;
+        d->capacity = new_capacity;
+    }
+    d->items[(d->head + d->count) % d->capacity] = item;
+    d->count++;
+    return 0;
+}
+
+/**
+ * @brief Retira o primeiro item de uma fila (a thread dona: o maior que lhe resta).
+ *
+ * @return 1 se retirou um item, 0 se a fila estava vazia.
+ */
+static int deque_pop_front(SearchDeque* d, SearchPoolItem* out) {
+    pthread_mutex_lock(&d->mutex);
+    int found = (d->count > 0);
+    if (found) {
+        *out = d->items[d->head];
+        d->head = (d->head + 1) % d->capacity;
+        d->count--;
+    }
+    pthread_mutex_unlock(&d->mutex);
+    return found;
+}
+
+/**
+ * @brief Retira o último item de uma fila (roubo por outra thread: o mais pequeno).
+ *
+ * @return 1 se retirou um item, 0 se a fila estava vazia.
+ */
+static int deque_pop_back(SearchDeque* d, SearchPoolItem* out) {
+    pthread_mutex_lock(&d->mutex);
+    int found = (d->count > 0);
+    if (found) {
+        *out = d->items[(d->head + d->count - 1) % d->capacity];
+        d->count--;
+    }
+    pthread_mutex_unlock(&d->mutex);
+    return found;
+}
+
+/**
+ * @brief Obtém o próximo item para a thread `self`: da sua fila ou, se vazia, roubado de outra.
+ *
+ * @return 1 se obteve um item, 0 se todas as filas estavam vazias.
+ */
+static int next_item(SearchPool* pool, int self, SearchPoolItem* out) {
+    if (deque_pop_front(&pool->deques[self], out)) return 1;
+    for (int i = 1; i < pool->num_threads; i++) {
+        if (deque_pop_back(&pool->deques[(self + i) % pool->num_threads], out)) {
+            __atomic_add_fetch(&pool->steals, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Processa um item e, se for o último da sua pesquisa, acorda quem a submeteu.
+ */
+static void run_item(SearchPoolItem item) {
+    SearchJob* job = item.job;
+    job->matched[item.index] = (unsigned char)(job->fn(item.index, job->ctx) ? 1 : 0);
+    if (__atomic_sub_fetch(&job->remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_lock(&job->mutex);
+        job->finished = 1;
+        pthread_cond_signal(&job->done);
+        pthread_mutex_unlock(&job->mutex); // A partir daqui o job pode deixar de existir.
+    }
+}
+
+/**
+ * @brief Ciclo de uma thread do pool: processa itens enquanto houver, e dorme quando não há.
+ *
+ * `queued` é decrementado quando um item sai de uma fila e incrementado por `search_pool_run`
+ * só depois de os itens lá estarem (pode ficar negativo entretanto); uma thread só dorme se,
+ * com o mutex do pool, não houver itens contados, e `search_pool_run` acorda-as com o mesmo
+ * mutex depois de os contar.
+ */
+static void* search_thread_main(void* arg) {
+    SearchThreadArg* thread_arg = arg;
+    SearchPool* pool = thread_arg->pool;
+    int self = thread_arg->self;
+    free(thread_arg);
+
+    for (;;) {
+        SearchPoolItem item;
+        if (next_item(pool, self, &item)) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+            run_item(item);
+            continue;
+        }
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->stop && __atomic_load_n(&pool->queued, __ATOMIC_RELAXED) <= 0) {
+            pthread_cond_wait(&pool->work, &pool->mutex);
+        }
+        int stop = pool->stop && __atomic_load_n(&pool->queued, __ATOMIC_RELAXED) <= 0;
+        pthread_mutex_unlock(&pool->mutex);
+        if (stop) break;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Número de threads por defeito: os processadores disponíveis.
+ */
+int search_pool_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > SEARCH_POOL_MAX_THREADS ? SEARCH_POOL_MAX_THREADS : (int)cpus;
+}
+
+/**
+ * @brief Cria o pool e as suas threads.
+ *
+ * @param num_threads Número de threads (1 a SEARCH_POOL_MAX_THREADS).
+ * @return 0 em caso de sucesso, -1 em caso de erro (o pool fica com num_threads == 0).
+ */
+int search_pool_init(SearchPool* pool, int num_threads) {
+    memset(pool, 0, sizeof(SearchPool));
+    if (num_threads < 1 || num_threads > SEARCH_POOL_MAX_THREADS) return -1;
+    pool->deques = calloc(num_threads, sizeof(SearchDeque));
+    pool->threads = malloc(num_threads * sizeof(pthread_t));
+    if (!pool->deques || !pool->threads) {
+        free(pool->deques);
+        free(pool->threads);
+        return -1;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_mutex_init(&pool->deques[i].mutex, NULL);
+    }
+
+    // As filas têm de existir todas antes de qualquer thread tentar roubar.
+    int started = 0;
+    pool->num_threads = num_threads;
+    for (int i = 0; i < num_threads; i++) {
+        SearchThreadArg* arg = malloc(sizeof(SearchThreadArg));
+        if (!arg) break;
+        arg->pool = pool;
+        arg->self = i;
+        if (pthread_create(&pool->threads[i], NULL, search_thread_main, arg) != 0) {
+            free(arg);
+            break;
+        }
+        started++;
+    }
+    if (started < num_threads) {
+        // As threads criadas veem as filas de todas; termina-as antes de libertar.
+        pthread_mutex_lock(&pool->mutex);
+        pool->stop = 1;
+        pthread_cond_broadcast(&pool->work);
+        pthread_mutex_unlock(&pool->mutex);
+        for (int i = 0; i < started; i++) pthread_join(pool->threads[i], NULL);
+        for (int i = 0; i < num_threads; i++) pthread_mutex_destroy(&pool->deques[i].mutex);
+        pthread_cond_destroy(&pool->work);
+        pthread_mutex_destroy(&pool->mutex);
+        free(pool->deques);
+        free(pool->threads);
+        memset(pool, 0, sizeof(SearchPool));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Termina as threads e liberta o pool (nenhuma pesquisa pode estar a decorrer).
+ */
+void search_pool_destroy(SearchPool* pool) {
+    if (pool->num_threads == 0) return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+        free(pool->deques[i].items);
+        pthread_mutex_destroy(&pool->deques[i].mutex);
+    }
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->deques);
+    free(pool->threads);
+    memset(pool, 0, sizeof(SearchPool));
+}
+
+/**
+ * @brief Processa todos os itens de uma pesquisa nas threads do pool e espera que terminem.
+ *
+ * Os itens são ordenados por `weights` (do maior para o menor) e distribuídos em rodízio
+ * pelas filas, a começar numa fila diferente em cada pesquisa.
+ *
+ * @param num_items Número de itens.
+ * @param weights Custo estimado de cada item (ex: tamanho do ficheiro em bytes).
+ * @param fn Função chamada para cada item, numa das threads do pool.
+ * @param ctx Ponteiro passado a `fn`.
+ * @param matched Array com num_items posições; recebe o resultado de `fn` para cada item.
+ * @return 0 em caso de sucesso, -1 se o pool não existe ou faltar memória (nenhum item foi
+ * processado: o chamador deve fazer a pesquisa de outra forma).
+ */
+int search_pool_run(SearchPool* pool, int num_items, const long* weights, SearchPoolFn fn, void* ctx, unsigned char* matched) {
+    if (num_items <= 0) return 0;
+    if (pool->num_threads == 0) return -1;
+
+    WeightedItem* order = malloc(num_items * sizeof(WeightedItem));
+    if (!order) return -1;
+    for (int i = 0; i < num_items; i++) {
+        order[i].weight = weights[i];
+        order[i].index = i;
+    }
+    qsort(order, num_items, sizeof(WeightedItem), compare_weight_desc);
+
+    SearchJob job;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.matched = matched;
+    job.remaining = num_items;
+    job.finished = 0;
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_cond_init(&job.done, NULL);
+
+    pthread_mutex_lock(&pool->mutex);
+    int first = pool->next_deque;
+    pool->next_deque = (first + 1) % pool->num_threads;
+    pthread_mutex_unlock(&pool->mutex);
+
+    int num_deques = (num_items < pool->num_threads) ? num_items : pool->num_threads;
+    // Posição k da ordem vai para a fila k % num_deques: cada fila fica também ordenada
+    // do maior para o menor. Se faltar memória para crescer uma fila, os itens que não
+    // couberam correm nesta thread.
+    for (int d = 0; d < num_deques; d++) {
+        SearchDeque* deque = &pool->deques[(first + d) % pool->num_threads];
+        pthread_mutex_lock(&deque->mutex);
+        int pushed = 0;
+        int k;
+        for (k = d; k < num_items; k += num_deques) {
+            SearchPoolItem item = { &job, order[k].index };
+            if (deque_push_back(deque, item) != 0) break;
+            pushed++;
+        }
+        pthread_mutex_unlock(&deque->mutex);
+        __atomic_add_fetch(&pool->queued, pushed, __ATOMIC_RELAXED);
+        for (; k < num_items; k += num_deques) {
+            SearchPoolItem item = { &job, order[k].index };
+            run_item(item);
+        }
+    }
+    free(order);
+
+    pthread_mutex_lock(&pool->mutex);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_lock(&job.mutex);
+    while (!job.finished) {
+        pthread_cond_wait(&job.done, &job.mutex);
+    }
+    pthread_mutex_unlock(&job.mutex);
+    pthread_cond_destroy(&job.done);
+    pthread_mutex_destroy(&job.mutex);
+    return 0;
+}
@@ -0,0 +1,387 @@
+#include "Search_Query.h"
+#include <ctype.h>      // Para isspace
+
+// Símbolos da consulta (ver `next_token`).
+#define TOKEN_END 0
+#define TOKEN_TERM 1    // Palavra ou frase (texto em `text`).
+#define TOKEN_AND 2
+#define TOKEN_OR 3
+#define TOKEN_NOT 4
+#define TOKEN_OPEN 5
+#define TOKEN_CLOSE 6
+
+/**
+ * @brief Estado da análise de uma consulta (descida recursiva, um símbolo de avanço).
+ */
+typedef struct {
+    const char* pos;            // Próximo carácter por ler.
+    int token;                  // Símbolo atual (TOKEN_*).
+    char text[MAX_KEYWORD_SIZE]; // Texto do símbolo TOKEN_TERM.
+    SearchQuery* query;
+    char* error;
+    size_t error_size;
+    int failed;                 // 1 depois do primeiro erro (a mensagem é a desse erro).
+} QueryParser;
+
+/**
+ * @brief Regista um erro de análise (só o primeiro fica na mensagem).
+ *
+ * @return -1, para os chamadores devolverem diretamente.
+ */
+static int parse_error(QueryParser* p, const char* msg) {
+    if (!p->failed && p->error && p->error_size > 0) snprintf(p->error, p->error_size, "%s", msg);
+    p->failed = 1;
+    return -1;
+}
+
+/**
+ * @brief Lê o símbolo seguinte para `p->token` (e `p->text`).
+ *
+ * @return 0 em caso de sucesso, -1 se o texto for inválido (frase por fechar ou termo longo demais).
+ */
+static int next_token(QueryParser* p) {
+    while (isspace((unsigned char)*p->pos)) p->pos++;
+    char c = *p->pos;
+    if (c == '\0') {
+        p->token = TOKEN_END;
+        return 0;
+    }
+    if (c == '(' || c == ')') {
+        p->token = (c == '(') ? TOKEN_OPEN : TOKEN_CLOSE;
+        p->pos++;
+        return 0;
+    }
+
+    const char* start;
+    size_t len;
+    if (c == '"') {
+        start = ++p->pos;
+        const char* end = strchr(start, '"');
+        if (!end) return parse_error(p, "frase sem aspas de fecho");
+        len = end - start;
+        p->pos = end + 1;
+        if (len == 0) return parse_error(p, "frase vazia");
+    } else {
+        start = p->pos;
+        while (*p->pos && !isspace((unsigned char)*p->pos) && !strchr("()\"", *p->pos)) p->pos++;
+        len = p->pos - start;
+    }
+    if (len >= MAX_KEYWORD_SIZE) return parse_error(p, "termo demasiado longo");
+    memcpy(p->text, start, len);
+    p->text[len] = '\0';
+
+    p->token = TOKEN_TERM;
+    if (c != '"') { // Entre aspas, AND/OR/NOT são texto.
+        if (strcmp(p->text, "AND") == 0) p->token = TOKEN_AND;
+        else if (strcmp(p->text, "OR") == 0) p->token = TOKEN_OR;
+        else if (strcmp(p->text, "NOT") == 0) p->token = TOKEN_NOT;
+    }
+    return 0;
+}
+
+/**
+ * @brief Acrescenta um nó à árvore.
+ *
+ * @return A posição do nó, ou -1 se a consulta tiver nós a mais.
+ */
+static int add_node(QueryParser* p, int type, int left, int right, int term) {
+    SearchQuery* q = p->query;
+    if (q->num_nodes == QUERY_MAX_NODES) return parse_error(p, "consulta demasiado longa");
+    QueryNode* node = &q->nodes[q->num_nodes];
+    node->type = type;
+    node->left = left;
+    node->right = right;
+    node->term = term;
+    return q->num_nodes++;
+}
+
+/**
+ * @brief Acrescenta um nó para o termo atual (termos repetidos partilham a mesma posição).
+ */
+static int add_term_node(QueryParser* p) {
+    SearchQuery* q = p->query;
+    int term = 0;
+    while (term < q->num_terms && strcmp(q->terms[term], p->text) != 0) term++;
+    if (term == q->num_terms) {
+        if (q->num_terms == QUERY_MAX_TERMS) return parse_error(p, "demasiados termos");
+        strcpy(q->terms[q->num_terms++], p->text);
+    }
+    return add_node(p, QUERY_TERM, -1, -1, term);
+}
+
+static int parse_or(QueryParser* p);
+
+/**
+ * @brief primario := "(" ou ")" | termo
+ */
+static int parse_primary(QueryParser* p) {
+    if (p->token == TOKEN_OPEN) {
+        if (next_token(p) != 0) return -1;
+        int node = parse_or(p);
+        if (node < 0) return -1;
+        if (p->token != TOKEN_CLOSE) return parse_error(p, "falta ')'");
+        return (next_token(p) == 0) ? node : -1;
+    }
+    if (p->token != TOKEN_TERM) return parse_error(p, "falta um termo");
+    int node = add_term_node(p);
+    if (node < 0 || next_token(p) != 0) return -1;
+    return node;
+}
+
+/**
+ * @brief nao := "NOT" nao | primario
+ */
+static int parse_not(QueryParser* p) {
+    if (p->token != TOKEN_NOT) return parse_primary(p);
+    if (next_token(p) != 0) return -1;
+    int child = parse_not(p);
+    return (child < 0) ? -1 : add_node(p, QUERY_NOT, child, -1, -1);
+}
+
+/**
+ * @brief e := nao ( ["AND"] nao )*
+ */
+static int parse_and(QueryParser* p) {
+    int left = parse_not(p);
+    while (left >= 0) {
+        if (p->token == TOKEN_AND) {
+            if (next_token(p) != 0) return -1;
+        } else if (p->token != TOKEN_TERM && p->token != TOKEN_NOT && p->token != TOKEN_OPEN) {
+            break;
+        }
+        int right = parse_not(p);
+        if (right < 0) return -1;
+        left = add_node(p, QUERY_AND, left, right, -1);
+    }
+    return left;
+}
+
+/**
+ * @brief ou := e ( "OR" e )*
+ */
+static int parse_or(QueryParser* p) {
+    int left = parse_and(p);
+    while (left >= 0 && p->token == TOKEN_OR) {
+        if (next_token(p) != 0) return -1;
+        int right = parse_and(p);
+        if (right < 0) return -1;
+        left = add_node(p, QUERY_OR, left, right, -1);
+    }
+    return left;
+}
+
+/**
+ * @brief Analisa o texto de uma consulta (ver a gramática em Search_Query.h).
+ *
+ * @param text A consulta (terminada em '\0').
+ * @param query Recebe a árvore e os termos.
+ * @param error Recebe a descrição do erro, se houver (pode ser NULL).
+ * @param error_size Capacidade de error.
+ * @return 0 em caso de sucesso, -1 se a consulta for inválida.
+ */
+int search_query_parse(const char* text, SearchQuery* query, char* error, size_t error_size) {
+    QueryParser p;
+    memset(&p, 0, sizeof(QueryParser));
+    p.pos = text;
+    p.query = query;
+    p.error = error;
+    p.error_size = error_size;
+    query->num_nodes = 0;
+    query->num_terms = 0;
+
+    if (next_token(&p) != 0) return -1;
+    if (p.token == TOKEN_END) return parse_error(&p, "consulta vazia");
+    query->root = parse_or(&p);
+    if (query->root < 0) return -1;
+    if (p.token != TOKEN_END) return parse_error(&p, (p.token == TOKEN_CLOSE) ? "')' a mais" : "operador fora do lugar");
+    return 0;
+}
+
+/**
+ * @brief Avalia um nó para um documento (ver `search_query_matches`).
+ */
+static int matches_node(const SearchQuery* query, int n, const unsigned char* term_found) {
+    const QueryNode* node = &query->nodes[n];
+    switch (node->type) {
+        case QUERY_TERM:
+            return term_found[node->term] != 0;
+        case QUERY_AND:
+            return matches_node(query, node->left, term_found) && matches_node(query, node->right, term_found);
+        case QUERY_OR:
+            return matches_node(query, node->left, term_found) || matches_node(query, node->right, term_found);
+        default:
+            return !matches_node(query, node->left, term_found);
+    }
+}
+
+/**
+ * @brief Indica se um documento corresponde à consulta.
+ *
+ * @param term_found Uma flag por termo (query->terms): diferente de 0 se o documento o contém.
+ * @return 1 se corresponde, 0 caso contrário.
+ */
+int search_query_matches(const SearchQuery* query, const unsigned char* term_found) {
+    return matches_node(query, query->root, term_found);
+}
+
+/**
+ * @brief Primeira posição a partir de `from` com ids[pos] >= id (count se não houver).
+ *
+ * Procura galopante: avança em passos 1, 2, 4, ... até ultrapassar id e termina com uma
+ * procura binária nesse último intervalo. Custa O(log d), com d a distância percorrida, por
+ * isso percorrer uma lista longa à procura dos elementos de uma curta custa O(m log(n / m)).
+ */
+static int gallop(const int* ids, int count, int from, int id) {
+    int low = from, high = from, step = 1;
+    while (high < count && ids[high] < id) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    if (high > count) high = count;
+    while (low < high) { // ids[low - 1] < id <= ids[high] (se existirem).
+        int mid = low + (high - low) / 2;
+        if (ids[mid] < id) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+/**
+ * @brief Interseção de duas listas (procura galopante dos elementos da mais curta na mais longa).
+ *
+ * @param out Recebe a lista resultante (a libertar com free).
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int id_list_intersect(const IdList* a, const IdList* b, IdList* out) {
+    const IdList* small = (a->count <= b->count) ? a : b;
+    const IdList* large = (small == a) ? b : a;
+    out->count = 0;
+    out->ids = malloc((small->count + 1) * sizeof(int)); // +1: nunca malloc(0).
+    if (!out->ids) return -1;
+    int pos = 0;
+    for (int i = 0; i < small->count && pos < large->count; i++) {
+        pos = gallop(large->ids, large->count, pos, small->ids[i]);
+        if (pos < large->count && large->ids[pos] == small->ids[i]) out->ids[out->count++] = small->ids[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief União de duas listas (fusão).
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int id_list_union(const IdList* a, const IdList* b, IdList* out) {
+    out->count = 0;
+    out->ids = malloc((a->count + b->count + 1) * sizeof(int));
+    if (!out->ids) return -1;
+    int i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        if (j == b->count || (i < a->count && a->ids[i] < b->ids[j])) {
+            out->ids[out->count++] = a->ids[i++];
+        } else {
+            if (i < a->count && a->ids[i] == b->ids[j]) i++;
+            out->ids[out->count++] = b->ids[j++];
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Diferença a \ b (cada elemento de a é procurado em b de forma galopante).
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int id_list_difference(const IdList* a, const IdList* b, IdList* out) {
+    out->count = 0;
+    out->ids = malloc((a->count + 1) * sizeof(int));
+    if (!out->ids) return -1;
+    int pos = 0;
+    for (int i = 0; i < a->count; i++) {
+        pos = gallop(b->ids, b->count, pos, a->ids[i]);
+        if (pos == b->count || b->ids[pos] != a->ids[i]) out->ids[out->count++] = a->ids[i];
+    }
+    return 0;
+}
+
+static int id_list_copy(const IdList* src, IdList* out) {
+    out->count = src->count;
+    out->ids = malloc((src->count + 1) * sizeof(int));
+    if (!out->ids) return -1;
+    memcpy(out->ids, src->ids, src->count * sizeof(int));
+    return 0;
+}
+
+/**
+ * @brief Avalia um nó sobre listas de IDs (ver `search_query_eval_lists`).
+ */
+static int eval_node(const SearchQuery* query, int n, const IdList* terms, const int* exact, const IdList* universe,
+                     IdList* out, int* out_exact) {
+    const QueryNode* node = &query->nodes[n];
+    IdList left, right;
+    int left_exact, right_exact, result;
+
+    if (node->type == QUERY_TERM) {
+        *out_exact = exact[node->term];
+        return id_list_copy(&terms[node->term], out);
+    }
+    if (node->type == QUERY_NOT) {
+        if (eval_node(query, node->left, terms, exact, universe, &left, &left_exact) != 0) return -1;
+        // Sem a lista exata do filho, o complemento pode ser qualquer documento.
+        *out_exact = left_exact;
+        result = left_exact ? id_list_difference(universe, &left, out) : id_list_copy(universe, out);
+        free(left.ids);
+        return result;
+    }
+
+    if (node->type == QUERY_AND) {
+        // "a AND NOT b": a \ b, sem construir o complemento de b.
+        int negated = (query->nodes[node->right].type == QUERY_NOT) ? node->right :
+                      (query->nodes[node->left].type == QUERY_NOT) ? node->left : -1;
+        if (negated >= 0) {
+            int other = (negated == node->right) ? node->left : node->right;
+            if (eval_node(query, other, terms, exact, universe, &left, &left_exact) != 0) return -1;
+            if (eval_node(query, query->nodes[negated].left, terms, exact, universe, &right, &right_exact) != 0) {
+                free(left.ids);
+                return -1;
+            }
+            *out_exact = left_exact && right_exact;
+            result = right_exact ? id_list_difference(&left, &right, out) : id_list_copy(&left, out);
+            free(left.ids);
+            free(right.ids);
+            return result;
+        }
+    }
+
+    if (eval_node(query, node->left, terms, exact, universe, &left, &left_exact) != 0) return -1;
+    if (eval_node(query, node->right, terms, exact, universe, &right, &right_exact) != 0) {
+        free(left.ids);
+        return -1;
+    }
+    *out_exact = left_exact && right_exact;
+    result = (node->type == QUERY_AND) ? id_list_intersect(&left, &right, out) : id_list_union(&left, &right, out);
+    free(left.ids);
+    free(right.ids);
+    return result;
+}
+
+/**
+ * @brief Avalia a consulta sobre as listas de documentos de cada termo.
+ *
+ * A lista de um termo pode ser exata (os documentos que o contêm) ou apenas um superconjunto
+ * (candidatos, ex: documentos com todas as palavras de uma frase). O resultado é exato se
+ * todas as listas usadas o forem; caso contrário é um superconjunto do resultado, cujos
+ * documentos têm de ser confirmados (ver `search_query_matches`).
+ *
+ * @param terms Lista de cada termo, contida em universe.
+ * @param exact Para cada termo, 1 se a sua lista é exata.
+ * @param universe Todos os documentos considerados (complemento de NOT).
+ * @param result Recebe a lista resultante (a libertar com free).
+ * @param result_exact Recebe 1 se o resultado é exato.
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int search_query_eval_lists(const SearchQuery* query, const IdList* terms, const int* exact, const IdList* universe,
+                            IdList* result, int* result_exact) {
+    return eval_node(query, query->root, terms, exact, universe, result, result_exact);
+}
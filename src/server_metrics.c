@@ -0,0 +1,147 @@
+#include "Server_Metrics.h"
+
+static __thread MetricsShard* thread_shard = NULL; // Parte da thread atual (ver `shard_of_thread`).
+
+/**
+ * @brief Parte da thread atual; na primeira chamada de cada thread, reserva a próxima livre.
+ */
+static MetricsShard* shard_of_thread(ServerMetrics* m) {
+    if (!thread_shard) {
+        int i = __atomic_fetch_add(&m->next_shard, 1, __ATOMIC_RELAXED);
+        thread_shard = &m->shards[i < m->num_shards ? i : m->num_shards - 1];
+    }
+    return thread_shard;
+}
+
+/**
+ * @brief Posição do histograma de uma latência.
+ */
+static int bucket_of(unsigned long us) {
+    if (us < METRICS_SUB_BUCKETS) return (int)us;
+    int exponent = 63 - __builtin_clzl(us); // >= 3
+    int index = METRICS_SUB_BUCKETS * (exponent - 2) + (int)((us >> (exponent - 3)) & (METRICS_SUB_BUCKETS - 1));
+    return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+/**
+ * @brief Maior latência que cai numa posição do histograma.
+ */
+static unsigned long bucket_upper_us(int index) {
+    if (index < METRICS_SUB_BUCKETS) return (unsigned long)index;
+    int exponent = index / METRICS_SUB_BUCKETS + 2;
+    unsigned long sub = index % METRICS_SUB_BUCKETS;
+    return ((METRICS_SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+}
+
+/**
+ * @brief Cria as métricas.
+ *
+ * @param num_shards Número de partes: uma por thread que regista métricas (mais threads
+ * partilham a última, com o mesmo resultado e mais contenção).
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int server_metrics_init(ServerMetrics* m, int num_shards) {
+    memset(m, 0, sizeof(ServerMetrics));
+    m->start_us = server_metrics_now_us();
+    if (num_shards < 1) num_shards = 1;
+    m->shards = aligned_alloc(64, num_shards * sizeof(MetricsShard));
+    if (!m->shards) return -1;
+    memset(m->shards, 0, num_shards * sizeof(MetricsShard));
+    m->num_shards = num_shards;
+    return 0;
+}
+
+/**
+ * @brief Liberta as métricas (nenhuma thread pode continuar a registar).
+ */
+void server_metrics_destroy(ServerMetrics* m) {
+    free(m->shards);
+    m->shards = NULL;
+    m->num_shards = 0;
+}
+
+/**
+ * @brief Tempo do relógio monotónico, em microssegundos.
+ */
+long long server_metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Regista um pedido processado.
+ *
+ * @param operation Código da operação (fora de 0 a NUM_OPERATIONS - 1 conta como 0).
+ * @param status Estado da resposta (diferente de 0 conta como erro).
+ * @param latency_us Latência do pedido em microssegundos.
+ */
+void server_metrics_record(ServerMetrics* m, int operation, int status, long long latency_us) {
+    if (!m->shards) return;
+    MetricsShard* s = shard_of_thread(m);
+    if (operation < 0 || operation >= NUM_OPERATIONS) operation = 0;
+    unsigned long us = latency_us > 0 ? (unsigned long)latency_us : 0;
+
+    if (status != 0) __atomic_add_fetch(&s->errors[operation], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s->latency[operation][bucket_of(us)], 1, __ATOMIC_RELAXED);
+    unsigned long max = __atomic_load_n(&s->max_us[operation], __ATOMIC_RELAXED);
+    while (us > max && !__atomic_compare_exchange_n(&s->max_us[operation], &max, us, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * @brief Conta bytes de ficheiros pesquisados (chamada também pelas threads do pool de pesquisa).
+ */
+void server_metrics_add_bytes(ServerMetrics* m, long bytes) {
+    if (!m->shards || bytes <= 0) return;
+    __atomic_add_fetch(&shard_of_thread(m)->bytes_scanned, (unsigned long)bytes, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Soma as partes de todas as threads: contagens, percentis, bytes e tempo de funcionamento.
+ *
+ * Os restantes campos de `out` (caches, fila) não são alterados. As threads continuam a
+ * registar durante a soma: o resultado é aproximado por um ou outro pedido, nunca incoerente.
+ */
+void server_metrics_snapshot(ServerMetrics* m, ServerStats* out) {
+    out->uptime_ms = (long)((server_metrics_now_us() - m->start_us) / 1000);
+    out->bytes_scanned = 0;
+    if (!m->shards) return;
+
+    unsigned long histogram[METRICS_BUCKETS];
+    for (int op = 0; op < NUM_OPERATIONS; op++) {
+        OperationStats* o = &out->ops[op];
+        memset(o, 0, sizeof(OperationStats));
+        memset(histogram, 0, sizeof(histogram));
+        unsigned long total = 0;
+        for (int i = 0; i < m->num_shards; i++) {
+            MetricsShard* s = &m->shards[i];
+            o->errors += __atomic_load_n(&s->errors[op], __ATOMIC_RELAXED);
+            unsigned long max = __atomic_load_n(&s->max_us[op], __ATOMIC_RELAXED);
+            if (max > o->max_us) o->max_us = max;
+            for (int b = 0; b < METRICS_BUCKETS; b++) {
+                unsigned long n = __atomic_load_n(&s->latency[op][b], __ATOMIC_RELAXED);
+                histogram[b] += n;
+                total += n;
+            }
+        }
+        o->count = total; // Cada pedido conta numa posição do histograma.
+        if (total == 0) continue;
+
+        unsigned long* targets[3] = { &o->p50_us, &o->p95_us, &o->p99_us };
+        const unsigned long ranks[3] = { (total * 50 + 99) / 100, (total * 95 + 99) / 100, (total * 99 + 99) / 100 };
+        unsigned long seen = 0;
+        int next = 0;
+        for (int b = 0; b < METRICS_BUCKETS && next < 3; b++) {
+            seen += histogram[b];
+            while (next < 3 && seen >= ranks[next]) {
+                unsigned long upper = bucket_upper_us(b);
+                *targets[next++] = upper < o->max_us ? upper : o->max_us;
+            }
+        }
+    }
+
+    for (int i = 0; i < m->num_shards; i++) {
+        out->bytes_scanned += __atomic_load_n(&m->shards[i].bytes_scanned, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Regression test for the SEARCH_DOCS result cache: a search answered by reading the files
+# (regex or punctuation keywords) must notice a file that did not match and was then edited
+# to contain the keyword.
+# Usage: ./tests/result_cache.sh [bin_folder]
+
+BIN="$(cd "${1:-bin}" && pwd)"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+mkdir docs
+printf 'linha com foo.bar\n' > docs/a.txt
+printf 'nada aqui\n' > docs/b.txt
+
+"$BIN/dserver" docs 10 > server.log 2>&1 &
+SERVER=$!
+sleep 0.5
+
+"$BIN/dclient" -a "A" "Autor" "2000" "a.txt" > /dev/null
+"$BIN/dclient" -a "B" "Autor" "2000" "b.txt" > /dev/null
+
+failed=0
+check() {
+    local keyword="$1" expected="$2" got
+    got="$("$BIN/dclient" -s "$keyword")"
+    if [ "$got" != "$expected" ]; then
+        echo "FAIL: -s '$keyword': expected '$expected', got '$got'"
+        failed=1
+    fi
+}
+
+check 'o\.b' "[1]"
+check 'foo.bar' "[1]"
+check 'foo.bar' "[1]" # Now answered by the result cache.
+
+# b.txt did not match either search; edit it so that it matches both.
+sleep 0.01
+printf 'agora foo.bar\n' >> docs/b.txt
+check 'o\.b' "[1, 2]"
+check 'foo.bar' "[1, 2]"
+
+"$BIN/dclient" -f > /dev/null
+wait "$SERVER"
+
+if [ "$failed" -eq 0 ]; then
+    echo "result_cache: OK"
+fi
+exit "$failed"